@@ -0,0 +1,73 @@
+package org.ioex.carrier;
+
+import android.support.test.InstrumentationRegistry;
+import android.support.test.runner.AndroidJUnit4;
+import android.util.Log;
+
+import org.ioex.carrier.exceptions.IOEXException;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+
+import java.util.HashSet;
+import java.util.Set;
+
+import org.ioex.carrier.common.Synchronizer;
+import org.ioex.carrier.common.TestOptions;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertNotEquals;
+import static org.junit.Assert.assertTrue;
+
+@RunWith(AndroidJUnit4.class)
+public class MultiCarrierTest {
+	private static final String TAG = "MultiCarrierTest";
+	private static final int CARRIER_COUNT = 3;
+
+	private String getAppPath(int index) {
+		return InstrumentationRegistry.getTargetContext().getFilesDir().getAbsolutePath()
+			+ "/carrier" + index;
+	}
+
+	class TestHandler extends AbstractCarrierHandler {
+		Synchronizer synch = new Synchronizer();
+
+		public void onReady(Carrier carrier) {
+			synch.wakeup();
+		}
+	}
+
+	@Test
+	public void testMultipleCarriers() {
+		Carrier[] carriers = new Carrier[CARRIER_COUNT];
+		TestHandler[] handlers = new TestHandler[CARRIER_COUNT];
+		Set<String> userIds = new HashSet<String>();
+
+		try {
+			for (int i = 0; i < CARRIER_COUNT; i++) {
+				handlers[i] = new TestHandler();
+				carriers[i] = Carrier.createInstance(new TestOptions(getAppPath(i)), handlers[i]);
+				assertNotEquals(null, carriers[i]);
+
+				carriers[i].start(1000);
+			}
+
+			for (int i = 0; i < CARRIER_COUNT; i++) {
+				handlers[i].synch.await();
+				userIds.add(carriers[i].getUserId());
+			}
+
+			assertEquals(CARRIER_COUNT, userIds.size());
+			assertEquals(null, Carrier.getInstance());
+
+			for (int i = 0; i < CARRIER_COUNT; i++)
+				carriers[i].kill();
+
+		} catch (IOEXException e) {
+			Log.e(TAG, "test error:" + e.getErrorCode());
+			assertTrue(false);
+		} catch (Exception e) {
+			e.printStackTrace();
+			assertTrue(false);
+		}
+	}
+}
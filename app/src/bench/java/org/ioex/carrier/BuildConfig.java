@@ -45,20 +45,11 @@
 package org.ioex.carrier;
 
 /*
- * The interface to iterate each friend item in friends list.
+ * Host build replacement for the BuildConfig class generated by the Android
+ * build. Debug logging stays off so it does not distort measurements.
  */
-interface FriendsIterator {
-
-	/**
-	 * The callback function to iterate friends.
-	 *
-	 * @param
-	 * 		friendInfo		The friend information that representing a friend.
-	 * @param
-	 * 		context:		The application defined context data.
-	 *
-     * @return
-	 * 		True to continue iterate next friend user info, false to stop iteration.
-     */
-	boolean onIterated(FriendInfo friendInfo, Object context);
+public final class BuildConfig {
+    public static final boolean DEBUG = false;
+    public static final String APPLICATION_ID = "org.ioex.carrier";
+    public static final String BUILD_TYPE = "release";
 }
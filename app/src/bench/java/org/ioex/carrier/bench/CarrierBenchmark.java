@@ -0,0 +1,846 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier.bench;
+
+import java.io.File;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+
+import org.ioex.carrier.AbstractCarrierHandler;
+import org.ioex.carrier.BinaryMessageHandler;
+import org.ioex.carrier.CallbackLatencyStats;
+import org.ioex.carrier.Carrier;
+import org.ioex.carrier.DispatchStats;
+import org.ioex.carrier.FileTransfers;
+import org.ioex.carrier.FriendInfo;
+import org.ioex.carrier.FriendsSnapshot;
+import org.ioex.carrier.PresenceStatus;
+import org.ioex.carrier.session.AbstractStreamHandler;
+import org.ioex.carrier.session.ChannelQueueStats;
+import org.ioex.carrier.session.Manager;
+import org.ioex.carrier.session.Session;
+import org.ioex.carrier.session.Stream;
+import org.ioex.carrier.session.StreamStats;
+import org.ioex.carrier.session.StreamType;
+import org.ioex.carrier.session.WritabilityStreamHandler;
+
+/**
+ * Host benchmarks of the JNI binding, run against the stub libcarrier.
+ *
+ * Usage: CarrierBenchmark <case> [scale]
+ *
+ * Each case prints one result line and exits non-zero if the binding did
+ * not deliver or accept the expected amount of calls.
+ */
+public final class CarrierBenchmark {
+    private static final int PACKET_SIZE = 1024;
+    private static final int MESSAGE_SIZE = 64;
+    private static final int BATCH_SIZE = 128;
+    private static final int QUEUE_CAPACITY = 64 * 1024;
+    private static final long PACE_RATE = 16 * 1024 * 1024;
+    private static final int PACE_BURST = 64 * 1024;
+    private static final int TEXT_SIZE = 256;
+    private static final String ASCII_TEXT = "The quick brown fox jumps over the lazy dog. ";
+    private static final String MULTILINGUAL_TEXT =
+            "Gr\u00fc\u00dfe \u041f\u0440\u0438\u0432\u0435\u0442 \u4f60\u597d\u4e16\u754c "
+            + "\u3053\u3093\u306b\u3061\u306f \uc548\ub155 \ud83c\udf89\ud83d\ude00 ";
+    private static final int FRIEND_COUNT = 1000;
+    private static final int FILE_COUNT = 500;
+    private static final int CARRIER_COUNT = 8;
+    private static final long READY_TIMEOUT = 10;
+
+    private static int scale = 1;
+    private static File workDir;
+
+    private CarrierBenchmark() {}
+
+    static class Node extends AbstractCarrierHandler implements BinaryMessageHandler {
+        final CountDownLatch ready = new CountDownLatch(1);
+        final AtomicLong presences = new AtomicLong();
+        final AtomicLong messages = new AtomicLong();
+        final AtomicLong messageBytes = new AtomicLong();
+        volatile String lastMessage;
+        Carrier carrier;
+        String userId;
+        Manager manager;
+        Session session;
+
+        @Override
+        public void onReady(Carrier carrier) {
+            ready.countDown();
+        }
+
+        @Override
+        public void onFriendPresence(Carrier carrier, String friendId, PresenceStatus presence) {
+            presences.incrementAndGet();
+        }
+
+        @Override
+        public void onFriendMessage(Carrier carrier, String from, String message) {
+            lastMessage = message;
+            messages.incrementAndGet();
+        }
+
+        @Override
+        public void onFriendBinaryMessage(Carrier carrier, String from, ByteBuffer message) {
+            messages.incrementAndGet();
+            messageBytes.addAndGet(message.remaining());
+        }
+    }
+
+    static class DataHandler extends AbstractStreamHandler {
+        final AtomicLong packets = new AtomicLong();
+        final AtomicLong bytes = new AtomicLong();
+
+        @Override
+        public void onStreamData(Stream stream, byte[] data) {
+            packets.incrementAndGet();
+            bytes.addAndGet(data.length);
+        }
+
+        @Override
+        public boolean onChannelData(Stream stream, int channel, byte[] data) {
+            packets.incrementAndGet();
+            bytes.addAndGet(data.length);
+            return true;
+        }
+    }
+
+    static class QueueHandler extends DataHandler implements WritabilityStreamHandler {
+        final AtomicLong changes = new AtomicLong();
+        volatile boolean writable = true;
+
+        @Override
+        public void onChannelWritabilityChanged(Stream stream, int channel, boolean writable) {
+            this.writable = writable;
+            changes.incrementAndGet();
+        }
+    }
+
+    private static void check(boolean condition, String message) {
+        if (!condition)
+            throw new IllegalStateException(message);
+    }
+
+    private static void report(String name, long ops, long nanos, long bytes) {
+        double ms = nanos / 1e6;
+        String line = String.format("%-16s %10d ops %10.2f ms %10.1f ns/op %12.0f ops/s",
+                name, ops, ms, (double)nanos / ops, ops * 1e9 / nanos);
+        if (bytes > 0)
+            line += String.format(" %10.1f MB/s", bytes * 1e3 / nanos);
+        System.out.println(line);
+    }
+
+    private static Node startNode(int index) throws Exception {
+        return startNode(index, 0);
+    }
+
+    private static Node startNode(int index, int dispatchQueue) throws Exception {
+        return startNode(index, dispatchQueue, false);
+    }
+
+    private static Node startNode(int index, int dispatchQueue, boolean binaryMessages)
+            throws Exception {
+        File dir = new File(workDir, "carrier" + index);
+        check(dir.isDirectory() || dir.mkdirs(), "Create " + dir + " failed");
+
+        Carrier.Options options = new Carrier.Options();
+        options.setPersistentLocation(dir.getAbsolutePath());
+        options.setUdpEnabled(true);
+
+        List<Carrier.Options.BootstrapNode> nodes = new ArrayList<Carrier.Options.BootstrapNode>();
+        nodes.add(new Carrier.Options.BootstrapNode()
+                .setIpv4("127.0.0.1")
+                .setPort("33445")
+                .setPublicKey("89vny8MrKdDKs7Uta9RdVmspPjnRMdwMmaiEW27pZ7gh"));
+        options.setBootstrapNodes(nodes);
+        if (dispatchQueue > 0)
+            options.setAsyncDispatch(dispatchQueue, 1, Carrier.Options.OverflowPolicy.Block);
+        options.setBinaryMessages(binaryMessages);
+
+        Node node = new Node();
+        node.carrier = Carrier.createInstance(options, node);
+        node.userId = node.carrier.getUserId();
+        node.carrier.start(100);
+
+        check(node.ready.await(READY_TIMEOUT, TimeUnit.SECONDS), "Carrier not ready");
+        return node;
+    }
+
+    private static String addPeer(Node node) throws Exception {
+        check(StubControl.setFriends(node.userId, 1), "Set stub friends failed");
+        List<FriendInfo> friends = node.carrier.getFriends();
+        check(friends.size() == 1, "Unexpected friend count " + friends.size());
+        return friends.get(0).getUserId();
+    }
+
+    private static Stream openStream(Node node, DataHandler handler, int options) throws Exception {
+        String peerId = addPeer(node);
+
+        node.manager = Manager.getInstance(node.carrier);
+        node.session = node.manager.newSession(peerId);
+        return node.session.addStream(StreamType.Application, options, handler);
+    }
+
+    private static void stopNode(Node node) {
+        if (node.session != null)
+            node.session.close();
+        if (node.manager != null)
+            node.manager.cleanup();
+
+        node.carrier.kill();
+    }
+
+    private static void benchWriteData(boolean direct) throws Exception {
+        Node node = startNode(0);
+        try {
+            Stream stream = openStream(node, new DataHandler(), 0);
+            int count = 200000 * scale;
+            byte[] data = new byte[PACKET_SIZE];
+            ByteBuffer buffer = ByteBuffer.allocateDirect(PACKET_SIZE);
+
+            for (int i = 0; i < count / 10; i++) {
+                if (direct) {
+                    buffer.clear();
+                    stream.writeData(buffer);
+                } else {
+                    stream.writeData(data);
+                }
+            }
+
+            long before = StubControl.getBytesWritten(node.userId);
+            long start = System.nanoTime();
+            for (int i = 0; i < count; i++) {
+                if (direct) {
+                    buffer.clear();
+                    stream.writeData(buffer);
+                } else {
+                    stream.writeData(data);
+                }
+            }
+            long elapsed = System.nanoTime() - start;
+            long written = StubControl.getBytesWritten(node.userId) - before;
+
+            check(written == (long)count * PACKET_SIZE, "Stub received " + written + " bytes");
+            StreamStats stats = stream.getStats();
+            check(stats.getBytesOut() == (long)(count + count / 10) * PACKET_SIZE
+                    && stats.getWriteErrors() == 0,
+                    "Unexpected stream stats " + stats);
+            report(direct ? "writeDirect" : "writeData", count, elapsed, written);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchWriteSmall() throws Exception {
+        Node node = startNode(0);
+        try {
+            Stream stream = openStream(node, new DataHandler(), 0);
+            int count = 1000000 * scale;
+            byte[] data = new byte[MESSAGE_SIZE];
+
+            for (int i = 0; i < count / 10; i++)
+                stream.writeData(data);
+
+            long before = StubControl.getBytesWritten(node.userId);
+            long start = System.nanoTime();
+            for (int i = 0; i < count; i++)
+                stream.writeData(data);
+            long elapsed = System.nanoTime() - start;
+            long written = StubControl.getBytesWritten(node.userId) - before;
+
+            check(written == (long)count * MESSAGE_SIZE, "Stub received " + written + " bytes");
+            check(stream.getStats().getPacketsOut() == count + count / 10,
+                    "Unexpected stream stats " + stream.getStats());
+            report("writeSmall", count, elapsed, written);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchWriteBatch() throws Exception {
+        Node node = startNode(0);
+        try {
+            Stream stream = openStream(node, new DataHandler(), Stream.PROPERTY_MULTIPLEXING);
+            int[] channels = new int[BATCH_SIZE];
+            int[] offsets = new int[BATCH_SIZE];
+            int[] lengths = new int[BATCH_SIZE];
+            ByteBuffer data = ByteBuffer.allocateDirect(BATCH_SIZE * MESSAGE_SIZE);
+            int control = stream.openChannel("control");
+            int bulk = stream.openChannel("bulk");
+            int count = 10000 * scale;
+
+            for (int i = 0; i < BATCH_SIZE; i++) {
+                channels[i] = i % 8 == 0 ? control : bulk;
+                offsets[i] = i * MESSAGE_SIZE;
+                lengths[i] = MESSAGE_SIZE;
+            }
+
+            for (int i = 0; i < count / 10; i++)
+                stream.writeChannelBatch(channels, data, offsets, lengths);
+
+            long before = StubControl.getBytesWritten(node.userId);
+            long start = System.nanoTime();
+            for (int i = 0; i < count; i++) {
+                int[] written = stream.writeChannelBatch(channels, data, offsets, lengths);
+                check(written.length == BATCH_SIZE, "Batch stopped after " + written.length);
+            }
+            long elapsed = System.nanoTime() - start;
+            long written = StubControl.getBytesWritten(node.userId) - before;
+
+            check(written == (long)count * BATCH_SIZE * MESSAGE_SIZE,
+                    "Stub received " + written + " bytes");
+            report("writeBatch", (long)count * BATCH_SIZE, elapsed, written);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchQueuedWrite() throws Exception {
+        Node node = startNode(0);
+        try {
+            QueueHandler handler = new QueueHandler();
+            Stream stream = openStream(node, handler, Stream.PROPERTY_MULTIPLEXING);
+            int channel = stream.openChannel("bulk");
+            int streamId = stream.getStreamId();
+            int count = 200000 * scale;
+            byte[] data = new byte[MESSAGE_SIZE];
+
+            stream.setSendQueue(QUEUE_CAPACITY, QUEUE_CAPACITY / 4, QUEUE_CAPACITY / 2);
+            check(StubControl.fireChannelPending(node.userId, streamId, channel) >= 0,
+                    "Fire channel pending failed");
+            check(StubControl.setWriteWindow(node.userId, 0), "Set write window failed");
+
+            // The transport takes an eighth of the queue per resume, so the
+            // channel keeps swinging between the two watermarks.
+            long start = System.nanoTime();
+            for (int i = 0; i < count; i++) {
+                while (!handler.writable) {
+                    StubControl.setWriteWindow(node.userId, QUEUE_CAPACITY / 8);
+                    check(StubControl.fireChannelResume(node.userId, streamId, channel) >= 0,
+                            "Fire channel resume failed");
+                }
+                stream.writeData(channel, data);
+            }
+
+            check(StubControl.setWriteWindow(node.userId, -1), "Set write window failed");
+            check(StubControl.fireChannelResume(node.userId, streamId, channel) >= 0,
+                    "Fire channel resume failed");
+            long elapsed = System.nanoTime() - start;
+            long written = StubControl.getBytesWritten(node.userId);
+
+            check(written == (long)count * MESSAGE_SIZE, "Stub received " + written + " bytes");
+            check(stream.getQueuedBytes(channel) == 0 && handler.writable
+                    && handler.changes.get() > 0,
+                    "Queue not drained, " + handler.changes.get() + " writability changes");
+            StreamStats stats = stream.getStats();
+            check(stats.getQueuedWrites() > 0 && stats.getWriteErrors() == 0,
+                    "Unexpected stream stats " + stats);
+            report("queuedWrite", count, elapsed, written);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchScheduledWrite() throws Exception {
+        Node node = startNode(0);
+        try {
+            QueueHandler handler = new QueueHandler();
+            Stream stream = openStream(node, handler, Stream.PROPERTY_MULTIPLEXING);
+            int control = stream.openChannel("control");
+            int bulk = stream.openChannel("bulk");
+            int streamId = stream.getStreamId();
+            int count = 100000 * scale;
+            int messages = (count + 15) / 16;
+            byte[] message = new byte[MESSAGE_SIZE];
+            byte[] packet = new byte[PACKET_SIZE];
+
+            stream.setSendQueue(QUEUE_CAPACITY, QUEUE_CAPACITY / 4, QUEUE_CAPACITY / 2);
+            stream.setChannelPriority(control, 1, 1);
+            check(StubControl.setWriteWindow(node.userId, 0), "Set write window failed");
+
+            // Bulk packets keep the transport congested while every 16th
+            // iteration sends a control message that should not queue behind them.
+            long start = System.nanoTime();
+            for (int i = 0; i < count; i++) {
+                while (!handler.writable) {
+                    StubControl.setWriteWindow(node.userId, QUEUE_CAPACITY / 8);
+                    check(StubControl.fireChannelResume(node.userId, streamId, bulk) >= 0,
+                            "Fire channel resume failed");
+                }
+                stream.writeData(bulk, packet);
+                if (i % 16 == 0)
+                    stream.writeData(control, message);
+            }
+
+            check(StubControl.setWriteWindow(node.userId, -1), "Set write window failed");
+            check(StubControl.fireChannelResume(node.userId, streamId, bulk) >= 0,
+                    "Fire channel resume failed");
+            long elapsed = System.nanoTime() - start;
+            long written = StubControl.getBytesWritten(node.userId);
+            long expected = (long)count * PACKET_SIZE + (long)messages * MESSAGE_SIZE;
+
+            check(written == expected, "Stub received " + written + " bytes");
+            ChannelQueueStats controlStats = stream.getChannelQueueStats(control);
+            ChannelQueueStats bulkStats = stream.getChannelQueueStats(bulk);
+            check(controlStats.getFrames() == messages && bulkStats.getFrames() == count,
+                    "Unexpected frame counts " + controlStats + " " + bulkStats);
+            check(controlStats.getAverageDelayNanos() < bulkStats.getAverageDelayNanos(),
+                    "Control waited longer than bulk " + controlStats + " " + bulkStats);
+            report("scheduledWrite", count + messages, elapsed, written);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchPacedWrite() throws Exception {
+        Node node = startNode(0);
+        try {
+            QueueHandler handler = new QueueHandler();
+            Stream stream = openStream(node, handler, 0);
+            int count = 4096 * scale;
+            byte[] packet = new byte[PACKET_SIZE];
+
+            // The process wide limit is the tighter one, so both are in play.
+            stream.setSendQueue(QUEUE_CAPACITY, QUEUE_CAPACITY / 4, QUEUE_CAPACITY / 2);
+            stream.setRateLimit(PACE_RATE * 2, PACE_BURST);
+            Stream.setGlobalRateLimit(PACE_RATE, PACE_BURST);
+
+            // The writer only ever waits for writability; the native pacer
+            // sends what the limits hold back as their tokens refill.
+            long start = System.nanoTime();
+            for (int i = 0; i < count; i++) {
+                while (!handler.writable)
+                    Thread.sleep(1);
+                stream.writeData(packet);
+            }
+            while (stream.getQueuedBytes(0) > 0)
+                Thread.sleep(1);
+            long elapsed = System.nanoTime() - start;
+            long written = StubControl.getBytesWritten(node.userId);
+            long expected = (long)count * PACKET_SIZE;
+            long floor = (expected - PACE_BURST) * 1000000000L / PACE_RATE;
+
+            check(written == expected, "Stub received " + written + " bytes");
+            check(elapsed >= floor * 9 / 10, "Sent " + written + " bytes in " + elapsed
+                    + " ns, faster than the rate limit");
+            ChannelQueueStats stats = stream.getChannelQueueStats(0);
+            check(stats.getFrames() == count && stats.getThrottledNanos() > 0,
+                    "Unexpected queue stats " + stats);
+            report("pacedWrite", count, elapsed, written);
+        } finally {
+            Stream.setGlobalRateLimit(0, 0);
+            stopNode(node);
+        }
+    }
+
+    private static void benchStreamData(boolean channel) throws Exception {
+        Node node = startNode(0);
+        try {
+            DataHandler handler = new DataHandler();
+            Stream stream = openStream(node, handler,
+                    channel ? Stream.PROPERTY_MULTIPLEXING : 0);
+            int channelId = channel ? stream.openChannel("bench") : 0;
+            int count = 200000 * scale;
+            long elapsed;
+
+            if (channel) {
+                check(StubControl.fireChannelData(node.userId, stream.getStreamId(), channelId,
+                        PACKET_SIZE, count / 10) >= 0, "Fire channel data failed");
+                handler.packets.set(0);
+                elapsed = StubControl.fireChannelData(node.userId, stream.getStreamId(), channelId,
+                        PACKET_SIZE, count);
+            } else {
+                check(StubControl.fireStreamData(node.userId, stream.getStreamId(),
+                        PACKET_SIZE, count / 10) >= 0, "Fire stream data failed");
+                handler.packets.set(0);
+                elapsed = StubControl.fireStreamData(node.userId, stream.getStreamId(),
+                        PACKET_SIZE, count);
+            }
+
+            check(elapsed > 0, "Fire data failed");
+            check(handler.packets.get() == count, "Delivered " + handler.packets.get() + " packets");
+            StreamStats stats = node.session.getStats();
+            check(stats.getPacketsIn() == count + count / 10, "Unexpected session stats " + stats);
+            report(channel ? "channelData" : "streamData", count, elapsed, (long)count * PACKET_SIZE);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchFriendIteration() throws Exception {
+        Node node = startNode(0);
+        try {
+            int rounds = 200 * scale;
+            check(StubControl.setFriends(node.userId, FRIEND_COUNT), "Set stub friends failed");
+
+            for (int i = 0; i < rounds / 10; i++)
+                node.carrier.getFriendsSnapshot();
+
+            long start = System.nanoTime();
+            for (int i = 0; i < rounds; i++) {
+                FriendsSnapshot friends = node.carrier.getFriendsSnapshot();
+                check(friends.size() == FRIEND_COUNT, "Iterated " + friends.size() + " friends");
+                for (int j = 0; j < friends.size(); j++)
+                    check(friends.getUserId(j).length() > 0, "Empty friend id");
+            }
+            long elapsed = System.nanoTime() - start;
+
+            report("friendIteration", (long)rounds * FRIEND_COUNT, elapsed, 0);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchFileTransfers() throws Exception {
+        Node node = startNode(0);
+        try {
+            int rounds = 200 * scale;
+            check(StubControl.setFiles(node.userId, FILE_COUNT), "Set stub files failed");
+
+            for (int i = 0; i < rounds / 10; i++)
+                node.carrier.getFileTransfers();
+
+            long start = System.nanoTime();
+            for (int i = 0; i < rounds; i++) {
+                FileTransfers transfers = node.carrier.getFileTransfers();
+                check(transfers.size() == FILE_COUNT, "Polled " + transfers.size() + " transfers");
+                for (int j = 0; j < transfers.size(); j++)
+                    check(transfers.getTransferredSize(j) <= transfers.getFileSize(j)
+                            && transfers.getStatus(j) != FileTransfers.STATUS_NONE,
+                            "Bad status of file " + transfers.getFileId(j));
+            }
+            long elapsed = System.nanoTime() - start;
+
+            report("fileTransfers", (long)rounds * FILE_COUNT, elapsed, 0);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchPresence() throws Exception {
+        Node node = startNode(0);
+        try {
+            int count = 200000 * scale;
+            check(StubControl.setFriends(node.userId, 1), "Set stub friends failed");
+
+            check(StubControl.firePresence(node.userId, count / 10) >= 0, "Fire presence failed");
+            node.presences.set(0);
+
+            long elapsed = StubControl.firePresence(node.userId, count);
+            check(elapsed > 0, "Fire presence failed");
+            check(node.presences.get() == count, "Delivered " + node.presences.get() + " callbacks");
+
+            CallbackLatencyStats latency = Carrier.getCallbackLatencyStats();
+            int presence = latency.indexOf("onFriendPresence");
+            check(presence >= 0 && latency.getCount(presence) >= count + count / 10,
+                    "Unexpected callback latency stats " + latency);
+
+            report("presence", count, elapsed, 0);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchFriendMessage(boolean binary) throws Exception {
+        Node node = startNode(0, 0, binary);
+        try {
+            int count = 200000 * scale;
+            check(StubControl.setFriends(node.userId, 1), "Set stub friends failed");
+
+            check(StubControl.fireFriendMessage(node.userId, MESSAGE_SIZE, count / 10) >= 0,
+                    "Fire friend message failed");
+            node.messages.set(0);
+            node.messageBytes.set(0);
+
+            long elapsed = StubControl.fireFriendMessage(node.userId, MESSAGE_SIZE, count);
+            check(elapsed > 0, "Fire friend message failed");
+            check(node.messages.get() == count, "Delivered " + node.messages.get() + " messages");
+            if (binary) {
+                long bytes = node.messageBytes.get();
+                check(bytes == (long)count * MESSAGE_SIZE, "Delivered " + bytes + " message bytes");
+            }
+
+            report(binary ? "binaryMessage" : "friendMessage", count, elapsed,
+                    (long)count * MESSAGE_SIZE);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    // Repeats seed up to TEXT_SIZE bytes of UTF-8 without splitting a character.
+    private static String makeText(String seed) throws Exception {
+        StringBuilder text = new StringBuilder();
+        int bytes = 0;
+
+        for (int i = 0; ; i = seed.offsetByCodePoints(i, 1) % seed.length()) {
+            String ch = new String(Character.toChars(seed.codePointAt(i)));
+            int size = ch.getBytes("UTF-8").length;
+            if (bytes + size > TEXT_SIZE)
+                break;
+            text.append(ch);
+            bytes += size;
+        }
+        return text.toString();
+    }
+
+    private static void benchTextMessage(Node node, String name, String text) throws Exception {
+        byte[] utf8 = text.getBytes("UTF-8");
+        int count = 200000 * scale;
+
+        check(StubControl.fireTextMessage(node.userId, utf8, count / 10) >= 0,
+                "Fire text message failed");
+        node.messages.set(0);
+
+        long elapsed = StubControl.fireTextMessage(node.userId, utf8, count);
+        check(elapsed > 0, "Fire text message failed");
+        check(node.messages.get() == count, "Delivered " + node.messages.get() + " messages");
+        check(text.equals(node.lastMessage), "Decoded message mismatch: " + node.lastMessage);
+
+        report(name, count, elapsed, (long)count * utf8.length);
+    }
+
+    private static void benchUtf8Message() throws Exception {
+        Node node = startNode(0);
+        try {
+            check(StubControl.setFriends(node.userId, 1), "Set stub friends failed");
+
+            benchTextMessage(node, "utf8Ascii", makeText(ASCII_TEXT));
+            benchTextMessage(node, "utf8Multilingual", makeText(MULTILINGUAL_TEXT));
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchAsyncFriendMessage() throws Exception {
+        Node node = startNode(0, 4096);
+        try {
+            int count = 200000 * scale;
+            check(StubControl.setFriends(node.userId, 1), "Set stub friends failed");
+
+            check(StubControl.fireFriendMessage(node.userId, MESSAGE_SIZE, count / 10) >= 0,
+                    "Fire friend message failed");
+            long deadline = System.nanoTime() + TimeUnit.SECONDS.toNanos(READY_TIMEOUT);
+            while (node.messages.get() < count / 10 && System.nanoTime() < deadline)
+                Thread.sleep(1);
+            node.messages.set(0);
+
+            // Time spent on the carrier thread, then until java saw every message.
+            long start = System.nanoTime();
+            long elapsed = StubControl.fireFriendMessage(node.userId, MESSAGE_SIZE, count);
+            check(elapsed > 0, "Fire friend message failed");
+
+            deadline = System.nanoTime() + TimeUnit.SECONDS.toNanos(READY_TIMEOUT);
+            while (node.messages.get() < count && System.nanoTime() < deadline)
+                Thread.sleep(1);
+            long total = System.nanoTime() - start;
+            check(node.messages.get() == count, "Delivered " + node.messages.get() + " messages");
+
+            DispatchStats stats = node.carrier.getDispatchStats();
+            check(stats.getDroppedCount() == 0, "Dropped " + stats.getDroppedCount() + " events");
+
+            report("asyncMsgPost", count, elapsed, (long)count * MESSAGE_SIZE);
+            report("asyncMsgDeliver", count, total, (long)count * MESSAGE_SIZE);
+            System.out.println(stats);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchSendMessage() throws Exception {
+        Node node = startNode(0);
+        try {
+            String peerId = addPeer(node);
+            int count = 200000 * scale;
+            char[] chars = new char[MESSAGE_SIZE];
+            Arrays.fill(chars, 'm');
+            String message = new String(chars);
+
+            for (int i = 0; i < count / 10; i++)
+                node.carrier.sendFriendMessage(peerId, message);
+
+            long before = StubControl.getBytesWritten(node.userId);
+            long start = System.nanoTime();
+            for (int i = 0; i < count; i++)
+                node.carrier.sendFriendMessage(peerId, message);
+            long elapsed = System.nanoTime() - start;
+            long written = StubControl.getBytesWritten(node.userId) - before;
+
+            // Messages go out NUL terminated.
+            check(written == (long)count * (MESSAGE_SIZE + 1), "Stub received " + written + " bytes");
+            report("sendMessage", count, elapsed, written);
+        } finally {
+            stopNode(node);
+        }
+    }
+
+    private static void benchMultiCarrier() throws Exception {
+        final Node[] nodes = new Node[CARRIER_COUNT];
+        final int count = 20000 * scale;
+        Thread[] threads = new Thread[CARRIER_COUNT];
+        final long[] elapsed = new long[CARRIER_COUNT];
+
+        try {
+            for (int i = 0; i < CARRIER_COUNT; i++) {
+                nodes[i] = startNode(i);
+                check(StubControl.setFriends(nodes[i].userId, 1), "Set stub friends failed");
+            }
+
+            for (int i = 0; i < CARRIER_COUNT; i++) {
+                final int index = i;
+                threads[i] = new Thread() {
+                    @Override
+                    public void run() {
+                        elapsed[index] = StubControl.firePresence(nodes[index].userId, count);
+                    }
+                };
+            }
+
+            long start = System.nanoTime();
+            for (Thread thread : threads)
+                thread.start();
+            for (Thread thread : threads)
+                thread.join();
+            long total = System.nanoTime() - start;
+
+            for (int i = 0; i < CARRIER_COUNT; i++) {
+                check(elapsed[i] > 0, "Fire presence on carrier " + i + " failed");
+                check(nodes[i].presences.get() == count,
+                        "Carrier " + i + " got " + nodes[i].presences.get() + " callbacks");
+            }
+
+            report("multiCarrier", (long)count * CARRIER_COUNT, total, 0);
+        } finally {
+            for (Node node : nodes) {
+                if (node != null)
+                    stopNode(node);
+            }
+        }
+
+        check(StubControl.getLiveCarriers() == 0,
+                StubControl.getLiveCarriers() + " carriers left after kill");
+    }
+
+    private static void deleteAll(File file) {
+        File[] children = file.listFiles();
+        if (children != null) {
+            for (File child : children)
+                deleteAll(child);
+        }
+        file.delete();
+    }
+
+    public static void main(String[] args) {
+        if (args.length < 1) {
+            System.err.println("Usage: CarrierBenchmark <writeData|writeDirect|writeSmall|writeBatch|"
+                    + "queuedWrite|scheduledWrite|pacedWrite|streamData|channelData|friendIteration|"
+                    + "fileTransfers|presence|friendMessage|binaryMessage|utf8Message|"
+                    + "asyncFriendMessage|sendMessage|multiCarrier> [scale]");
+            System.exit(2);
+        }
+
+        if (args.length > 1)
+            scale = Math.max(1, Integer.parseInt(args[1]));
+
+        int rc = 0;
+        try {
+            workDir = File.createTempFile("carrierbench", "");
+            check(workDir.delete() && workDir.mkdir(), "Create work directory failed");
+
+            String name = args[0];
+            if (name.equals("writeData"))
+                benchWriteData(false);
+            else if (name.equals("writeDirect"))
+                benchWriteData(true);
+            else if (name.equals("writeSmall"))
+                benchWriteSmall();
+            else if (name.equals("writeBatch"))
+                benchWriteBatch();
+            else if (name.equals("queuedWrite"))
+                benchQueuedWrite();
+            else if (name.equals("scheduledWrite"))
+                benchScheduledWrite();
+            else if (name.equals("pacedWrite"))
+                benchPacedWrite();
+            else if (name.equals("streamData"))
+                benchStreamData(false);
+            else if (name.equals("channelData"))
+                benchStreamData(true);
+            else if (name.equals("friendIteration"))
+                benchFriendIteration();
+            else if (name.equals("fileTransfers"))
+                benchFileTransfers();
+            else if (name.equals("presence"))
+                benchPresence();
+            else if (name.equals("friendMessage"))
+                benchFriendMessage(false);
+            else if (name.equals("binaryMessage"))
+                benchFriendMessage(true);
+            else if (name.equals("utf8Message"))
+                benchUtf8Message();
+            else if (name.equals("asyncFriendMessage"))
+                benchAsyncFriendMessage();
+            else if (name.equals("sendMessage"))
+                benchSendMessage();
+            else if (name.equals("multiCarrier"))
+                benchMultiCarrier();
+            else
+                throw new IllegalArgumentException("Unknown benchmark " + name);
+        } catch (Exception e) {
+            e.printStackTrace();
+            rc = 1;
+        } finally {
+            if (workDir != null)
+                deleteAll(workDir);
+        }
+
+        System.exit(rc);
+    }
+}
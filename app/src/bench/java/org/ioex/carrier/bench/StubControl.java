@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier.bench;
+
+/*
+ * Control interface of the stub libcarrier. Every fire method drives the
+ * given number of callbacks through the binding and returns the time spent
+ * in nanoseconds, or -1 on failure.
+ */
+final class StubControl {
+    static {
+        System.loadLibrary("carrierstub");
+    }
+
+    private StubControl() {}
+
+    private static native boolean set_friends(String userId, int count);
+    private static native boolean set_files(String userId, int count);
+    private static native long fire_presence(String userId, int count);
+    private static native long fire_friend_message(String userId, int length, int count);
+    private static native long fire_text_message(String userId, byte[] text, int count);
+    private static native long fire_stream_data(String userId, int streamId, int length, int count);
+    private static native long fire_channel_data(String userId, int streamId, int channel, int length, int count);
+    private static native long fire_channel_flow(String userId, int streamId, int channel, boolean resume);
+    private static native boolean set_write_window(String userId, long bytes);
+    private static native long get_bytes_written(String userId);
+    private static native int get_live_carriers();
+
+    static boolean setFriends(String userId, int count) {
+        return set_friends(userId, count);
+    }
+
+    static boolean setFiles(String userId, int count) {
+        return set_files(userId, count);
+    }
+
+    static long firePresence(String userId, int count) {
+        return fire_presence(userId, count);
+    }
+
+    static long fireFriendMessage(String userId, int length, int count) {
+        return fire_friend_message(userId, length, count);
+    }
+
+    static long fireTextMessage(String userId, byte[] text, int count) {
+        return fire_text_message(userId, text, count);
+    }
+
+    static long fireStreamData(String userId, int streamId, int length, int count) {
+        return fire_stream_data(userId, streamId, length, count);
+    }
+
+    static long fireChannelData(String userId, int streamId, int channel, int length, int count) {
+        return fire_channel_data(userId, streamId, channel, length, count);
+    }
+
+    static long fireChannelPending(String userId, int streamId, int channel) {
+        return fire_channel_flow(userId, streamId, channel, false);
+    }
+
+    static long fireChannelResume(String userId, int streamId, int channel) {
+        return fire_channel_flow(userId, streamId, channel, true);
+    }
+
+    static boolean setWriteWindow(String userId, long bytes) {
+        return set_write_window(userId, bytes);
+    }
+
+    static long getBytesWritten(String userId) {
+        return get_bytes_written(userId);
+    }
+
+    static int getLiveCarriers() {
+        return get_live_carriers();
+    }
+}
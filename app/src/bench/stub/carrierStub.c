@@ -0,0 +1,1821 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/*
+ * A stand-in for libcarrier used by the host benchmark harness. It keeps
+ * every node in process memory, never touches the network and reports
+ * itself connected and ready as soon as IOEX_run() is entered. Callbacks
+ * are only produced when the harness asks for them through carrierStub.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "carrierStub.h"
+
+#define STUB_KEY_LEN            32
+
+enum {
+    StubJob_Presence = 1,
+    StubJob_FriendMessage
+};
+
+typedef struct StubJob {
+    struct StubJob* next;
+    int type;
+    const void* data;
+    size_t len;
+    int count;
+    int done;
+    int64_t elapsed;
+} StubJob;
+
+typedef struct StubStream {
+    struct StubStream* next;
+    IOEXSession* session;
+    int id;
+    IOEXStreamType type;
+    int options;
+    IOEXStreamCallbacks callbacks;
+    void* context;
+    int nextChannel;
+    int nextPortForwarding;
+} StubStream;
+
+struct IOEXSession {
+    IOEXCarrier* carrier;
+    char peer[IOEX_MAX_ADDRESS_LEN + 1];
+    void* userdata;
+};
+
+struct IOEXCarrier {
+    IOEXCarrier* next;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    IOEXCallbacks callbacks;
+    void* context;
+    IOEXSessionRequestCallback* sessionCallback;
+    void* sessionContext;
+
+    uint8_t key[STUB_KEY_LEN];
+    uint32_t nospam;
+    char userid[IOEX_MAX_ID_LEN + 1];
+    char address[IOEX_MAX_ADDRESS_LEN + 1];
+    IOEXUserInfo selfInfo;
+    IOEXPresenceStatus presence;
+
+    IOEXFriendInfo* friends;
+    int friendCount;
+
+    IOEXFileInfo* files;
+    int fileCount;
+
+    StubStream* streams;
+    int nextStreamId;
+
+    StubJob* jobHead;
+    StubJob* jobTail;
+
+    int running;
+    int ready;
+    int stopped;
+    int freeOnExit;
+    pthread_t runThread;
+
+    int64_t bytesWritten;
+
+    /* Bytes stream writes may still take, or -1 for no limit */
+    int64_t writeWindow;
+};
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static IOEXCarrier* gCarriers;
+static int gLiveCarriers;
+static uint64_t gSeed;
+
+static __thread int tErrorCode;
+
+static const char base58Alphabet[] =
+        "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+static
+void setError(int code)
+{
+    tErrorCode = IOEX_GENERAL_ERROR(code);
+}
+
+static
+int64_t nowNanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static
+void randomBytes(uint8_t* data, size_t len)
+{
+    uint64_t x;
+    size_t i;
+
+    x = __atomic_add_fetch(&gSeed, 0x9E3779B97F4A7C15ULL, __ATOMIC_RELAXED);
+    x ^= (uint64_t)nowNanos();
+
+    for (i = 0; i < len; i++) {
+        uint64_t z;
+
+        x += 0x9E3779B97F4A7C15ULL;
+        z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        data[i] = (uint8_t)(z ^ (z >> 31));
+    }
+}
+
+static
+void base58Encode(const uint8_t* data, size_t len, char* out, size_t outLen)
+{
+    uint8_t digits[80];
+    size_t ndigits = 0;
+    size_t zeros = 0;
+    size_t n = 0;
+    size_t i, j;
+
+    while (zeros < len && !data[zeros])
+        zeros++;
+
+    for (i = zeros; i < len; i++) {
+        int carry = data[i];
+
+        for (j = 0; j < ndigits; j++) {
+            carry += digits[j] << 8;
+            digits[j] = (uint8_t)(carry % 58);
+            carry /= 58;
+        }
+
+        while (carry && ndigits < sizeof(digits)) {
+            digits[ndigits++] = (uint8_t)(carry % 58);
+            carry /= 58;
+        }
+    }
+
+    for (i = 0; i < zeros && n + 1 < outLen; i++)
+        out[n++] = '1';
+    for (i = ndigits; i > 0 && n + 1 < outLen; i--)
+        out[n++] = base58Alphabet[digits[i - 1]];
+    out[n] = 0;
+}
+
+static
+void randomId(char* id, size_t len)
+{
+    uint8_t key[STUB_KEY_LEN];
+
+    randomBytes(key, sizeof(key));
+    base58Encode(key, sizeof(key), id, len);
+}
+
+static
+void makeAddress(IOEXCarrier* c)
+{
+    uint8_t addr[STUB_KEY_LEN + 6];
+    uint16_t checksum = 0;
+    int i;
+
+    memcpy(addr, c->key, STUB_KEY_LEN);
+    memcpy(addr + STUB_KEY_LEN, &c->nospam, sizeof(c->nospam));
+    for (i = 0; i < STUB_KEY_LEN + 4; i += 2)
+        checksum ^= (uint16_t)(addr[i] | (addr[i + 1] << 8));
+    memcpy(addr + STUB_KEY_LEN + 4, &checksum, sizeof(checksum));
+
+    base58Encode(addr, sizeof(addr), c->address, sizeof(c->address));
+}
+
+static
+IOEXCarrier* findCarrier(const char* userId)
+{
+    IOEXCarrier* c;
+
+    pthread_mutex_lock(&gLock);
+    for (c = gCarriers; c; c = c->next) {
+        if (!strcmp(c->userid, userId))
+            break;
+    }
+    pthread_mutex_unlock(&gLock);
+
+    return c;
+}
+
+static
+StubStream* findStream(IOEXCarrier* c, int id)
+{
+    StubStream* s;
+
+    for (s = c->streams; s; s = s->next) {
+        if (s->id == id)
+            return s;
+    }
+    return NULL;
+}
+
+static
+void destroyCarrier(IOEXCarrier* c)
+{
+    IOEXCarrier** pp;
+
+    pthread_mutex_lock(&gLock);
+    for (pp = &gCarriers; *pp; pp = &(*pp)->next) {
+        if (*pp == c) {
+            *pp = c->next;
+            gLiveCarriers--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+
+    while (c->streams) {
+        StubStream* s = c->streams;
+        c->streams = s->next;
+        free(s);
+    }
+
+    free(c->friends);
+    free(c->files);
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+/* Global APIs */
+
+int IOEX_get_error(void)
+{
+    return tErrorCode;
+}
+
+void IOEX_clear_error(void)
+{
+    tErrorCode = IOEXSUCCESS;
+}
+
+void IOEX_log_init(IOEXLogLevel level, const char *log_file,
+                   void (*log_printer)(const char *format, va_list args))
+{
+    (void)level;
+    (void)log_file;
+    (void)log_printer;
+}
+
+IOEXCarrier *IOEX_new(const IOEXOptions *options, IOEXCallbacks *callbacks,
+                      void *context)
+{
+    IOEXCarrier* c;
+
+    if (!options || !options->persistent_location) {
+        setError(IOEXERR_INVALID_ARGS);
+        return NULL;
+    }
+
+    c = (IOEXCarrier*)calloc(1, sizeof(*c));
+    if (!c) {
+        setError(IOEXERR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+
+    if (callbacks)
+        c->callbacks = *callbacks;
+    c->context = context;
+
+    randomBytes(c->key, sizeof(c->key));
+    randomBytes((uint8_t*)&c->nospam, sizeof(c->nospam));
+    base58Encode(c->key, sizeof(c->key), c->userid, sizeof(c->userid));
+    makeAddress(c);
+
+    strcpy(c->selfInfo.userid, c->userid);
+    c->presence = IOEXPresenceStatus_None;
+    c->nextStreamId = 1;
+    c->writeWindow = -1;
+
+    pthread_mutex_lock(&gLock);
+    c->next = gCarriers;
+    gCarriers = c;
+    gLiveCarriers++;
+    pthread_mutex_unlock(&gLock);
+
+    return c;
+}
+
+static
+void runJob(IOEXCarrier* c, StubJob* job)
+{
+    char friendId[IOEX_MAX_ID_LEN + 1];
+    uint8_t* data = NULL;
+    int64_t start;
+    int i;
+
+    pthread_mutex_lock(&c->lock);
+    strcpy(friendId, c->friendCount > 0 ? c->friends[0].user_info.userid : c->userid);
+    pthread_mutex_unlock(&c->lock);
+
+    if (job->type == StubJob_FriendMessage && !job->data) {
+        data = (uint8_t*)malloc(job->len ? job->len : 1);
+        if (!data) {
+            job->elapsed = -1;
+            return;
+        }
+        for (i = 0; i < (int)job->len; i++)
+            data[i] = (uint8_t)('a' + i % 26);
+    }
+
+    start = nowNanos();
+    for (i = 0; i < job->count; i++) {
+        switch (job->type) {
+        case StubJob_Presence:
+            if (c->callbacks.friend_presence)
+                c->callbacks.friend_presence(c, friendId,
+                        (IOEXPresenceStatus)(i % 3), c->context);
+            break;
+        case StubJob_FriendMessage:
+            if (c->callbacks.friend_message)
+                c->callbacks.friend_message(c, friendId, job->data ? job->data : data, job->len,
+                                            c->context);
+            break;
+        }
+    }
+    job->elapsed = nowNanos() - start;
+
+    free(data);
+}
+
+static
+void deliverFriendList(IOEXCarrier* c)
+{
+    IOEXFriendInfo* friends = NULL;
+    int count;
+    int i;
+
+    if (!c->callbacks.friend_list)
+        return;
+
+    pthread_mutex_lock(&c->lock);
+    count = c->friendCount;
+    if (count > 0) {
+        friends = (IOEXFriendInfo*)malloc(sizeof(*friends) * count);
+        if (friends)
+            memcpy(friends, c->friends, sizeof(*friends) * count);
+        else
+            count = 0;
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    for (i = 0; i < count; i++) {
+        if (!c->callbacks.friend_list(c, &friends[i], c->context))
+            break;
+    }
+    c->callbacks.friend_list(c, NULL, c->context);
+
+    free(friends);
+}
+
+int IOEX_run(IOEXCarrier *carrier, int interval)
+{
+    IOEXCarrier* c = carrier;
+    int freeOnExit;
+
+    if (!c || interval < 0) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    if (interval == 0)
+        interval = 1000;
+
+    pthread_mutex_lock(&c->lock);
+    if (c->running || c->stopped) {
+        pthread_mutex_unlock(&c->lock);
+        setError(c->running ? IOEXERR_ALREADY_RUN : IOEXERR_WRONG_STATE);
+        return -1;
+    }
+    c->running = 1;
+    c->runThread = pthread_self();
+    pthread_mutex_unlock(&c->lock);
+
+    if (c->callbacks.connection_status)
+        c->callbacks.connection_status(c, IOEXConnectionStatus_Connected, c->context);
+
+    deliverFriendList(c);
+
+    pthread_mutex_lock(&c->lock);
+    c->ready = 1;
+    pthread_mutex_unlock(&c->lock);
+
+    if (c->callbacks.ready)
+        c->callbacks.ready(c, c->context);
+
+    pthread_mutex_lock(&c->lock);
+    while (!c->stopped) {
+        StubJob* job = c->jobHead;
+        struct timespec deadline;
+
+        if (job) {
+            c->jobHead = job->next;
+            if (!c->jobHead)
+                c->jobTail = NULL;
+            pthread_mutex_unlock(&c->lock);
+
+            runJob(c, job);
+
+            pthread_mutex_lock(&c->lock);
+            job->done = 1;
+            pthread_cond_broadcast(&c->cond);
+            continue;
+        }
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += interval / 1000;
+        deadline.tv_nsec += (long)(interval % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        if (pthread_cond_timedwait(&c->cond, &c->lock, &deadline) == ETIMEDOUT &&
+                !c->stopped && !c->jobHead && c->callbacks.idle) {
+            pthread_mutex_unlock(&c->lock);
+            c->callbacks.idle(c, c->context);
+            pthread_mutex_lock(&c->lock);
+        }
+    }
+
+    while (c->jobHead) {
+        StubJob* job = c->jobHead;
+        c->jobHead = job->next;
+        job->elapsed = -1;
+        job->done = 1;
+    }
+    c->jobTail = NULL;
+
+    c->running = 0;
+    c->ready = 0;
+    freeOnExit = c->freeOnExit;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+
+    if (freeOnExit)
+        destroyCarrier(c);
+
+    return 0;
+}
+
+void IOEX_kill(IOEXCarrier *carrier)
+{
+    IOEXCarrier* c = carrier;
+
+    if (!c)
+        return;
+
+    pthread_mutex_lock(&c->lock);
+    c->stopped = 1;
+    pthread_cond_broadcast(&c->cond);
+
+    if (c->running && pthread_equal(c->runThread, pthread_self())) {
+        c->freeOnExit = 1;
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+
+    while (c->running)
+        pthread_cond_wait(&c->cond, &c->lock);
+    pthread_mutex_unlock(&c->lock);
+
+    destroyCarrier(c);
+}
+
+/* Node information */
+
+static
+char* copyString(const char* src, char* buf, size_t len)
+{
+    if (!buf) {
+        setError(IOEXERR_INVALID_ARGS);
+        return NULL;
+    }
+
+    if (strlen(src) >= len) {
+        setError(IOEXERR_BUFFER_TOO_SMALL);
+        return NULL;
+    }
+
+    strcpy(buf, src);
+    return buf;
+}
+
+char *IOEX_get_address(IOEXCarrier *carrier, char *address, size_t len)
+{
+    char* rc;
+
+    if (!carrier) {
+        setError(IOEXERR_INVALID_ARGS);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    rc = copyString(carrier->address, address, len);
+    pthread_mutex_unlock(&carrier->lock);
+
+    return rc;
+}
+
+char *IOEX_get_nodeid(IOEXCarrier *carrier, char *nodeid, size_t len)
+{
+    if (!carrier) {
+        setError(IOEXERR_INVALID_ARGS);
+        return NULL;
+    }
+
+    return copyString(carrier->userid, nodeid, len);
+}
+
+char *IOEX_get_userid(IOEXCarrier *carrier, char *userid, size_t len)
+{
+    return IOEX_get_nodeid(carrier, userid, len);
+}
+
+int IOEX_set_self_nospam(IOEXCarrier *carrier, uint32_t nospam)
+{
+    if (!carrier) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    carrier->nospam = nospam;
+    makeAddress(carrier);
+    pthread_mutex_unlock(&carrier->lock);
+
+    return 0;
+}
+
+int IOEX_get_self_nospam(IOEXCarrier *carrier, uint32_t *nospam)
+{
+    if (!carrier || !nospam) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    *nospam = carrier->nospam;
+    return 0;
+}
+
+int IOEX_set_self_info(IOEXCarrier *carrier, const IOEXUserInfo *info)
+{
+    if (!carrier || !info) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    carrier->selfInfo = *info;
+    strcpy(carrier->selfInfo.userid, carrier->userid);
+    pthread_mutex_unlock(&carrier->lock);
+
+    return 0;
+}
+
+int IOEX_get_self_info(IOEXCarrier *carrier, IOEXUserInfo *info)
+{
+    if (!carrier || !info) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    *info = carrier->selfInfo;
+    pthread_mutex_unlock(&carrier->lock);
+
+    return 0;
+}
+
+int IOEX_set_self_presence(IOEXCarrier *carrier, IOEXPresenceStatus presence)
+{
+    if (!carrier || presence < IOEXPresenceStatus_None ||
+            presence > IOEXPresenceStatus_Busy) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    carrier->presence = presence;
+    return 0;
+}
+
+int IOEX_get_self_presence(IOEXCarrier *carrier, IOEXPresenceStatus *presence)
+{
+    if (!carrier || !presence) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    *presence = carrier->presence;
+    return 0;
+}
+
+bool IOEX_is_ready(IOEXCarrier *carrier)
+{
+    bool ready;
+
+    if (!carrier)
+        return false;
+
+    pthread_mutex_lock(&carrier->lock);
+    ready = carrier->ready != 0;
+    pthread_mutex_unlock(&carrier->lock);
+
+    return ready;
+}
+
+/* Friends */
+
+static
+IOEXFriendInfo* findFriend(IOEXCarrier* c, const char* userid)
+{
+    int i;
+
+    for (i = 0; i < c->friendCount; i++) {
+        if (!strcmp(c->friends[i].user_info.userid, userid))
+            return &c->friends[i];
+    }
+    return NULL;
+}
+
+static
+IOEXFriendInfo* appendFriend(IOEXCarrier* c, const char* userid)
+{
+    IOEXFriendInfo* friends;
+    IOEXFriendInfo* fi;
+
+    friends = (IOEXFriendInfo*)realloc(c->friends,
+                                       sizeof(*friends) * (c->friendCount + 1));
+    if (!friends)
+        return NULL;
+
+    c->friends = friends;
+    fi = &friends[c->friendCount++];
+    memset(fi, 0, sizeof(*fi));
+    strncpy(fi->user_info.userid, userid, IOEX_MAX_ID_LEN);
+    fi->status = IOEXConnectionStatus_Connected;
+    fi->presence = IOEXPresenceStatus_None;
+
+    return fi;
+}
+
+int IOEX_get_friends(IOEXCarrier *carrier,
+                     IOEXFriendsIterateCallback *callback, void *context)
+{
+    IOEXFriendInfo* friends = NULL;
+    int count;
+    int i;
+
+    if (!carrier || !callback) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    count = carrier->friendCount;
+    if (count > 0) {
+        friends = (IOEXFriendInfo*)malloc(sizeof(*friends) * count);
+        if (!friends) {
+            pthread_mutex_unlock(&carrier->lock);
+            setError(IOEXERR_OUT_OF_MEMORY);
+            return -1;
+        }
+        memcpy(friends, carrier->friends, sizeof(*friends) * count);
+    }
+    pthread_mutex_unlock(&carrier->lock);
+
+    for (i = 0; i < count; i++) {
+        if (!callback(&friends[i], context))
+            break;
+    }
+    if (i == count)
+        callback(NULL, context);
+
+    free(friends);
+    return 0;
+}
+
+int IOEX_get_friend_info(IOEXCarrier *carrier, const char *friendid,
+                         IOEXFriendInfo *info)
+{
+    IOEXFriendInfo* fi;
+
+    if (!carrier || !friendid || !info) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    fi = findFriend(carrier, friendid);
+    if (fi)
+        *info = *fi;
+    pthread_mutex_unlock(&carrier->lock);
+
+    if (!fi) {
+        setError(IOEXERR_NOT_EXIST);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_set_friend_label(IOEXCarrier *carrier, const char *friendid,
+                          const char *label)
+{
+    IOEXFriendInfo* fi;
+
+    if (!carrier || !friendid) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    fi = findFriend(carrier, friendid);
+    if (fi) {
+        memset(fi->label, 0, sizeof(fi->label));
+        if (label)
+            strncpy(fi->label, label, sizeof(fi->label) - 1);
+    }
+    pthread_mutex_unlock(&carrier->lock);
+
+    if (!fi) {
+        setError(IOEXERR_NOT_EXIST);
+        return -1;
+    }
+    return 0;
+}
+
+bool IOEX_is_friend(IOEXCarrier* carrier, const char* userid)
+{
+    bool rc;
+
+    if (!carrier || !userid)
+        return false;
+
+    pthread_mutex_lock(&carrier->lock);
+    rc = findFriend(carrier, userid) != NULL;
+    pthread_mutex_unlock(&carrier->lock);
+
+    return rc;
+}
+
+int IOEX_add_friend(IOEXCarrier *carrier, const char *address, const char *hello)
+{
+    if (!carrier || !address || !hello) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    if (!strcmp(address, carrier->address)) {
+        setError(IOEXERR_ADD_SELF);
+        return -1;
+    }
+
+    return 0;
+}
+
+int IOEX_accept_friend(IOEXCarrier *carrier, const char *userid)
+{
+    IOEXFriendInfo* fi;
+
+    if (!carrier || !userid) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    if (findFriend(carrier, userid)) {
+        pthread_mutex_unlock(&carrier->lock);
+        setError(IOEXERR_ALREADY_EXIST);
+        return -1;
+    }
+    fi = appendFriend(carrier, userid);
+    pthread_mutex_unlock(&carrier->lock);
+
+    if (!fi) {
+        setError(IOEXERR_OUT_OF_MEMORY);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_remove_friend(IOEXCarrier *carrier, const char *userid)
+{
+    IOEXFriendInfo* fi;
+
+    if (!carrier || !userid) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    fi = findFriend(carrier, userid);
+    if (fi) {
+        int index = (int)(fi - carrier->friends);
+        memmove(fi, fi + 1, sizeof(*fi) * (carrier->friendCount - index - 1));
+        carrier->friendCount--;
+    }
+    pthread_mutex_unlock(&carrier->lock);
+
+    if (!fi) {
+        setError(IOEXERR_NOT_EXIST);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_send_friend_message(IOEXCarrier *carrier, const char *to,
+                             const void *msg, size_t len)
+{
+    if (!carrier || !to || !msg || !len || len > IOEX_MAX_APP_MESSAGE_LEN) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    __atomic_add_fetch(&carrier->bytesWritten, (int64_t)len, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int IOEX_invite_friend(IOEXCarrier *carrier, const char *to,
+                       const void *data, size_t len,
+                       IOEXFriendInviteResponseCallback *callback,
+                       void *context)
+{
+    if (!carrier || !to || !data || !len || !callback) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    return 0;
+}
+
+int IOEX_reply_friend_invite(IOEXCarrier *carrier, const char *to,
+                             int status, const char *reason,
+                             const void *data, size_t len)
+{
+    if (!carrier || !to) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* File transfer */
+
+int IOEX_send_file_query(IOEXCarrier *carrier, const char *friendid,
+                         const char *filename, const char *message)
+{
+    if (!carrier || !friendid || !filename) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_send_file_request(IOEXCarrier *carrier, char *fileid, size_t id_len,
+                           const char *friendid, const char *filename)
+{
+    if (!carrier || !fileid || id_len < IOEX_MAX_ID_LEN || !friendid || !filename) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    randomId(fileid, id_len);
+    return 0;
+}
+
+int IOEX_send_file_accept(IOEXCarrier *carrier, const char *fileid,
+                          const char *filename, const char *filepath)
+{
+    if (!carrier || !fileid) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_send_file_seek(IOEXCarrier *carrier, const char *fileid,
+                        const char *position)
+{
+    if (!carrier || !fileid || !position) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_send_file_reject(IOEXCarrier *carrier, const char *fileid)
+{
+    if (!carrier || !fileid) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_send_file_pause(IOEXCarrier *carrier, const char *fileid)
+{
+    return IOEX_send_file_reject(carrier, fileid);
+}
+
+int IOEX_send_file_resume(IOEXCarrier *carrier, const char *fileid)
+{
+    return IOEX_send_file_reject(carrier, fileid);
+}
+
+int IOEX_send_file_cancel(IOEXCarrier *carrier, const char *fileid)
+{
+    return IOEX_send_file_reject(carrier, fileid);
+}
+
+int IOEX_get_files(IOEXCarrier *carrier, IOEXFilesIterateCallback *callback, void *context)
+{
+    IOEXFileInfo* files = NULL;
+    int count;
+    int i;
+
+    if (!carrier || !callback) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    count = carrier->fileCount;
+    if (count > 0) {
+        files = (IOEXFileInfo*)malloc(sizeof(*files) * count);
+        if (!files) {
+            pthread_mutex_unlock(&carrier->lock);
+            setError(IOEXERR_OUT_OF_MEMORY);
+            return -1;
+        }
+        memcpy(files, carrier->files, sizeof(*files) * count);
+    }
+    pthread_mutex_unlock(&carrier->lock);
+
+    for (i = 0; i < count; i++) {
+        if (!callback(files[i].direction, &files[i].ti, context))
+            break;
+    }
+    if (i == count)
+        callback(IOEXFileTransmissionDirection_Unknown, NULL, context);
+
+    free(files);
+    return 0;
+}
+
+int IOEX_get_file_info(IOEXCarrier *carrier, IOEXFileInfo *fileinfo, const char *fileid)
+{
+    int found = 0;
+    int i;
+
+    if (!carrier || !fileinfo || !fileid) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    memset(fileinfo, 0, sizeof(*fileinfo));
+
+    pthread_mutex_lock(&carrier->lock);
+    for (i = 0; i < carrier->fileCount; i++) {
+        if (strcmp(carrier->files[i].ti.file_id, fileid) == 0) {
+            *fileinfo = carrier->files[i];
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&carrier->lock);
+
+    if (!found) {
+        setError(IOEXERR_NOT_EXIST);
+        return -1;
+    }
+    return 0;
+}
+
+/* Sessions */
+
+int IOEX_session_init(IOEXCarrier *carrier,
+                      IOEXSessionRequestCallback *callback, void *context)
+{
+    if (!carrier) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    pthread_mutex_lock(&carrier->lock);
+    carrier->sessionCallback = callback;
+    carrier->sessionContext = context;
+    pthread_mutex_unlock(&carrier->lock);
+
+    return 0;
+}
+
+void IOEX_session_cleanup(IOEXCarrier *carrier)
+{
+    if (!carrier)
+        return;
+
+    pthread_mutex_lock(&carrier->lock);
+    carrier->sessionCallback = NULL;
+    carrier->sessionContext = NULL;
+    pthread_mutex_unlock(&carrier->lock);
+}
+
+IOEXSession *IOEX_session_new(IOEXCarrier *carrier, const char *address)
+{
+    IOEXSession* ws;
+
+    if (!carrier || !address) {
+        setError(IOEXERR_INVALID_ARGS);
+        return NULL;
+    }
+
+    ws = (IOEXSession*)calloc(1, sizeof(*ws));
+    if (!ws) {
+        setError(IOEXERR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    ws->carrier = carrier;
+    strncpy(ws->peer, address, sizeof(ws->peer) - 1);
+
+    return ws;
+}
+
+void IOEX_session_close(IOEXSession *session)
+{
+    IOEXCarrier* c;
+    StubStream** pp;
+
+    if (!session)
+        return;
+
+    c = session->carrier;
+    pthread_mutex_lock(&c->lock);
+    pp = &c->streams;
+    while (*pp) {
+        StubStream* s = *pp;
+        if (s->session == session) {
+            *pp = s->next;
+            free(s);
+        } else {
+            pp = &s->next;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    free(session);
+}
+
+char *IOEX_session_get_peer(IOEXSession *session, char *address, size_t len)
+{
+    if (!session) {
+        setError(IOEXERR_INVALID_ARGS);
+        return NULL;
+    }
+
+    return copyString(session->peer, address, len);
+}
+
+void IOEX_session_set_userdata(IOEXSession *session, void *userdata)
+{
+    if (session)
+        session->userdata = userdata;
+}
+
+void *IOEX_session_get_userdata(IOEXSession *session)
+{
+    return session ? session->userdata : NULL;
+}
+
+/*
+ * Session negotiation completes immediately on the calling thread: the
+ * stub has no peer to exchange SDP with.
+ */
+int IOEX_session_request(IOEXSession *session,
+                         IOEXSessionRequestCompleteCallback *callback,
+                         void *context)
+{
+    static const char sdp[] = "stub-sdp";
+
+    if (!session || !callback) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    callback(session, 0, NULL, sdp, sizeof(sdp), context);
+    return 0;
+}
+
+int IOEX_session_reply_request(IOEXSession *session, int status,
+                               const char* reason)
+{
+    if (!session || (status != 0 && !reason)) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+    return 0;
+}
+
+int IOEX_session_start(IOEXSession *session, const char *sdp, size_t len)
+{
+    static const IOEXStreamState states[] = {
+        IOEXStreamState_transport_ready,
+        IOEXStreamState_connecting,
+        IOEXStreamState_connected
+    };
+    IOEXCarrier* c;
+    StubStream* s;
+    size_t i;
+
+    if (!session || !sdp || !len) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    c = session->carrier;
+    for (i = 0; i < sizeof(states) / sizeof(states[0]); i++) {
+        for (s = c->streams; s; s = s->next) {
+            if (s->session == session && s->callbacks.state_changed)
+                s->callbacks.state_changed(session, s->id, states[i], s->context);
+        }
+    }
+
+    return 0;
+}
+
+int IOEX_session_add_service(IOEXSession *session, const char *service,
+                             PortForwardingProtocol protocol, const char *host,
+                             const char *port)
+{
+    if (!session || !service || !host || !port) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+    return 0;
+}
+
+void IOEX_session_remove_service(IOEXSession *session, const char *service)
+{
+}
+
+/* Streams */
+
+int IOEX_session_add_stream(IOEXSession *session, IOEXStreamType type,
+                            int options, IOEXStreamCallbacks *callbacks,
+                            void *context)
+{
+    IOEXCarrier* c;
+    StubStream* s;
+
+    if (!session || !callbacks) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    s = (StubStream*)calloc(1, sizeof(*s));
+    if (!s) {
+        setError(IOEXERR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    s->session = session;
+    s->type = type;
+    s->options = options;
+    s->callbacks = *callbacks;
+    s->context = context;
+    s->nextChannel = 1;
+    s->nextPortForwarding = 1;
+
+    c = session->carrier;
+    pthread_mutex_lock(&c->lock);
+    s->id = c->nextStreamId++;
+    s->next = c->streams;
+    c->streams = s;
+    pthread_mutex_unlock(&c->lock);
+
+    if (s->callbacks.state_changed)
+        s->callbacks.state_changed(session, s->id, IOEXStreamState_initialized,
+                                   context);
+
+    return s->id;
+}
+
+int IOEX_session_remove_stream(IOEXSession *session, int stream)
+{
+    IOEXCarrier* c;
+    StubStream** pp;
+    StubStream* s = NULL;
+
+    if (!session || stream <= 0) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    c = session->carrier;
+    pthread_mutex_lock(&c->lock);
+    for (pp = &c->streams; *pp; pp = &(*pp)->next) {
+        if ((*pp)->id == stream && (*pp)->session == session) {
+            s = *pp;
+            *pp = s->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    if (!s) {
+        setError(IOEXERR_NOT_EXIST);
+        return -1;
+    }
+
+    if (s->callbacks.state_changed)
+        s->callbacks.state_changed(session, s->id, IOEXStreamState_closed,
+                                   s->context);
+    free(s);
+    return 0;
+}
+
+static
+StubStream* lockStream(IOEXSession* session, int stream)
+{
+    StubStream* s;
+
+    if (!session || stream <= 0) {
+        setError(IOEXERR_INVALID_ARGS);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&session->carrier->lock);
+    s = findStream(session->carrier, stream);
+    if (!s || s->session != session) {
+        pthread_mutex_unlock(&session->carrier->lock);
+        setError(IOEXERR_NOT_EXIST);
+        return NULL;
+    }
+    return s;
+}
+
+static
+void unlockStream(IOEXSession* session)
+{
+    pthread_mutex_unlock(&session->carrier->lock);
+}
+
+/* Called with the carrier lock held. */
+static
+ssize_t takeWriteWindow(IOEXCarrier* c, size_t len)
+{
+    if (c->writeWindow < 0)
+        return (ssize_t)len;
+
+    if (c->writeWindow == 0) {
+        setError(IOEXERR_BUSY);
+        return -1;
+    }
+
+    if ((int64_t)len > c->writeWindow)
+        len = (size_t)c->writeWindow;
+    c->writeWindow -= (int64_t)len;
+    return (ssize_t)len;
+}
+
+int IOEX_stream_get_type(IOEXSession *session, int stream, IOEXStreamType *type)
+{
+    StubStream* s;
+
+    if (!type) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    *type = s->type;
+    unlockStream(session);
+
+    return 0;
+}
+
+int IOEX_stream_get_transport_info(IOEXSession *session, int stream,
+                                   IOEXTransportInfo *info)
+{
+    StubStream* s;
+
+    if (!info) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    unlockStream(session);
+
+    memset(info, 0, sizeof(*info));
+    info->topology = IOEXNetworkTopology_LAN;
+    info->local.type = IOEXCandidateType_Host;
+    strcpy(info->local.addr, "127.0.0.1");
+    info->local.port = 33445;
+    info->remote = info->local;
+    info->remote.port = 33446;
+
+    return 0;
+}
+
+ssize_t IOEX_stream_write(IOEXSession *session, int stream,
+                          const void *data, size_t len)
+{
+    StubStream* s;
+    ssize_t bytes;
+
+    if (!data || !len) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    bytes = takeWriteWindow(session->carrier, len);
+    unlockStream(session);
+
+    if (bytes > 0)
+        __atomic_add_fetch(&session->carrier->bytesWritten, (int64_t)bytes,
+                           __ATOMIC_RELAXED);
+    return bytes;
+}
+
+int IOEX_stream_open_channel(IOEXSession *session, int stream,
+                             const char *cookie)
+{
+    StubStream* s;
+    int channel;
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    channel = s->nextChannel++;
+    unlockStream(session);
+
+    return channel;
+}
+
+int IOEX_stream_close_channel(IOEXSession *session, int stream, int channel)
+{
+    IOEXStreamCallbacks callbacks;
+    StubStream* s;
+    void* context;
+
+    if (channel <= 0) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    callbacks = s->callbacks;
+    context = s->context;
+    unlockStream(session);
+
+    if (callbacks.channel_close)
+        callbacks.channel_close(session, stream, channel, CloseReason_Normal,
+                                context);
+    return 0;
+}
+
+ssize_t IOEX_stream_write_channel(IOEXSession *session, int stream,
+                                  int channel, const void *data, size_t len)
+{
+    StubStream* s;
+    ssize_t bytes;
+
+    if (channel <= 0 || !data || !len) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    bytes = takeWriteWindow(session->carrier, len);
+    unlockStream(session);
+
+    if (bytes > 0)
+        __atomic_add_fetch(&session->carrier->bytesWritten, (int64_t)bytes,
+                           __ATOMIC_RELAXED);
+    return bytes;
+}
+
+int IOEX_stream_pend_channel(IOEXSession *session, int stream, int channel)
+{
+    StubStream* s;
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    unlockStream(session);
+
+    return 0;
+}
+
+int IOEX_stream_resume_channel(IOEXSession *session, int stream, int channel)
+{
+    return IOEX_stream_pend_channel(session, stream, channel);
+}
+
+int IOEX_stream_open_port_forwarding(IOEXSession *session, int stream,
+        const char *service, PortForwardingProtocol protocol,
+        const char *host, const char *port)
+{
+    StubStream* s;
+    int pfid;
+
+    if (!service || !host || !port) {
+        setError(IOEXERR_INVALID_ARGS);
+        return -1;
+    }
+
+    s = lockStream(session, stream);
+    if (!s)
+        return -1;
+    pfid = s->nextPortForwarding++;
+    unlockStream(session);
+
+    return pfid;
+}
+
+int IOEX_stream_close_port_forwarding(IOEXSession *session, int stream,
+                                      int portforwarding)
+{
+    return IOEX_stream_pend_channel(session, stream, portforwarding);
+}
+
+/* Harness control */
+
+int stubSetFriends(const char* userId, int count)
+{
+    IOEXCarrier* c;
+    IOEXFriendInfo* friends = NULL;
+    int i;
+
+    c = findCarrier(userId);
+    if (!c || count < 0)
+        return -1;
+
+    if (count > 0) {
+        friends = (IOEXFriendInfo*)calloc((size_t)count, sizeof(*friends));
+        if (!friends)
+            return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        IOEXFriendInfo* fi = &friends[i];
+
+        randomId(fi->user_info.userid, sizeof(fi->user_info.userid));
+        snprintf(fi->user_info.name, sizeof(fi->user_info.name), "friend-%d", i);
+        snprintf(fi->user_info.description, sizeof(fi->user_info.description),
+                 "stub friend %d", i);
+        strcpy(fi->user_info.region, "host");
+        snprintf(fi->label, sizeof(fi->label), "label-%d", i);
+        fi->status = IOEXConnectionStatus_Connected;
+        fi->presence = (IOEXPresenceStatus)(i % 3);
+    }
+
+    pthread_mutex_lock(&c->lock);
+    free(c->friends);
+    c->friends = friends;
+    c->friendCount = count;
+    pthread_mutex_unlock(&c->lock);
+
+    return 0;
+}
+
+int stubSetFiles(const char* userId, int count)
+{
+    IOEXCarrier* c;
+    IOEXFileInfo* files = NULL;
+    int i;
+
+    c = findCarrier(userId);
+    if (!c || count < 0)
+        return -1;
+
+    if (count > 0) {
+        files = (IOEXFileInfo*)calloc((size_t)count, sizeof(*files));
+        if (!files)
+            return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        IOEXFileInfo* fi = &files[i];
+
+        randomId(fi->ti.file_id, sizeof(fi->ti.file_id));
+        snprintf(fi->ti.file_name, sizeof(fi->ti.file_name), "file-%d", i);
+        fi->ti.file_size = (uint64_t)(i + 1) << 20;
+        fi->ti.friend_number = (uint32_t)i;
+        fi->ti.file_index = (uint32_t)i;
+        fi->status = (IOEXFileTransmissionStatus)(1 + i % 3);
+        fi->paused = (IOEXFileTransmissionPausedStatus)(i % 4);
+        fi->direction = (IOEXFileTransmissionDirection)(1 + i % 2);
+        fi->transferred_size = fi->ti.file_size / 2;
+    }
+
+    pthread_mutex_lock(&c->lock);
+    free(c->files);
+    c->files = files;
+    c->fileCount = count;
+    pthread_mutex_unlock(&c->lock);
+
+    return 0;
+}
+
+static
+int64_t runOnCarrierThread(const char* userId, int type, const void* data, size_t len,
+                           int count)
+{
+    IOEXCarrier* c;
+    StubJob job;
+
+    c = findCarrier(userId);
+    if (!c || count <= 0)
+        return -1;
+
+    memset(&job, 0, sizeof(job));
+    job.type = type;
+    job.data = data;
+    job.len = len;
+    job.count = count;
+
+    pthread_mutex_lock(&c->lock);
+    if (!c->running || c->stopped) {
+        pthread_mutex_unlock(&c->lock);
+        return -1;
+    }
+
+    if (c->jobTail)
+        c->jobTail->next = &job;
+    else
+        c->jobHead = &job;
+    c->jobTail = &job;
+    pthread_cond_broadcast(&c->cond);
+
+    while (!job.done)
+        pthread_cond_wait(&c->cond, &c->lock);
+    pthread_mutex_unlock(&c->lock);
+
+    return job.elapsed;
+}
+
+int64_t stubFirePresence(const char* userId, int count)
+{
+    return runOnCarrierThread(userId, StubJob_Presence, NULL, 0, count);
+}
+
+int64_t stubFireFriendMessage(const char* userId, size_t len, int count)
+{
+    if (!len || len > IOEX_MAX_APP_MESSAGE_LEN)
+        return -1;
+
+    return runOnCarrierThread(userId, StubJob_FriendMessage, NULL, len, count);
+}
+
+int64_t stubFireTextMessage(const char* userId, const void* text, size_t len, int count)
+{
+    if (!text || !len || len > IOEX_MAX_APP_MESSAGE_LEN)
+        return -1;
+
+    return runOnCarrierThread(userId, StubJob_FriendMessage, text, len, count);
+}
+
+enum {
+    StubBurst_Data = 0,
+    StubBurst_Pending,
+    StubBurst_Resume
+};
+
+typedef struct TransportBurst {
+    int event;
+    IOEXSession* session;
+    int stream;
+    int channel;
+    IOEXStreamCallbacks callbacks;
+    void* context;
+    size_t len;
+    int count;
+    int64_t elapsed;
+} TransportBurst;
+
+static
+void* transportRoutine(void* arg)
+{
+    TransportBurst* burst = (TransportBurst*)arg;
+    uint8_t* data;
+    int64_t start;
+    size_t i;
+    int n;
+
+    data = (uint8_t*)malloc(burst->len);
+    if (!data) {
+        burst->elapsed = -1;
+        return NULL;
+    }
+    for (i = 0; i < burst->len; i++)
+        data[i] = (uint8_t)i;
+
+    start = nowNanos();
+    for (n = 0; n < burst->count; n++) {
+        if (burst->event == StubBurst_Pending)
+            burst->callbacks.channel_pending(burst->session, burst->stream,
+                    burst->channel, burst->context);
+        else if (burst->event == StubBurst_Resume)
+            burst->callbacks.channel_resume(burst->session, burst->stream,
+                    burst->channel, burst->context);
+        else if (burst->channel > 0)
+            burst->callbacks.channel_data(burst->session, burst->stream,
+                    burst->channel, data, burst->len, burst->context);
+        else
+            burst->callbacks.stream_data(burst->session, burst->stream,
+                    data, burst->len, burst->context);
+    }
+    burst->elapsed = nowNanos() - start;
+
+    free(data);
+    return NULL;
+}
+
+static
+int64_t runOnTransportThread(const char* userId, int event, int stream, int channel,
+                             size_t len, int count)
+{
+    TransportBurst burst;
+    IOEXCarrier* c;
+    StubStream* s;
+    pthread_t thread;
+
+    c = findCarrier(userId);
+    if (!c || !len || count <= 0)
+        return -1;
+
+    memset(&burst, 0, sizeof(burst));
+
+    pthread_mutex_lock(&c->lock);
+    s = findStream(c, stream);
+    if (s) {
+        burst.session = s->session;
+        burst.callbacks = s->callbacks;
+        burst.context = s->context;
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    if (!s)
+        return -1;
+    if (event == StubBurst_Pending && !burst.callbacks.channel_pending)
+        return -1;
+    if (event == StubBurst_Resume && !burst.callbacks.channel_resume)
+        return -1;
+    if (event == StubBurst_Data && channel > 0 && !burst.callbacks.channel_data)
+        return -1;
+    if (event == StubBurst_Data && channel <= 0 && !burst.callbacks.stream_data)
+        return -1;
+
+    burst.event = event;
+    burst.stream = stream;
+    burst.channel = channel;
+    burst.len = len;
+    burst.count = count;
+
+    if (pthread_create(&thread, NULL, transportRoutine, &burst) != 0)
+        return -1;
+    pthread_join(thread, NULL);
+
+    return burst.elapsed;
+}
+
+int64_t stubFireStreamData(const char* userId, int stream, size_t len, int count)
+{
+    return runOnTransportThread(userId, StubBurst_Data, stream, 0, len, count);
+}
+
+int64_t stubFireChannelData(const char* userId, int stream, int channel,
+                            size_t len, int count)
+{
+    if (channel <= 0)
+        return -1;
+
+    return runOnTransportThread(userId, StubBurst_Data, stream, channel, len, count);
+}
+
+int64_t stubFireChannelPending(const char* userId, int stream, int channel)
+{
+    if (channel <= 0)
+        return -1;
+
+    return runOnTransportThread(userId, StubBurst_Pending, stream, channel, 1, 1);
+}
+
+int64_t stubFireChannelResume(const char* userId, int stream, int channel)
+{
+    if (channel <= 0)
+        return -1;
+
+    return runOnTransportThread(userId, StubBurst_Resume, stream, channel, 1, 1);
+}
+
+int stubSetWriteWindow(const char* userId, int64_t bytes)
+{
+    IOEXCarrier* c;
+
+    c = findCarrier(userId);
+    if (!c)
+        return -1;
+
+    pthread_mutex_lock(&c->lock);
+    c->writeWindow = bytes < 0 ? -1 : bytes;
+    pthread_mutex_unlock(&c->lock);
+
+    return 0;
+}
+
+int64_t stubGetBytesWritten(const char* userId)
+{
+    IOEXCarrier* c;
+
+    c = findCarrier(userId);
+    if (!c)
+        return -1;
+
+    return __atomic_load_n(&c->bytesWritten, __ATOMIC_RELAXED);
+}
+
+int stubGetLiveCarriers(void)
+{
+    int count;
+
+    pthread_mutex_lock(&gLock);
+    count = gLiveCarriers;
+    pthread_mutex_unlock(&gLock);
+
+    return count;
+}
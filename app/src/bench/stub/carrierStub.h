@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __CARRIER_STUB_H__
+#define __CARRIER_STUB_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <IOEX_carrier.h>
+#include <IOEX_session.h>
+
+/*
+ * Control interface of the stand-in libcarrier used by the host benchmark
+ * harness. Carriers are looked up by their user id; every fire function
+ * drives the given number of callbacks through the binding and returns the
+ * elapsed time in nanoseconds, or -1 on failure.
+ */
+
+/* Replace the friend list of carrier with count synthetic friends. */
+int stubSetFriends(const char* userId, int count);
+
+/* Replace the file trackers of carrier with count synthetic transfers. */
+int stubSetFiles(const char* userId, int count);
+
+/* Number of friend presence callbacks, delivered on the carrier thread. */
+int64_t stubFirePresence(const char* userId, int count);
+
+/* Number of friend message callbacks, delivered on the carrier thread. */
+int64_t stubFireFriendMessage(const char* userId, size_t len, int count);
+
+/* Same as above, but every message carries the given bytes. */
+int64_t stubFireTextMessage(const char* userId, const void* text, size_t len, int count);
+
+/* Number of stream data callbacks, delivered on a native transport thread. */
+int64_t stubFireStreamData(const char* userId, int stream, size_t len, int count);
+
+/* Number of channel data callbacks, delivered on a native transport thread. */
+int64_t stubFireChannelData(const char* userId, int stream, int channel,
+                            size_t len, int count);
+
+/* One channel pending callback, delivered on a native transport thread. */
+int64_t stubFireChannelPending(const char* userId, int stream, int channel);
+
+/* One channel resume callback, delivered on a native transport thread. */
+int64_t stubFireChannelResume(const char* userId, int stream, int channel);
+
+/*
+ * Let stream writes of carrier take at most bytes more before they fail with
+ * IOEXERR_BUSY; the last write may be partial. A negative value lifts the limit.
+ */
+int stubSetWriteWindow(const char* userId, int64_t bytes);
+
+/* Bytes accepted by IOEX_stream_write and IOEX_stream_write_channel. */
+int64_t stubGetBytesWritten(const char* userId);
+
+/* Number of carrier instances created by IOEX_new and not yet killed. */
+int stubGetLiveCarriers(void);
+
+#endif //__CARRIER_STUB_H__
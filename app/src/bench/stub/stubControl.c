@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdio.h>
+
+#include "carrierStub.h"
+
+static
+jboolean setFriends(JNIEnv* env, jclass clazz, jstring juserId, jint count)
+{
+    const char* userId;
+    int rc;
+
+    (void)clazz;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return JNI_FALSE;
+
+    rc = stubSetFriends(userId, (int)count);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return rc == 0 ? JNI_TRUE : JNI_FALSE;
+}
+
+static
+jboolean setFiles(JNIEnv* env, jclass clazz, jstring juserId, jint count)
+{
+    const char* userId;
+    int rc;
+
+    (void)clazz;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return JNI_FALSE;
+
+    rc = stubSetFiles(userId, (int)count);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return rc == 0 ? JNI_TRUE : JNI_FALSE;
+}
+
+static
+jlong firePresence(JNIEnv* env, jclass clazz, jstring juserId, jint count)
+{
+    const char* userId;
+    int64_t elapsed;
+
+    (void)clazz;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return -1;
+
+    elapsed = stubFirePresence(userId, (int)count);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return (jlong)elapsed;
+}
+
+static
+jlong fireFriendMessage(JNIEnv* env, jclass clazz, jstring juserId, jint length,
+                        jint count)
+{
+    const char* userId;
+    int64_t elapsed;
+
+    (void)clazz;
+
+    if (length <= 0)
+        return -1;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return -1;
+
+    elapsed = stubFireFriendMessage(userId, (size_t)length, (int)count);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return (jlong)elapsed;
+}
+
+static
+jlong fireTextMessage(JNIEnv* env, jclass clazz, jstring juserId, jbyteArray jtext,
+                      jint count)
+{
+    const char* userId;
+    jbyte* text;
+    int64_t elapsed;
+
+    (void)clazz;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return -1;
+
+    text = (*env)->GetByteArrayElements(env, jtext, NULL);
+    if (!text) {
+        (*env)->ReleaseStringUTFChars(env, juserId, userId);
+        return -1;
+    }
+
+    elapsed = stubFireTextMessage(userId, text, (size_t)(*env)->GetArrayLength(env, jtext),
+                                  (int)count);
+    (*env)->ReleaseByteArrayElements(env, jtext, text, JNI_ABORT);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return (jlong)elapsed;
+}
+
+static
+jlong fireStreamData(JNIEnv* env, jclass clazz, jstring juserId, jint stream,
+                     jint length, jint count)
+{
+    const char* userId;
+    int64_t elapsed;
+
+    (void)clazz;
+
+    if (length <= 0)
+        return -1;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return -1;
+
+    elapsed = stubFireStreamData(userId, (int)stream, (size_t)length, (int)count);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return (jlong)elapsed;
+}
+
+static
+jlong fireChannelData(JNIEnv* env, jclass clazz, jstring juserId, jint stream,
+                      jint channel, jint length, jint count)
+{
+    const char* userId;
+    int64_t elapsed;
+
+    (void)clazz;
+
+    if (length <= 0)
+        return -1;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return -1;
+
+    elapsed = stubFireChannelData(userId, (int)stream, (int)channel,
+                                  (size_t)length, (int)count);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return (jlong)elapsed;
+}
+
+static
+jlong fireChannelFlow(JNIEnv* env, jclass clazz, jstring juserId, jint stream, jint channel,
+                      jboolean resume)
+{
+    const char* userId;
+    int64_t elapsed;
+
+    (void)clazz;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return -1;
+
+    if (resume)
+        elapsed = stubFireChannelResume(userId, (int)stream, (int)channel);
+    else
+        elapsed = stubFireChannelPending(userId, (int)stream, (int)channel);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return (jlong)elapsed;
+}
+
+static
+jboolean setWriteWindow(JNIEnv* env, jclass clazz, jstring juserId, jlong bytes)
+{
+    const char* userId;
+    int rc;
+
+    (void)clazz;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return JNI_FALSE;
+
+    rc = stubSetWriteWindow(userId, (int64_t)bytes);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return rc == 0 ? JNI_TRUE : JNI_FALSE;
+}
+
+static
+jlong getBytesWritten(JNIEnv* env, jclass clazz, jstring juserId)
+{
+    const char* userId;
+    int64_t bytes;
+
+    (void)clazz;
+
+    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
+    if (!userId)
+        return -1;
+
+    bytes = stubGetBytesWritten(userId);
+    (*env)->ReleaseStringUTFChars(env, juserId, userId);
+
+    return (jlong)bytes;
+}
+
+static
+jint getLiveCarriers(JNIEnv* env, jclass clazz)
+{
+    (void)env;
+    (void)clazz;
+
+    return (jint)stubGetLiveCarriers();
+}
+
+static const char* gClassName = "org/ioex/carrier/bench/StubControl";
+static JNINativeMethod gMethods[] = {
+        {"set_friends",         "(Ljava/lang/String;I)Z",     (void *) setFriends        },
+        {"set_files",           "(Ljava/lang/String;I)Z",     (void *) setFiles          },
+        {"fire_presence",       "(Ljava/lang/String;I)J",     (void *) firePresence      },
+        {"fire_friend_message", "(Ljava/lang/String;II)J",    (void *) fireFriendMessage },
+        {"fire_text_message",   "(Ljava/lang/String;[BI)J",   (void *) fireTextMessage   },
+        {"fire_stream_data",    "(Ljava/lang/String;III)J",   (void *) fireStreamData    },
+        {"fire_channel_data",   "(Ljava/lang/String;IIII)J",  (void *) fireChannelData   },
+        {"fire_channel_flow",   "(Ljava/lang/String;IIZ)J",   (void *) fireChannelFlow   },
+        {"set_write_window",    "(Ljava/lang/String;J)Z",     (void *) setWriteWindow    },
+        {"get_bytes_written",   "(Ljava/lang/String;)J",      (void *) getBytesWritten   },
+        {"get_live_carriers",   "()I",                        (void *) getLiveCarriers   },
+};
+
+jint JNI_OnLoad(JavaVM* vm, void* reserved)
+{
+    JNIEnv* env = NULL;
+    jclass clazz;
+    jint rc;
+
+    (void)reserved;
+
+    if ((*vm)->GetEnv(vm, (void**)&env, JNI_VERSION_1_6) != JNI_OK)
+        return -1;
+
+    clazz = (*env)->FindClass(env, gClassName);
+    if (!clazz) {
+        fprintf(stderr, "E/CarrierStub: Class %s not found\n", gClassName);
+        return -1;
+    }
+
+    rc = (*env)->RegisterNatives(env, clazz, gMethods,
+                                 sizeof(gMethods) / sizeof(gMethods[0]));
+    (*env)->DeleteLocalRef(env, clazz);
+    if (rc < 0) {
+        fprintf(stderr, "E/CarrierStub: Register native methods error\n");
+        return -1;
+    }
+
+    return JNI_VERSION_1_6;
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utf8.h"
+
+#define R   0xFFFD
+
+typedef struct Vector {
+    const char* name;
+    const char* utf8;
+    size_t length;
+    jchar expected[8];
+    size_t count;
+} Vector;
+
+#define VEC(name, utf8, ...)                                               \
+    { name, utf8, sizeof(utf8) - 1, { __VA_ARGS__ },                       \
+      sizeof((jchar[]){ __VA_ARGS__ }) / sizeof(jchar) }
+
+static const Vector vectors[] = {
+    VEC("ascii",               "Az~",                'A', 'z', '~'),
+    VEC("2-byte",              "\xC2\xA9",           0x00A9),
+    VEC("3-byte",              "\xE2\x82\xAC",       0x20AC),
+    VEC("4-byte",              "\xF0\x9F\x98\x80",   0xD83D, 0xDE00),
+    VEC("max code point",      "\xF4\x8F\xBF\xBF",   0xDBFF, 0xDFFF),
+    VEC("last before surrogates", "\xED\x9F\xBF",    0xD7FF),
+    VEC("first after surrogates", "\xEE\x80\x80",    0xE000),
+
+    VEC("overlong 2-byte NUL", "\xC0\x80",           R, R),
+    VEC("overlong 2-byte",     "\xC1\xBF",           R, R),
+    VEC("overlong 3-byte",     "\xE0\x80\xAF",       R, R, R),
+    VEC("overlong 3-byte max", "\xE0\x9F\xBF",       R, R, R),
+    VEC("overlong 4-byte",     "\xF0\x80\x80\xAF",   R, R, R, R),
+    VEC("overlong 4-byte max", "\xF0\x8F\xBF\xBF",   R, R, R, R),
+
+    VEC("high surrogate",      "\xED\xA0\x80",       R, R, R),
+    VEC("low surrogate",       "\xED\xBF\xBF",       R, R, R),
+    VEC("surrogate pair",      "\xED\xA0\xBD\xED\xB8\x80", R, R, R, R, R, R),
+
+    VEC("above U+10FFFF",      "\xF4\x90\x80\x80",   R, R, R, R),
+    VEC("lead F5",             "\xF5\x80\x80\x80",   R, R, R, R),
+    VEC("lead FF",             "\xFF",               R),
+    VEC("lone continuation",   "\x80" "a",           R, 'a'),
+
+    VEC("truncated 2-byte",    "\xC2",               R),
+    VEC("truncated 3-byte",    "\xE2\x82",           R),
+    VEC("truncated 4-byte",    "\xF0\x9F\x98",       R),
+    VEC("interrupted 3-byte",  "\xE2\x82" "a",       R, 'a'),
+    VEC("interrupted 4-byte",  "\xF0\x9F" "\xE2\x82\xAC", R, 0x20AC),
+
+    VEC("NUL stops",           "ab\0cd",             'a', 'b'),
+    VEC("NUL after 4-byte",    "\xF0\x9F\x98\x80\0a", 0xD83D, 0xDE00),
+};
+
+static int failures;
+
+static
+void check(const char* name, const uint8_t* utf8, size_t length,
+           const jchar* expected, size_t count)
+{
+    // Exactly length units, so an overrunning store is caught under ASan.
+    jchar* out = (jchar*)malloc((length ? length : 1) * sizeof(jchar));
+    size_t n;
+
+    if (!out) {
+        fprintf(stderr, "%s: out of memory\n", name);
+        exit(1);
+    }
+
+    n = utf8ToUtf16(utf8, length, out);
+    if (n != count || memcmp(out, expected, count * sizeof(jchar))) {
+        size_t i;
+
+        fprintf(stderr, "%s: got", name);
+        for (i = 0; i < n; i++)
+            fprintf(stderr, " %04X", out[i]);
+        fprintf(stderr, ", expected");
+        for (i = 0; i < count; i++)
+            fprintf(stderr, " %04X", expected[i]);
+        fprintf(stderr, "\n");
+        failures++;
+    }
+
+    free(out);
+}
+
+static
+void checkVectors(void)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+        check(vectors[i].name, (const uint8_t*)vectors[i].utf8,
+              vectors[i].length, vectors[i].expected, vectors[i].count);
+}
+
+/*
+ * Places a sequence after every ASCII prefix length up to three vector
+ * blocks, so it lands before, across and after each 16-byte boundary, and
+ * follows it with an ASCII tail that goes back to the vector path.
+ */
+static
+void checkBoundary(const char* name, const char* seq, const jchar* units,
+                   size_t count)
+{
+    uint8_t utf8[64];
+    jchar expected[64];
+    char label[64];
+    size_t seqLength = strlen(seq);
+    size_t prefix, i;
+
+    for (prefix = 0; prefix <= 48; prefix++) {
+        size_t length = 0, n = 0;
+
+        for (i = 0; i < prefix; i++) {
+            utf8[length++] = (uint8_t)('a' + i % 26);
+            expected[n++] = (jchar)('a' + i % 26);
+        }
+        memcpy(utf8 + length, seq, seqLength);
+        length += seqLength;
+        memcpy(expected + n, units, count * sizeof(jchar));
+        n += count;
+
+        snprintf(label, sizeof(label), "%s after %zu", name, prefix);
+        check(label, utf8, length, expected, n);
+
+        for (i = 0; i < 16 && length < sizeof(utf8); i++) {
+            utf8[length++] = 'Z';
+            expected[n++] = 'Z';
+        }
+        snprintf(label, sizeof(label), "%s after %zu with tail", name, prefix);
+        check(label, utf8, length, expected, n);
+    }
+}
+
+static
+void checkBoundaries(void)
+{
+    static const jchar copyright[] = { 0x00A9 };
+    static const jchar euro[] = { 0x20AC };
+    static const jchar emoji[] = { 0xD83D, 0xDE00 };
+    static const jchar replaced[] = { R };
+    static const jchar surrogate[] = { R, R, R };
+    uint8_t utf8[64];
+    size_t prefix, i;
+
+    checkBoundary("2-byte", "\xC2\xA9", copyright, 1);
+    checkBoundary("3-byte", "\xE2\x82\xAC", euro, 1);
+    checkBoundary("4-byte", "\xF0\x9F\x98\x80", emoji, 2);
+    checkBoundary("truncated", "\xF0\x9F\x98", replaced, 1);
+    checkBoundary("surrogate", "\xED\xA0\x80", surrogate, 3);
+    checkBoundary("high byte", "\x80", replaced, 1);
+
+    // A NUL inside or at the edge of a block ends the string there, even
+    // with more ASCII after it in the same block.
+    for (prefix = 0; prefix <= 48; prefix++) {
+        jchar expected[64];
+        char label[64];
+
+        for (i = 0; i < sizeof(utf8); i++) {
+            utf8[i] = (uint8_t)('a' + i % 26);
+            expected[i] = (jchar)('a' + i % 26);
+        }
+        utf8[prefix] = 0;
+
+        snprintf(label, sizeof(label), "NUL at %zu", prefix);
+        check(label, utf8, sizeof(utf8), expected, prefix);
+    }
+
+    // Lengths on either side of whole blocks, all ASCII.
+    for (prefix = 0; prefix <= 48; prefix++) {
+        jchar expected[64];
+        char label[64];
+
+        for (i = 0; i < prefix; i++) {
+            utf8[i] = (uint8_t)(' ' + i % 95);
+            expected[i] = (jchar)(' ' + i % 95);
+        }
+
+        snprintf(label, sizeof(label), "ASCII length %zu", prefix);
+        check(label, utf8, prefix, expected, prefix);
+    }
+}
+
+int main(void)
+{
+    checkVectors();
+    checkBoundaries();
+
+    if (failures) {
+        fprintf(stderr, "%d utf8 check(s) failed\n", failures);
+        return 1;
+    }
+
+    printf("utf8: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "bufferPool.h"
+
+struct BufferPool {
+    pthread_mutex_t lock;
+    uint8_t* slab;
+    int bufferSize;
+    int count;
+
+    jobject* buffers;
+    int* freeList;
+    int freeCount;
+    uint8_t* inUse;
+
+    uint64_t hits;
+    uint64_t misses;
+};
+
+BufferPool* bufferPoolCreate(JNIEnv* env, int bufferSize, int count)
+{
+    BufferPool* pool;
+    int i;
+
+    assert(bufferSize > 0);
+    assert(count > 0);
+
+    pool = (BufferPool*)calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pool->slab = (uint8_t*)malloc((size_t)bufferSize * count);
+    pool->buffers = (jobject*)calloc((size_t)count, sizeof(jobject));
+    pool->freeList = (int*)calloc((size_t)count, sizeof(int));
+    pool->inUse = (uint8_t*)calloc((size_t)count, sizeof(uint8_t));
+    if (!pool->slab || !pool->buffers || !pool->freeList || !pool->inUse)
+        goto errorExit;
+
+    pool->bufferSize = bufferSize;
+    pool->count = count;
+    pthread_mutex_init(&pool->lock, NULL);
+
+    for (i = 0; i < count; i++) {
+        jobject lbuffer;
+
+        lbuffer = (*env)->NewDirectByteBuffer(env, pool->slab + (size_t)i * bufferSize,
+                                              (jlong)bufferSize);
+        if (!lbuffer) {
+            logE("New direct ByteBuffer for buffer pool error");
+            goto errorExit;
+        }
+
+        pool->buffers[i] = (*env)->NewGlobalRef(env, lbuffer);
+        (*env)->DeleteLocalRef(env, lbuffer);
+        if (!pool->buffers[i]) {
+            logE("New global reference to pooled ByteBuffer error");
+            goto errorExit;
+        }
+
+        pool->freeList[pool->freeCount++] = i;
+    }
+
+    return pool;
+
+errorExit:
+    bufferPoolDestroy(pool, env);
+    return NULL;
+}
+
+void bufferPoolDestroy(BufferPool* pool, JNIEnv* env)
+{
+    int i;
+
+    if (!pool)
+        return;
+
+    if (pool->buffers) {
+        for (i = 0; i < pool->count; i++) {
+            if (pool->buffers[i])
+                (*env)->DeleteGlobalRef(env, pool->buffers[i]);
+        }
+        free(pool->buffers);
+    }
+
+    if (pool->count > 0)
+        pthread_mutex_destroy(&pool->lock);
+
+    if (pool->freeList)
+        free(pool->freeList);
+    if (pool->inUse)
+        free(pool->inUse);
+    if (pool->slab)
+        free(pool->slab);
+    free(pool);
+}
+
+jobject bufferPoolAcquire(BufferPool* pool, const void* data, size_t len)
+{
+    int index = -1;
+
+    assert(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    if (len <= (size_t)pool->bufferSize && pool->freeCount > 0) {
+        index = pool->freeList[--pool->freeCount];
+        pool->inUse[index] = 1;
+        pool->hits++;
+    } else {
+        pool->misses++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (index < 0)
+        return NULL;
+
+    memcpy(pool->slab + (size_t)index * pool->bufferSize, data, len);
+    return pool->buffers[index];
+}
+
+int bufferPoolRecycle(BufferPool* pool, JNIEnv* env, jobject buffer)
+{
+    uint8_t* address;
+    size_t offset;
+    int index;
+
+    assert(pool);
+
+    address = (uint8_t*)(*env)->GetDirectBufferAddress(env, buffer);
+    if (!address || address < pool->slab)
+        return 0;
+
+    offset = (size_t)(address - pool->slab);
+    if (offset % pool->bufferSize != 0 || offset / pool->bufferSize >= (size_t)pool->count)
+        return 0;
+
+    index = (int)(offset / pool->bufferSize);
+
+    pthread_mutex_lock(&pool->lock);
+    if (!pool->inUse[index]) {
+        pthread_mutex_unlock(&pool->lock);
+        logW("Pooled ByteBuffer recycled more than once");
+        return 0;
+    }
+    pool->inUse[index] = 0;
+    pool->freeList[pool->freeCount++] = index;
+    pthread_mutex_unlock(&pool->lock);
+
+    return 1;
+}
+
+void bufferPoolStats(BufferPool* pool, uint64_t* hits, uint64_t* misses)
+{
+    assert(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    *hits = pool->hits;
+    *misses = pool->misses;
+    pthread_mutex_unlock(&pool->lock);
+}
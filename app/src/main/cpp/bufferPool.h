@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __BUFFER_POOL_H__
+#define __BUFFER_POOL_H__
+
+#include <jni.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A fixed set of direct ByteBuffers carved out of one native slab, used to
+ * hand inbound stream data to java without allocating a byte[] per packet.
+ * Buffers are acquired on the callback thread and recycled from any thread.
+ */
+typedef struct BufferPool BufferPool;
+
+BufferPool* bufferPoolCreate(JNIEnv* env, int bufferSize, int count);
+
+void bufferPoolDestroy(BufferPool* pool, JNIEnv* env);
+
+/*
+ * Copy len bytes into a free pooled buffer and return its global reference.
+ * Returns NULL (and counts a miss) if the pool is exhausted or the data does
+ * not fit into one buffer.
+ */
+jobject bufferPoolAcquire(BufferPool* pool, const void* data, size_t len);
+
+/*
+ * Give a buffer back to the pool. Buffers not owned by the pool are ignored.
+ * Returns 1 if the buffer was recycled, otherwise 0.
+ */
+int bufferPoolRecycle(BufferPool* pool, JNIEnv* env, jobject buffer);
+
+void bufferPoolStats(BufferPool* pool, uint64_t* hits, uint64_t* misses);
+
+#endif //__BUFFER_POOL_H__
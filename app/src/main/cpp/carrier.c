@@ -47,32 +47,70 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <IOEX_carrier.h>
 #include "log.h"
 #include "utils.h"
+#include "utilsExt.h"
 #include "carrierUtils.h"
 #include "carrierHandler.h"
 #include "carrierCookie.h"
+#include "jniCache.h"
+#include "friendsSnapshot.h"
+#include "fileTransfers.h"
+#include "utf8.h"
+#include "upcallStats.h"
 
-static HandlerContext handlerContext;
+/* Binary friend messages are delivered only to a BinaryMessageHandler. */
+static
+int handlerTakesBinaryMessages(JNIEnv* env, jobject thiz)
+{
+    jobject jhandler;
+    int rc;
+
+    jhandler = (*env)->GetObjectField(env, thiz, gJni.carrier.handler);
+    if (!jhandler)
+        return 0;
+
+    rc = (*env)->IsInstanceOf(env, jhandler, gJni.binaryMessageHandler.clazz);
+    (*env)->DeleteLocalRef(env, jhandler);
+    return rc;
+}
 
 static
 jboolean carrierInit(JNIEnv* env, jobject thiz, jobject joptions, jobject jcallbacks)
 {
     OptionsHelper helper;
     IOEXCarrier *carrier;
-    HandlerContext *hc = &handlerContext;
+    HandlerContext *hc;
 
     memset(&helper, 0, sizeof(helper));
-    memset(hc, 0, sizeof(*hc));
+
+    hc = (HandlerContext*)calloc(1, sizeof(*hc));
+    if (!hc) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        return JNI_FALSE;
+    }
+    friendIdTableInit(&hc->friendIds);
 
     if (!getOptionsHelper(env, joptions, &helper)) {
+        friendIdTableCleanup(&hc->friendIds, env);
+        free(hc);
         cleanupOptionsHelper(&helper);
         setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
         return JNI_FALSE;
     }
 
+    if (helper.binary_messages && !handlerTakesBinaryMessages(env, thiz)) {
+        logE("Binary messages need a handler implementing BinaryMessageHandler");
+        friendIdTableCleanup(&hc->friendIds, env);
+        free(hc);
+        cleanupOptionsHelper(&helper);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+        return JNI_FALSE;
+    }
+
     IOEXOptions opts = {
         .udp_enabled = true,
         .persistent_location = helper.persistent_location,
@@ -83,6 +121,23 @@ jboolean carrierInit(JNIEnv* env, jobject thiz, jobject joptions, jobject jcallb
     if (!handlerCtxtSet(hc, env, thiz, jcallbacks)) {
         setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
         cleanupOptionsHelper(&helper);
+        friendIdTableCleanup(&hc->friendIds, env);
+        free(hc);
+        return JNI_FALSE;
+    }
+
+    hc->binaryMessages = helper.binary_messages;
+    progressThrottleInit(&hc->progress, helper.progress_interval, helper.progress_percent,
+                         (uint64_t)helper.progress_bytes);
+
+    if (helper.dispatch_capacity > 0 &&
+        !handlerCtxtStartDispatcher(hc, helper.dispatch_capacity, helper.dispatch_threads,
+                                    (DispatchOverflow)helper.dispatch_policy)) {
+        logE("Start carrier callback dispatcher error");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        cleanupOptionsHelper(&helper);
+        handlerCtxtCleanup(hc, env);
+        free(hc);
         return JNI_FALSE;
     }
 
@@ -91,33 +146,69 @@ jboolean carrierInit(JNIEnv* env, jobject thiz, jobject joptions, jobject jcallb
     if (!carrier) {
         logE("Call IOEX_new API error");
         setErrorCode(IOEX_get_error());
+        handlerCtxtCleanup(hc, env);
+        free(hc);
         return JNI_FALSE;
     }
 
     hc->nativeCarrier = carrier;
-    setLongField(env, thiz, "nativeCookie", (uint64_t)hc);
+    setLongField(env, thiz, gJni.carrier.nativeCookie, (uint64_t)hc);
 
     return JNI_TRUE;
 }
 
+/*
+ * Serializes the handoff of a HandlerContext between native_run and
+ * native_kill, which run on different threads: fetching it from the
+ * cookie and claiming it happen as one step on either side.
+ */
+static pthread_mutex_t gHandoffLock = PTHREAD_MUTEX_INITIALIZER;
+
 static
 jboolean carrierRun(JNIEnv* env, jobject thiz, jint jinterval)
 {
-    HandlerContext *hc = getContext(env, thiz);
+    HandlerContext *hc;
+    int killed;
     int rc;
 
     assert(jinterval >= 0);
+
+    pthread_mutex_lock(&gHandoffLock);
+    hc = getContext(env, thiz);
+    if (!hc || hc->state != HandlerState_Idle) {
+        pthread_mutex_unlock(&gHandoffLock);
+        setErrorCode(IOEX_GENERAL_ERROR(hc ? IOEXERR_ALREADY_RUN : IOEXERR_WRONG_STATE));
+        return JNI_FALSE;
+    }
     assert(hc->nativeCarrier);
 
+    hc->state = HandlerState_Running;
     hc->env = env;
+    pthread_mutex_unlock(&gHandoffLock);
 
     rc = IOEX_run(hc->nativeCarrier, jinterval);
     if (rc < 0) {
         logE("Call IOEX_run API error");
         setErrorCode(IOEX_get_error());
+
+        // A native_kill that saw the carrier running leaves the context to us.
+        pthread_mutex_lock(&gHandoffLock);
+        hc->env = NULL;
+        killed = (hc->state == HandlerState_Killed);
+        if (!killed)
+            hc->state = HandlerState_Idle;
+        pthread_mutex_unlock(&gHandoffLock);
+
+        if (killed) {
+            handlerCtxtCleanup(hc, env);
+            free(hc);
+        }
         return JNI_FALSE;
     }
+
+    // the run loop owns the context from here, native_kill has already detached it.
     handlerCtxtCleanup(hc, env);
+    free(hc);
     logI("Native carrier node exited");
     return JNI_TRUE;
 }
@@ -125,14 +216,30 @@ jboolean carrierRun(JNIEnv* env, jobject thiz, jint jinterval)
 static
 void carrierKill(JNIEnv* env, jobject thiz)
 {
-    HandlerContext* hc = getContext(env, thiz);
+    IOEXCarrier* carrier;
+    HandlerContext* hc;
+    int running;
+
+    pthread_mutex_lock(&gHandoffLock);
+    hc = getContext(env, thiz);
+    if (!hc) {
+        pthread_mutex_unlock(&gHandoffLock);
+        return;
+    }
     assert(hc->nativeCarrier);
 
-    IOEX_kill(hc->nativeCarrier);
-    if (!hc->env)
-        handlerCtxtCleanup(hc, env);
+    setLongField(env, thiz, gJni.carrier.nativeCookie, 0);
+    running = (hc->state == HandlerState_Running);
+    hc->state = HandlerState_Killed;
+    carrier = hc->nativeCarrier;
+    pthread_mutex_unlock(&gHandoffLock);
 
-    setLongField(env, thiz, "nativeCookie", 0);
+    // Once running, the context belongs to native_run and may be gone by now.
+    IOEX_kill(carrier);
+    if (!running) {
+        handlerCtxtCleanup(hc, env);
+        free(hc);
+    }
 }
 
 static
@@ -322,7 +429,7 @@ jobject getPresence(JNIEnv *env, jobject thiz)
         return NULL;
     }
 
-    return jpresence;
+    return (*env)->NewLocalRef(env, jpresence);
 }
 
 static
@@ -332,74 +439,94 @@ jboolean isReady(JNIEnv *env, jobject thiz)
 }
 
 static
-bool friendIteratedCallback(const IOEXFriendInfo* friendInfo, void* context)
+bool friendSnapshotCallback(const IOEXFriendInfo* friendInfo, void* context)
 {
-    jobject jfriendInfo = NULL;
-
-    ARG(context, 0, JNIEnv*, env);
-    ARG(context, 1, jobject, jiterator);
-    ARG(context, 2, jobject, jcontext);
+    ARG(context, 0, FriendsSnapshot*, fs);
+    ARG(context, 1, int*, failed);
 
-    if (friendInfo) {
-        if (!newJavaFriendInfo(env, friendInfo, &jfriendInfo)) {
-            logE("Construct Java FriendInfo object error");
-            return false;
-        }
-    }
+    if (!friendInfo)
+        return false;
 
-    jboolean result = JNI_FALSE;
-    if (!callBooleanMethod(env, NULL, jiterator, "onIterated",
-                       "("_W("FriendInfo;")_J("Object;)Z"),
-                       &result, jfriendInfo, jcontext)) {
-        logE("Call method boolean onIterated(FriendInfo, Object error");
+    if (!friendsSnapshotAppend(fs, friendInfo)) {
+        *failed = 1;
+        return false;
     }
-
-    if (jfriendInfo)
-        (*env)->DeleteLocalRef(env, jfriendInfo);
-
-    return result;
+    return true;
 }
 
 static
-jboolean getFriends(JNIEnv* env, jobject thiz, jobject friendIterator, jobject context)
+jobject getFriendsSnapshot(JNIEnv* env, jobject thiz)
 {
+    FriendsSnapshot fs;
+    jobject jsnapshot;
+    int failed = 0;
     void* argv[] = {
-        env,
-        friendIterator,
-        context
+        &fs,
+        &failed
     };
     int rc;
 
-    assert(friendIterator);
+    friendsSnapshotInit(&fs);
 
-    rc = IOEX_get_friends(getCarrier(env, thiz), friendIteratedCallback, (void*)argv);
+    rc = IOEX_get_friends(getCarrier(env, thiz), friendSnapshotCallback, (void*)argv);
     if (rc < 0) {
         logE("Call IOEX_get_friends API error");
         setErrorCode(IOEX_get_error());
-        return JNI_FALSE;
+        friendsSnapshotCleanup(&fs);
+        return NULL;
     }
-    return JNI_TRUE;
+
+    if (failed) {
+        logE("Pack friends snapshot error");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        friendsSnapshotCleanup(&fs);
+        return NULL;
+    }
+
+    jsnapshot = friendsSnapshotToJava(env, &fs);
+    friendsSnapshotCleanup(&fs);
+
+    if (!jsnapshot) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
+        return NULL;
+    }
+
+    return jsnapshot;
+}
+
+/* A file position is sent as a decimal string of at most 64 bits. */
+#define FILE_POSITION_LEN   20
+
+/*
+ * String arguments are copied into stack buffers sized by the carrier
+ * limits, so marshalling them costs no heap allocation and nothing needs
+ * to be released afterwards.
+ */
+static
+int getStringArg(JNIEnv* env, jstring jstr, char* buf, int length)
+{
+    if (!getStringRegion(env, jstr, buf, length)) {
+        logE("String argument exceeds %d bytes", length - 1);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+        return 0;
+    }
+    return 1;
 }
 
 static
 jobject getFriend(JNIEnv* env, jobject thiz, jstring jfriendId)
 {
-    const char *friendId;
+    char friendId[IOEX_MAX_ID_LEN + 1];
     IOEXFriendInfo fi;
     jobject jfriendInfo = NULL;
     int rc;
 
     assert(jfriendId);
 
-    friendId = (*env)->GetStringUTFChars(env, jfriendId, NULL);
-    if (!friendId) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfriendId, friendId, sizeof(friendId)))
         return NULL;
-    }
 
     rc = IOEX_get_friend_info(getCarrier(env, thiz), friendId, &fi);
-    (*env)->ReleaseStringUTFChars(env, jfriendId, friendId);
-
     if (rc < 0) {
         logE("Call IOEX_get_friend_info API error");
         setErrorCode(IOEX_get_error());
@@ -417,29 +544,18 @@ jobject getFriend(JNIEnv* env, jobject thiz, jstring jfriendId)
 static
 jboolean labelFriend(JNIEnv* env, jobject thiz, jstring jfriendId, jstring jlabel)
 {
-    const char *friendId;
-    const char *label;
+    char friendId[IOEX_MAX_ID_LEN + 1];
+    char label[IOEX_MAX_USER_NAME_LEN + 1];
     int rc;
 
     assert(jfriendId);
     assert(jlabel);
 
-    friendId = (*env)->GetStringUTFChars(env, jfriendId, NULL);
-    if (!friendId) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfriendId, friendId, sizeof(friendId)) ||
+        !getStringArg(env, jlabel, label, sizeof(label)))
         return JNI_FALSE;
-    }
-    label = (*env)->GetStringUTFChars(env, jlabel, NULL);
-    if (!label) {
-        (*env)->ReleaseStringUTFChars(env, jfriendId, friendId);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
 
     rc = IOEX_set_friend_label(getCarrier(env, thiz), friendId, label);
-    (*env)->ReleaseStringUTFChars(env, jfriendId, friendId);
-    (*env)->ReleaseStringUTFChars(env, jlabel, label);
-
     if (rc < 0) {
         logE("Call IOEX_set_friend_label API error");
         setErrorCode(IOEX_get_error());
@@ -451,50 +567,31 @@ jboolean labelFriend(JNIEnv* env, jobject thiz, jstring jfriendId, jstring jlabe
 static
 jboolean isFriend(JNIEnv* env, jobject thiz, jstring juserId)
 {
-    const char *userId;
-    bool rc;
+    char userId[IOEX_MAX_ID_LEN + 1];
 
     assert(juserId);
 
-    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
-    if (!userId) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, juserId, userId, sizeof(userId)))
         return JNI_FALSE;
-    }
 
-    rc = IOEX_is_friend(getCarrier(env, thiz), userId);
-    (*env)->ReleaseStringUTFChars(env, juserId, userId);
-
-    return (jboolean)rc;
+    return (jboolean)IOEX_is_friend(getCarrier(env, thiz), userId);
 }
 
 static
 jboolean addFriend(JNIEnv* env, jobject thiz, jstring jaddress, jstring jhello)
 {
-    const char *address;
-    const char *hello;
+    char address[IOEX_MAX_ADDRESS_LEN + 1];
+    char hello[IOEX_MAX_APP_MESSAGE_LEN + 1];
     int rc;
 
     assert(jaddress);
     assert(jhello);
 
-    address = (*env)->GetStringUTFChars(env, jaddress, NULL);
-    if (!address) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
-
-    hello = (*env)->GetStringUTFChars(env, jhello, NULL);
-    if (!hello) {
-        (*env)->ReleaseStringUTFChars(env, jaddress, address);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jaddress, address, sizeof(address)) ||
+        !getStringArg(env, jhello, hello, sizeof(hello)))
         return JNI_FALSE;
-    }
 
     rc = IOEX_add_friend(getCarrier(env, thiz), address, hello);
-    (*env)->ReleaseStringUTFChars(env, jaddress, address);
-    (*env)->ReleaseStringUTFChars(env, jhello, hello);
-
     if (rc < 0) {
         logE("Call IOEX_add_friend API error (0x%x)", IOEX_get_error());
         setErrorCode(IOEX_get_error());
@@ -506,18 +603,15 @@ jboolean addFriend(JNIEnv* env, jobject thiz, jstring jaddress, jstring jhello)
 static
 jboolean acceptFriend(JNIEnv* env, jobject thiz, jstring juserId)
 {
-    const char* userId;
+    char userId[IOEX_MAX_ID_LEN + 1];
     int rc;
 
-    userId = (*env)->GetStringUTFChars(env, juserId, NULL);
-    if (!userId) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    assert(juserId);
+
+    if (!getStringArg(env, juserId, userId, sizeof(userId)))
         return JNI_FALSE;
-    }
 
     rc = IOEX_accept_friend(getCarrier(env, thiz), userId);
-    (*env)->ReleaseStringUTFChars(env, juserId, userId);
-
     if (rc < 0) {
         logE("Call IOEX_accept_friend API error");
         setErrorCode(IOEX_get_error());
@@ -529,20 +623,15 @@ jboolean acceptFriend(JNIEnv* env, jobject thiz, jstring juserId)
 static
 jboolean removeFriend(JNIEnv* env, jobject thiz, jstring jfriendId)
 {
-    const char *friendId;
+    char friendId[IOEX_MAX_ID_LEN + 1];
     int rc;
 
     assert(jfriendId);
 
-    friendId = (*env)->GetStringUTFChars(env, jfriendId, NULL);
-    if (!friendId) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfriendId, friendId, sizeof(friendId)))
         return JNI_FALSE;
-    }
 
     rc = IOEX_remove_friend(getCarrier(env, thiz), friendId);
-    (*env)->ReleaseStringUTFChars(env, jfriendId, friendId);
-
     if (rc < 0) {
         logE("Call IOEX_remove_friend API error");
         setErrorCode(IOEX_get_error());
@@ -554,30 +643,55 @@ jboolean removeFriend(JNIEnv* env, jobject thiz, jstring jfriendId)
 static
 jboolean sendMessage(JNIEnv* env, jobject thiz, jstring jto, jstring jmsg)
 {
-    const char *to;
-    const char *msg;
+    char to[IOEX_MAX_ID_LEN + 1];
+    char msg[IOEX_MAX_APP_MESSAGE_LEN];
     int rc;
 
     assert(jto);
     assert(jmsg);
 
-    to = (*env)->GetStringUTFChars(env, jto, NULL);
-    if (!to) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jto, to, sizeof(to)) ||
+        !getStringArg(env, jmsg, msg, sizeof(msg)))
+        return JNI_FALSE;
+
+    rc = IOEX_send_friend_message(getCarrier(env, thiz), to, msg, strlen(msg) + 1);
+    if (rc < 0) {
+        logE("Call IOEX_send_friend_message API error");
+        setErrorCode(IOEX_get_error());
         return JNI_FALSE;
     }
+    return JNI_TRUE;
+}
 
-    msg = (*env)->GetStringUTFChars(env, jmsg, NULL);
-    if (!msg) {
-        (*env)->ReleaseStringUTFChars(env, jto, to);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+static
+jboolean sendBinaryMessage(JNIEnv* env, jobject thiz, jstring jto, jbyteArray jdata,
+                           jint offset, jint length)
+{
+    char to[IOEX_MAX_ID_LEN + 1];
+    jbyte data[IOEX_MAX_APP_MESSAGE_LEN];
+    int rc;
+
+    assert(jto);
+    assert(jdata);
+    assert(offset >= 0 && length > 0);
+
+    if (!getStringArg(env, jto, to, sizeof(to)))
+        return JNI_FALSE;
+
+    if (length > IOEX_MAX_APP_MESSAGE_LEN) {
+        logE("Binary message exceeds %d bytes", IOEX_MAX_APP_MESSAGE_LEN);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
         return JNI_FALSE;
     }
 
-    rc = IOEX_send_friend_message(getCarrier(env, thiz), to, msg, strlen(msg) + 1);
-    (*env)->ReleaseStringUTFChars(env, jto, to);
-    (*env)->ReleaseStringUTFChars(env, jmsg, msg);
+    (*env)->GetByteArrayRegion(env, jdata, offset, length, data);
+    if ((*env)->ExceptionCheck(env)) {
+        (*env)->ExceptionClear(env);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+        return JNI_FALSE;
+    }
 
+    rc = IOEX_send_friend_message(getCarrier(env, thiz), to, data, (size_t)length);
     if (rc < 0) {
         logE("Call IOEX_send_friend_message API error");
         setErrorCode(IOEX_get_error());
@@ -587,44 +701,63 @@ jboolean sendMessage(JNIEnv* env, jobject thiz, jstring jto, jstring jmsg)
 }
 
 static
-jstring sendFile(JNIEnv* env, jobject thiz, jstring jto, jstring jfilename)
+jboolean sendDirectMessage(JNIEnv* env, jobject thiz, jstring jto, jobject jbuffer,
+                           jint position, jint limit)
 {
-    const char *to;
-    const char *filename;
-    char fileid[100];
-    char *fileidPtr = fileid;
+    char to[IOEX_MAX_ID_LEN + 1];
+    uint8_t *address;
     int rc;
-    jstring jfileid;
 
     assert(jto);
-    assert(jfilename);
+    assert(jbuffer);
+    assert(position >= 0 && position < limit);
 
-    to = (*env)->GetStringUTFChars(env, jto, NULL);
-    if (!to) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jto, to, sizeof(to)))
+        return JNI_FALSE;
+
+    address = (uint8_t*)(*env)->GetDirectBufferAddress(env, jbuffer);
+    if (!address || (*env)->GetDirectBufferCapacity(env, jbuffer) < (jlong)limit) {
+        logE("Buffer is not a direct ByteBuffer or beyond its capacity");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
         return JNI_FALSE;
     }
 
-    filename = (*env)->GetStringUTFChars(env, jfilename, NULL);
-    if (!filename) {
-        (*env)->ReleaseStringUTFChars(env, jto, to);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    rc = IOEX_send_friend_message(getCarrier(env, thiz), to, address + position,
+                                  (size_t)(limit - position));
+    if (rc < 0) {
+        logE("Call IOEX_send_friend_message API error");
+        setErrorCode(IOEX_get_error());
         return JNI_FALSE;
     }
+    return JNI_TRUE;
+}
+
+static
+jstring sendFile(JNIEnv* env, jobject thiz, jstring jto, jstring jfilename)
+{
+    char to[IOEX_MAX_ID_LEN + 1];
+    char filename[IOEX_MAX_FILE_NAME_LEN + 1];
+    char fileid[IOEX_MAX_FILE_ID_LEN + 1];
+    int rc;
+    jstring jfileid;
+
+    assert(jto);
+    assert(jfilename);
 
-    rc = IOEX_send_file_request(getCarrier(env, thiz), fileidPtr, sizeof(fileid), to, filename);
-    (*env)->ReleaseStringUTFChars(env, jto, to);
-    (*env)->ReleaseStringUTFChars(env, jfilename, filename);
+    if (!getStringArg(env, jto, to, sizeof(to)) ||
+        !getStringArg(env, jfilename, filename, sizeof(filename)))
+        return NULL;
 
+    rc = IOEX_send_file_request(getCarrier(env, thiz), fileid, sizeof(fileid), to, filename);
     if (rc < 0) {
         logE("Call IOEX_send_file_request API error");
         setErrorCode(IOEX_get_error());
-        return JNI_FALSE;
+        return NULL;
     }
 
-    jfileid = (*env)->NewStringUTF(env, fileidPtr);
+    jfileid = (*env)->NewStringUTF(env, fileid);
     if (!jfileid) {
-        logE("Can not convert C-string(%s) to JAVA-String", fileidPtr);
+        logE("Can not convert C-string(%s) to JAVA-String", fileid);
         setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
         return NULL;
     }
@@ -635,40 +768,21 @@ jstring sendFile(JNIEnv* env, jobject thiz, jstring jto, jstring jfilename)
 static
 jboolean queryFile(JNIEnv* env, jobject thiz, jstring jfrinendid, jstring jfilename, jstring jmessage)
 {
-    const char *friendid;
-    const char *filename;
-    const char *message;
+    char friendid[IOEX_MAX_ID_LEN + 1];
+    char filename[IOEX_MAX_FILE_NAME_LEN + 1];
+    char message[IOEX_MAX_APP_MESSAGE_LEN];
     int rc;
 
     assert(jfrinendid);
     assert(jfilename);
+    assert(jmessage);
 
-    friendid = (*env)->GetStringUTFChars(env, jfrinendid, NULL);
-    if (!friendid) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
-
-    filename = (*env)->GetStringUTFChars(env, jfilename, NULL);
-    if (!filename) {
-        (*env)->ReleaseStringUTFChars(env, jfrinendid, friendid);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfrinendid, friendid, sizeof(friendid)) ||
+        !getStringArg(env, jfilename, filename, sizeof(filename)) ||
+        !getStringArg(env, jmessage, message, sizeof(message)))
         return JNI_FALSE;
-    }
-
-    message = (*env)->GetStringUTFChars(env, jmessage, NULL);
-    if (!message) {
-        (*env)->ReleaseStringUTFChars(env, jfrinendid, friendid);
-        (*env)->ReleaseStringUTFChars(env, jfilename, filename);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
 
     rc = IOEX_send_file_query(getCarrier(env, thiz), friendid, filename, message);
-    (*env)->ReleaseStringUTFChars(env, jfrinendid, friendid);
-    (*env)->ReleaseStringUTFChars(env, jfilename, filename);
-    (*env)->ReleaseStringUTFChars(env, jmessage, message);
-
     if (rc < 0) {
         logE("Call IOEX_send_file_query API error");
         setErrorCode(IOEX_get_error());
@@ -680,30 +794,18 @@ jboolean queryFile(JNIEnv* env, jobject thiz, jstring jfrinendid, jstring jfilen
 static
 jboolean seekFile(JNIEnv* env, jobject thiz, jstring jfileid, jstring jposition)
 {
-    const char *fileid;
-    const char *position;
+    char fileid[IOEX_MAX_FILE_ID_LEN + 1];
+    char position[FILE_POSITION_LEN + 1];
     int rc;
 
     assert(jfileid);
     assert(jposition);
 
-    fileid = (*env)->GetStringUTFChars(env, jfileid, NULL);
-    if (!fileid) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
-
-    position = (*env)->GetStringUTFChars(env, jposition, NULL);
-    if (!position) {
-        (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfileid, fileid, sizeof(fileid)) ||
+        !getStringArg(env, jposition, position, sizeof(position)))
         return JNI_FALSE;
-    }
 
     rc = IOEX_send_file_seek(getCarrier(env, thiz), fileid, position);
-    (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-    (*env)->ReleaseStringUTFChars(env, jposition, position);
-
     if (rc < 0) {
         logE("Call IOEX_send_file_seek API error");
         setErrorCode(IOEX_get_error());
@@ -715,42 +817,23 @@ jboolean seekFile(JNIEnv* env, jobject thiz, jstring jfileid, jstring jposition)
 static
 jboolean acceptFile(JNIEnv* env, jobject thiz, jstring jfileid, jstring jfilename, jstring jfilepath)
 {
-    const char *fileid;
-    const char *filename;
-    const char *filepath;
+    char fileid[IOEX_MAX_FILE_ID_LEN + 1];
+    char filename[IOEX_MAX_FILE_NAME_LEN + 1];
+    char filepath[IOEX_MAX_FILE_PATH_LEN + 1];
     int rc;
 
     assert(jfileid);
     assert(jfilename);
     assert(jfilepath);
 
-    fileid = (*env)->GetStringUTFChars(env, jfileid, NULL);
-    if (!fileid) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
-
-    filename = (*env)->GetStringUTFChars(env, jfilename, NULL);
-    if (!filename) {
-        (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfileid, fileid, sizeof(fileid)) ||
+        !getStringArg(env, jfilename, filename, sizeof(filename)) ||
+        !getStringArg(env, jfilepath, filepath, sizeof(filepath)))
         return JNI_FALSE;
-    }
 
-    filepath = (*env)->GetStringUTFChars(env, jfilepath, NULL);
-    if (!filepath) {
-        (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-        (*env)->ReleaseStringUTFChars(env, jfilename, filename);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
-    logE("filepath: %s" , filepath);
+    logD("Accept file %s to %s", fileid, filepath);
 
     rc = IOEX_send_file_accept(getCarrier(env, thiz), fileid, filename, filepath);
-    (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-    (*env)->ReleaseStringUTFChars(env, jfilename, filename);
-    (*env)->ReleaseStringUTFChars(env, jfilepath, filepath);
-
     if (rc < 0) {
         logE("Call IOEX_send_file_accept API error");
         setErrorCode(IOEX_get_error());
@@ -762,20 +845,15 @@ jboolean acceptFile(JNIEnv* env, jobject thiz, jstring jfileid, jstring jfilenam
 static
 jboolean pauseFile(JNIEnv* env, jobject thiz, jstring jfileid)
 {
-    const char *fileid;
+    char fileid[IOEX_MAX_FILE_ID_LEN + 1];
     int rc;
 
     assert(jfileid);
 
-    fileid = (*env)->GetStringUTFChars(env, jfileid, NULL);
-    if (!fileid) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfileid, fileid, sizeof(fileid)))
         return JNI_FALSE;
-    }
 
     rc = IOEX_send_file_pause(getCarrier(env, thiz), fileid);
-    (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-
     if (rc < 0) {
         logE("Call IOEX_send_file_pause API error");
         setErrorCode(IOEX_get_error());
@@ -787,20 +865,15 @@ jboolean pauseFile(JNIEnv* env, jobject thiz, jstring jfileid)
 static
 jboolean resumeFile(JNIEnv* env, jobject thiz, jstring jfileid)
 {
-    const char *fileid;
+    char fileid[IOEX_MAX_FILE_ID_LEN + 1];
     int rc;
 
     assert(jfileid);
 
-    fileid = (*env)->GetStringUTFChars(env, jfileid, NULL);
-    if (!fileid) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfileid, fileid, sizeof(fileid)))
         return JNI_FALSE;
-    }
 
     rc = IOEX_send_file_resume(getCarrier(env, thiz), fileid);
-    (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-
     if (rc < 0) {
         logE("Call IOEX_send_file_resume API error");
         setErrorCode(IOEX_get_error());
@@ -812,20 +885,15 @@ jboolean resumeFile(JNIEnv* env, jobject thiz, jstring jfileid)
 static
 jboolean cancelFile(JNIEnv* env, jobject thiz, jstring jfileid)
 {
-    const char *fileid;
+    char fileid[IOEX_MAX_FILE_ID_LEN + 1];
     int rc;
 
     assert(jfileid);
 
-    fileid = (*env)->GetStringUTFChars(env, jfileid, NULL);
-    if (!fileid) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jfileid, fileid, sizeof(fileid)))
         return JNI_FALSE;
-    }
 
     rc = IOEX_send_file_cancel(getCarrier(env, thiz), fileid);
-    (*env)->ReleaseStringUTFChars(env, jfileid, fileid);
-
     if (rc < 0) {
         logE("Call IOEX_send_file_cancel API error");
         setErrorCode(IOEX_get_error());
@@ -843,7 +911,6 @@ void friendInviteRspCallback(IOEXCarrier* carrier, const char* from, int status,
     jstring jdata = NULL;
 
     (void)carrier;
-    (void)length;
 
     ARG(context, 0, JNIEnv*, env);
     ARG(context, 1, jobject, jhandler);
@@ -854,16 +921,16 @@ void friendInviteRspCallback(IOEXCarrier* carrier, const char* from, int status,
         goto cleanup;
 
     if (status != 0)
-        jreason = (*env)->NewStringUTF(env, reason);
+        jreason = newStringFromUtf8(env, reason, strlen(reason));
     else
-        jdata = (*env)->NewStringUTF(env, (const char *)data);
+        jdata = newStringFromUtf8(env, data, length);
 
     if (!jreason && !jdata) {
         (*env)->DeleteLocalRef(env, jfrom);
         goto cleanup;
     }
-    if (!callVoidMethod(env, NULL, jhandler, "onReceived",
-                        "("_J("String;I")_J("String;")_J("String;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_INVITE_RESPONSE, jhandler,
+                        gJni.inviteResponseHandler.onReceived,
                         jfrom, status, jreason, jdata)) {
         logE("Call method 'void onReceived(String, int, String, String)' error");
     }
@@ -880,9 +947,9 @@ static
 jboolean inviteFriend(JNIEnv* env, jobject thiz, jstring jto, jstring jdata,
                       jobject jresponseHandler)
 {
-    const char* to = NULL;
-    const char* data = NULL;
-    jobject gjhandler = NULL;
+    char to[IOEX_MAX_ID_LEN + 1];
+    char data[IOEX_MAX_APP_MESSAGE_LEN];
+    jobject gjhandler;
     void** argv;
     int rc;
 
@@ -890,17 +957,14 @@ jboolean inviteFriend(JNIEnv* env, jobject thiz, jstring jto, jstring jdata,
     assert(jdata);
     assert(jresponseHandler);
 
-    to = (*env)->GetStringUTFChars(env, jto, NULL);
-    data = (*env)->GetStringUTFChars(env, jdata, NULL);
-    if (!to || !data) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        goto errorExit;
-    }
+    if (!getStringArg(env, jto, to, sizeof(to)) ||
+        !getStringArg(env, jdata, data, sizeof(data)))
+        return JNI_FALSE;
 
     gjhandler = (*env)->NewGlobalRef(env, jresponseHandler);
     if (!gjhandler) {
         setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
-        goto errorExit;
+        return JNI_FALSE;
     }
 
     argv = (void**)calloc(1, sizeof(void*) * 4);
@@ -913,12 +977,6 @@ jboolean inviteFriend(JNIEnv* env, jobject thiz, jstring jto, jstring jdata,
 
     rc  = IOEX_invite_friend(getCarrier(env, thiz), to, data, strlen(data) + 1,
                             friendInviteRspCallback, (void*)argv);
-
-    (*env)->ReleaseStringUTFChars(env, jto, to);
-    (*env)->ReleaseStringUTFChars(env, jdata, data);
-    to = NULL;
-    data = NULL;
-
     if (rc < 0) {
         logE("Call IOEX_invite_friend API error");
         setErrorCode(IOEX_get_error());
@@ -928,9 +986,7 @@ jboolean inviteFriend(JNIEnv* env, jobject thiz, jstring jto, jstring jdata,
     return JNI_TRUE;
 
 errorExit:
-    if (to) (*env)->ReleaseStringUTFChars(env, jto, to);
-    if (data) (*env)->ReleaseStringUTFChars(env, jdata, data);
-    if (gjhandler) (*env)->DeleteWeakGlobalRef(env, gjhandler);
+    (*env)->DeleteGlobalRef(env, gjhandler);
     return JNI_FALSE;
 }
 
@@ -938,7 +994,8 @@ static
 jboolean replyFriendInvite(JNIEnv* env, jobject thiz, jstring jto, jint jstatus,
                            jstring jreason, jstring jdata)
 {
-    const char *to = NULL;
+    char to[IOEX_MAX_ID_LEN + 1];
+    char text[IOEX_MAX_APP_MESSAGE_LEN];
     const char *reason = NULL;
     const char *data = NULL;
     int rc;
@@ -947,31 +1004,17 @@ jboolean replyFriendInvite(JNIEnv* env, jobject thiz, jstring jto, jint jstatus,
     assert(jstatus == 0 || (jstatus != 0 && jreason != NULL));
     assert((jstatus == 0 && jdata != NULL) || (jstatus != 0));
 
-    to = (*env)->GetStringUTFChars(env, jto, NULL);
-    if (!to) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    if (!getStringArg(env, jto, to, sizeof(to)) ||
+        !getStringArg(env, jstatus != 0 ? jreason : jdata, text, sizeof(text)))
         return JNI_FALSE;
-    }
-
-    if (jstatus != 0) {
-        reason = (*env)->GetStringUTFChars(env, jreason, NULL);
-    } else {
-        data   = (*env)->GetStringUTFChars(env, jdata, NULL);
-    }
 
-    if (!reason && !data) {
-        (*env)->ReleaseStringUTFChars(env, jto, to);
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        return JNI_FALSE;
-    }
+    if (jstatus != 0)
+        reason = text;
+    else
+        data = text;
 
     rc  = IOEX_reply_friend_invite(getCarrier(env, thiz), to, jstatus, reason,
                                   data, data ? strlen(data) + 1 : 0);
-
-    (*env)->ReleaseStringUTFChars(env, jto, to);
-    if (data)   (*env)->ReleaseStringUTFChars(env, jdata, data);
-    if (reason) (*env)->ReleaseStringUTFChars(env, jreason, reason);
-
     if (rc < 0) {
         logE("Call IOEX_reply_friend_invite API error");
         setErrorCode(IOEX_get_error());
@@ -980,6 +1023,30 @@ jboolean replyFriendInvite(JNIEnv* env, jobject thiz, jstring jto, jint jstatus,
     return JNI_TRUE;
 }
 
+static
+jlongArray getDispatchStats(JNIEnv* env, jobject thiz)
+{
+    HandlerContext* hc = getContext(env, thiz);
+    int64_t stats[DispatchStat_Count];
+    jlongArray jstats;
+
+    if (!hc || !hc->dispatcher) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return NULL;
+    }
+
+    dispatcherGetStats(hc->dispatcher, stats);
+
+    jstats = (*env)->NewLongArray(env, DispatchStat_Count);
+    if (!jstats) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
+        return NULL;
+    }
+
+    (*env)->SetLongArrayRegion(env, jstats, 0, DispatchStat_Count, (const jlong*)stats);
+    return jstats;
+}
+
 static
 jint getErrorCode(JNIEnv* env, jclass clazz)
 {
@@ -989,6 +1056,192 @@ jint getErrorCode(JNIEnv* env, jclass clazz)
     return _getErrorCode();
 }
 
+static
+jlong getAttachCount(JNIEnv* env, jclass clazz)
+{
+    (void)env;
+    (void)clazz;
+
+    return (jlong)getJvmAttachCount();
+}
+
+static
+jobject getCallbackLatencyStats(JNIEnv* env, jclass clazz)
+{
+    int64_t values[UPCALL_COUNT * UPCALL_STATS_STRIDE];
+    jobjectArray jnames;
+    jlongArray jvalues;
+    jobject jstats = NULL;
+    int i;
+
+    (void)clazz;
+
+    upcallStatsGet(values);
+
+    jnames = (*env)->NewObjectArray(env, UPCALL_COUNT, gJni.string.clazz, NULL);
+    if (!jnames) {
+        (*env)->ExceptionClear(env);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        return NULL;
+    }
+
+    for (i = 0; i < UPCALL_COUNT; i++) {
+        jstring jname = (*env)->NewStringUTF(env, upcallName(i));
+        if (!jname) {
+            (*env)->ExceptionClear(env);
+            (*env)->DeleteLocalRef(env, jnames);
+            setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+            return NULL;
+        }
+        (*env)->SetObjectArrayElement(env, jnames, i, jname);
+        (*env)->DeleteLocalRef(env, jname);
+    }
+
+    jvalues = (*env)->NewLongArray(env, UPCALL_COUNT * UPCALL_STATS_STRIDE);
+    if (!jvalues) {
+        (*env)->ExceptionClear(env);
+        (*env)->DeleteLocalRef(env, jnames);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        return NULL;
+    }
+    (*env)->SetLongArrayRegion(env, jvalues, 0, UPCALL_COUNT * UPCALL_STATS_STRIDE,
+                               (const jlong*)values);
+
+    jstats = (*env)->NewObject(env, gJni.callbackLatencyStats.clazz,
+                               gJni.callbackLatencyStats.init, jnames, jvalues);
+    if (!jstats) {
+        logE("New java CallbackLatencyStats object error");
+        (*env)->ExceptionClear(env);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
+    }
+
+    (*env)->DeleteLocalRef(env, jnames);
+    (*env)->DeleteLocalRef(env, jvalues);
+    return jstats;
+}
+
+static
+void setSlowCallbackThreshold(JNIEnv* env, jclass clazz, jint ms)
+{
+    (void)env;
+    (void)clazz;
+
+    upcallStatsSetSlowThreshold((int)ms);
+}
+
+static
+void setLogLevel(JNIEnv* env, jclass clazz, jint level)
+{
+    (void)env;
+    (void)clazz;
+
+    IOEX_log_init((IOEXLogLevel)level, NULL, NULL);
+    logSetLevel((int)level);
+}
+
+static
+jboolean setAsyncLogging(JNIEnv* env, jclass clazz, jboolean enable)
+{
+    (void)env;
+    (void)clazz;
+
+    if (!enable) {
+        logStopAsync();
+        return JNI_TRUE;
+    }
+
+    if (!logStartAsync()) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+static
+jlongArray getProgressStats(JNIEnv* env, jobject thiz)
+{
+    HandlerContext* hc = getContext(env, thiz);
+    int64_t stats[2];
+    jlongArray jstats;
+
+    if (!hc) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return NULL;
+    }
+
+    progressThrottleGetStats(&hc->progress, &stats[0], &stats[1]);
+
+    jstats = (*env)->NewLongArray(env, 2);
+    if (!jstats) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
+        return NULL;
+    }
+
+    (*env)->SetLongArrayRegion(env, jstats, 0, 2, (const jlong*)stats);
+    return jstats;
+}
+
+static
+bool fileTransfersCallback(int direction, const IOEXTrackerInfo* info, void* context)
+{
+    ARG(context, 0, FileTransfers*, ft);
+    ARG(context, 1, int*, failed);
+
+    (void)direction;
+
+    if (!info)
+        return false;
+
+    if (!fileTransfersAppend(ft, info)) {
+        *failed = 1;
+        return false;
+    }
+    return true;
+}
+
+static
+jobject getFileTransfers(JNIEnv* env, jobject thiz)
+{
+    IOEXCarrier* carrier = getCarrier(env, thiz);
+    FileTransfers ft;
+    jobject jtransfers;
+    int failed = 0;
+    void* argv[] = {
+        &ft,
+        &failed
+    };
+    int rc;
+
+    fileTransfersInit(&ft);
+
+    rc = IOEX_get_files(carrier, fileTransfersCallback, (void*)argv);
+    if (rc < 0) {
+        logE("Call IOEX_get_files API error");
+        setErrorCode(IOEX_get_error());
+        fileTransfersCleanup(&ft);
+        return NULL;
+    }
+
+    if (failed) {
+        logE("Collect file transfers error");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        fileTransfersCleanup(&ft);
+        return NULL;
+    }
+
+    fileTransfersResolve(&ft, carrier);
+
+    jtransfers = fileTransfersToJava(env, &ft);
+    fileTransfersCleanup(&ft);
+
+    if (!jtransfers) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
+        return NULL;
+    }
+
+    return jtransfers;
+}
+
 static const char* gClassName = "org/ioex/carrier/Carrier";
 static JNINativeMethod gMethods[] = {
         {"native_init",        "("_W("Carrier$Options;")_W("Carrier$Callbacks;)Z"),
@@ -1004,7 +1257,7 @@ static JNINativeMethod gMethods[] = {
         {"set_presence",       "("_W("PresenceStatus;)Z"),         (void *) setPresence        },
         {"get_presence",       "()"_W("PresenceStatus;"),          (void *) getPresence        },
         {"is_ready",           "()Z",                              (void *) isReady            },
-        {"get_friends",        "("_W("FriendsIterator;")_J("Object;)Z"), (void *) getFriends   },
+        {"get_friends_snapshot", "()"_W("FriendsSnapshot;"),       (void *) getFriendsSnapshot },
         {"get_friend",         "("_J("String;)")_W("FriendInfo;"), (void *) getFriend          },
         {"label_friend",       "("_J("String;")_J("String;)Z"),    (void *) labelFriend        },
         {"is_friend",          "("_J("String;)Z"),                 (void *) isFriend           },
@@ -1012,6 +1265,9 @@ static JNINativeMethod gMethods[] = {
         {"accept_friend",      "("_J("String;)Z"),                 (void *) acceptFriend       },
         {"remove_friend",      "("_J("String;)Z"),                 (void *) removeFriend       },
         {"send_message",       "("_J("String;")_J("String;)Z"),    (void *) sendMessage        },
+        {"send_binary_message","("_J("String;")"[BII)Z",           (void *) sendBinaryMessage  },
+        {"send_direct_message","("_J("String;")"Ljava/nio/ByteBuffer;II)Z",\
+                                                                   (void *) sendDirectMessage  },
         {"send_file",          "("_J("String;")_J("String;")")"_J("String;"),\
                                                                    (void *) sendFile           },
         {"accept_file",        "("_J("String;")_J("String;")_J("String;)Z"),\
@@ -1026,7 +1282,16 @@ static JNINativeMethod gMethods[] = {
                                                                    (void*)inviteFriend         },
         {"reply_friend_invite","("_J("String;I")_J("String;")_J("String;)Z"),\
                                                                    (void*)replyFriendInvite    },
+        {"get_dispatch_stats", "()[J",                             (void*)getDispatchStats     },
+        {"get_progress_stats", "()[J",                             (void*)getProgressStats     },
+        {"get_file_transfers", "()"_W("FileTransfers;"),           (void*)getFileTransfers     },
         {"get_error_code",     "()I",                              (void*)getErrorCode         },
+        {"get_attach_count",   "()J",                              (void*)getAttachCount       },
+        {"get_callback_latency_stats", "()"_W("CallbackLatencyStats;"),
+                                                                   (void*)getCallbackLatencyStats },
+        {"set_slow_callback_threshold", "(I)V",                    (void*)setSlowCallbackThreshold },
+        {"set_log_level",      "(I)V",                             (void*)setLogLevel          },
+        {"set_async_logging",  "(Z)Z",                             (void*)setAsyncLogging      },
 };
 
 int registerCarrierMethods(JNIEnv* env)
@@ -50,12 +50,13 @@
 #include <IOEX_carrier.h>
 #include "utilsExt.h"
 #include "carrierHandler.h"
+#include "jniCache.h"
 
 static inline
 IOEXCarrier* getCarrier(JNIEnv* env, jobject thiz)
 {
     uint64_t ctxt = 0;
-    return getLongField(env, thiz, "nativeCookie", &ctxt) ? \
+    return getLongField(env, thiz, gJni.carrier.nativeCookie, &ctxt) ? \
            (ctxt ? ((HandlerContext*)ctxt)->nativeCarrier : NULL) : NULL;
 }
 
@@ -63,7 +64,7 @@ static inline
 HandlerContext* getContext(JNIEnv* env, jobject thiz)
 {
     uint64_t ctxt = 0;
-    return getLongField(env, thiz, "nativeCookie", &ctxt) ? \
+    return getLongField(env, thiz, gJni.carrier.nativeCookie, &ctxt) ? \
         (HandlerContext*)ctxt : NULL;
 }
 
@@ -71,7 +72,7 @@ static inline
 JNIEnv* getCarrierEnv(JNIEnv* env, jobject thiz)
 {
     uint64_t ctxt = 0;
-    return getLongField(env, thiz, "nativeCookie", &ctxt) ? \
+    return getLongField(env, thiz, gJni.carrier.nativeCookie, &ctxt) ? \
            (ctxt ? ((HandlerContext*)ctxt)->env : NULL) : NULL;
 }
 
@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "utils.h"
+#include "carrierDispatcher.h"
+
+#define MAX_DISPATCH_THREADS    8
+#define MAX_COALESCED_EVENTS    256
+
+/*
+ * Bounded MPMC ring after Dmitry Vyukov: every slot carries a sequence
+ * number telling producers and consumers whose turn it is, so neither side
+ * takes a lock. The mutex and condition variables below are only used to
+ * park idle dispatchers and blocked producers.
+ */
+typedef struct DispatchSlot {
+    uint64_t seq;
+    DispatchEvent ev;
+} DispatchSlot;
+
+struct CarrierDispatcher {
+    DispatchSlot* slots;
+    uint64_t mask;
+
+    uint64_t tail __attribute__((aligned(64)));
+    uint64_t head __attribute__((aligned(64)));
+
+    DispatchOverflow policy;
+    DispatchDeliver deliver;
+    DispatchRelease release;
+    void* context;
+
+    pthread_t threads[MAX_DISPATCH_THREADS];
+    int threadCount;
+    int stopped;
+
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    int sleepers;
+    int waiters;
+
+    /* Latest coalescable events parked while the ring was full */
+    pthread_mutex_t coalesceLock;
+    DispatchEvent coalesced[MAX_COALESCED_EVENTS];
+    int coalescedCount;
+
+    int64_t stats[DispatchStat_Count];
+};
+
+static
+int64_t nowNanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline
+void statAdd(CarrierDispatcher* d, int index, int64_t value)
+{
+    __atomic_add_fetch(&d->stats[index], value, __ATOMIC_RELAXED);
+}
+
+static inline
+void statMax(CarrierDispatcher* d, int index, int64_t value)
+{
+    int64_t cur = __atomic_load_n(&d->stats[index], __ATOMIC_RELAXED);
+
+    while (value > cur &&
+           !__atomic_compare_exchange_n(&d->stats[index], &cur, value, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static
+int tryPush(CarrierDispatcher* d, const DispatchEvent* ev)
+{
+    uint64_t pos = __atomic_load_n(&d->tail, __ATOMIC_RELAXED);
+    DispatchSlot* slot;
+
+    for (;;) {
+        slot = &d->slots[pos & d->mask];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t dif = (int64_t)(seq - pos);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&d->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (dif < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&d->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->ev = *ev;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static
+int tryPop(CarrierDispatcher* d, DispatchEvent* ev)
+{
+    uint64_t pos = __atomic_load_n(&d->head, __ATOMIC_RELAXED);
+    DispatchSlot* slot;
+
+    for (;;) {
+        slot = &d->slots[pos & d->mask];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t dif = (int64_t)(seq - (pos + 1));
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&d->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (dif < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&d->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    *ev = slot->ev;
+    __atomic_store_n(&slot->seq, pos + d->mask + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static
+int ringEmpty(CarrierDispatcher* d)
+{
+    uint64_t pos = __atomic_load_n(&d->head, __ATOMIC_RELAXED);
+    DispatchSlot* slot = &d->slots[pos & d->mask];
+
+    return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1;
+}
+
+static
+void wakeup(CarrierDispatcher* d, pthread_cond_t* cond, int* sleepers)
+{
+    // Pairs with the fence in the waiter: either it sees our change before
+    // sleeping or we see it counted as a sleeper here.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(sleepers, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&d->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&d->lock);
+    }
+}
+
+static
+void releaseEvent(CarrierDispatcher* d, DispatchEvent* ev)
+{
+    statAdd(d, DispatchStat_Dropped, 1);
+    d->release(d->context, ev);
+}
+
+static
+int coalesce(CarrierDispatcher* d, DispatchEvent* ev)
+{
+    int i;
+
+    pthread_mutex_lock(&d->coalesceLock);
+    for (i = 0; i < d->coalescedCount; i++) {
+        DispatchEvent* cur = &d->coalesced[i];
+
+        if (cur->type == ev->type && !strcmp(cur->id, ev->id)) {
+            d->release(d->context, cur);
+            *cur = *ev;
+            pthread_mutex_unlock(&d->coalesceLock);
+            statAdd(d, DispatchStat_Coalesced, 1);
+            return 1;
+        }
+    }
+
+    if (d->coalescedCount < MAX_COALESCED_EVENTS) {
+        d->coalesced[d->coalescedCount] = *ev;
+        __atomic_store_n(&d->coalescedCount, d->coalescedCount + 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&d->coalesceLock);
+        statAdd(d, DispatchStat_Enqueued, 1);
+        wakeup(d, &d->notEmpty, &d->sleepers);
+        return 1;
+    }
+    pthread_mutex_unlock(&d->coalesceLock);
+
+    releaseEvent(d, ev);
+    return 0;
+}
+
+static
+int takeCoalesced(CarrierDispatcher* d, DispatchEvent* ev)
+{
+    int found = 0;
+
+    if (__atomic_load_n(&d->coalescedCount, __ATOMIC_SEQ_CST) == 0)
+        return 0;
+
+    pthread_mutex_lock(&d->coalesceLock);
+    if (d->coalescedCount > 0) {
+        *ev = d->coalesced[d->coalescedCount - 1];
+        __atomic_store_n(&d->coalescedCount, d->coalescedCount - 1, __ATOMIC_SEQ_CST);
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->coalesceLock);
+    return found;
+}
+
+static
+void deliverEvent(CarrierDispatcher* d, JNIEnv* env, DispatchEvent* ev)
+{
+    int64_t latency = nowNanos() - ev->enqueuedNs;
+
+    statAdd(d, DispatchStat_Dispatched, 1);
+    statAdd(d, DispatchStat_TotalLatencyNs, latency);
+    statMax(d, DispatchStat_MaxLatencyNs, latency);
+
+    if (env)
+        d->deliver(env, d->context, ev);
+    else
+        d->release(d->context, ev);
+}
+
+static
+void* dispatchRoutine(void* arg)
+{
+    CarrierDispatcher* d = (CarrierDispatcher*)arg;
+    int needDetach = 0;
+    DispatchEvent ev;
+    JNIEnv* env;
+
+    env = attachJvm(&needDetach);
+    if (!env)
+        logE("Attach dispatcher thread to JVM error, events will be dropped");
+
+    for (;;) {
+        if (tryPop(d, &ev)) {
+            wakeup(d, &d->notFull, &d->waiters);
+            deliverEvent(d, env, &ev);
+            continue;
+        }
+
+        // Parked events are newer than anything that was in the ring when
+        // they were parked, so only hand them out once the ring drained.
+        if (takeCoalesced(d, &ev)) {
+            deliverEvent(d, env, &ev);
+            continue;
+        }
+
+        if (__atomic_load_n(&d->stopped, __ATOMIC_ACQUIRE))
+            break;
+
+        pthread_mutex_lock(&d->lock);
+        __atomic_add_fetch(&d->sleepers, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (ringEmpty(d) && !__atomic_load_n(&d->coalescedCount, __ATOMIC_SEQ_CST) &&
+            !__atomic_load_n(&d->stopped, __ATOMIC_ACQUIRE))
+            pthread_cond_wait(&d->notEmpty, &d->lock);
+        __atomic_sub_fetch(&d->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&d->lock);
+    }
+
+    if (env)
+        detachJvm(env, needDetach);
+    return NULL;
+}
+
+CarrierDispatcher* dispatcherCreate(int capacity, int threads, DispatchOverflow policy,
+                                    DispatchDeliver deliver, DispatchRelease release,
+                                    void* context)
+{
+    CarrierDispatcher* d;
+    uint64_t size = 2;
+    uint64_t i;
+
+    assert(capacity > 0);
+    assert(deliver);
+    assert(release);
+
+    while (size < (uint64_t)capacity)
+        size <<= 1;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_DISPATCH_THREADS)
+        threads = MAX_DISPATCH_THREADS;
+
+    d = (CarrierDispatcher*)calloc(1, sizeof(*d));
+    if (!d)
+        return NULL;
+
+    d->slots = (DispatchSlot*)calloc((size_t)size, sizeof(DispatchSlot));
+    if (!d->slots) {
+        free(d);
+        return NULL;
+    }
+
+    for (i = 0; i < size; i++)
+        d->slots[i].seq = i;
+
+    d->mask = size - 1;
+    d->policy = policy;
+    d->deliver = deliver;
+    d->release = release;
+    d->context = context;
+
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_mutex_init(&d->coalesceLock, NULL);
+    pthread_cond_init(&d->notEmpty, NULL);
+    pthread_cond_init(&d->notFull, NULL);
+
+    for (i = 0; i < (uint64_t)threads; i++) {
+        if (pthread_create(&d->threads[i], NULL, dispatchRoutine, d) != 0) {
+            logE("Create carrier dispatcher thread error");
+            break;
+        }
+        d->threadCount++;
+    }
+
+    if (d->threadCount == 0) {
+        dispatcherDestroy(d);
+        return NULL;
+    }
+
+    logI("Carrier dispatcher started with %d threads, %d slots",
+         d->threadCount, (int)size);
+    return d;
+}
+
+void dispatcherDestroy(CarrierDispatcher* d)
+{
+    DispatchEvent ev;
+    int i;
+
+    if (!d)
+        return;
+
+    __atomic_store_n(&d->stopped, 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&d->lock);
+    pthread_cond_broadcast(&d->notEmpty);
+    pthread_cond_broadcast(&d->notFull);
+    pthread_mutex_unlock(&d->lock);
+
+    for (i = 0; i < d->threadCount; i++)
+        pthread_join(d->threads[i], NULL);
+
+    // Nothing left to deliver them once the dispatcher threads are gone.
+    while (tryPop(d, &ev))
+        releaseEvent(d, &ev);
+    while (takeCoalesced(d, &ev))
+        releaseEvent(d, &ev);
+
+    pthread_cond_destroy(&d->notFull);
+    pthread_cond_destroy(&d->notEmpty);
+    pthread_mutex_destroy(&d->coalesceLock);
+    pthread_mutex_destroy(&d->lock);
+
+    free(d->slots);
+    free(d);
+}
+
+static
+int pushBlocking(CarrierDispatcher* d, DispatchEvent* ev)
+{
+    int pushed;
+
+    statAdd(d, DispatchStat_Blocked, 1);
+
+    pthread_mutex_lock(&d->lock);
+    __atomic_add_fetch(&d->waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (!(pushed = tryPush(d, ev)) && !__atomic_load_n(&d->stopped, __ATOMIC_ACQUIRE))
+        pthread_cond_wait(&d->notFull, &d->lock);
+    __atomic_sub_fetch(&d->waiters, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&d->lock);
+
+    return pushed;
+}
+
+int dispatcherPost(CarrierDispatcher* d, DispatchEvent* ev)
+{
+    int coalescable;
+    uint64_t depth;
+
+    assert(d);
+    assert(ev);
+
+    ev->enqueuedNs = nowNanos();
+
+    if (__atomic_load_n(&d->stopped, __ATOMIC_ACQUIRE)) {
+        releaseEvent(d, ev);
+        return 0;
+    }
+
+    coalescable = (d->policy == DispatchOverflow_Coalesce) &&
+                  (ev->flags & DISPATCH_EVENT_COALESCABLE);
+
+    // Once something is parked, later updates of the same kind must not
+    // overtake it through the ring.
+    if (coalescable && __atomic_load_n(&d->coalescedCount, __ATOMIC_SEQ_CST) > 0)
+        return coalesce(d, ev);
+
+    if (!tryPush(d, ev)) {
+        if (d->policy == DispatchOverflow_Drop) {
+            releaseEvent(d, ev);
+            return 0;
+        }
+
+        if (coalescable)
+            return coalesce(d, ev);
+
+        if (!pushBlocking(d, ev)) {
+            releaseEvent(d, ev);
+            return 0;
+        }
+    }
+
+    statAdd(d, DispatchStat_Enqueued, 1);
+    depth = __atomic_load_n(&d->tail, __ATOMIC_RELAXED) -
+            __atomic_load_n(&d->head, __ATOMIC_RELAXED);
+    statMax(d, DispatchStat_MaxDepth, (int64_t)depth);
+
+    wakeup(d, &d->notEmpty, &d->sleepers);
+    return 1;
+}
+
+void dispatcherGetStats(CarrierDispatcher* d, int64_t stats[DispatchStat_Count])
+{
+    uint64_t tail, head;
+    int i;
+
+    assert(d);
+
+    for (i = 0; i < DispatchStat_Count; i++)
+        stats[i] = __atomic_load_n(&d->stats[i], __ATOMIC_RELAXED);
+
+    tail = __atomic_load_n(&d->tail, __ATOMIC_RELAXED);
+    head = __atomic_load_n(&d->head, __ATOMIC_RELAXED);
+    stats[DispatchStat_Depth] = (tail > head ? (int64_t)(tail - head) : 0) +
+                                __atomic_load_n(&d->coalescedCount, __ATOMIC_RELAXED);
+}
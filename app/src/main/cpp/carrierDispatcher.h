@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __CARRIER_DISPATCHER_H__
+#define __CARRIER_DISPATCHER_H__
+
+#include <jni.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <IOEX_carrier.h>
+
+/*
+ * Moves carrier callbacks off the IOEX_run thread. Callbacks copy their
+ * arguments into a compact DispatchEvent and push it into a bounded
+ * lock-free ring; dedicated dispatcher threads pop events and deliver them
+ * to java, so a slow handler no longer stalls the carrier network loop.
+ */
+
+/* Values of org.ioex.carrier.Carrier.Options.OverflowPolicy */
+typedef enum DispatchOverflow {
+    /* Drop the new event when the ring is full. */
+    DispatchOverflow_Drop = 0,
+
+    /* Block the carrier thread until a dispatcher frees a slot. */
+    DispatchOverflow_Block = 1,
+
+    /*
+     * Keep only the latest coalescable event (friend presence and friend
+     * connection changes) per friend while the ring is full, block for all
+     * other events.
+     */
+    DispatchOverflow_Coalesce = 2
+} DispatchOverflow;
+
+#define DISPATCH_EVENT_COALESCABLE  0x01
+
+typedef struct DispatchEvent {
+    int type;
+    int flags;
+    int ival;
+    int64_t lval[2];
+    int64_t enqueuedNs;
+
+    /* Friend or user id the event is about, also the coalescing key */
+    char id[IOEX_MAX_ID_LEN + 1];
+
+    /* Heap copy of variable sized arguments, owned by the event */
+    void* payload;
+    size_t length;
+} DispatchEvent;
+
+/*
+ * deliver is called on a dispatcher thread, release whenever an event is
+ * dropped or replaced without being delivered. Both must free the payload.
+ */
+typedef void (*DispatchDeliver)(JNIEnv* env, void* context, DispatchEvent* ev);
+typedef void (*DispatchRelease)(void* context, DispatchEvent* ev);
+
+typedef struct CarrierDispatcher CarrierDispatcher;
+
+/* Indexes of the statistics array filled by dispatcherGetStats() */
+enum {
+    DispatchStat_Depth = 0,
+    DispatchStat_MaxDepth,
+    DispatchStat_Enqueued,
+    DispatchStat_Dispatched,
+    DispatchStat_Dropped,
+    DispatchStat_Coalesced,
+    DispatchStat_Blocked,
+    DispatchStat_TotalLatencyNs,
+    DispatchStat_MaxLatencyNs,
+    DispatchStat_Count
+};
+
+CarrierDispatcher* dispatcherCreate(int capacity, int threads, DispatchOverflow policy,
+                                    DispatchDeliver deliver, DispatchRelease release,
+                                    void* context);
+
+/*
+ * Stop accepting events, let the dispatcher threads deliver what is still
+ * queued, join them and free the dispatcher.
+ */
+void dispatcherDestroy(CarrierDispatcher* dispatcher);
+
+/*
+ * Queue one event, taking ownership of its payload. Returns 0 if the event
+ * was dropped (its payload has been released), otherwise 1.
+ */
+int dispatcherPost(CarrierDispatcher* dispatcher, DispatchEvent* ev);
+
+void dispatcherGetStats(CarrierDispatcher* dispatcher, int64_t stats[DispatchStat_Count]);
+
+#endif //__CARRIER_DISPATCHER_H__
@@ -45,11 +45,131 @@
 #include <jni.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
 #include "log.h"
 #include "utils.h"
 #include "IOEX_carrier.h"
 #include "carrierUtils.h"
 #include "carrierHandler.h"
+#include "jniCache.h"
+#include "utf8.h"
+#include "upcallStats.h"
+
+/*
+ * Every carrier callback is split in two: the cbOn* function runs on the
+ * IOEX_run thread and either delivers right away or, with async dispatch
+ * enabled, copies its arguments into a DispatchEvent; the deliver*
+ * function makes the java upcall on whichever thread owns env.
+ */
+enum {
+    EventIdle = 0,
+    EventConnection,
+    EventReady,
+    EventSelfInfo,
+    EventFriends,
+    EventFriendConnection,
+    EventFriendInfo,
+    EventFriendPresence,
+    EventFriendRequest,
+    EventFriendAdded,
+    EventFriendRemoved,
+    EventFriendMessage,
+    EventFriendInvite,
+    EventFileRequest,
+    EventFileAccepted,
+    EventFilePaused,
+    EventFileResumed,
+    EventFileCanceled,
+    EventFileCompleted,
+    EventFileProgress,
+    EventFileQueried
+};
+
+static
+void initEvent(DispatchEvent* ev, int type, const char* id)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->type = type;
+    if (id)
+        strncpy(ev->id, id, sizeof(ev->id) - 1);
+}
+
+static
+int setPayload(DispatchEvent* ev, const void* data, size_t len)
+{
+    ev->payload = malloc(len ? len : 1);
+    if (!ev->payload) {
+        logE("Copy carrier event payload error");
+        return 0;
+    }
+    memcpy(ev->payload, data, len);
+    ev->length = len;
+    return 1;
+}
+
+/*
+ * Pack count C-strings back to back (each with its terminator) into the
+ * event payload. NULL strings are stored as empty ones.
+ */
+static
+int setStringsPayload(DispatchEvent* ev, int count, ...)
+{
+    const char* strs[4];
+    size_t lens[4];
+    size_t total = 0;
+    va_list ap;
+    char* pos;
+    int i;
+
+    assert(count <= 4);
+
+    va_start(ap, count);
+    for (i = 0; i < count; i++) {
+        strs[i] = va_arg(ap, const char*);
+        lens[i] = strs[i] ? strlen(strs[i]) : 0;
+        total += lens[i] + 1;
+    }
+    va_end(ap);
+
+    pos = (char*)malloc(total);
+    if (!pos) {
+        logE("Copy carrier event payload error");
+        return 0;
+    }
+
+    ev->payload = pos;
+    ev->length = total;
+    for (i = 0; i < count; i++) {
+        if (lens[i])
+            memcpy(pos, strs[i], lens[i]);
+        pos[lens[i]] = 0;
+        pos += lens[i] + 1;
+    }
+    return 1;
+}
+
+static inline
+const char* nextString(const char* str)
+{
+    return str + strlen(str) + 1;
+}
+
+static
+void postEvent(HandlerContext* hc, DispatchEvent* ev)
+{
+    if (!dispatcherPost(hc->dispatcher, ev))
+        logW("Carrier event queue full, event %d dropped", ev->type);
+}
+
+static
+void deliverIdle(JNIEnv* env, HandlerContext* hc)
+{
+    if (!callVoidUpcall(env, UPCALL_IDLE, hc->callbacks, gJni.callbacks.onIdle,
+                        hc->carrier)) {
+        logE("Call Carrier.Callbacks.OnIdle error");
+    }
+}
 
 static
 void cbOnIdle(IOEXCarrier* carrier, void* context)
@@ -61,10 +181,35 @@ void cbOnIdle(IOEXCarrier* carrier, void* context)
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onIdle", "("_W("Carrier;)V"),
-                        hc->carrier)) {
-        logE("Call Carrier.Callbacks.OnIdle error");
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        // One pending idle event is enough, skip ticks until it is handled.
+        if (__atomic_exchange_n(&hc->idlePending, 1, __ATOMIC_ACQ_REL))
+            return;
+
+        initEvent(&ev, EventIdle, NULL);
+        if (!dispatcherPost(hc->dispatcher, &ev))
+            __atomic_store_n(&hc->idlePending, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    deliverIdle(hc->env, hc);
+}
+
+static
+void deliverConnection(JNIEnv* env, HandlerContext* hc, IOEXConnectionStatus status)
+{
+    jobject jstatus = NULL;
+
+    if (!newJavaConnectionStatus(env, status, &jstatus)) {
+        logE("Construct java Connection object error");
+        return;
+    }
+
+    if (!callVoidUpcall(env, UPCALL_CONNECTION, hc->callbacks, gJni.callbacks.onConnection,
+                        hc->carrier, jstatus)) {
+        logE("Call Carrier.Callbacks.OnConnection error");
     }
 }
 
@@ -72,7 +217,6 @@ static
 void cbOnConnection(IOEXCarrier* carrier, IOEXConnectionStatus status, void* context)
 {
     HandlerContext *hc = (HandlerContext *) context;
-    jobject jstatus = NULL;
 
     assert(carrier);
     assert(context);
@@ -80,19 +224,25 @@ void cbOnConnection(IOEXCarrier* carrier, IOEXConnectionStatus status, void* con
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    if (!newJavaConnectionStatus(hc->env, status, &jstatus)) {
-        logE("Construct java Connection object error");
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventConnection, NULL);
+        ev.ival = (int)status;
+        postEvent(hc, &ev);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onConnection",
-                        "("_W("Carrier;")_W("ConnectionStatus;)V"),
-                        hc->carrier, jstatus)) {
-        logE("Call Carrier.Callbacks.OnConnection error");
-    }
+    deliverConnection(hc->env, hc, status);
+}
 
-    (*hc->env)->DeleteLocalRef(hc->env, jstatus);
+static
+void deliverReady(JNIEnv* env, HandlerContext* hc)
+{
+    if (!callVoidUpcall(env, UPCALL_READY, hc->callbacks, gJni.callbacks.onReady,
+                        hc->carrier)) {
+        logE("Call Carrier.Callbacks.OnReady error");
+    }
 }
 
 static
@@ -105,19 +255,39 @@ void cbOnReady(IOEXCarrier* carrier, void* context)
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onReady",
-                        "("_W("Carrier;)V"),
-                        hc->carrier)) {
-        logE("Call Carrier.Callbacks.OnReady error");
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventReady, NULL);
+        postEvent(hc, &ev);
+        return;
     }
+
+    deliverReady(hc->env, hc);
+}
+
+static
+void deliverSelfInfoChanged(JNIEnv* env, HandlerContext* hc, const IOEXUserInfo* userInfo)
+{
+    jobject juserInfo;
+
+    if (!newJavaUserInfo(env, userInfo, &juserInfo)) {
+        logE("Construct Java UserInfo object error");
+        return;
+    }
+
+    if (!callVoidUpcall(env, UPCALL_SELF_INFO_CHANGED, hc->callbacks,
+                        gJni.callbacks.onSelfInfoChanged,
+                        hc->carrier, juserInfo)) {
+        logE("Call Carrier.Callbacks.OnSelfInfoChanged error");
+    }
+    (*env)->DeleteLocalRef(env, juserInfo);
 }
 
 static
 void cbOnSelfInfoChanged(IOEXCarrier* carrier, const IOEXUserInfo* userInfo, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jobject juserInfo;
 
     assert(carrier);
     assert(userInfo);
@@ -126,26 +296,42 @@ void cbOnSelfInfoChanged(IOEXCarrier* carrier, const IOEXUserInfo* userInfo, voi
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    if (!newJavaUserInfo(hc->env, userInfo, &juserInfo)) {
-        logE("Construct Java UserInfo object error");
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventSelfInfo, NULL);
+        if (setPayload(&ev, userInfo, sizeof(*userInfo)))
+            postEvent(hc, &ev);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onSelfInfoChanged",
-                        "("_W("Carrier;")_W("UserInfo;)V"),
-                        hc->carrier, juserInfo)) {
-        logE("Call Carrier.Callbacks.OnSelfInfoChanged error");
+    deliverSelfInfoChanged(hc->env, hc, userInfo);
+}
+
+static
+void deliverFriends(JNIEnv* env, HandlerContext* hc, FriendsSnapshot* friends)
+{
+    jobject jsnapshot;
+
+    jsnapshot = friendsSnapshotToJava(env, friends);
+    friendsSnapshotCleanup(friends);
+    if (!jsnapshot) {
+        logE("Construct Java FriendsSnapshot object error");
+        return;
+    }
+
+    if (!callVoidUpcall(env, UPCALL_FRIENDS, hc->callbacks, gJni.callbacks.onFriends,
+                        hc->carrier, jsnapshot)) {
+        logE("Call Carrier.Callbacks.onFriends error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, juserInfo);
+
+    (*env)->DeleteLocalRef(env, jsnapshot);
 }
 
 static
 bool cbFriendsIterated(IOEXCarrier* carrier, const IOEXFriendInfo* friendInfo, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jobject jfriendInfo = NULL;
-    jboolean result;
 
     assert(carrier);
     assert(context);
@@ -154,625 +340,833 @@ bool cbFriendsIterated(IOEXCarrier* carrier, const IOEXFriendInfo* friendInfo, v
     assert(hc->env);
 
     if (friendInfo) {
-        if (!newJavaFriendInfo(hc->env, friendInfo, &jfriendInfo)) {
-            logE("Construct Java FriendInfo object error");
+        friendIdTableAdd(&hc->friendIds, hc->env, friendInfo->user_info.userid);
+        if (!friendsSnapshotAppend(&hc->friends, friendInfo)) {
+            logE("Pack friend into friends snapshot error");
+            friendsSnapshotCleanup(&hc->friends);
             return false;
         }
+        return true;
     }
 
-    if (!callBooleanMethod(hc->env, hc->clazz, hc->callbacks,
-                           "onFriendsIterated",
-                           "("_W("Carrier;")_W("FriendInfo;)Z"),
-                           &result, hc->carrier, jfriendInfo)) {
-        logE("Call Carrier.Callbacks.OnFriendIterated error");
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        // Hand the collected snapshot over to the event as is.
+        initEvent(&ev, EventFriends, NULL);
+        if (setPayload(&ev, &hc->friends, sizeof(hc->friends))) {
+            friendsSnapshotInit(&hc->friends);
+            postEvent(hc, &ev);
+        } else {
+            friendsSnapshotCleanup(&hc->friends);
+        }
+        return true;
     }
 
-    if (jfriendInfo)
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendInfo);
-    return (bool)result;
+    deliverFriends(hc->env, hc, &hc->friends);
+    return true;
 }
 
 static
-void cbOnFriendConnectionChanged(IOEXCarrier *carrier, const char *friendId,
-                                 IOEXConnectionStatus status, void *context)
+void deliverFriendConnectionChanged(JNIEnv* env, HandlerContext* hc, const char* friendId,
+                                    IOEXConnectionStatus status)
 {
-    HandlerContext *hc = (HandlerContext *) context;
     jstring jfriendId;
     jobject jstatus;
 
-    assert(carrier);
-    assert(context);
-
-    assert(carrier == hc->nativeCarrier);
-    assert(hc->env);
-
-    jfriendId = (*hc->env)->NewStringUTF(hc->env, friendId);
+    jfriendId = friendIdTableGet(&hc->friendIds, env, friendId);
     if (!jfriendId) {
         logE("New Java String object error");
         return;
     }
 
-    if (!newJavaConnectionStatus(hc->env, status, &jstatus)) {
+    if (!newJavaConnectionStatus(env, status, &jstatus)) {
         logE("Construct java Connection object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
+        (*env)->DeleteLocalRef(env, jfriendId);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendConnection",
-                        "("_W("Carrier;")_J("String;")_W("ConnectionStatus;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_CONNECTION, hc->callbacks,
+                        gJni.callbacks.onFriendConnection,
             hc->carrier, jfriendId, jstatus)) {
         logE("Call Carrier.Callbacks.OnFriendConnection error");
     }
 
-    (*hc->env)->DeleteLocalRef(hc->env, jstatus);
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
+    (*env)->DeleteLocalRef(env, jfriendId);
 }
 
 static
-void cbOnFriendInfoChanged(IOEXCarrier* carrier, const char* friendId,
-                           const IOEXFriendInfo* friendInfo, void* context)
+void cbOnFriendConnectionChanged(IOEXCarrier *carrier, const char *friendId,
+                                 IOEXConnectionStatus status, void *context)
 {
-    HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendId;
-    jobject jfriendInfo;
+    HandlerContext *hc = (HandlerContext *) context;
 
     assert(carrier);
-    assert(friendId);
-    assert(friendInfo);
     assert(context);
 
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    jfriendId = (*hc->env)->NewStringUTF(hc->env, friendId);
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFriendConnection, friendId);
+        ev.flags = DISPATCH_EVENT_COALESCABLE;
+        ev.ival = (int)status;
+        postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFriendConnectionChanged(hc->env, hc, friendId, status);
+}
+
+static
+void deliverFriendInfoChanged(JNIEnv* env, HandlerContext* hc, const char* friendId,
+                              const IOEXFriendInfo* friendInfo)
+{
+    jstring jfriendId;
+    jobject jfriendInfo;
+
+    jfriendId = friendIdTableGet(&hc->friendIds, env, friendId);
     if (!jfriendId) {
         logE("New Java String object error");
         return;
     }
 
-    if (!newJavaFriendInfo(hc->env, friendInfo, &jfriendInfo)) {
+    if (!newJavaFriendInfo(env, friendInfo, &jfriendInfo)) {
         logE("Construct Java FriendInfo object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
+        (*env)->DeleteLocalRef(env, jfriendId);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendInfoChanged",
-                        "("_W("Carrier;")_J("String;")_W("FriendInfo;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_INFO_CHANGED, hc->callbacks,
+                        gJni.callbacks.onFriendInfoChanged,
                         hc->carrier, jfriendId, jfriendInfo)) {
         logE("Call Carrier.Callbacks.OnFriendInfoChanged error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendInfo);
+    (*env)->DeleteLocalRef(env, jfriendId);
+    (*env)->DeleteLocalRef(env, jfriendInfo);
 }
 
 static
-void cbOnFriendPresence(IOEXCarrier* carrier, const char* friendId,
-                        IOEXPresenceStatus status, void* context)
+void cbOnFriendInfoChanged(IOEXCarrier* carrier, const char* friendId,
+                           const IOEXFriendInfo* friendInfo, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendId;
-    jobject jpresence;
 
     assert(carrier);
     assert(friendId);
+    assert(friendInfo);
     assert(context);
 
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    jfriendId = (*hc->env)->NewStringUTF(hc->env, friendId);
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFriendInfo, friendId);
+        if (setPayload(&ev, friendInfo, sizeof(*friendInfo)))
+            postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFriendInfoChanged(hc->env, hc, friendId, friendInfo);
+}
+
+static
+void deliverFriendPresence(JNIEnv* env, HandlerContext* hc, const char* friendId,
+                           IOEXPresenceStatus status)
+{
+    jstring jfriendId;
+    jobject jpresence;
+
+    jfriendId = friendIdTableGet(&hc->friendIds, env, friendId);
     if (!jfriendId) {
         logE("New Java String object error");
         return;
     }
 
-    if (!newJavaPresenceStatus(hc->env, status, &jpresence)) {
+    if (!newJavaPresenceStatus(env, status, &jpresence)) {
         logE("Construct java PresenceStatus object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
+        (*env)->DeleteLocalRef(env, jfriendId);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendPresence",
-                        "("_W("Carrier;")_J("String;")_W("PresenceStatus;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_PRESENCE, hc->callbacks,
+                        gJni.callbacks.onFriendPresence,
                         hc->carrier, jfriendId, jpresence)){
         logE("Call Carrier.Callbacks.onFriendPresence error");
     }
 
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
-    (*hc->env)->DeleteLocalRef(hc->env, jpresence);
+    (*env)->DeleteLocalRef(env, jfriendId);
 }
 
 static
-void cbOnFriendAdded(IOEXCarrier* carrier, const IOEXFriendInfo* friendInfo, void* context)
+void cbOnFriendPresence(IOEXCarrier* carrier, const char* friendId,
+                        IOEXPresenceStatus status, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jobject jfriendInfo;
 
     assert(carrier);
-    assert(friendInfo);
+    assert(friendId);
     assert(context);
 
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    if (!newJavaFriendInfo(hc->env, friendInfo, &jfriendInfo)){
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFriendPresence, friendId);
+        ev.flags = DISPATCH_EVENT_COALESCABLE;
+        ev.ival = (int)status;
+        postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFriendPresence(hc->env, hc, friendId, status);
+}
+
+static
+void deliverFriendAdded(JNIEnv* env, HandlerContext* hc, const IOEXFriendInfo* friendInfo)
+{
+    jobject jfriendInfo;
+
+    if (!newJavaFriendInfo(env, friendInfo, &jfriendInfo)){
         logE("Construct Java UserInfo object error");
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendAdded",
-                        "("_W("Carrier;")_W("FriendInfo;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_ADDED, hc->callbacks,
+                        gJni.callbacks.onFriendAdded,
                         hc->carrier, jfriendInfo)) {
         logE("Call Carrier.Callbacks.onFriendAdded error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendInfo);
+    (*env)->DeleteLocalRef(env, jfriendInfo);
 }
 
 static
-void cbOnFriendRemoved(IOEXCarrier* carrier, const char* friendId, void* context)
+void cbOnFriendAdded(IOEXCarrier* carrier, const IOEXFriendInfo* friendInfo, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendId;
 
     assert(carrier);
-    assert(friendId);
+    assert(friendInfo);
     assert(context);
 
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    jfriendId = (*hc->env)->NewStringUTF(hc->env, friendId);
+    friendIdTableAdd(&hc->friendIds, hc->env, friendInfo->user_info.userid);
+
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFriendAdded, friendInfo->user_info.userid);
+        if (setPayload(&ev, friendInfo, sizeof(*friendInfo)))
+            postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFriendAdded(hc->env, hc, friendInfo);
+}
+
+static
+void deliverFriendRemoved(JNIEnv* env, HandlerContext* hc, const char* friendId)
+{
+    jstring jfriendId;
+
+    jfriendId = friendIdTableGet(&hc->friendIds, env, friendId);
     if (!jfriendId) {
         logE("New Java String object error");
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendRemoved",
-                        "("_W("Carrier;")_J("String;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_REMOVED, hc->callbacks,
+                        gJni.callbacks.onFriendRemoved,
                         hc->carrier, jfriendId)) {
         logE("Call Carrier.Callbacks.onFriendRemoved error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
+    (*env)->DeleteLocalRef(env, jfriendId);
 }
 
 static
-void cbOnFriendRequest(IOEXCarrier* carrier, const char* userId, const IOEXUserInfo* userInfo,
-                       const char* hello, void* context)
+void cbOnFriendRemoved(IOEXCarrier* carrier, const char* friendId, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring juserId;
-    jobject juserInfo;
-    jstring jhello;
 
     assert(carrier);
-    assert(userId);
-    assert(userInfo);
+    assert(friendId);
     assert(context);
 
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    juserId = (*hc->env)->NewStringUTF(hc->env, userId);
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFriendRemoved, friendId);
+        postEvent(hc, &ev);
+    } else {
+        deliverFriendRemoved(hc->env, hc, friendId);
+    }
+
+    friendIdTableRemove(&hc->friendIds, hc->env, friendId);
+}
+
+static
+void deliverFriendRequest(JNIEnv* env, HandlerContext* hc, const char* userId,
+                          const IOEXUserInfo* userInfo, const char* hello)
+{
+    jstring juserId;
+    jobject juserInfo;
+    jstring jhello;
+
+    juserId = (*env)->NewStringUTF(env, userId);
     if (!juserId) {
         logE("New Java String object error");
         return;
     }
-    if (!newJavaUserInfo(hc->env, userInfo, &juserInfo)) {
+    if (!newJavaUserInfo(env, userInfo, &juserInfo)) {
         logE("Construct Java UserInfo object error");
-        (*hc->env)->DeleteLocalRef(hc->env, juserId);
+        (*env)->DeleteLocalRef(env, juserId);
         return;
     }
-    jhello = (*hc->env)->NewStringUTF(hc->env, hello);
+    jhello = newStringFromUtf8(env, hello, strlen(hello));
     if (!jhello) {
         logE("New Java String object error");
-        (*hc->env)->DeleteLocalRef(hc->env, juserId);
-        (*hc->env)->DeleteLocalRef(hc->env, juserInfo);
+        (*env)->DeleteLocalRef(env, juserId);
+        (*env)->DeleteLocalRef(env, juserInfo);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendRequest",
-                        "("_W("Carrier;")_J("String;")_W("UserInfo;")_J("String;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_REQUEST, hc->callbacks,
+                        gJni.callbacks.onFriendRequest,
                         hc->carrier, juserId, juserInfo, jhello)) {
         logE("Call Carrier.Callbacks.OnFriendRequest error");
     }
 
-    (*hc->env)->DeleteLocalRef(hc->env, juserId);
-    (*hc->env)->DeleteLocalRef(hc->env, juserInfo);
-    (*hc->env)->DeleteLocalRef(hc->env, jhello);
+    (*env)->DeleteLocalRef(env, juserId);
+    (*env)->DeleteLocalRef(env, juserInfo);
+    (*env)->DeleteLocalRef(env, jhello);
 }
 
 static
-void cbOnFriendMessage(IOEXCarrier* carrier, const char* friendId, const void* message, size_t length,
-                       void* context)
+void cbOnFriendRequest(IOEXCarrier* carrier, const char* userId, const IOEXUserInfo* userInfo,
+                       const char* hello, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendId;
-    jstring jmessage;
 
     assert(carrier);
-    assert(friendId);
-    assert(message);
-    assert(length > 0);
+    assert(userId);
+    assert(userInfo);
+    assert(context);
 
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    jfriendId = (*hc->env)->NewStringUTF(hc->env, friendId);
+    if (hc->dispatcher) {
+        size_t helloLen = hello ? strlen(hello) : 0;
+        DispatchEvent ev;
+        char* payload;
+
+        // The user info is followed by the NUL-terminated hello message.
+        initEvent(&ev, EventFriendRequest, userId);
+        payload = (char*)malloc(sizeof(*userInfo) + helloLen + 1);
+        if (!payload) {
+            logE("Copy carrier event payload error");
+            return;
+        }
+        memcpy(payload, userInfo, sizeof(*userInfo));
+        memcpy(payload + sizeof(*userInfo), hello ? hello : "", helloLen + 1);
+        ev.payload = payload;
+        ev.length = sizeof(*userInfo) + helloLen + 1;
+        postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFriendRequest(hc->env, hc, userId, userInfo, hello);
+}
+
+static
+void deliverFriendMessage(JNIEnv* env, HandlerContext* hc, const char* friendId,
+                          const void* message, size_t length)
+{
+    jstring jfriendId;
+    jobject jmessage;
+    jmethodID method;
+
+    jfriendId = friendIdTableGet(&hc->friendIds, env, friendId);
     if (!jfriendId) {
         logE("New Java String object error");
         return;
     }
-    jmessage = (*hc->env)->NewStringUTF(hc->env, (const char *)message);
+
+    if (hc->binaryMessages) {
+        jmessage = (*env)->NewByteArray(env, (jsize)length);
+        if (jmessage)
+            (*env)->SetByteArrayRegion(env, (jbyteArray)jmessage, 0, (jsize)length,
+                                       (const jbyte*)message);
+        method = gJni.callbacks.onFriendBinaryMessage;
+    } else {
+        jmessage = newStringFromUtf8(env, message, length);
+        method = gJni.callbacks.onFriendMessage;
+    }
     if (!jmessage) {
-        logE("New Java String object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
+        logE("New Java message object error");
+        (*env)->DeleteLocalRef(env, jfriendId);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendMessage",
-                        "("_W("Carrier;")_J("String;")_J("String;)V"),
-                        hc->carrier, jfriendId, jmessage)) {
-        logE("Call Carrier.Callbacks.onFriendMessage error");
+    if (!callVoidUpcall(env, UPCALL_FRIEND_MESSAGE, hc->callbacks, method, hc->carrier,
+                        jfriendId, jmessage)) {
+        logE("Call Carrier.Callbacks.%s error",
+             hc->binaryMessages ? "onFriendBinaryMessage" : "onFriendMessage");
     }
 
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendId);
-    (*hc->env)->DeleteLocalRef(hc->env, jmessage);
+    (*env)->DeleteLocalRef(env, jfriendId);
+    (*env)->DeleteLocalRef(env, jmessage);
 }
 
 static
-void cbOnFriendInviteRquest(IOEXCarrier* carrier, const char* from, const void* hello,
-                            size_t length, void* context)
+void cbOnFriendMessage(IOEXCarrier* carrier, const char* friendId, const void* message, size_t length,
+                       void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfrom;
-    jstring jhello;
-
-    (void)length;
 
     assert(carrier);
-    assert(from);
-    assert(hello);
+    assert(friendId);
+    assert(message);
+    assert(length > 0);
 
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
-    jfrom = (*hc->env)->NewStringUTF(hc->env, from);
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFriendMessage, friendId);
+        ev.payload = malloc(length + 1);
+        if (!ev.payload) {
+            logE("Copy carrier event payload error");
+            return;
+        }
+        memcpy(ev.payload, message, length);
+        ((char*)ev.payload)[length] = 0;
+        ev.length = length + 1;
+        postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFriendMessage(hc->env, hc, friendId, message, length);
+}
+
+static
+void deliverFriendInviteRequest(JNIEnv* env, HandlerContext* hc, const char* from,
+                                const void* hello, size_t length)
+{
+    jstring jfrom;
+    jstring jhello;
+
+    jfrom = friendIdTableGet(&hc->friendIds, env, from);
     if (!jfrom) {
         logE("New java String object error");
         return;
     }
-    jhello = (*hc->env)->NewStringUTF(hc->env, (const char *)hello);
+    jhello = newStringFromUtf8(env, hello, length);
     if (!jhello) {
         logE("New java String object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfrom);
+        (*env)->DeleteLocalRef(env, jfrom);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                           "onFriendInviteRequest",
-                           "("_W("Carrier;")_J("String;")_J("String;)V"),
+    if (!callVoidUpcall(env, UPCALL_FRIEND_INVITE_REQUEST, hc->callbacks,
+                        gJni.callbacks.onFriendInviteRequest,
                            hc->carrier, jfrom, jhello)) {
         logE("Call Carrier.Callbacks.onFriendInviteRequest error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jfrom);
-    (*hc->env)->DeleteLocalRef(hc->env, jhello);
+    (*env)->DeleteLocalRef(env, jfrom);
+    (*env)->DeleteLocalRef(env, jhello);
 }
 
 static
-void cbOnFileRequest(IOEXCarrier *carrier, const char *fileid, const char *from,
-                     const char *filename, size_t filesize, void *context)
+void cbOnFriendInviteRquest(IOEXCarrier* carrier, const char* from, const void* hello,
+                            size_t length, void* context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfileid, jfrom, jfilename;
-    jlong jfilesize;
 
-    (void)filesize;
     assert(carrier);
-    assert(fileid);
     assert(from);
-    assert(filename);
+    assert(hello);
+
     assert(carrier == hc->nativeCarrier);
     assert(hc->env);
 
+    if (hc->dispatcher) {
+        DispatchEvent ev;
 
+        initEvent(&ev, EventFriendInvite, from);
+        ev.payload = malloc(length + 1);
+        if (!ev.payload) {
+            logE("Copy carrier event payload error");
+            return;
+        }
+        memcpy(ev.payload, hello, length);
+        ((char*)ev.payload)[length] = 0;
+        ev.length = length + 1;
+        postEvent(hc, &ev);
+        return;
+    }
 
-    jfrom = (*hc->env)->NewStringUTF(hc->env, from);
+    deliverFriendInviteRequest(hc->env, hc, from, hello, length);
+}
+
+static
+void deliverFileRequest(JNIEnv* env, HandlerContext* hc, const char* fileid, const char* from,
+                        const char* filename, size_t filesize)
+{
+    jstring jfileid, jfrom, jfilename;
+    jlong jfilesize;
+
+    jfrom = friendIdTableGet(&hc->friendIds, env, from);
     if (!jfrom) {
         logE("New java String(jfrom) object error");
         return;
     }
 
-    jfileid = (*hc->env)->NewStringUTF(hc->env, fileid);
+    jfileid = (*env)->NewStringUTF(env, fileid);
     if (!jfileid) {
         logE("New java String(jfileid) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfrom);
+        (*env)->DeleteLocalRef(env, jfrom);
         return;
     }
 
-    jfilename = (*hc->env)->NewStringUTF(hc->env, filename);
+    jfilename = (*env)->NewStringUTF(env, filename);
     if (!jfilename) {
         logE("New java String(jfilename) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfrom);
-        (*hc->env)->DeleteLocalRef(hc->env, jfileid);
+        (*env)->DeleteLocalRef(env, jfrom);
+        (*env)->DeleteLocalRef(env, jfileid);
         return;
     }
 
     jfilesize = (jlong)filesize;
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFileRequest",
-                        "("_W("Carrier;")_J("String;")_J("String;")_J("String;")"J)V",
+    if (!callVoidUpcall(env, UPCALL_FILE_REQUEST, hc->callbacks,
+                        gJni.callbacks.onFriendFileRequest,
                         hc->carrier, jfrom, jfileid, jfilename, jfilesize)) {
         logE("Call Carrier.Callbacks.onFriendFileRequest error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jfrom);
-    (*hc->env)->DeleteLocalRef(hc->env, jfileid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfilename);
+    (*env)->DeleteLocalRef(env, jfrom);
+    (*env)->DeleteLocalRef(env, jfileid);
+    (*env)->DeleteLocalRef(env, jfilename);
 }
 
 static
-void cbOnFileAccepted(IOEXCarrier *carrier, const char *fileid, const char *friendid,
-                      const char *fullpath, size_t filesize, void *context)
+void cbOnFileRequest(IOEXCarrier *carrier, const char *fileid, const char *from,
+                     const char *filename, size_t filesize, void *context)
 {
     HandlerContext* hc = (HandlerContext*)context;
 
+    assert(carrier);
+    assert(fileid);
+    assert(from);
+    assert(filename);
+    assert(carrier == hc->nativeCarrier);
+    assert(hc->env);
+
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFileRequest, from);
+        ev.lval[0] = (int64_t)filesize;
+        if (setStringsPayload(&ev, 2, fileid, filename))
+            postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFileRequest(hc->env, hc, fileid, from, filename, filesize);
+}
+
+static
+void deliverFileAccepted(JNIEnv* env, HandlerContext* hc, const char* fileid,
+                         const char* friendid, const char* fullpath, size_t filesize)
+{
     jstring jfileid, jreceiver, jfilepath;
     jlong jfilesize;
 
-    (void)filesize;
-
-    jreceiver = (*hc->env)->NewStringUTF(hc->env, friendid);
+    jreceiver = friendIdTableGet(&hc->friendIds, env, friendid);
     if(!jreceiver){
         logE("New java String(jreceiver) object error");
         return;
     }
 
-    jfileid = (*hc->env)->NewStringUTF(hc->env, fileid);
+    jfileid = (*env)->NewStringUTF(env, fileid);
     if(!jfileid){
         logE("New java String(jfileid) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jreceiver);
+        (*env)->DeleteLocalRef(env, jreceiver);
         return;
     }
 
-    jfilepath = (*hc->env)->NewStringUTF(hc->env, fullpath);
+    jfilepath = (*env)->NewStringUTF(env, fullpath);
     if(!jfilepath){
         logE("New java String(jfilepath) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jreceiver);
-        (*hc->env)->DeleteLocalRef(hc->env, jfileid);
+        (*env)->DeleteLocalRef(env, jreceiver);
+        (*env)->DeleteLocalRef(env, jfileid);
         return;
     }
 
     jfilesize = (jlong)filesize;
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFileAccepted",
-                        "("_W("Carrier;")_J("String;")_J("String;")_J("String;")"J)V",
+    if (!callVoidUpcall(env, UPCALL_FILE_ACCEPTED, hc->callbacks,
+                        gJni.callbacks.onFriendFileAccepted,
                         hc->carrier, jreceiver, jfileid, jfilepath, jfilesize)) {
         logE("Call Carrier.Callbacks.onFriendFileAccepted error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jreceiver);
-    (*hc->env)->DeleteLocalRef(hc->env, jfileid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfilepath);
+    (*env)->DeleteLocalRef(env, jreceiver);
+    (*env)->DeleteLocalRef(env, jfileid);
+    (*env)->DeleteLocalRef(env, jfilepath);
 }
 
 static
-void cbOnFilePaused(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
+void cbOnFileAccepted(IOEXCarrier *carrier, const char *fileid, const char *friendid,
+                      const char *fullpath, size_t filesize, void *context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendid, jfileid;
 
-    jfriendid = (*hc->env)->NewStringUTF(hc->env ,friendid);
-    if(!jfriendid){
-        logE("New java String(jfriendid) object error");
-        return;
-    }
+    if (hc->dispatcher) {
+        DispatchEvent ev;
 
-    jfileid = (*hc->env)->NewStringUTF(hc->env ,fileid);
-    if(!jfileid){
-        logE("New java String(jfileid) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
+        initEvent(&ev, EventFileAccepted, friendid);
+        ev.lval[0] = (int64_t)filesize;
+        if (setStringsPayload(&ev, 2, fileid, fullpath))
+            postEvent(hc, &ev);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFilePaused",
-                        "("_W("Carrier;")_J("String;")_J("String;)V"),
-                        hc->carrier, jfriendid, jfileid)) {
-        logE("Call Carrier.Callbacks.onFriendFilePaused error");
-    }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfileid);
+    deliverFileAccepted(hc->env, hc, fileid, friendid, fullpath, filesize);
 }
 
+/*
+ * Paused, resumed, canceled and completed notifications only differ in the
+ * java method they call.
+ */
 static
-void cbOnFileResumed(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
+void deliverFileState(JNIEnv* env, HandlerContext* hc, jmethodID method, int upcall,
+                      const char* fileid, const char* friendid)
 {
-    HandlerContext* hc = (HandlerContext*)context;
     jstring jfriendid, jfileid;
 
-    jfriendid = (*hc->env)->NewStringUTF(hc->env ,friendid);
+    jfriendid = friendIdTableGet(&hc->friendIds, env, friendid);
     if(!jfriendid){
         logE("New java String(jfriendid) object error");
         return;
     }
 
-    jfileid = (*hc->env)->NewStringUTF(hc->env ,fileid);
+    jfileid = (*env)->NewStringUTF(env, fileid);
     if(!jfileid){
         logE("New java String(jfileid) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
+        (*env)->DeleteLocalRef(env, jfriendid);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFileResumed",
-                        "("_W("Carrier;")_J("String;")_J("String;)V"),
-                        hc->carrier, jfriendid, jfileid)) {
-        logE("Call Carrier.Callbacks.onFriendFileResumed error");
+    if (!callVoidUpcall(env, upcall, hc->callbacks, method, hc->carrier, jfriendid, jfileid)) {
+        logE("Call Carrier.Callbacks.%s error", upcallName(upcall));
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfileid);
+    (*env)->DeleteLocalRef(env, jfriendid);
+    (*env)->DeleteLocalRef(env, jfileid);
 }
 
 static
-void cbOnFileCanceled(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
+void postFileState(HandlerContext* hc, int type, const char* fileid, const char* friendid)
 {
-    HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendid, jfileid;
+    DispatchEvent ev;
 
-    jfriendid = (*hc->env)->NewStringUTF(hc->env ,friendid);
-    if(!jfriendid){
-        logE("New java String(jfriendid) object error");
-        return;
-    }
+    initEvent(&ev, type, friendid);
+    if (setStringsPayload(&ev, 1, fileid))
+        postEvent(hc, &ev);
+}
 
-    jfileid = (*hc->env)->NewStringUTF(hc->env ,fileid);
-    if(!jfileid){
-        logE("New java String(jfileid) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-        return;
-    }
+static
+void cbOnFilePaused(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
+{
+    HandlerContext* hc = (HandlerContext*)context;
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFileCanceled",
-                        "("_W("Carrier;")_J("String;")_J("String;)V"),
-                        hc->carrier, jfriendid, jfileid)) {
-        logE("Call Carrier.Callbacks.onFriendFileCanceled error");
-    }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfileid);
+    if (hc->dispatcher)
+        postFileState(hc, EventFilePaused, fileid, friendid);
+    else
+        deliverFileState(hc->env, hc, gJni.callbacks.onFriendFilePaused,
+                         UPCALL_FILE_PAUSED, fileid, friendid);
 }
 
 static
-void cbOnFileCompleted(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
+void cbOnFileResumed(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendid, jfileid;
 
-    jfriendid = (*hc->env)->NewStringUTF(hc->env ,friendid);
-    if(!jfriendid){
-        logE("New java String(jfriendid) object error");
-        return;
-    }
+    if (hc->dispatcher)
+        postFileState(hc, EventFileResumed, fileid, friendid);
+    else
+        deliverFileState(hc->env, hc, gJni.callbacks.onFriendFileResumed,
+                         UPCALL_FILE_RESUMED, fileid, friendid);
+}
 
-    jfileid = (*hc->env)->NewStringUTF(hc->env ,fileid);
-    if(!jfileid){
-        logE("New java String(jfileid) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-        return;
-    }
+static
+void cbOnFileCanceled(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
+{
+    HandlerContext* hc = (HandlerContext*)context;
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFileCompleted",
-                        "("_W("Carrier;")_J("String;")_J("String;)V"),
-                        hc->carrier, jfriendid, jfileid)) {
-        logE("Call Carrier.Callbacks.onFriendFileCompleted error");
-    }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfileid);
+    progressThrottleForget(&hc->progress, fileid);
 
+    if (hc->dispatcher)
+        postFileState(hc, EventFileCanceled, fileid, friendid);
+    else
+        deliverFileState(hc->env, hc, gJni.callbacks.onFriendFileCanceled,
+                         UPCALL_FILE_CANCELED, fileid, friendid);
 }
 
 static
-void cbOnFileProgress(IOEXCarrier *carrier, const char *fileid, const char *friendid,
-                      const char *fullpath, uint64_t size, uint64_t transferred,
-                      void *context)
+void cbOnFileCompleted(IOEXCarrier *carrier, const char *fileid, const char *friendid, void *context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendid, jfileid, jfilepath;
-    jlong jtotalsize, jtransferredsize;
 
-    (void)size;
-    (void)transferred;
+    progressThrottleForget(&hc->progress, fileid);
 
-    assert(fileid);
-    assert(friendid);
-    assert(fullpath);
-    assert(hc->env);
+    if (hc->dispatcher)
+        postFileState(hc, EventFileCompleted, fileid, friendid);
+    else
+        deliverFileState(hc->env, hc, gJni.callbacks.onFriendFileCompleted,
+                         UPCALL_FILE_COMPLETED, fileid, friendid);
+}
 
-    jfriendid = (*hc->env)->NewStringUTF(hc->env, friendid);
+static
+void deliverFileProgress(JNIEnv* env, HandlerContext* hc, const char* fileid,
+                         const char* friendid, const char* fullpath,
+                         uint64_t size, uint64_t transferred)
+{
+    jstring jfriendid, jfileid, jfilepath;
+    jlong jtotalsize, jtransferredsize;
+
+    jfriendid = friendIdTableGet(&hc->friendIds, env, friendid);
     if(!jfriendid){
         logE("New java String(jfriendid) object error");
         return;
     }
 
-    jfilepath = (*hc->env)->NewStringUTF(hc->env, fullpath);
+    jfilepath = (*env)->NewStringUTF(env, fullpath);
     if(!jfilepath){
         logE("New java String(jfilepath) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
+        (*env)->DeleteLocalRef(env, jfriendid);
         return;
     }
 
-    jfileid = (*hc->env)->NewStringUTF(hc->env, fileid);
+    jfileid = (*env)->NewStringUTF(env, fileid);
     if(!jfileid){
         logE("New java String(jfilepath) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-        (*hc->env)->DeleteLocalRef(hc->env, jfilepath);
+        (*env)->DeleteLocalRef(env, jfriendid);
+        (*env)->DeleteLocalRef(env, jfilepath);
         return;
     }
 
     jtotalsize = (jlong) size;
     jtransferredsize = (jlong) transferred;
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFileProgress",
-                        "("_W("Carrier;")_J("String;")_J("String;")_J("String;")"JJ)V",
+    if (!callVoidUpcall(env, UPCALL_FILE_PROGRESS, hc->callbacks,
+                        gJni.callbacks.onFriendFileProgress,
                         hc->carrier, jfriendid, jfilepath, jfileid, jtotalsize, jtransferredsize)) {
         logE("Call Carrier.Callbacks.onFriendFileChunkReceived error");
     }
 
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfilepath);
-    (*hc->env)->DeleteLocalRef(hc->env, jfileid);
+    (*env)->DeleteLocalRef(env, jfriendid);
+    (*env)->DeleteLocalRef(env, jfilepath);
+    (*env)->DeleteLocalRef(env, jfileid);
 }
 
 static
-void cbOnFileQueried(IOEXCarrier *carrier, const char *friendid, const char *filename, const char *message, void *context)
+void cbOnFileProgress(IOEXCarrier *carrier, const char *fileid, const char *friendid,
+                      const char *fullpath, uint64_t size, uint64_t transferred,
+                      void *context)
 {
     HandlerContext* hc = (HandlerContext*)context;
-    jstring jfriendid, jfilename, jmessage;
 
+    assert(fileid);
     assert(friendid);
-    assert(filename);
-    assert(message);
+    assert(fullpath);
     assert(hc->env);
 
-    jfriendid = (*hc->env)->NewStringUTF(hc->env ,friendid);
+    if (!progressThrottleCheck(&hc->progress, fileid, size, transferred))
+        return;
+
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFileProgress, friendid);
+        ev.lval[0] = (int64_t)size;
+        ev.lval[1] = (int64_t)transferred;
+        if (setStringsPayload(&ev, 2, fileid, fullpath))
+            postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFileProgress(hc->env, hc, fileid, friendid, fullpath, size, transferred);
+}
+
+static
+void deliverFileQueried(JNIEnv* env, HandlerContext* hc, const char* friendid,
+                        const char* filename, const char* message)
+{
+    jstring jfriendid, jfilename, jmessage;
+
+    jfriendid = friendIdTableGet(&hc->friendIds, env, friendid);
     if(!jfriendid){
         logE("New java String(jfriendid) object error");
         return;
     }
 
-    jfilename = (*hc->env)->NewStringUTF(hc->env ,filename);
+    jfilename = (*env)->NewStringUTF(env, filename);
     if(!jfilename){
         logE("New java String(jfilename) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
+        (*env)->DeleteLocalRef(env, jfriendid);
         return;
     }
 
-    jmessage = (*hc->env)->NewStringUTF(hc->env ,message);
+    jmessage = (*env)->NewStringUTF(env, message);
     if(!jmessage){
         logE("New java String(jmessage) object error");
-        (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-        (*hc->env)->DeleteLocalRef(hc->env, jfilename);
+        (*env)->DeleteLocalRef(env, jfriendid);
+        (*env)->DeleteLocalRef(env, jfilename);
         return;
     }
 
-    if (!callVoidMethod(hc->env, hc->clazz, hc->callbacks,
-                        "onFriendFileQueried",
-                        "("_W("Carrier;")_J("String;")_J("String;")_J("String;")")V",
+    if (!callVoidUpcall(env, UPCALL_FILE_QUERIED, hc->callbacks,
+                        gJni.callbacks.onFriendFileQueried,
                         hc->carrier, jfriendid, jfilename, jmessage)) {
         logE("Call Carrier.Callbacks.onFriendFileQueried error");
     }
-    (*hc->env)->DeleteLocalRef(hc->env, jfriendid);
-    (*hc->env)->DeleteLocalRef(hc->env, jfilename);
-    (*hc->env)->DeleteLocalRef(hc->env, jmessage);
+    (*env)->DeleteLocalRef(env, jfriendid);
+    (*env)->DeleteLocalRef(env, jfilename);
+    (*env)->DeleteLocalRef(env, jmessage);
+}
 
+static
+void cbOnFileQueried(IOEXCarrier *carrier, const char *friendid, const char *filename, const char *message, void *context)
+{
+    HandlerContext* hc = (HandlerContext*)context;
+
+    assert(friendid);
+    assert(filename);
+    assert(message);
+    assert(hc->env);
+
+    if (hc->dispatcher) {
+        DispatchEvent ev;
+
+        initEvent(&ev, EventFileQueried, friendid);
+        if (setStringsPayload(&ev, 2, filename, message))
+            postEvent(hc, &ev);
+        return;
+    }
+
+    deliverFileQueried(hc->env, hc, friendid, filename, message);
 }
 
 IOEXCallbacks  carrierCallbacks = {
@@ -799,34 +1193,144 @@ IOEXCallbacks  carrierCallbacks = {
         .file_queried    = cbOnFileQueried,
 };
 
-int handlerCtxtSet(HandlerContext* hc, JNIEnv* env, jobject jcarrier, jobject jcallbacks)
+static
+void freeEventPayload(DispatchEvent* ev)
 {
-    jclass lclazz = (*env)->GetObjectClass(env, jcallbacks);
-    if (!lclazz) {
-        logE("Java class implementing interface 'CarrierHandler' not found");
-        return 0;
+    if (!ev->payload)
+        return;
+
+    if (ev->type == EventFriends)
+        friendsSnapshotCleanup((FriendsSnapshot*)ev->payload);
+
+    free(ev->payload);
+    ev->payload = NULL;
+}
+
+static
+void releaseEvent(void* context, DispatchEvent* ev)
+{
+    HandlerContext* hc = (HandlerContext*)context;
+
+    if (ev->type == EventIdle)
+        __atomic_store_n(&hc->idlePending, 0, __ATOMIC_RELEASE);
+
+    freeEventPayload(ev);
+}
+
+static
+void deliverEvent(JNIEnv* env, void* context, DispatchEvent* ev)
+{
+    HandlerContext* hc = (HandlerContext*)context;
+    const char* strs = (const char*)ev->payload;
+
+    switch (ev->type) {
+    case EventIdle:
+        __atomic_store_n(&hc->idlePending, 0, __ATOMIC_RELEASE);
+        deliverIdle(env, hc);
+        break;
+    case EventConnection:
+        deliverConnection(env, hc, (IOEXConnectionStatus)ev->ival);
+        break;
+    case EventReady:
+        deliverReady(env, hc);
+        break;
+    case EventSelfInfo:
+        deliverSelfInfoChanged(env, hc, (const IOEXUserInfo*)ev->payload);
+        break;
+    case EventFriends:
+        deliverFriends(env, hc, (FriendsSnapshot*)ev->payload);
+        break;
+    case EventFriendConnection:
+        deliverFriendConnectionChanged(env, hc, ev->id, (IOEXConnectionStatus)ev->ival);
+        break;
+    case EventFriendInfo:
+        deliverFriendInfoChanged(env, hc, ev->id, (const IOEXFriendInfo*)ev->payload);
+        break;
+    case EventFriendPresence:
+        deliverFriendPresence(env, hc, ev->id, (IOEXPresenceStatus)ev->ival);
+        break;
+    case EventFriendRequest:
+        deliverFriendRequest(env, hc, ev->id, (const IOEXUserInfo*)ev->payload,
+                             strs + sizeof(IOEXUserInfo));
+        break;
+    case EventFriendAdded:
+        deliverFriendAdded(env, hc, (const IOEXFriendInfo*)ev->payload);
+        break;
+    case EventFriendRemoved:
+        deliverFriendRemoved(env, hc, ev->id);
+        break;
+    case EventFriendMessage:
+        deliverFriendMessage(env, hc, ev->id, ev->payload, ev->length - 1);
+        break;
+    case EventFriendInvite:
+        deliverFriendInviteRequest(env, hc, ev->id, ev->payload, ev->length - 1);
+        break;
+    case EventFileRequest:
+        deliverFileRequest(env, hc, strs, ev->id, nextString(strs), (size_t)ev->lval[0]);
+        break;
+    case EventFileAccepted:
+        deliverFileAccepted(env, hc, strs, ev->id, nextString(strs), (size_t)ev->lval[0]);
+        break;
+    case EventFilePaused:
+        deliverFileState(env, hc, gJni.callbacks.onFriendFilePaused,
+                         UPCALL_FILE_PAUSED, strs, ev->id);
+        break;
+    case EventFileResumed:
+        deliverFileState(env, hc, gJni.callbacks.onFriendFileResumed,
+                         UPCALL_FILE_RESUMED, strs, ev->id);
+        break;
+    case EventFileCanceled:
+        deliverFileState(env, hc, gJni.callbacks.onFriendFileCanceled,
+                         UPCALL_FILE_CANCELED, strs, ev->id);
+        break;
+    case EventFileCompleted:
+        deliverFileState(env, hc, gJni.callbacks.onFriendFileCompleted,
+                         UPCALL_FILE_COMPLETED, strs, ev->id);
+        break;
+    case EventFileProgress:
+        deliverFileProgress(env, hc, strs, ev->id, nextString(strs),
+                            (uint64_t)ev->lval[0], (uint64_t)ev->lval[1]);
+        break;
+    case EventFileQueried:
+        deliverFileQueried(env, hc, ev->id, strs, nextString(strs));
+        break;
+    default:
+        logW("Unknown carrier event %d", ev->type);
+        break;
     }
 
-    jclass  gclazz      = NULL;
+    freeEventPayload(ev);
+}
+
+int handlerCtxtStartDispatcher(HandlerContext* hc, int capacity, int threads,
+                               DispatchOverflow policy)
+{
+    assert(hc);
+    assert(!hc->dispatcher);
+
+    hc->dispatcher = dispatcherCreate(capacity, threads, policy,
+                                      deliverEvent, releaseEvent, hc);
+    return hc->dispatcher != NULL;
+}
+
+int handlerCtxtSet(HandlerContext* hc, JNIEnv* env, jobject jcarrier, jobject jcallbacks)
+{
     jobject gjcarrier   = NULL;
     jobject gjcallbacks = NULL;
 
-    gclazz      = (*env)->NewGlobalRef(env, lclazz);
     gjcarrier   = (*env)->NewGlobalRef(env, jcarrier);
     gjcallbacks = (*env)->NewGlobalRef(env, jcallbacks);
 
-    if (!gclazz || !gjcarrier || !gjcallbacks) {
+    if (!gjcarrier || !gjcallbacks) {
         logE("New global reference to local object error");
         goto errorExit;
     }
 
-    hc->clazz     = gclazz;
     hc->carrier   = gjcarrier;
     hc->callbacks = gjcallbacks;
     return 1;
 
 errorExit:
-    if (gclazz)      (*env)->DeleteGlobalRef(env, gclazz);
     if (gjcarrier)   (*env)->DeleteGlobalRef(env, gjcarrier);
     if (gjcallbacks) (*env)->DeleteGlobalRef(env, gjcallbacks);
     return 0;
@@ -837,11 +1341,24 @@ void handlerCtxtCleanup(HandlerContext* hc, JNIEnv* env)
     assert(hc);
     assert(env);
 
-    if (hc->clazz)
-        (*env)->DeleteGlobalRef(env, hc->clazz);
+    // Pending events still need the java references below.
+    if (hc->dispatcher) {
+        dispatcherDestroy(hc->dispatcher);
+        hc->dispatcher = NULL;
+    }
+
     if (hc->carrier)
         (*env)->DeleteGlobalRef(env, hc->carrier);
     if (hc->callbacks)
         (*env)->DeleteGlobalRef(env, hc->callbacks);
-}
+    if (hc->sessionHandler)
+        (*env)->DeleteGlobalRef(env, hc->sessionHandler);
+
+    hc->carrier = NULL;
+    hc->callbacks = NULL;
+    hc->sessionHandler = NULL;
 
+    friendsSnapshotCleanup(&hc->friends);
+    friendIdTableCleanup(&hc->friendIds, env);
+    progressThrottleCleanup(&hc->progress);
+}
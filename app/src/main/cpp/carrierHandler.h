@@ -47,18 +47,60 @@
 
 #include <jni.h>
 #include <IOEX_carrier.h>
+#include "friendsSnapshot.h"
+#include "carrierDispatcher.h"
+#include "friendIdTable.h"
+#include "progressThrottle.h"
 
 extern IOEXCallbacks carrierCallbacks;
 
+/* Who owns a HandlerContext, see carrierRun() and carrierKill() */
+typedef enum HandlerState {
+    HandlerState_Idle = 0,
+    HandlerState_Running,
+    HandlerState_Killed
+} HandlerState;
+
+/*
+ * Per carrier instance context, allocated by native_init and referenced by
+ * Carrier.nativeCookie. It is freed by native_kill if the carrier never ran,
+ * otherwise by native_run once IOEX_run returns.
+ */
 typedef struct HandlerContext {
     JNIEnv* env;
+    HandlerState state;
     IOEXCarrier* nativeCarrier;
-    jclass  clazz;
     jobject carrier;
     jobject callbacks;
+
+    /* Session manager handler of this carrier, set by Manager.native_init */
+    jobject sessionHandler;
+
+    /* Friend list being collected from friend_list callbacks */
+    FriendsSnapshot friends;
+
+    /* Interned java Strings of the friend ids of this carrier */
+    FriendIdTable friendIds;
+
+    /* Friend messages go to onFriendBinaryMessage as raw bytes */
+    int binaryMessages;
+
+    /* Drops file progress callbacks per transfer, see progressThrottle.h */
+    ProgressThrottle progress;
+
+    /* Set when callbacks are delivered asynchronously, NULL otherwise */
+    CarrierDispatcher* dispatcher;
+    int idlePending;
 } HandlerContext;
 
 int handlerCtxtSet(HandlerContext* hc, JNIEnv* env, jobject jcarrier, jobject jhandler);
+
+/*
+ * Deliver callbacks of this carrier on dedicated dispatcher threads instead
+ * of the IOEX_run thread. Must be called before the carrier is created.
+ */
+int handlerCtxtStartDispatcher(HandlerContext* hc, int capacity, int threads,
+                               DispatchOverflow policy);
 void handlerCtxtCleanup(HandlerContext* hc, JNIEnv* env);
 
 #endif //__JNI_CARRUER_HADNDLER_H__
\ No newline at end of file
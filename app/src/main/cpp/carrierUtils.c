@@ -49,45 +49,62 @@
 #include "utilsExt.h"
 #include "log.h"
 #include "carrierUtils.h"
-
-#define _T(type)  "org/ioex/carrier/"type
+#include "jniCache.h"
 
 int getOptionsHelper(JNIEnv* env, jobject jopts, OptionsHelper* opts)
 {
-    jclass clazz;
-    jclass bNClazz;
     jobject jnodes;
-    jsize size;
+    jint size;
     int rc;
     int i;
 
-    clazz = (*env)->GetObjectClass(env, jopts);
-    if (!clazz) {
-        logE("Java class 'Carrier::Options' not found");
+    if (!getBoolean(env, jopts, gJni.options.getUdpEnabled, &opts->udp_enabled) ||
+        !getStringExt(env, jopts, gJni.options.getPersistentLocation, &opts->persistent_location)) {
+
+        logE("At least one getter method of class 'Carrier.Options' mismatched");
         return 0;
     }
 
-    if (!getBoolean(env, clazz, jopts, "getUdpEnabled", &opts->udp_enabled) ||
-        !getStringExt(env, clazz, jopts, "getPersistentLocation",&opts->persistent_location)) {
+    if (!getBoolean(env, jopts, gJni.options.getBinaryMessages, &opts->binary_messages)) {
+        logE("Get binary messages setting of class 'Carrier.Options' error");
+        return 0;
+    }
 
-        logE("At least one getter method of class 'Carrier.Options' mismatched");
+    if (!getInt(env, jopts, gJni.options.getProgressMinInterval, &opts->progress_interval) ||
+        !getInt(env, jopts, gJni.options.getProgressMinPercent, &opts->progress_percent) ||
+        !getLong(env, jopts, gJni.options.getProgressMinBytes, &opts->progress_bytes)) {
+        logE("Get file progress settings of class 'Carrier.Options' error");
         return 0;
     }
 
-    rc = callObjectMethod(env, clazz, jopts, "getBootstrapNodes", "()Ljava/util/List;", &jnodes);
-    if (!rc) {
-        logE("call method Carrier::Options::getBootstrapNodes error");
+    if (!getInt(env, jopts, gJni.options.getDispatchQueueCapacity, &opts->dispatch_capacity) ||
+        !getInt(env, jopts, gJni.options.getDispatchThreads, &opts->dispatch_threads)) {
+        logE("Get dispatch settings of class 'Carrier.Options' error");
         return 0;
     }
 
-    bNClazz = (*env)->GetObjectClass(env, jnodes);
-    if (!bNClazz) {
-        logE("Java class 'java/util/List' not found");
-        (*env)->DeleteLocalRef(env, jnodes);
+    if (opts->dispatch_capacity > 0) {
+        jobject jpolicy = NULL;
+
+        rc = callObjectMethod(env, jopts, gJni.options.getOverflowPolicy, &jpolicy);
+        if (!rc || !jpolicy) {
+            logE("call method Carrier::Options::getOverflowPolicy error");
+            return 0;
+        }
+
+        rc = callIntMethod(env, jpolicy, gJni.overflowPolicy.value, &opts->dispatch_policy);
+        (*env)->DeleteLocalRef(env, jpolicy);
+        if (!rc)
+            return 0;
+    }
+
+    rc = callObjectMethod(env, jopts, gJni.options.getBootstrapNodes, &jnodes);
+    if (!rc || !jnodes) {
+        logE("call method Carrier::Options::getBootstrapNodes error");
         return 0;
     }
 
-    rc = callIntMethod(env, bNClazz, jnodes, "size", "()I", (int *)&size);
+    rc = callIntMethod(env, jnodes, gJni.list.size, &size);
     if (!rc) {
         (*env)->DeleteLocalRef(env, jnodes);
         return 0;
@@ -109,27 +126,18 @@ int getOptionsHelper(JNIEnv* env, jobject jopts, OptionsHelper* opts)
 
     for (i = 0; i < (int)size; i++) {
         BootstrapHelper *node = &opts->bootstraps[i];
-        jclass  jnodeClazz;
         jobject jnode;
 
-        rc = callObjectMethod(env, bNClazz, jnodes, "get",
-                              "(I)"_J("Object;"), &jnode, i);
+        rc = callObjectMethod(env, jnodes, gJni.list.get, &jnode, i);
         if (!rc) {
             (*env)->DeleteLocalRef(env, jnodes);
             return 0;
         }
 
-        jnodeClazz = (*env)->GetObjectClass(env, jnode);
-        if (!jnodeClazz) {
-            (*env)->DeleteLocalRef(env, jnode);
-            (*env)->DeleteLocalRef(env, jnodes);
-            return 0;
-        }
-
-        if (!getStringExt(env, jnodeClazz, jnode, "getIpv4", &node->ipv4) ||
-            !getStringExt(env, jnodeClazz, jnode, "getIpv6", &node->ipv6) ||
-            !getStringExt(env, jnodeClazz, jnode, "getPort", &node->port) ||
-            !getStringExt(env, jnodeClazz, jnode, "getPublicKey", &node->public_key)) {
+        if (!getStringExt(env, jnode, gJni.bootstrapNode.getIpv4, &node->ipv4) ||
+            !getStringExt(env, jnode, gJni.bootstrapNode.getIpv6, &node->ipv6) ||
+            !getStringExt(env, jnode, gJni.bootstrapNode.getPort, &node->port) ||
+            !getStringExt(env, jnode, gJni.bootstrapNode.getPublicKey, &node->public_key)) {
 
             logE("At least one getter method of class 'Carrier.BootstrapNode' mismatched");
 
@@ -172,92 +180,90 @@ void cleanupOptionsHelper(OptionsHelper* opts)
 
 int getNativeUserInfo(JNIEnv* env, jobject juserInfo, IOEXUserInfo* ui)
 {
-    jclass clazz;
+    if (!getBoolean(env, juserInfo, gJni.userInfo.hasAvatar, &ui->has_avatar)||
+        !getString(env, juserInfo, gJni.userInfo.getUserId, ui->userid, sizeof(ui->userid)) ||
+        !getString(env, juserInfo, gJni.userInfo.getName, ui->name, sizeof(ui->name)) ||
+        !getString(env, juserInfo, gJni.userInfo.getDescription, ui->description, sizeof(ui->description)) ||
+        !getString(env, juserInfo, gJni.userInfo.getGender, ui->gender, sizeof(ui->gender)) ||
+        !getString(env, juserInfo, gJni.userInfo.getPhone, ui->phone, sizeof(ui->phone)) ||
+        !getString(env, juserInfo, gJni.userInfo.getEmail, ui->email, sizeof(ui->email)) ||
+        !getString(env, juserInfo, gJni.userInfo.getRegion, ui->region, sizeof(ui->region))) {
 
-    clazz = (*env)->GetObjectClass(env, juserInfo);
-    if (!clazz) {
-        logE("Java class 'UserInfo' not found");
+        logE("At least one getter method of class 'UserInfo' missing");
         return 0;
     }
+    return 1;
+}
 
-    if (!getBoolean(env, clazz, juserInfo, "hasAvatar", &ui->has_avatar)||
-        !getString(env, clazz, juserInfo, "getUserId", ui->userid, sizeof(ui->userid)) ||
-        !getString(env, clazz, juserInfo, "getName", ui->name, sizeof(ui->name)) ||
-        !getString(env, clazz, juserInfo, "getDescription", ui->description, sizeof(ui->description)) ||
-        !getString(env, clazz, juserInfo, "getGender", ui->gender, sizeof(ui->gender)) ||
-        !getString(env, clazz, juserInfo, "getPhone", ui->phone, sizeof(ui->phone)) ||
-        !getString(env, clazz, juserInfo, "getEmail", ui->email, sizeof(ui->email)) ||
-        !getString(env, clazz, juserInfo, "getRegion", ui->region, sizeof(ui->region))) {
+#define USER_INFO_ARGC  8
 
-        logE("At least one getter method of class 'UserInfo' missing");
-        return 0;
+static
+void deleteArgStrings(JNIEnv* env, jvalue* args, int from, int to)
+{
+    int i;
+
+    for (i = from; i < to; i++) {
+        if (args[i].l)
+            (*env)->DeleteLocalRef(env, args[i].l);
     }
-    return 1;
 }
 
-int setJavaUserInfo(JNIEnv *env, jclass clazz, jobject jinfo, const IOEXUserInfo *userInfo)
+/*
+ * Fill the leading constructor arguments shared by UserInfo and FriendInfo,
+ * so that each object is built with a single NewObjectA transition instead
+ * of one upcall per setter.
+ */
+static
+int setUserInfoArgs(JNIEnv* env, const IOEXUserInfo* ui, jvalue* args)
 {
-    return (setBoolean(env, clazz, jinfo, "setHasAvatar", userInfo->has_avatar) &&
-            setString(env, clazz, jinfo, "setUserId", userInfo->userid) &&
-            setString(env, clazz, jinfo, "setName", userInfo->name) &&
-            setString(env, clazz, jinfo, "setDescription", userInfo->description) &&
-            setString(env, clazz, jinfo, "setGender", userInfo->gender) &&
-            setString(env, clazz, jinfo, "setPhone", userInfo->phone) &&
-            setString(env, clazz, jinfo, "setEmail", userInfo->email) &&
-            setString(env, clazz, jinfo, "setRegion", userInfo->region));
+    const char* strs[] = {
+        ui->userid, ui->name, ui->description, ui->gender,
+        ui->phone,  ui->email, ui->region
+    };
+    int i;
+
+    for (i = 0; i < USER_INFO_ARGC - 1; i++) {
+        args[i].l = (*env)->NewStringUTF(env, strs[i]);
+        if (!args[i].l) {
+            logE("Convert from C-chars to Java string error");
+            deleteArgStrings(env, args, 0, i);
+            return 0;
+        }
+    }
+    args[USER_INFO_ARGC - 1].z = ui->has_avatar ? JNI_TRUE : JNI_FALSE;
+    return 1;
 }
 
 int newJavaUserInfo(JNIEnv* env, const IOEXUserInfo* userInfo, jobject* juserInfo)
 {
-    jclass clazz;
-    jmethodID contor;
+    jvalue args[USER_INFO_ARGC];
     jobject jobj;
 
-    clazz = (*env)->FindClass(env, _T("UserInfo"));
-    if (!clazz) {
-        logE("Java class 'UserInfo' not found");
-        return 0;
-    }
-    contor = (*env)->GetMethodID(env, clazz, "<init>", "()V");
-    if (!contor) {
-        logE("Contructor UserInfo() not found");
+    if (!setUserInfoArgs(env, userInfo, args))
         return 0;
-    }
 
-    jobj = (*env)->NewObject(env, clazz, contor);
+    jobj = (*env)->NewObjectA(env, gJni.userInfo.clazz, gJni.userInfo.init, args);
+    deleteArgStrings(env, args, 0, USER_INFO_ARGC - 1);
     if (!jobj) {
+        (*env)->ExceptionClear(env);
         logE("New class UserInfo object error");
         return 0;
     }
 
-    if (!setJavaUserInfo(env, clazz, jobj, userInfo)) {
-        logE("Set UserInfo object's fields error");
-        (*env)->DeleteLocalRef(env, jobj);
-        return 0;
-    }
-
     *juserInfo = jobj;
     return 1;
 }
 
 int newJavaPresenceStatus(JNIEnv* env, IOEXPresenceStatus status, jobject* jpresence)
 {
-    jclass clazz;
     jobject jobj;
-    int rc;
 
+    (void)env;
     assert(jpresence);
 
-    clazz = (*env)->FindClass(env, _T("PresenceStatus"));
-    if (!clazz) {
-        logE("Java class 'PresenceStatus' not found");
-        return 0;
-    }
-
-    rc = callStaticObjectMethod(env, clazz, "valueOf", "(I)"_W("PresenceStatus;"),
-                                &jobj, status);
-    if (!rc) {
-        logE("call static method PresenceStatus::valueOf error");
+    jobj = ENUM_CONSTANT(presenceStatus, status);
+    if (!jobj) {
+        logE("Invalid presence status %d", (int)status);
         return 0;
     }
 
@@ -267,17 +273,10 @@ int newJavaPresenceStatus(JNIEnv* env, IOEXPresenceStatus status, jobject* jpres
 
 int newNativePresenceStatus(JNIEnv *env, jobject jpresence, IOEXPresenceStatus *presence)
 {
-    jclass clazz;
     int rc;
     int value;
 
-    clazz = (*env)->GetObjectClass(env, jpresence);
-    if (!clazz) {
-        logE("Java Enum 'PresenceStatus' not found");
-        return 0;
-    }
-
-    rc = callIntMethod(env, clazz, jpresence, "value", "()I", &value);
+    rc = callIntMethod(env, jpresence, gJni.presenceStatus.value, &value);
     if (!rc) {
         logE("call method PresenceStatus::value error");
         return 0;
@@ -289,20 +288,13 @@ int newNativePresenceStatus(JNIEnv *env, jobject jpresence, IOEXPresenceStatus *
 
 int newJavaConnectionStatus(JNIEnv* env, IOEXConnectionStatus status, jobject* jstatus)
 {
-    jclass clazz;
     jobject jobj;
-    int rc;
 
-    clazz = (*env)->FindClass(env, _T("ConnectionStatus"));
-    if (!clazz) {
-        logE("Java class 'ConnectionStatus' not found");
-        return 0;
-    }
+    (void)env;
 
-    rc = callStaticObjectMethod(env, clazz, "valueOf", "(I)"_W("ConnectionStatus;"),
-                                &jobj, status);
-    if (!rc) {
-        logE("call static method ConnectionStatus::valueOf error");
+    jobj = ENUM_CONSTANT(connectionStatus, status);
+    if (!jobj) {
+        logE("Invalid connection status %d", (int)status);
         return 0;
     }
 
@@ -312,78 +304,30 @@ int newJavaConnectionStatus(JNIEnv* env, IOEXConnectionStatus status, jobject* j
 
 int newJavaFriendInfo(JNIEnv* env, const IOEXFriendInfo* friendInfo, jobject* jfriendInfo)
 {
-    jclass clazz;
-    jmethodID contor;
+    jvalue args[USER_INFO_ARGC + 3];
     jobject jobj;
-    jstring jlabel;
-    jobject jpresence;
-    jobject jconnection;
-    int rc;
 
-    clazz = (*env)->FindClass(env, _T("FriendInfo"));
-    if (!clazz) {
-        logE("Java class 'FriendInfo' not found");
+    if (!setUserInfoArgs(env, &friendInfo->user_info, args))
         return 0;
-    }
-    contor = (*env)->GetMethodID(env, clazz, "<init>", "()V");
-    if (!contor) {
-        logE("Contructor FriendInfo() not found");
+
+    args[USER_INFO_ARGC].l = (*env)->NewStringUTF(env, friendInfo->label);
+    if (!args[USER_INFO_ARGC].l) {
+        logE("Convert from C-chars to Java string error");
+        deleteArgStrings(env, args, 0, USER_INFO_ARGC - 1);
         return 0;
     }
-    jobj = (*env)->NewObject(env, clazz, contor);
+    args[USER_INFO_ARGC + 1].i = (jint)friendInfo->presence;
+    args[USER_INFO_ARGC + 2].i = (jint)friendInfo->status;
+
+    jobj = (*env)->NewObjectA(env, gJni.friendInfo.clazz, gJni.friendInfo.init, args);
+    deleteArgStrings(env, args, 0, USER_INFO_ARGC - 1);
+    (*env)->DeleteLocalRef(env, args[USER_INFO_ARGC].l);
     if (!jobj) {
+        (*env)->ExceptionClear(env);
         logE("New class FriendInfo object error");
         return 0;
     }
 
-    // setUserInfo.
-    if (!setJavaUserInfo(env, clazz, jobj, &friendInfo->user_info)) {
-        logE("Set UserInfo of Friend Object error");
-        goto errorExit;
-    }
-
-    // setLabel.
-    jlabel = (*env)->NewStringUTF(env, friendInfo->label);
-    if (!jlabel) {
-        logE("Convert from C-chars to Java string error");
-        goto errorExit;
-    }
-    rc = callVoidMethod(env, clazz, jobj, "setLabel", "("_J("String;)V"), jlabel);
-    (*env)->DeleteLocalRef(env, jlabel);
-    if (!rc) {
-        logE("Call method 'void FriendInfo::setLabel(String label)' error");
-        goto errorExit;
-    }
-
-    // setPresence.
-    if (!newJavaPresenceStatus(env, friendInfo->presence, &jpresence)) {
-        logE("Construct Java PresenceStatuss object error");
-        goto errorExit;
-    }
-    rc = callVoidMethod(env, clazz, jobj, "setPresence", "("_W("PresenceStatus;)V"),
-                        jpresence);
-    (*env)->DeleteLocalRef(env, jpresence);
-    if (!rc) {
-        logE("Call method FriendInfo::setPresence error");
-        goto errorExit;
-    }
-
-    if (!newJavaConnectionStatus(env, friendInfo->status, &jconnection)) {
-        logE("Construct Java ConnectionStatus object error");
-        goto errorExit;
-    }
-    rc = callVoidMethod(env, clazz, jobj, "setConnectionStatus", "("_W("ConnectionStatus;)V"),
-                            jconnection);
-    (*env)->DeleteLocalRef(env, jconnection);
-    if (!rc) {
-        logE("Call method FriendInfo::setConnectionStatus error");
-        goto errorExit;
-    }
-
     *jfriendInfo = jobj;
     return 1;
-
-errorExit:
-    (*env)->DeleteGlobalRef(env, jobj);
-    return 0;
 }
@@ -60,6 +60,19 @@ typedef struct OptionsHelper {
     char* persistent_location;
     size_t  bootstraps_size;
     BootstrapHelper *bootstraps;
+
+    /* 0 means callbacks are delivered on the carrier thread */
+    int dispatch_capacity;
+    int dispatch_threads;
+    int dispatch_policy;
+
+    /* Deliver friend messages as raw bytes instead of strings */
+    int binary_messages;
+
+    /* File progress throttle, 0 disables a threshold */
+    int progress_interval;
+    int progress_percent;
+    int64_t progress_bytes;
 } OptionsHelper;
 
 int getOptionsHelper(JNIEnv* env, jobject jopts, OptionsHelper* opts);
@@ -72,6 +85,10 @@ int newJavaUserInfo(JNIEnv* env, const IOEXUserInfo* userInfo, jobject* juserInf
 
 int newJavaFriendInfo(JNIEnv* env, const IOEXFriendInfo* friendInfo, jobject* jfriendInfo);
 
+/*
+ * The two functions below hand out the cached enum constant, which is a
+ * global reference owned by the JNI cache: do not delete it.
+ */
 int newJavaConnectionStatus(JNIEnv* env, IOEXConnectionStatus status, jobject* jstatus);
 
 int newJavaPresenceStatus(JNIEnv* env, IOEXPresenceStatus presence, jobject* jpresence);
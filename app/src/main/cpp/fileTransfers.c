@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "log.h"
+#include "jniCache.h"
+#include "fileTransfers.h"
+
+void fileTransfersInit(FileTransfers* ft)
+{
+    assert(ft);
+    memset(ft, 0, sizeof(*ft));
+}
+
+void fileTransfersCleanup(FileTransfers* ft)
+{
+    if (!ft)
+        return;
+
+    free(ft->ids);
+    free(ft->values);
+    memset(ft, 0, sizeof(*ft));
+}
+
+static
+int reserve(FileTransfers* ft)
+{
+    int capacity;
+    void* ids;
+    jlong* values;
+
+    if (ft->count < ft->capacity)
+        return 1;
+
+    capacity = ft->capacity ? ft->capacity << 1 : 16;
+
+    ids = realloc(ft->ids, sizeof(*ft->ids) * capacity);
+    if (!ids)
+        return 0;
+    ft->ids = ids;
+
+    values = (jlong*)realloc(ft->values,
+                             sizeof(jlong) * FILE_TRANSFER_STRIDE * capacity);
+    if (!values)
+        return 0;
+    ft->values = values;
+
+    ft->capacity = capacity;
+    return 1;
+}
+
+int fileTransfersAppend(FileTransfers* ft, const IOEXTrackerInfo* ti)
+{
+    assert(ft);
+    assert(ti);
+
+    if (!reserve(ft))
+        return 0;
+
+    strncpy(ft->ids[ft->count], ti->file_id, IOEX_MAX_FILE_ID_LEN);
+    ft->ids[ft->count][IOEX_MAX_FILE_ID_LEN] = 0;
+    ft->count++;
+    return 1;
+}
+
+void fileTransfersResolve(FileTransfers* ft, IOEXCarrier* carrier)
+{
+    IOEXFileInfo fi;
+    jlong* values;
+    int i;
+    int n = 0;
+
+    assert(ft);
+    assert(carrier);
+
+    for (i = 0; i < ft->count; i++) {
+        if (IOEX_get_file_info(carrier, &fi, ft->ids[i]) < 0 ||
+            fi.status == IOEXFileTransmissionStatus_None)
+            continue;
+
+        if (n != i)
+            memcpy(ft->ids[n], ft->ids[i], sizeof(ft->ids[n]));
+
+        values = ft->values + (size_t)n * FILE_TRANSFER_STRIDE;
+        values[0] = (jlong)fi.ti.file_size;
+        values[1] = (jlong)fi.transferred_size;
+        values[2] = (jlong)((uint64_t)fi.status |
+                            (uint64_t)fi.paused << 8 |
+                            (uint64_t)fi.direction << 16 |
+                            (uint64_t)fi.ti.friend_number << 32);
+        n++;
+    }
+
+    ft->count = n;
+}
+
+jobject fileTransfersToJava(JNIEnv* env, const FileTransfers* ft)
+{
+    jobjectArray jids;
+    jlongArray jvalues;
+    jobject jtransfers = NULL;
+    int i;
+
+    assert(env);
+    assert(ft);
+
+    jids = (*env)->NewObjectArray(env, ft->count, gJni.string.clazz, NULL);
+    if (!jids) {
+        logE("New string array for file transfers error");
+        (*env)->ExceptionClear(env);
+        return NULL;
+    }
+
+    for (i = 0; i < ft->count; i++) {
+        jstring jid = (*env)->NewStringUTF(env, ft->ids[i]);
+        if (!jid) {
+            logE("New java string for file id error");
+            (*env)->ExceptionClear(env);
+            goto errorExit;
+        }
+        (*env)->SetObjectArrayElement(env, jids, i, jid);
+        (*env)->DeleteLocalRef(env, jid);
+    }
+
+    jvalues = (*env)->NewLongArray(env, ft->count * FILE_TRANSFER_STRIDE);
+    if (!jvalues) {
+        logE("New long array for file transfers error");
+        (*env)->ExceptionClear(env);
+        goto errorExit;
+    }
+
+    if (ft->count > 0)
+        (*env)->SetLongArrayRegion(env, jvalues, 0, ft->count * FILE_TRANSFER_STRIDE,
+                                   ft->values);
+
+    jtransfers = (*env)->NewObject(env, gJni.fileTransfers.clazz, gJni.fileTransfers.init,
+                                   jids, jvalues);
+    if (!jtransfers) {
+        logE("New java FileTransfers object error");
+        (*env)->ExceptionClear(env);
+    }
+
+    (*env)->DeleteLocalRef(env, jvalues);
+
+errorExit:
+    (*env)->DeleteLocalRef(env, jids);
+    return jtransfers;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __FILE_TRANSFERS_H__
+#define __FILE_TRANSFERS_H__
+
+#include <jni.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <IOEX_carrier.h>
+
+/*
+ * Status of every file transmission tracked by a carrier, collected in one
+ * pass and handed to java as a String[] of file ids plus one long[] holding
+ * FILE_TRANSFER_STRIDE values per transfer:
+ *
+ *     file size, transferred size,
+ *     status | paused << 8 | direction << 16 | friend number << 32
+ *
+ * org.ioex.carrier.FileTransfers reads the values in place.
+ */
+#define FILE_TRANSFER_STRIDE    3
+
+typedef struct FileTransfers {
+    char (*ids)[IOEX_MAX_FILE_ID_LEN + 1];
+    jlong* values;
+    int count;
+    int capacity;
+} FileTransfers;
+
+void fileTransfersInit(FileTransfers* ft);
+
+void fileTransfersCleanup(FileTransfers* ft);
+
+/* Append the id of one tracker. Returns 1 on success, 0 if out of memory. */
+int fileTransfersAppend(FileTransfers* ft, const IOEXTrackerInfo* ti);
+
+/*
+ * Query the status of every appended tracker. Trackers that went away
+ * since they were appended are dropped.
+ */
+void fileTransfersResolve(FileTransfers* ft, IOEXCarrier* carrier);
+
+/* Build the java FileTransfers object, or NULL on error. */
+jobject fileTransfersToJava(JNIEnv* env, const FileTransfers* ft);
+
+#endif //__FILE_TRANSFERS_H__
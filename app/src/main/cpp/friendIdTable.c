@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "log.h"
+#include "friendIdTable.h"
+
+#define MIN_CAPACITY    64
+
+static
+uint32_t hashId(const char* id)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*id) {
+        hash ^= (uint8_t)*id++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Slot holding id, or the empty slot where it would go. Lock held. */
+static
+int findSlot(const FriendIdTable* table, const char* id)
+{
+    int mask = table->capacity - 1;
+    int i = (int)(hashId(id) & (uint32_t)mask);
+
+    while (table->entries[i].jid && strcmp(table->entries[i].id, id))
+        i = (i + 1) & mask;
+    return i;
+}
+
+/* Called with the write lock held. */
+static
+int grow(FriendIdTable* table)
+{
+    FriendIdEntry* old = table->entries;
+    int oldCapacity = table->capacity;
+    int capacity = oldCapacity ? oldCapacity * 2 : MIN_CAPACITY;
+    int i;
+
+    table->entries = (FriendIdEntry*)calloc((size_t)capacity, sizeof(FriendIdEntry));
+    if (!table->entries) {
+        table->entries = old;
+        return 0;
+    }
+    table->capacity = capacity;
+
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i].jid)
+            table->entries[findSlot(table, old[i].id)] = old[i];
+    }
+
+    free(old);
+    return 1;
+}
+
+void friendIdTableInit(FriendIdTable* table)
+{
+    memset(table, 0, sizeof(*table));
+    pthread_rwlock_init(&table->lock, NULL);
+}
+
+void friendIdTableCleanup(FriendIdTable* table, JNIEnv* env)
+{
+    int i;
+
+    pthread_rwlock_wrlock(&table->lock);
+    for (i = 0; i < table->capacity; i++) {
+        if (table->entries[i].jid)
+            (*env)->DeleteGlobalRef(env, table->entries[i].jid);
+    }
+    free(table->entries);
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+    pthread_rwlock_unlock(&table->lock);
+
+    pthread_rwlock_destroy(&table->lock);
+}
+
+int friendIdTableAdd(FriendIdTable* table, JNIEnv* env, const char* id)
+{
+    jstring lid;
+    jstring gid;
+    int slot;
+
+    assert(id);
+
+    if (strlen(id) > IOEX_MAX_ID_LEN)
+        return 0;
+
+    pthread_rwlock_wrlock(&table->lock);
+
+    if ((table->count + 1) * 4 > table->capacity * 3 && !grow(table)) {
+        pthread_rwlock_unlock(&table->lock);
+        logE("Grow friend id table error");
+        return 0;
+    }
+
+    slot = findSlot(table, id);
+    if (table->entries[slot].jid) {
+        pthread_rwlock_unlock(&table->lock);
+        return 1;
+    }
+
+    lid = (*env)->NewStringUTF(env, id);
+    gid = lid ? (*env)->NewGlobalRef(env, lid) : NULL;
+    if (lid)
+        (*env)->DeleteLocalRef(env, lid);
+    if (!gid) {
+        pthread_rwlock_unlock(&table->lock);
+        (*env)->ExceptionClear(env);
+        logE("Intern friend id string error");
+        return 0;
+    }
+
+    strcpy(table->entries[slot].id, id);
+    table->entries[slot].jid = gid;
+    table->count++;
+
+    pthread_rwlock_unlock(&table->lock);
+    return 1;
+}
+
+void friendIdTableRemove(FriendIdTable* table, JNIEnv* env, const char* id)
+{
+    int mask;
+    int i, j;
+
+    assert(id);
+
+    pthread_rwlock_wrlock(&table->lock);
+    if (!table->count) {
+        pthread_rwlock_unlock(&table->lock);
+        return;
+    }
+
+    mask = table->capacity - 1;
+    i = findSlot(table, id);
+    if (!table->entries[i].jid) {
+        pthread_rwlock_unlock(&table->lock);
+        return;
+    }
+
+    (*env)->DeleteGlobalRef(env, table->entries[i].jid);
+    table->entries[i].jid = NULL;
+    table->count--;
+
+    // Backward shift deletion: pull later entries of the probe run into
+    // the hole, so lookups never need tombstones.
+    for (j = (i + 1) & mask; table->entries[j].jid; j = (j + 1) & mask) {
+        int home = (int)(hashId(table->entries[j].id) & (uint32_t)mask);
+
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table->entries[i] = table->entries[j];
+            table->entries[j].jid = NULL;
+            i = j;
+        }
+    }
+
+    pthread_rwlock_unlock(&table->lock);
+}
+
+jstring friendIdTableGet(FriendIdTable* table, JNIEnv* env, const char* id)
+{
+    jstring jid = NULL;
+
+    assert(id);
+
+    pthread_rwlock_rdlock(&table->lock);
+    if (table->count) {
+        int slot = findSlot(table, id);
+
+        if (table->entries[slot].jid)
+            jid = (*env)->NewLocalRef(env, table->entries[slot].jid);
+    }
+    pthread_rwlock_unlock(&table->lock);
+
+    return jid ? jid : (*env)->NewStringUTF(env, id);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __FRIEND_ID_TABLE_H__
+#define __FRIEND_ID_TABLE_H__
+
+#include <jni.h>
+#include <pthread.h>
+#include <IOEX_carrier.h>
+
+/*
+ * Interns the java String of every known friend id, so callbacks about a
+ * friend hand java the same String instance instead of allocating a new
+ * one per event. Entries are added for friends reported by the friend
+ * list and friend_added callbacks and evicted by friend_removed; ids of
+ * strangers are never interned.
+ *
+ * Open addressing with linear probing, guarded by a read/write lock since
+ * callbacks may run on several dispatcher threads.
+ */
+typedef struct FriendIdEntry {
+    char id[IOEX_MAX_ID_LEN + 1];
+    jstring jid;
+} FriendIdEntry;
+
+typedef struct FriendIdTable {
+    pthread_rwlock_t lock;
+    FriendIdEntry* entries;
+    int capacity;
+    int count;
+} FriendIdTable;
+
+void friendIdTableInit(FriendIdTable* table);
+
+void friendIdTableCleanup(FriendIdTable* table, JNIEnv* env);
+
+/* Intern the id of a known friend. Returns 1 on success, 0 on error. */
+int friendIdTableAdd(FriendIdTable* table, JNIEnv* env, const char* id);
+
+void friendIdTableRemove(FriendIdTable* table, JNIEnv* env, const char* id);
+
+/*
+ * Get a local reference to the java String of id, the interned instance
+ * if id is a known friend, otherwise a new String. The caller deletes the
+ * local reference as usual.
+ */
+jstring friendIdTableGet(FriendIdTable* table, JNIEnv* env, const char* id);
+
+#endif //__FRIEND_ID_TABLE_H__
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "log.h"
+#include "jniCache.h"
+#include "friendsSnapshot.h"
+
+#define RECORD_HEADER_LEN   3
+#define RECORD_STRINGS      8
+
+void friendsSnapshotInit(FriendsSnapshot* fs)
+{
+    assert(fs);
+    memset(fs, 0, sizeof(*fs));
+}
+
+void friendsSnapshotCleanup(FriendsSnapshot* fs)
+{
+    if (!fs)
+        return;
+
+    free(fs->data);
+    free(fs->offsets);
+    memset(fs, 0, sizeof(*fs));
+}
+
+static
+int reserve(FriendsSnapshot* fs, size_t len)
+{
+    size_t capacity;
+    uint8_t* data;
+
+    if (fs->size + len <= fs->capacity)
+        return 1;
+
+    capacity = fs->capacity ? fs->capacity : 4096;
+    while (capacity < fs->size + len)
+        capacity <<= 1;
+
+    data = (uint8_t*)realloc(fs->data, capacity);
+    if (!data)
+        return 0;
+
+    fs->data = data;
+    fs->capacity = capacity;
+    return 1;
+}
+
+static
+void putString(FriendsSnapshot* fs, const char* str)
+{
+    size_t len = strlen(str);
+
+    /* All carrier user info fields are bounded well below 256 bytes */
+    if (len > UINT8_MAX)
+        len = UINT8_MAX;
+
+    fs->data[fs->size++] = (uint8_t)len;
+    memcpy(fs->data + fs->size, str, len);
+    fs->size += len;
+}
+
+int friendsSnapshotAppend(FriendsSnapshot* fs, const IOEXFriendInfo* fi)
+{
+    const IOEXUserInfo* ui;
+    const char* strings[RECORD_STRINGS];
+    size_t len = RECORD_HEADER_LEN;
+    int i;
+
+    assert(fs);
+    assert(fi);
+
+    ui = &fi->user_info;
+    strings[0] = ui->userid;
+    strings[1] = fi->label;
+    strings[2] = ui->name;
+    strings[3] = ui->description;
+    strings[4] = ui->gender;
+    strings[5] = ui->phone;
+    strings[6] = ui->email;
+    strings[7] = ui->region;
+
+    for (i = 0; i < RECORD_STRINGS; i++)
+        len += 1 + strlen(strings[i]);
+
+    if (fs->count == fs->offsetCapacity) {
+        int capacity = fs->offsetCapacity ? fs->offsetCapacity * 2 : 64;
+        jint* offsets = (jint*)realloc(fs->offsets, sizeof(jint) * capacity);
+        if (!offsets)
+            return 0;
+
+        fs->offsets = offsets;
+        fs->offsetCapacity = capacity;
+    }
+
+    if (!reserve(fs, len))
+        return 0;
+
+    fs->offsets[fs->count++] = (jint)fs->size;
+
+    fs->data[fs->size++] = (uint8_t)fi->status;
+    fs->data[fs->size++] = (uint8_t)fi->presence;
+    fs->data[fs->size++] = (uint8_t)(ui->has_avatar ? 1 : 0);
+
+    for (i = 0; i < RECORD_STRINGS; i++)
+        putString(fs, strings[i]);
+
+    return 1;
+}
+
+jobject friendsSnapshotToJava(JNIEnv* env, const FriendsSnapshot* fs)
+{
+    jbyteArray jdata;
+    jintArray joffsets;
+    jobject jsnapshot;
+
+    assert(env);
+    assert(fs);
+
+    jdata = (*env)->NewByteArray(env, (jsize)fs->size);
+    if (!jdata) {
+        logE("New byte array for friends snapshot error");
+        return NULL;
+    }
+
+    joffsets = (*env)->NewIntArray(env, (jsize)fs->count);
+    if (!joffsets) {
+        logE("New int array for friends snapshot error");
+        (*env)->DeleteLocalRef(env, jdata);
+        return NULL;
+    }
+
+    if (fs->size > 0)
+        (*env)->SetByteArrayRegion(env, jdata, 0, (jsize)fs->size, (const jbyte*)fs->data);
+    if (fs->count > 0)
+        (*env)->SetIntArrayRegion(env, joffsets, 0, (jsize)fs->count, fs->offsets);
+
+    jsnapshot = (*env)->NewObject(env, gJni.friendsSnapshot.clazz, gJni.friendsSnapshot.init,
+                                  jdata, joffsets);
+    if (!jsnapshot) {
+        logE("New java FriendsSnapshot object error");
+        (*env)->ExceptionClear(env);
+    }
+
+    (*env)->DeleteLocalRef(env, jdata);
+    (*env)->DeleteLocalRef(env, joffsets);
+    return jsnapshot;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __FRIENDS_SNAPSHOT_H__
+#define __FRIENDS_SNAPSHOT_H__
+
+#include <jni.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <IOEX_carrier.h>
+
+/*
+ * Packs a friend list into one byte array so that it crosses into java
+ * with a single allocation instead of one FriendInfo object per friend.
+ *
+ * Each record starts at offsets[i] and is laid out as:
+ *
+ *     u8 status, u8 presence, u8 hasAvatar,
+ *     then userid, label, name, description, gender, phone, email, region,
+ *     each as u8 length followed by that many UTF-8 bytes.
+ *
+ * org.ioex.carrier.FriendsSnapshot decodes records lazily on access.
+ */
+typedef struct FriendsSnapshot {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+
+    jint* offsets;
+    int count;
+    int offsetCapacity;
+} FriendsSnapshot;
+
+void friendsSnapshotInit(FriendsSnapshot* fs);
+
+void friendsSnapshotCleanup(FriendsSnapshot* fs);
+
+/* Append one friend record. Returns 1 on success, 0 if out of memory. */
+int friendsSnapshotAppend(FriendsSnapshot* fs, const IOEXFriendInfo* fi);
+
+/* Build the java FriendsSnapshot object, or NULL on error. */
+jobject friendsSnapshotToJava(JNIEnv* env, const FriendsSnapshot* fs);
+
+#endif //__FRIENDS_SNAPSHOT_H__
@@ -46,6 +46,9 @@
 #include <stdlib.h>
 #include "log.h"
 #include "utils.h"
+#include "jniCache.h"
+#include "sendQueue.h"
+#include "upcallStats.h"
 #include "IOEX_session.h"
 
 extern int registerCarrierMethods(JNIEnv* env);
@@ -58,46 +61,6 @@ extern void unregisterCarrierSessionManagerMethods(JNIEnv* env);
 extern void unregisterCarrierSessionMethods(JNIEnv* env);
 extern void unregisterCarrierStreamMethods(JNIEnv* env);
 
-static jclass gClazzLoader = NULL;
-
-jclass findClass(JNIEnv* env, const char* className)
-{
-    jstring jsig = (*env)->NewStringUTF(env, className);
-
-    jclass loaderClazz = (*env)->FindClass(env, "java/lang/ClassLoader");
-    jmethodID   method = (*env)->GetMethodID(env, loaderClazz, "findClass",
-                                             "(Ljava/lang/String;)Ljava/lang/Class;");
-
-    jclass clazz = (*env)->CallObjectMethod(env, gClazzLoader, method, jsig);
-    (*env)->DeleteLocalRef(env, jsig);
-
-    return clazz;
-}
-
-static int getClassLoader(JNIEnv* env)
-{
-    jclass clazz = (*env)->FindClass(env, "org/ioex/carrier/Carrier");
-    jclass metaClazz = (*env)->GetObjectClass(env, clazz);
-    jmethodID method = (*env)->GetMethodID(env, metaClazz, "getClassLoader",
-                                           "()Ljava/lang/ClassLoader;");
-    jclass clazzLoader = (*env)->CallObjectMethod(env, clazz, method);
-
-    gClazzLoader = (*env)->NewGlobalRef(env, clazzLoader);
-    if (!gClazzLoader) {
-        logE("Can not new global reference to ClasssLoader");
-        return -1;
-    }
-    return 0;
-}
-
-static void cleanupClassLoader(JNIEnv* env)
-{
-    if (gClazzLoader) {
-        (*env)->DeleteGlobalRef(env, gClazzLoader);
-        gClazzLoader = NULL;
-    }
-}
-
 jint JNI_OnLoad(JavaVM* vm, void* reserved)
 {
     JNIEnv* env = NULL;
@@ -109,6 +72,11 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved)
         return -1;
     }
 
+    if (!jniCacheInit(env)) {
+        logE("Cache java classes, methods and fields error");
+        return -1;
+    }
+
     if ((registerCarrierMethods(env) != JNI_TRUE) ||
         (registerCarrierSessionManagerMethods(env) != JNI_TRUE) ||
         (registerCarrierSessionMethods(env) != JNI_TRUE) ||
@@ -118,14 +86,11 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved)
         return -1;
     }
 
-    if (getClassLoader(env) < 0) {
-        logE("Get class loader error");
-        return -1;
-    }
-
     setJvm(vm);
 
+#if defined(__ANDROID__)
     IOEX_session_jni_onload(vm, reserved);
+#endif
 
     logI("Android java JNI loaded");
 
@@ -142,11 +107,14 @@ void JNI_OnUnload(JavaVM* vm, void* reserved)
         return;
     }
 
-    cleanupClassLoader(env);
-
     unregisterCarrierSessionManagerMethods(env);
     unregisterCarrierSessionMethods(env);
     unregisterCarrierStreamMethods(env);
     unregisterCarrierMethods(env);
+
+    sendQueueShutdown();
+    upcallStatsShutdown();
+    jniCacheCleanup(env);
+    logStopAsync();
 }
 
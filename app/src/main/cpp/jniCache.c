@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <string.h>
+#include "log.h"
+#include "utils.h"
+#include "jniCache.h"
+
+#define MAX_CACHED_CLASSES  64
+#define MAX_CACHED_OBJECTS  32
+
+/* userId, name, description, gender, phone, email, region */
+#define USER_INFO_ARGS  "("_J("String;")_J("String;")_J("String;")_J("String;") \
+                        _J("String;")_J("String;")_J("String;")
+
+JniCache gJni;
+
+static jclass* gClassSlots[MAX_CACHED_CLASSES];
+static int gClassCount = 0;
+
+static jobject* gObjectSlots[MAX_CACHED_OBJECTS];
+static int gObjectCount = 0;
+
+static
+int cacheClass(JNIEnv* env, jclass* slot, const char* className)
+{
+    jclass lclazz;
+
+    if (gClassCount >= MAX_CACHED_CLASSES) {
+        logE("Too many java classes to cache");
+        return 0;
+    }
+
+    lclazz = (*env)->FindClass(env, className);
+    if (!lclazz) {
+        (*env)->ExceptionClear(env);
+        logE("Java class '%s' not found", className);
+        return 0;
+    }
+
+    *slot = (*env)->NewGlobalRef(env, lclazz);
+    (*env)->DeleteLocalRef(env, lclazz);
+    if (!*slot) {
+        logE("New global reference to class '%s' error", className);
+        return 0;
+    }
+
+    gClassSlots[gClassCount++] = slot;
+    return 1;
+}
+
+static
+int cacheMethod(JNIEnv* env, jmethodID* slot, jclass clazz, const char* name, const char* sig)
+{
+    *slot = (*env)->GetMethodID(env, clazz, name, sig);
+    if (!*slot) {
+        (*env)->ExceptionClear(env);
+        logE("Get method %s with signature:%s error", name, sig);
+        return 0;
+    }
+    return 1;
+}
+
+static
+int cacheStaticMethod(JNIEnv* env, jmethodID* slot, jclass clazz, const char* name,
+                      const char* sig)
+{
+    *slot = (*env)->GetStaticMethodID(env, clazz, name, sig);
+    if (!*slot) {
+        (*env)->ExceptionClear(env);
+        logE("Get static method %s with signature:%s error", name, sig);
+        return 0;
+    }
+    return 1;
+}
+
+static
+int cacheField(JNIEnv* env, jfieldID* slot, jclass clazz, const char* name, const char* sig)
+{
+    *slot = (*env)->GetFieldID(env, clazz, name, sig);
+    if (!*slot) {
+        (*env)->ExceptionClear(env);
+        logE("Get field %s with signature:%s error", name, sig);
+        return 0;
+    }
+    return 1;
+}
+
+static
+int cacheEnumValues(JNIEnv* env, jobject* values, int from, int count, jclass clazz,
+                    jmethodID valueOf, const char* name)
+{
+    jobject lvalue;
+    int i;
+
+    for (i = from; i < count; i++) {
+        if (gObjectCount >= MAX_CACHED_OBJECTS) {
+            logE("Too many java objects to cache");
+            return 0;
+        }
+
+        lvalue = (*env)->CallStaticObjectMethod(env, clazz, valueOf, (jint)i);
+        if ((*env)->ExceptionCheck(env) || !lvalue) {
+            (*env)->ExceptionClear(env);
+            logE("Resolve %s constant of value %d error", name, i);
+            return 0;
+        }
+
+        values[i] = (*env)->NewGlobalRef(env, lvalue);
+        (*env)->DeleteLocalRef(env, lvalue);
+        if (!values[i]) {
+            logE("New global reference to %s constant error", name);
+            return 0;
+        }
+
+        gObjectSlots[gObjectCount++] = &values[i];
+    }
+    return 1;
+}
+
+#define CLASS(entry, name) \
+    cacheClass(env, &gJni.entry.clazz, name)
+
+#define METHOD(entry, member, name, sig) \
+    cacheMethod(env, &gJni.entry.member, gJni.entry.clazz, name, sig)
+
+#define STATIC_METHOD(entry, member, name, sig) \
+    cacheStaticMethod(env, &gJni.entry.member, gJni.entry.clazz, name, sig)
+
+#define FIELD(entry, member, name, sig) \
+    cacheField(env, &gJni.entry.member, gJni.entry.clazz, name, sig)
+
+#define ENUM_VALUES(entry, from, count) \
+    cacheEnumValues(env, gJni.entry.values, from, count, gJni.entry.clazz, \
+                    gJni.entry.valueOf, #entry)
+
+static
+int cacheCarrierClasses(JNIEnv* env)
+{
+    return CLASS(carrier, "org/ioex/carrier/Carrier") &&
+        FIELD(carrier, nativeCookie, "nativeCookie", "J") &&
+        FIELD(carrier, handler, "handler", _W("CarrierHandler;")) &&
+
+        CLASS(options, "org/ioex/carrier/Carrier$Options") &&
+        METHOD(options, getUdpEnabled, "getUdpEnabled", "()Z") &&
+        METHOD(options, getPersistentLocation, "getPersistentLocation", "()"_J("String;")) &&
+        METHOD(options, getBootstrapNodes, "getBootstrapNodes", "()Ljava/util/List;") &&
+        METHOD(options, getDispatchQueueCapacity, "getDispatchQueueCapacity", "()I") &&
+        METHOD(options, getDispatchThreads, "getDispatchThreads", "()I") &&
+        METHOD(options, getOverflowPolicy, "getOverflowPolicy",
+               "()"_W("Carrier$Options$OverflowPolicy;")) &&
+        METHOD(options, getBinaryMessages, "getBinaryMessages", "()Z") &&
+        METHOD(options, getProgressMinInterval, "getProgressMinInterval", "()I") &&
+        METHOD(options, getProgressMinPercent, "getProgressMinPercent", "()I") &&
+        METHOD(options, getProgressMinBytes, "getProgressMinBytes", "()J") &&
+
+        CLASS(overflowPolicy, "org/ioex/carrier/Carrier$Options$OverflowPolicy") &&
+        METHOD(overflowPolicy, value, "value", "()I") &&
+
+        CLASS(bootstrapNode, "org/ioex/carrier/Carrier$Options$BootstrapNode") &&
+        METHOD(bootstrapNode, getIpv4, "getIpv4", "()"_J("String;")) &&
+        METHOD(bootstrapNode, getIpv6, "getIpv6", "()"_J("String;")) &&
+        METHOD(bootstrapNode, getPort, "getPort", "()"_J("String;")) &&
+        METHOD(bootstrapNode, getPublicKey, "getPublicKey", "()"_J("String;")) &&
+
+        CLASS(list, "java/util/List") &&
+        METHOD(list, size, "size", "()I") &&
+        METHOD(list, get, "get", "(I)"_J("Object;")) &&
+
+        CLASS(string, "java/lang/String") &&
+
+        CLASS(callbacks, "org/ioex/carrier/Carrier$Callbacks") &&
+        METHOD(callbacks, onIdle, "onIdle", "("_W("Carrier;)V")) &&
+        METHOD(callbacks, onConnection, "onConnection",
+               "("_W("Carrier;")_W("ConnectionStatus;)V")) &&
+        METHOD(callbacks, onReady, "onReady", "("_W("Carrier;)V")) &&
+        METHOD(callbacks, onSelfInfoChanged, "onSelfInfoChanged",
+               "("_W("Carrier;")_W("UserInfo;)V")) &&
+        METHOD(callbacks, onFriends, "onFriends",
+               "("_W("Carrier;")_W("FriendsSnapshot;)V")) &&
+        METHOD(callbacks, onFriendConnection, "onFriendConnection",
+               "("_W("Carrier;")_J("String;")_W("ConnectionStatus;)V")) &&
+        METHOD(callbacks, onFriendInfoChanged, "onFriendInfoChanged",
+               "("_W("Carrier;")_J("String;")_W("FriendInfo;)V")) &&
+        METHOD(callbacks, onFriendPresence, "onFriendPresence",
+               "("_W("Carrier;")_J("String;")_W("PresenceStatus;)V")) &&
+        METHOD(callbacks, onFriendRequest, "onFriendRequest",
+               "("_W("Carrier;")_J("String;")_W("UserInfo;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendAdded, "onFriendAdded",
+               "("_W("Carrier;")_W("FriendInfo;)V")) &&
+        METHOD(callbacks, onFriendRemoved, "onFriendRemoved",
+               "("_W("Carrier;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendMessage, "onFriendMessage",
+               "("_W("Carrier;")_J("String;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendBinaryMessage, "onFriendBinaryMessage",
+               "("_W("Carrier;")_J("String;")"[B)V") &&
+        METHOD(callbacks, onFriendInviteRequest, "onFriendInviteRequest",
+               "("_W("Carrier;")_J("String;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendFileRequest, "onFriendFileRequest",
+               "("_W("Carrier;")_J("String;")_J("String;")_J("String;")"J)V") &&
+        METHOD(callbacks, onFriendFileAccepted, "onFriendFileAccepted",
+               "("_W("Carrier;")_J("String;")_J("String;")_J("String;")"J)V") &&
+        METHOD(callbacks, onFriendFilePaused, "onFriendFilePaused",
+               "("_W("Carrier;")_J("String;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendFileResumed, "onFriendFileResumed",
+               "("_W("Carrier;")_J("String;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendFileCanceled, "onFriendFileCanceled",
+               "("_W("Carrier;")_J("String;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendFileCompleted, "onFriendFileCompleted",
+               "("_W("Carrier;")_J("String;")_J("String;)V")) &&
+        METHOD(callbacks, onFriendFileProgress, "onFriendFileProgress",
+               "("_W("Carrier;")_J("String;")_J("String;")_J("String;")"JJ)V") &&
+        METHOD(callbacks, onFriendFileQueried, "onFriendFileQueried",
+               "("_W("Carrier;")_J("String;")_J("String;")_J("String;)V")) &&
+
+        CLASS(binaryMessageHandler, "org/ioex/carrier/BinaryMessageHandler") &&
+
+        CLASS(friendsSnapshot, "org/ioex/carrier/FriendsSnapshot") &&
+        METHOD(friendsSnapshot, init, "<init>", "([B[I)V") &&
+
+        CLASS(fileTransfers, "org/ioex/carrier/FileTransfers") &&
+        METHOD(fileTransfers, init, "<init>", "(["_J("String;")"[J)V") &&
+
+        CLASS(callbackLatencyStats, "org/ioex/carrier/CallbackLatencyStats") &&
+        METHOD(callbackLatencyStats, init, "<init>", "(["_J("String;")"[J)V") &&
+
+        CLASS(inviteResponseHandler, "org/ioex/carrier/FriendInviteResponseHandler") &&
+        METHOD(inviteResponseHandler, onReceived, "onReceived",
+               "("_J("String;I")_J("String;")_J("String;)V")) &&
+
+        CLASS(userInfo, "org/ioex/carrier/UserInfo") &&
+        METHOD(userInfo, init, "<init>", USER_INFO_ARGS "Z)V") &&
+        METHOD(userInfo, hasAvatar, "hasAvatar", "()Z") &&
+        METHOD(userInfo, getUserId, "getUserId", "()"_J("String;")) &&
+        METHOD(userInfo, getName, "getName", "()"_J("String;")) &&
+        METHOD(userInfo, getDescription, "getDescription", "()"_J("String;")) &&
+        METHOD(userInfo, getGender, "getGender", "()"_J("String;")) &&
+        METHOD(userInfo, getPhone, "getPhone", "()"_J("String;")) &&
+        METHOD(userInfo, getEmail, "getEmail", "()"_J("String;")) &&
+        METHOD(userInfo, getRegion, "getRegion", "()"_J("String;")) &&
+
+        CLASS(friendInfo, "org/ioex/carrier/FriendInfo") &&
+        METHOD(friendInfo, init, "<init>", USER_INFO_ARGS "Z"_J("String;II)V")) &&
+
+        CLASS(presenceStatus, "org/ioex/carrier/PresenceStatus") &&
+        STATIC_METHOD(presenceStatus, valueOf, "valueOf", "(I)"_W("PresenceStatus;")) &&
+        METHOD(presenceStatus, value, "value", "()I") &&
+        ENUM_VALUES(presenceStatus, 0, PRESENCE_STATUS_COUNT) &&
+
+        CLASS(connectionStatus, "org/ioex/carrier/ConnectionStatus") &&
+        STATIC_METHOD(connectionStatus, valueOf, "valueOf", "(I)"_W("ConnectionStatus;")) &&
+        ENUM_VALUES(connectionStatus, 0, CONNECTION_STATUS_COUNT);
+}
+
+static
+int cacheSessionClasses(JNIEnv* env)
+{
+    return CLASS(managerHandler, "org/ioex/carrier/session/ManagerHandler") &&
+        METHOD(managerHandler, onSessionRequest, "onSessionRequest",
+               "("_W("Carrier;")_J("String;")_J("String;)V")) &&
+
+        CLASS(session, "org/ioex/carrier/session/Session") &&
+        METHOD(session, init, "<init>", "("_J("String;)V")) &&
+        FIELD(session, nativeCookie, "nativeCookie", "J") &&
+
+        CLASS(requestCompleteHandler, "org/ioex/carrier/session/SessionRequestCompleteHandler") &&
+        METHOD(requestCompleteHandler, onCompletion, "onCompletion",
+               "("_S("Session;I")_J("String;")_J("String;)V")) &&
+
+        CLASS(stream, "org/ioex/carrier/session/Stream") &&
+        METHOD(stream, init, "<init>", "("_S("StreamType;)V")) &&
+        FIELD(stream, nativeCookie, "nativeCookie", "J") &&
+        FIELD(stream, contextCookie, "contextCookie", "J") &&
+        FIELD(stream, streamId, "streamId", "I") &&
+
+        CLASS(streamHandler, "org/ioex/carrier/session/StreamHandler") &&
+        METHOD(streamHandler, onStateChanged, "onStateChanged",
+               "("_S("Stream;")_S("StreamState;)V")) &&
+        METHOD(streamHandler, onStreamData, "onStreamData", "("_S("Stream;[B)V")) &&
+        METHOD(streamHandler, onChannelOpen, "onChannelOpen",
+               "("_S("Stream;I")_J("String;)Z")) &&
+        METHOD(streamHandler, onChannelOpened, "onChannelOpened", "("_S("Stream;I)V")) &&
+        METHOD(streamHandler, onChannelClose, "onChannelClose",
+               "("_S("Stream;I")_S("CloseReason;)V")) &&
+        METHOD(streamHandler, onChannelData, "onChannelData", "("_S("Stream;I[B)Z")) &&
+        METHOD(streamHandler, onChannelPending, "onChannelPending", "("_S("Stream;I)V")) &&
+        METHOD(streamHandler, onChannelResume, "onChannelResume", "("_S("Stream;I)V")) &&
+
+        CLASS(pooledStreamHandler, "org/ioex/carrier/session/PooledStreamHandler") &&
+        METHOD(pooledStreamHandler, onStreamData, "onStreamData",
+               "("_S("Stream;")"Ljava/nio/ByteBuffer;I)V") &&
+        METHOD(pooledStreamHandler, onChannelData, "onChannelData",
+               "("_S("Stream;I")"Ljava/nio/ByteBuffer;I)Z") &&
+
+        CLASS(batchStreamHandler, "org/ioex/carrier/session/BatchStreamHandler") &&
+        METHOD(batchStreamHandler, onStreamDataBatch, "onStreamDataBatch",
+               "("_S("Stream;")"Ljava/nio/ByteBuffer;[II)V") &&
+
+        CLASS(writabilityStreamHandler, "org/ioex/carrier/session/WritabilityStreamHandler") &&
+        METHOD(writabilityStreamHandler, onChannelWritabilityChanged,
+               "onChannelWritabilityChanged", "("_S("Stream;IZ)V")) &&
+
+        CLASS(byteBuffer, "java/nio/ByteBuffer") &&
+        STATIC_METHOD(byteBuffer, wrap, "wrap", "([B)Ljava/nio/ByteBuffer;") &&
+
+        CLASS(streamType, "org/ioex/carrier/session/StreamType") &&
+        METHOD(streamType, value, "value", "()I") &&
+
+        CLASS(streamState, "org/ioex/carrier/session/StreamState") &&
+        STATIC_METHOD(streamState, valueOf, "valueOf", "(I)"_S("StreamState;")) &&
+        ENUM_VALUES(streamState, 1, STREAM_STATE_COUNT) &&
+
+        CLASS(closeReason, "org/ioex/carrier/session/CloseReason") &&
+        STATIC_METHOD(closeReason, valueOf, "valueOf", "(I)"_S("CloseReason;")) &&
+        ENUM_VALUES(closeReason, 0, CLOSE_REASON_COUNT) &&
+
+        CLASS(protocol, "org/ioex/carrier/session/PortForwardingProtocol") &&
+        METHOD(protocol, value, "value", "()I") &&
+
+        CLASS(transportInfo, "org/ioex/carrier/session/TransportInfo") &&
+        METHOD(transportInfo, init, "<init>",
+               "(I"_S("AddressInfo;")_S("AddressInfo;)V")) &&
+
+        CLASS(addressInfo, "org/ioex/carrier/session/AddressInfo") &&
+        METHOD(addressInfo, init, "<init>", "(I"_J("String;I")_J("String;I)V"));
+}
+
+int jniCacheInit(JNIEnv* env)
+{
+    memset(&gJni, 0, sizeof(gJni));
+    gClassCount = 0;
+    gObjectCount = 0;
+
+    if (!cacheCarrierClasses(env) || !cacheSessionClasses(env)) {
+        jniCacheCleanup(env);
+        return 0;
+    }
+    return 1;
+}
+
+void jniCacheCleanup(JNIEnv* env)
+{
+    int i;
+
+    for (i = 0; i < gClassCount; i++) {
+        if (*gClassSlots[i]) {
+            (*env)->DeleteGlobalRef(env, *gClassSlots[i]);
+            *gClassSlots[i] = NULL;
+        }
+    }
+    gClassCount = 0;
+
+    for (i = 0; i < gObjectCount; i++) {
+        if (*gObjectSlots[i]) {
+            (*env)->DeleteGlobalRef(env, *gObjectSlots[i]);
+            *gObjectSlots[i] = NULL;
+        }
+    }
+    gObjectCount = 0;
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __JNI_CACHE_H__
+#define __JNI_CACHE_H__
+
+#include <jni.h>
+
+/*
+ * Enum constants are resolved once by calling valueOf() for every native
+ * value and kept as global references indexed by that value, so turning a
+ * native enum into its java constant is an array lookup. Index 0 of
+ * streamState is unused, native stream states start at 1.
+ */
+#define PRESENCE_STATUS_COUNT       3
+#define CONNECTION_STATUS_COUNT     2
+#define STREAM_STATE_COUNT          8
+#define CLOSE_REASON_COUNT          3
+
+/*
+ * Registry of every java class, method and field the binding touches.
+ *
+ * All entries are resolved once in JNI_OnLoad, classes are pinned with
+ * global references, so that callbacks and natives never look anything
+ * up by name on the hot path.
+ */
+typedef struct JniCache {
+    struct {
+        jclass    clazz;
+        jfieldID  nativeCookie;
+        jfieldID  handler;
+    } carrier;
+
+    struct {
+        jclass    clazz;
+        jmethodID getUdpEnabled;
+        jmethodID getPersistentLocation;
+        jmethodID getBootstrapNodes;
+        jmethodID getDispatchQueueCapacity;
+        jmethodID getDispatchThreads;
+        jmethodID getOverflowPolicy;
+        jmethodID getBinaryMessages;
+        jmethodID getProgressMinInterval;
+        jmethodID getProgressMinPercent;
+        jmethodID getProgressMinBytes;
+    } options;
+
+    struct {
+        jclass    clazz;
+        jmethodID value;
+    } overflowPolicy;
+
+    struct {
+        jclass    clazz;
+        jmethodID getIpv4;
+        jmethodID getIpv6;
+        jmethodID getPort;
+        jmethodID getPublicKey;
+    } bootstrapNode;
+
+    struct {
+        jclass    clazz;
+        jmethodID size;
+        jmethodID get;
+    } list;
+
+    struct {
+        jclass    clazz;
+    } string;
+
+    struct {
+        jclass    clazz;
+        jmethodID onIdle;
+        jmethodID onConnection;
+        jmethodID onReady;
+        jmethodID onSelfInfoChanged;
+        jmethodID onFriends;
+        jmethodID onFriendConnection;
+        jmethodID onFriendInfoChanged;
+        jmethodID onFriendPresence;
+        jmethodID onFriendRequest;
+        jmethodID onFriendAdded;
+        jmethodID onFriendRemoved;
+        jmethodID onFriendMessage;
+        jmethodID onFriendBinaryMessage;
+        jmethodID onFriendInviteRequest;
+        jmethodID onFriendFileRequest;
+        jmethodID onFriendFileAccepted;
+        jmethodID onFriendFilePaused;
+        jmethodID onFriendFileResumed;
+        jmethodID onFriendFileCanceled;
+        jmethodID onFriendFileCompleted;
+        jmethodID onFriendFileProgress;
+        jmethodID onFriendFileQueried;
+    } callbacks;
+
+    struct {
+        jclass    clazz;
+    } binaryMessageHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+    } friendsSnapshot;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+    } fileTransfers;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+    } callbackLatencyStats;
+
+    struct {
+        jclass    clazz;
+        jmethodID onReceived;
+    } inviteResponseHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+        jmethodID hasAvatar;
+        jmethodID getUserId;
+        jmethodID getName;
+        jmethodID getDescription;
+        jmethodID getGender;
+        jmethodID getPhone;
+        jmethodID getEmail;
+        jmethodID getRegion;
+    } userInfo;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+    } friendInfo;
+
+    struct {
+        jclass    clazz;
+        jmethodID valueOf;
+        jmethodID value;
+        jobject   values[PRESENCE_STATUS_COUNT];
+    } presenceStatus;
+
+    struct {
+        jclass    clazz;
+        jmethodID valueOf;
+        jobject   values[CONNECTION_STATUS_COUNT];
+    } connectionStatus;
+
+    struct {
+        jclass    clazz;
+        jmethodID onSessionRequest;
+    } managerHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+        jfieldID  nativeCookie;
+    } session;
+
+    struct {
+        jclass    clazz;
+        jmethodID onCompletion;
+    } requestCompleteHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+        jfieldID  nativeCookie;
+        jfieldID  contextCookie;
+        jfieldID  streamId;
+    } stream;
+
+    struct {
+        jclass    clazz;
+        jmethodID onStateChanged;
+        jmethodID onStreamData;
+        jmethodID onChannelOpen;
+        jmethodID onChannelOpened;
+        jmethodID onChannelClose;
+        jmethodID onChannelData;
+        jmethodID onChannelPending;
+        jmethodID onChannelResume;
+    } streamHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID onStreamData;
+        jmethodID onChannelData;
+    } pooledStreamHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID onStreamDataBatch;
+    } batchStreamHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID onChannelWritabilityChanged;
+    } writabilityStreamHandler;
+
+    struct {
+        jclass    clazz;
+        jmethodID wrap;
+    } byteBuffer;
+
+    struct {
+        jclass    clazz;
+        jmethodID value;
+    } streamType;
+
+    struct {
+        jclass    clazz;
+        jmethodID valueOf;
+        jobject   values[STREAM_STATE_COUNT];
+    } streamState;
+
+    struct {
+        jclass    clazz;
+        jmethodID valueOf;
+        jobject   values[CLOSE_REASON_COUNT];
+    } closeReason;
+
+    struct {
+        jclass    clazz;
+        jmethodID value;
+    } protocol;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+    } transportInfo;
+
+    struct {
+        jclass    clazz;
+        jmethodID init;
+    } addressInfo;
+} JniCache;
+
+extern JniCache gJni;
+
+/*
+ * Look up a cached enum constant. The returned reference is global and
+ * owned by the cache: callers must not delete it. NULL if out of range.
+ */
+#define ENUM_CONSTANT(entry, index) \
+    (((unsigned)(index) < sizeof(gJni.entry.values) / sizeof(gJni.entry.values[0])) ? \
+     gJni.entry.values[(unsigned)(index)] : NULL)
+
+int jniCacheInit(JNIEnv* env);
+
+void jniCacheCleanup(JNIEnv* env);
+
+#endif //__JNI_CACHE_H__
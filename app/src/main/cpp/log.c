@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#endif
+
+#include "log.h"
+
+#define RING_SLOTS      256
+#define LINE_LEN        512
+
+typedef struct LogLine {
+    int level;
+    char text[LINE_LEN];
+} LogLine;
+
+typedef struct LogRing {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    LogLine* lines;
+    unsigned head;
+    unsigned tail;
+    int running;
+    uint64_t dropped;
+} LogRing;
+
+int gLogLevel = LOG_LEVEL_INFO;
+
+static LogRing gRing = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+static int gAsync;
+
+static
+void output(int level, const char* text)
+{
+#if defined(__ANDROID__)
+    static const int priorities[] = {
+        ANDROID_LOG_SILENT, ANDROID_LOG_FATAL, ANDROID_LOG_ERROR, ANDROID_LOG_WARN,
+        ANDROID_LOG_INFO, ANDROID_LOG_DEBUG, ANDROID_LOG_VERBOSE, ANDROID_LOG_VERBOSE
+    };
+
+    __android_log_write(priorities[level], LOG_TAG, text);
+#else
+    static const char letters[] = "-FEWIDVV";
+
+    fprintf(stderr, "%c/" LOG_TAG ": %s\n", letters[level], text);
+#endif
+}
+
+static
+void* writerRoutine(void* arg)
+{
+    LogRing* ring = (LogRing*)arg;
+    LogLine line;
+    uint64_t dropped;
+
+    pthread_mutex_lock(&ring->lock);
+    for (;;) {
+        while (ring->head == ring->tail && ring->running)
+            pthread_cond_wait(&ring->cond, &ring->lock);
+
+        if (ring->head == ring->tail)
+            break;
+
+        line = ring->lines[ring->head % RING_SLOTS];
+        ring->head++;
+        dropped = ring->dropped;
+        ring->dropped = 0;
+        pthread_mutex_unlock(&ring->lock);
+
+        if (dropped) {
+            char text[64];
+            snprintf(text, sizeof(text), "%llu log lines dropped", (unsigned long long)dropped);
+            output(LOG_LEVEL_WARNING, text);
+        }
+        output(line.level, line.text);
+
+        pthread_mutex_lock(&ring->lock);
+    }
+    pthread_mutex_unlock(&ring->lock);
+
+    return NULL;
+}
+
+/* Returns 0 if the writer thread is gone and the line was not taken. */
+static
+int enqueue(LogRing* ring, int level, const char* text)
+{
+    LogLine* line;
+
+    pthread_mutex_lock(&ring->lock);
+    if (!ring->running) {
+        pthread_mutex_unlock(&ring->lock);
+        return 0;
+    }
+
+    if (ring->tail - ring->head >= RING_SLOTS) {
+        ring->dropped++;
+        pthread_mutex_unlock(&ring->lock);
+        return 1;
+    }
+
+    line = &ring->lines[ring->tail % RING_SLOTS];
+    line->level = level;
+    strcpy(line->text, text);
+    ring->tail++;
+    pthread_cond_signal(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+    return 1;
+}
+
+void logWrite(int level, const char* fmt, ...)
+{
+    char text[LINE_LEN];
+    va_list args;
+
+    if (level < LOG_LEVEL_FATAL || level > LOG_LEVEL_VERBOSE)
+        return;
+
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    if (level != LOG_LEVEL_FATAL && __atomic_load_n(&gAsync, __ATOMIC_ACQUIRE) &&
+        enqueue(&gRing, level, text))
+        return;
+
+    output(level, text);
+}
+
+void logSetLevel(int level)
+{
+    if (level < LOG_LEVEL_NONE)
+        level = LOG_LEVEL_NONE;
+    if (level > LOG_LEVEL_VERBOSE)
+        level = LOG_LEVEL_VERBOSE;
+
+    __atomic_store_n(&gLogLevel, level, __ATOMIC_RELAXED);
+}
+
+int logStartAsync(void)
+{
+    LogRing* ring = &gRing;
+    int rc;
+
+    pthread_mutex_lock(&ring->lock);
+    if (ring->running) {
+        pthread_mutex_unlock(&ring->lock);
+        return 1;
+    }
+
+    ring->lines = (LogLine*)malloc(sizeof(LogLine) * RING_SLOTS);
+    if (!ring->lines) {
+        pthread_mutex_unlock(&ring->lock);
+        return 0;
+    }
+
+    ring->head = ring->tail = 0;
+    ring->dropped = 0;
+    ring->running = 1;
+
+    rc = pthread_create(&ring->thread, NULL, writerRoutine, ring);
+    if (rc != 0) {
+        ring->running = 0;
+        free(ring->lines);
+        ring->lines = NULL;
+        pthread_mutex_unlock(&ring->lock);
+        return 0;
+    }
+
+    __atomic_store_n(&gAsync, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&ring->lock);
+    return 1;
+}
+
+void logStopAsync(void)
+{
+    LogRing* ring = &gRing;
+
+    pthread_mutex_lock(&ring->lock);
+    if (!ring->running) {
+        pthread_mutex_unlock(&ring->lock);
+        return;
+    }
+
+    __atomic_store_n(&gAsync, 0, __ATOMIC_RELEASE);
+    ring->running = 0;
+    pthread_cond_signal(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+
+    pthread_join(ring->thread, NULL);
+
+    pthread_mutex_lock(&ring->lock);
+    free(ring->lines);
+    ring->lines = NULL;
+    pthread_mutex_unlock(&ring->lock);
+}
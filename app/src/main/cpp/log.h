@@ -1,74 +1,113 @@
-/*
- * Copyright (c) 2018 Elastos Foundation
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in all
- * copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
- * SOFTWARE.
- */
-
-/*
-* Copyright (c) 2019 ioeXNetwork
-*
-* Permission is hereby granted, free of charge, to any person obtaining a copy
-* of this software and associated documentation files (the "Software"), to deal
-* in the Software without restriction, including without limitation the rights
-* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-* copies of the Software, and to permit persons to whom the Software is
-* furnished to do so, subject to the following conditions:
-*
-* The above copyright notice and this permission notice shall be included in all
-* copies or substantial portions of the Software.
-*
-* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
-* SOFTWARE.
-*/
-
-#ifndef __JNI_LOG_H__
-#define __JNI_LOG_H__
-
-#include <jni.h>
-#include <android/log.h>
-
-#ifndef LOG_TAG
-#define LOG_TAG  "CarrierJni"
-#endif
-
-#define logV(fmt, ...) \
-    __android_log_print(ANDROID_LOG_VERBOSE, LOG_TAG, fmt, ## __VA_ARGS__)
-
-#define logD(fmt, ...) \
-    __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, fmt, ## __VA_ARGS__)
-
-#define logI(fmt, ...) \
-    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, fmt, ## __VA_ARGS__)
-
-#define logW(fmt, ...) \
-    __android_log_print(ANDROID_LOG_WARN, LOG_TAG, fmt, ## __VA_ARGS__)
-
-#define logE(fmt, ...) \
-    __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, fmt, ## __VA_ARGS__)
-
-#define logF(fmt, ...) \
-    __android_log_print(ANDROID_LOG_FATAL, LOG_TAG, fmt, ## __VA_ARGS__)
-
-#endif // __JNI_LOG_H__
-
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __JNI_LOG_H__
+#define __JNI_LOG_H__
+
+#include <jni.h>
+
+#ifndef LOG_TAG
+#define LOG_TAG  "CarrierJni"
+#endif
+
+/* Log levels, numbered like IOEXLogLevel */
+#define LOG_LEVEL_NONE          0
+#define LOG_LEVEL_FATAL         1
+#define LOG_LEVEL_ERROR         2
+#define LOG_LEVEL_WARNING       3
+#define LOG_LEVEL_INFO          4
+#define LOG_LEVEL_DEBUG         5
+#define LOG_LEVEL_VERBOSE       7
+
+/*
+ * The least severe level compiled in. Calls below it are removed by the
+ * compiler together with their arguments. Host builds (the benchmark
+ * harness) and release builds stop at info so that debug output does not
+ * distort measurements.
+ */
+#ifndef LOG_MIN_LEVEL
+#if defined(__ANDROID__) && !defined(NDEBUG)
+#define LOG_MIN_LEVEL           LOG_LEVEL_VERBOSE
+#else
+#define LOG_MIN_LEVEL           LOG_LEVEL_INFO
+#endif
+#endif
+
+/* The least severe level written at runtime, see logSetLevel(). */
+extern int gLogLevel;
+
+static inline
+int logEnabled(int level)
+{
+    return level <= __atomic_load_n(&gLogLevel, __ATOMIC_RELAXED);
+}
+
+void logWrite(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void logSetLevel(int level);
+
+/*
+ * Hand formatted lines to a writer thread through a ring buffer instead of
+ * writing them on the calling thread. Lines are dropped, and counted, when
+ * the ring is full. Fatal lines are always written synchronously.
+ */
+int logStartAsync(void);
+
+/* Stop the writer thread after it has written every queued line. */
+void logStopAsync(void);
+
+#define logAt(level, fmt, ...) \
+    do { \
+        if ((level) <= LOG_MIN_LEVEL && logEnabled(level)) \
+            logWrite(level, fmt, ## __VA_ARGS__); \
+    } while (0)
+
+#define logV(fmt, ...)  logAt(LOG_LEVEL_VERBOSE, fmt, ## __VA_ARGS__)
+#define logD(fmt, ...)  logAt(LOG_LEVEL_DEBUG, fmt, ## __VA_ARGS__)
+#define logI(fmt, ...)  logAt(LOG_LEVEL_INFO, fmt, ## __VA_ARGS__)
+#define logW(fmt, ...)  logAt(LOG_LEVEL_WARNING, fmt, ## __VA_ARGS__)
+#define logE(fmt, ...)  logAt(LOG_LEVEL_ERROR, fmt, ## __VA_ARGS__)
+#define logF(fmt, ...)  logAt(LOG_LEVEL_FATAL, fmt, ## __VA_ARGS__)
+
+#endif // __JNI_LOG_H__
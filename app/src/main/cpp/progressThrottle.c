@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "progressThrottle.h"
+
+#define MIN_CAPACITY    16
+
+static
+int64_t nowNanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static
+uint32_t hashId(const char* id)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*id) {
+        hash ^= (uint8_t)*id++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Slot tracking fileid, or the empty slot where it would go. */
+static
+int findSlot(const ProgressThrottle* pt, const char* fileid)
+{
+    int mask = pt->capacity - 1;
+    int i = (int)(hashId(fileid) & (uint32_t)mask);
+
+    while (pt->trackers[i].used && strcmp(pt->trackers[i].fileid, fileid))
+        i = (i + 1) & mask;
+    return i;
+}
+
+static
+int grow(ProgressThrottle* pt)
+{
+    ProgressTracker* old = pt->trackers;
+    int oldCapacity = pt->capacity;
+    int capacity = oldCapacity ? oldCapacity * 2 : MIN_CAPACITY;
+    int i;
+
+    pt->trackers = (ProgressTracker*)calloc((size_t)capacity, sizeof(ProgressTracker));
+    if (!pt->trackers) {
+        pt->trackers = old;
+        return 0;
+    }
+    pt->capacity = capacity;
+
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i].used)
+            pt->trackers[findSlot(pt, old[i].fileid)] = old[i];
+    }
+
+    free(old);
+    return 1;
+}
+
+static
+int enabled(const ProgressThrottle* pt)
+{
+    return pt->minIntervalNs > 0 || pt->minPercent > 0 || pt->minBytes > 0;
+}
+
+void progressThrottleInit(ProgressThrottle* pt, int minIntervalMs, int minPercent,
+                          uint64_t minBytes)
+{
+    memset(pt, 0, sizeof(*pt));
+    pt->minIntervalNs = minIntervalMs > 0 ? (int64_t)minIntervalMs * 1000000 : 0;
+    pt->minPercent = minPercent > 0 ? minPercent : 0;
+    pt->minBytes = minBytes;
+}
+
+void progressThrottleCleanup(ProgressThrottle* pt)
+{
+    free(pt->trackers);
+    pt->trackers = NULL;
+    pt->capacity = 0;
+    pt->count = 0;
+}
+
+static
+int deliver(ProgressThrottle* pt)
+{
+    __atomic_add_fetch(&pt->delivered, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+int progressThrottleCheck(ProgressThrottle* pt, const char* fileid,
+                          uint64_t size, uint64_t transferred)
+{
+    ProgressTracker* tracker;
+    int64_t now;
+    int i;
+
+    if (!enabled(pt))
+        return deliver(pt);
+
+    if (size > 0 && transferred >= size) {
+        progressThrottleForget(pt, fileid);
+        return deliver(pt);
+    }
+
+    now = nowNanos();
+
+    if ((pt->count + 1) * 4 > pt->capacity * 3 && !grow(pt)) {
+        logE("Grow file progress trackers error");
+        return deliver(pt);
+    }
+
+    i = findSlot(pt, fileid);
+    tracker = &pt->trackers[i];
+    if (!tracker->used) {
+        strncpy(tracker->fileid, fileid, sizeof(tracker->fileid) - 1);
+        tracker->used = 1;
+        tracker->lastNs = now;
+        tracker->lastTransferred = transferred;
+        pt->count++;
+        return deliver(pt);
+    }
+
+    if (transferred < tracker->lastTransferred)
+        tracker->lastTransferred = transferred;   // the transfer was sought back
+
+    if ((pt->minIntervalNs > 0 && now - tracker->lastNs < pt->minIntervalNs) ||
+        (pt->minBytes > 0 && transferred - tracker->lastTransferred < pt->minBytes) ||
+        (pt->minPercent > 0 && size > 0 &&
+         (transferred - tracker->lastTransferred) * 100 / size < (uint64_t)pt->minPercent)) {
+        __atomic_add_fetch(&pt->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    tracker->lastNs = now;
+    tracker->lastTransferred = transferred;
+    return deliver(pt);
+}
+
+void progressThrottleForget(ProgressThrottle* pt, const char* fileid)
+{
+    int mask, i, j;
+
+    if (!pt->count)
+        return;
+
+    i = findSlot(pt, fileid);
+    if (!pt->trackers[i].used)
+        return;
+
+    // Backward shift deletion keeps the probe sequences intact.
+    mask = pt->capacity - 1;
+    for (j = (i + 1) & mask; pt->trackers[j].used; j = (j + 1) & mask) {
+        int home = (int)(hashId(pt->trackers[j].fileid) & (uint32_t)mask);
+
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            pt->trackers[i] = pt->trackers[j];
+            i = j;
+        }
+    }
+    memset(&pt->trackers[i], 0, sizeof(pt->trackers[i]));
+    pt->count--;
+}
+
+void progressThrottleGetStats(ProgressThrottle* pt, int64_t* delivered, int64_t* suppressed)
+{
+    *delivered = __atomic_load_n(&pt->delivered, __ATOMIC_RELAXED);
+    *suppressed = __atomic_load_n(&pt->suppressed, __ATOMIC_RELAXED);
+}
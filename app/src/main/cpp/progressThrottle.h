@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __PROGRESS_THROTTLE_H__
+#define __PROGRESS_THROTTLE_H__
+
+#include <stdint.h>
+#include <IOEX_carrier.h>
+
+/*
+ * Rate limits file_progress callbacks per file transfer before they reach
+ * java. A progress event is delivered once every configured minimum, the
+ * time since, the percentage step and the byte delta from the last
+ * delivered event of that file, has been reached. The first and the final
+ * event of a transfer are always delivered.
+ *
+ * Trackers are hashed by file id with open addressing. Only the carrier
+ * thread touches the table; the counters may be read from any thread.
+ */
+typedef struct ProgressTracker {
+    char fileid[IOEX_MAX_FILE_ID_LEN + 1];
+    int used;
+    int64_t lastNs;
+    uint64_t lastTransferred;
+} ProgressTracker;
+
+typedef struct ProgressThrottle {
+    int64_t minIntervalNs;
+    int minPercent;
+    uint64_t minBytes;
+
+    ProgressTracker* trackers;
+    int capacity;
+    int count;
+
+    int64_t delivered;
+    int64_t suppressed;
+} ProgressThrottle;
+
+void progressThrottleInit(ProgressThrottle* pt, int minIntervalMs, int minPercent,
+                          uint64_t minBytes);
+
+void progressThrottleCleanup(ProgressThrottle* pt);
+
+/* Returns 1 if the progress event should be delivered, 0 to drop it. */
+int progressThrottleCheck(ProgressThrottle* pt, const char* fileid,
+                          uint64_t size, uint64_t transferred);
+
+/* Stop tracking a transfer that completed or was canceled. */
+void progressThrottleForget(ProgressThrottle* pt, const char* fileid);
+
+void progressThrottleGetStats(ProgressThrottle* pt, int64_t* delivered, int64_t* suppressed);
+
+#endif //__PROGRESS_THROTTLE_H__
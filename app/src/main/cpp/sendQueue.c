@@ -0,0 +1,1174 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "utils.h"
+#include "jniCache.h"
+#include "upcallStats.h"
+#include "streamContext.h"
+#include "tokenBucket.h"
+#include "sendQueue.h"
+
+typedef struct SendFrame {
+    struct SendFrame* next;
+    int64_t queued;
+    size_t len;
+    size_t sent;
+    uint8_t data[];
+} SendFrame;
+
+typedef struct ChannelQueue {
+    int channel;
+    int pended;
+    int unwritable;
+
+    /* Writability last reported to java */
+    int reported;
+
+    int priority;
+    int weight;
+    size_t deficit;
+
+    /* Rate limit, and whether it held the channel back in this drain */
+    TokenBucket bucket;
+    int throttled;
+    int64_t throttledSince;
+    uint64_t throttledTime;
+
+    size_t bytes;
+    SendFrame* head;
+    SendFrame* tail;
+
+    /* Frames sent, and how long the queued ones waited */
+    uint64_t frames;
+    uint64_t delayedFrames;
+    uint64_t totalDelay;
+    uint64_t maxDelay;
+} ChannelQueue;
+
+struct SendQueue {
+    /*
+     * Both locks are recursive: the transport may call back into the
+     * binding from a write, and a handler may write from its callback.
+     */
+    pthread_mutex_t lock;
+    pthread_mutex_t notifyLock;
+
+    CallbackContext* cc;
+    IOEXSession* session;
+    int streamId;
+    int notify;
+
+    size_t capacity;
+    size_t low;
+    size_t high;
+
+    ChannelQueue* channels;
+    int count;
+    int size;
+
+    /* Round robin position, and whether it was already credited this round */
+    int cursor;
+    int credited;
+
+    /* Rate limit of the stream as a whole */
+    TokenBucket bucket;
+
+    /* Held back while its stream is being removed: writes queue, nothing is sent */
+    int frozen;
+
+    /* Detached from its stream: nothing is sent or reported any more */
+    int closed;
+
+    /* Pacer wake up, guarded by the pacer lock */
+    int waiting;
+    int64_t wakeAt;
+    struct SendQueue* pacerNext;
+};
+
+/*
+ * The pacer drains queues held back by rate limits once they may send
+ * again: one thread for the process, sleeping until the earliest of them.
+ * Its lock also guards the process wide bucket all streams share. A queue
+ * lock may be held while taking the pacer lock, never the other way round.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int started;
+    int stopped;
+
+    SendQueue* waiting;
+    SendQueue* running;
+
+    TokenBucket bucket;
+} gPacer = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static
+int64_t nowNanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static
+void initRecursiveMutex(pthread_mutex_t* mutex)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void pacerSchedule(SendQueue* queue, int64_t when);
+
+static
+ChannelQueue* findChannel(SendQueue* queue, int channel)
+{
+    int i;
+
+    for (i = 0; i < queue->count; i++) {
+        if (queue->channels[i].channel == channel)
+            return &queue->channels[i];
+    }
+    return NULL;
+}
+
+static
+ChannelQueue* addChannel(SendQueue* queue, int channel)
+{
+    ChannelQueue* cq;
+
+    cq = findChannel(queue, channel);
+    if (cq)
+        return cq;
+
+    if (queue->count == queue->size) {
+        int size = queue->size ? queue->size * 2 : 4;
+
+        cq = (ChannelQueue*)realloc(queue->channels, sizeof(*cq) * (size_t)size);
+        if (!cq)
+            return NULL;
+        queue->channels = cq;
+        queue->size = size;
+    }
+
+    cq = &queue->channels[queue->count++];
+    memset(cq, 0, sizeof(*cq));
+    cq->channel = channel;
+    cq->reported = 1;
+    cq->weight = 1;
+    return cq;
+}
+
+static
+void dropFrames(ChannelQueue* cq)
+{
+    SendFrame* frame;
+
+    while (cq->head) {
+        frame = cq->head;
+        cq->head = frame->next;
+        free(frame);
+    }
+    cq->tail = NULL;
+    cq->bytes = 0;
+}
+
+static inline
+int sendable(const ChannelQueue* cq)
+{
+    return cq->head && !cq->pended && !cq->throttled;
+}
+
+/* The highest priority class with data to send, or -1 if there is none. */
+static
+int topPriority(SendQueue* queue)
+{
+    int priority = -1;
+    int i;
+
+    for (i = 0; i < queue->count; i++) {
+        if (sendable(&queue->channels[i]) && queue->channels[i].priority > priority)
+            priority = queue->channels[i].priority;
+    }
+    return priority;
+}
+
+static
+void frameSent(ChannelQueue* cq, int64_t queued)
+{
+    uint64_t delay;
+
+    cq->frames++;
+    if (!queued)
+        return;
+
+    delay = (uint64_t)(nowNanos() - queued);
+    cq->delayedFrames++;
+    cq->totalDelay += delay;
+    if (delay > cq->maxDelay)
+        cq->maxDelay = delay;
+}
+
+static inline
+int globalLimited(void)
+{
+    return __atomic_load_n(&gPacer.bucket.rate, __ATOMIC_RELAXED) > 0;
+}
+
+static inline
+int pacedLocked(SendQueue* queue, ChannelQueue* cq)
+{
+    return tokenBucketLimited(&cq->bucket) || tokenBucketLimited(&queue->bucket) ||
+           globalLimited();
+}
+
+/*
+ * Check a bucket for a send of want bytes: lower *allowed to the tokens it
+ * holds, or return the nanoseconds until it holds enough of them.
+ */
+static
+int64_t bucketAllowance(TokenBucket* tb, int64_t now, size_t want, size_t* allowed)
+{
+    int64_t tokens;
+    int64_t need;
+
+    if (!tokenBucketLimited(tb))
+        return 0;
+
+    need = (int64_t)want < tb->burst ? (int64_t)want : tb->burst;
+    tokens = tokenBucketRefill(tb, now);
+    if (tokens < need)
+        return tokenBucketDelay(tb, need);
+
+    if ((uint64_t)tokens < *allowed)
+        *allowed = (size_t)tokens;
+    return 0;
+}
+
+/*
+ * The bytes out of left that cq may send now under the rate limits of the
+ * channel, the stream and the process. Returns 0 if it has to wait, and
+ * moves *wake up to when it may send again. It waits for a quantum, or the
+ * whole rest if smaller, so paced data does not trickle out in slivers.
+ */
+static
+size_t allowanceLocked(SendQueue* queue, ChannelQueue* cq, size_t left, int64_t now,
+                       int64_t* wake)
+{
+    size_t want = left < SEND_QUEUE_QUANTUM ? left : SEND_QUEUE_QUANTUM;
+    size_t allowed = left;
+    int64_t delay;
+    int64_t wait;
+
+    delay = bucketAllowance(&cq->bucket, now, want, &allowed);
+
+    wait = bucketAllowance(&queue->bucket, now, want, &allowed);
+    if (wait > delay)
+        delay = wait;
+
+    if (globalLimited()) {
+        pthread_mutex_lock(&gPacer.lock);
+        wait = bucketAllowance(&gPacer.bucket, now, want, &allowed);
+        pthread_mutex_unlock(&gPacer.lock);
+        if (wait > delay)
+            delay = wait;
+    }
+
+    if (delay > 0) {
+        if (now + delay < *wake)
+            *wake = now + delay;
+        return 0;
+    }
+    return allowed;
+}
+
+static
+void takeTokensLocked(SendQueue* queue, ChannelQueue* cq, size_t bytes)
+{
+    if (tokenBucketLimited(&cq->bucket))
+        tokenBucketTake(&cq->bucket, bytes);
+    if (tokenBucketLimited(&queue->bucket))
+        tokenBucketTake(&queue->bucket, bytes);
+
+    if (globalLimited()) {
+        pthread_mutex_lock(&gPacer.lock);
+        if (tokenBucketLimited(&gPacer.bucket))
+            tokenBucketTake(&gPacer.bucket, bytes);
+        pthread_mutex_unlock(&gPacer.lock);
+    }
+}
+
+static
+void throttleLocked(ChannelQueue* cq, int64_t now)
+{
+    cq->throttled = 1;
+    if (!cq->throttledSince)
+        cq->throttledSince = now;
+}
+
+static
+void unthrottleLocked(ChannelQueue* cq, int64_t now)
+{
+    if (cq->throttledSince) {
+        cq->throttledTime += (uint64_t)(now - cq->throttledSince);
+        cq->throttledSince = 0;
+    }
+}
+
+/* Channel 0 is the stream itself. */
+static inline
+ssize_t transportWrite(SendQueue* queue, int channel, const void* data, size_t len)
+{
+    if (channel > 0)
+        return IOEX_stream_write_channel(queue->session, queue->streamId, channel, data, len);
+    else
+        return IOEX_stream_write(queue->session, queue->streamId, data, len);
+}
+
+/*
+ * Send up to limit bytes of the head frame of cq. Returns the bytes sent,
+ * or -1 if the transport would block.
+ */
+static
+ssize_t sendHead(SendQueue* queue, ChannelQueue* cq, size_t limit)
+{
+    SendFrame* frame = cq->head;
+    size_t left = frame->len - frame->sent;
+    ssize_t bytes;
+    int err;
+
+    if (left > limit)
+        left = limit;
+
+    bytes = transportWrite(queue, cq->channel, frame->data + frame->sent, left);
+    if (bytes < 0) {
+        err = IOEX_get_error();
+        if (sendWouldBlock(err))
+            return -1;
+
+        // Nobody waits for this frame any more, so the error only counts.
+        logE("Call IOEX_stream_write%s API error: 0x%x", cq->channel > 0 ? "_channel" : "",
+             err);
+        streamStatsWritten(queue->cc, left, bytes);
+        bytes = (ssize_t)left;
+    } else {
+        streamStatsWritten(queue->cc, left, bytes);
+    }
+
+    frame->sent += (size_t)bytes;
+    cq->bytes -= (size_t)bytes;
+    if (frame->sent == frame->len) {
+        cq->head = frame->next;
+        if (!cq->head)
+            cq->tail = NULL;
+        frameSent(cq, frame->queued);
+        free(frame);
+    }
+
+    if (cq->unwritable && cq->bytes <= queue->low)
+        cq->unwritable = 0;
+
+    return bytes;
+}
+
+/*
+ * Send queued frames of all channels until the transport pushes back.
+ * Higher priority classes go first; channels of one class share the
+ * transport by deficit round robin, each getting weight quanta per round.
+ * A channel out of tokens sits out this drain, and the pacer is asked to
+ * drain again once the earliest of them may send. Returns 1 unless the
+ * transport pushed back. Called with queue->lock held.
+ */
+static
+int drainLocked(SendQueue* queue)
+{
+    ChannelQueue* cq;
+    int64_t now = nowNanos();
+    int64_t wake = INT64_MAX;
+    size_t quantum;
+    size_t left;
+    size_t limit;
+    ssize_t bytes;
+    int priority;
+    int paced;
+    int index;
+    int full = 0;
+    int i;
+
+    if (queue->closed || queue->frozen)
+        return 0;
+
+    for (i = 0; i < queue->count; i++)
+        queue->channels[i].throttled = 0;
+
+    while (!full && (priority = topPriority(queue)) >= 0) {
+        for (i = 0; i < queue->count && !full; i++) {
+            index = (queue->cursor + i) % queue->count;
+            cq = &queue->channels[index];
+            if (!sendable(cq) || cq->priority != priority)
+                continue;
+
+            quantum = SEND_QUEUE_QUANTUM * (size_t)cq->weight;
+            if (!(i == 0 && queue->credited))
+                cq->deficit += quantum;
+
+            paced = pacedLocked(queue, cq);
+            while (sendable(cq) && (left = cq->head->len - cq->head->sent) <= cq->deficit) {
+                limit = left;
+                if (paced) {
+                    limit = allowanceLocked(queue, cq, left, now, &wake);
+                    if (!limit) {
+                        // Credit saved up while throttled must not turn into a burst.
+                        throttleLocked(cq, now);
+                        if (cq->deficit > quantum)
+                            cq->deficit = left > quantum ? left : quantum;
+                        break;
+                    }
+                }
+
+                bytes = sendHead(queue, cq, limit);
+                if (bytes >= 0)
+                    cq->deficit -= (size_t)bytes;
+                if (bytes > 0) {
+                    if (paced)
+                        takeTokensLocked(queue, cq, (size_t)bytes);
+                    unthrottleLocked(cq, now);
+                }
+
+                if (bytes < 0 || (size_t)bytes < limit) {
+                    // Transport is full: resume with this channel, already credited.
+                    queue->cursor = index;
+                    queue->credited = 1;
+                    full = 1;
+                    break;
+                }
+            }
+
+            if (!cq->head)
+                cq->deficit = 0;
+        }
+
+        if (!full)
+            queue->credited = 0;
+    }
+
+    if (wake != INT64_MAX)
+        pacerSchedule(queue, wake);
+
+    return !full;
+}
+
+static
+int appendLocked(SendQueue* queue, ChannelQueue* cq, const uint8_t* data, size_t len)
+{
+    SendFrame* frame;
+
+    frame = (SendFrame*)malloc(sizeof(*frame) + len);
+    if (!frame)
+        return 0;
+
+    frame->next = NULL;
+    frame->queued = nowNanos();
+    frame->len = len;
+    frame->sent = 0;
+    memcpy(frame->data, data, len);
+
+    if (cq->tail)
+        cq->tail->next = frame;
+    else
+        cq->head = frame;
+    cq->tail = frame;
+    cq->bytes += len;
+
+    if (!cq->unwritable && cq->bytes >= queue->high)
+        cq->unwritable = 1;
+
+    streamStatsAdd(queue->cc, STREAM_STAT_QUEUED_WRITES, 1);
+    return 1;
+}
+
+static inline
+int needsReport(const ChannelQueue* cq)
+{
+    return cq->reported != !cq->unwritable;
+}
+
+/*
+ * Report writability changes to java. The notify lock keeps reports of
+ * racing threads in order; the loop is bounded in case a handler keeps
+ * flipping channels from its callback.
+ */
+static
+void notifyWritability(SendQueue* queue, JNIEnv* env)
+{
+    int rounds;
+    int channel = 0;
+    int writable = 1;
+    int found;
+    int i;
+
+    if (!queue->notify)
+        return;
+
+    pthread_mutex_lock(&queue->notifyLock);
+
+    for (rounds = 0; rounds < 64; rounds++) {
+        found = 0;
+
+        pthread_mutex_lock(&queue->lock);
+        for (i = 0; i < queue->count && !queue->closed; i++) {
+            if (needsReport(&queue->channels[i])) {
+                channel = queue->channels[i].channel;
+                writable = !queue->channels[i].unwritable;
+                queue->channels[i].reported = writable;
+                found = 1;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        if (!found)
+            break;
+
+        if (!callVoidUpcall(env, UPCALL_CHANNEL_WRITABILITY, queue->cc->handler,
+                            gJni.writabilityStreamHandler.onChannelWritabilityChanged,
+                            queue->cc->object, channel, writable ? JNI_TRUE : JNI_FALSE)) {
+            logE("Call java callback 'void onChannelWritabilityChanged(Stream, int, boolean)' error");
+        }
+    }
+
+    pthread_mutex_unlock(&queue->notifyLock);
+}
+
+static
+int anyReportLocked(SendQueue* queue)
+{
+    int i;
+
+    for (i = 0; i < queue->count; i++) {
+        if (needsReport(&queue->channels[i]))
+            return 1;
+    }
+    return 0;
+}
+
+static
+void freeQueue(SendQueue* queue)
+{
+    free(queue->channels);
+    pthread_mutex_destroy(&queue->notifyLock);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+}
+
+/* Drain a queue whose rate limits let it send again. */
+static
+void pacerKick(SendQueue* queue, JNIEnv* env)
+{
+    int report;
+
+    pthread_mutex_lock(&queue->lock);
+    drainLocked(queue);
+    report = anyReportLocked(queue);
+    pthread_mutex_unlock(&queue->lock);
+
+    if (report)
+        notifyWritability(queue, env);
+}
+
+static
+void* pacerRoutine(void* arg)
+{
+    SendQueue* queue;
+    SendQueue** link;
+    struct timespec deadline;
+    int64_t now;
+    int64_t next;
+    int needDetach = 0;
+    JNIEnv* env;
+
+    (void)arg;
+
+    env = attachJvm(&needDetach);
+    if (!env) {
+        logE("Attach send pacer thread to JVM error");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&gPacer.lock);
+    while (!gPacer.stopped) {
+        now = nowNanos();
+        next = INT64_MAX;
+        queue = NULL;
+
+        for (link = &gPacer.waiting; *link; link = &(*link)->pacerNext) {
+            if ((*link)->wakeAt <= now) {
+                queue = *link;
+                *link = queue->pacerNext;
+                queue->waiting = 0;
+                break;
+            }
+            if ((*link)->wakeAt < next)
+                next = (*link)->wakeAt;
+        }
+
+        if (queue) {
+            gPacer.running = queue;
+            pthread_mutex_unlock(&gPacer.lock);
+
+            pacerKick(queue, env);
+
+            pthread_mutex_lock(&gPacer.lock);
+            gPacer.running = NULL;
+            pthread_cond_broadcast(&gPacer.cond);
+            continue;
+        }
+
+        if (next == INT64_MAX) {
+            pthread_cond_wait(&gPacer.cond, &gPacer.lock);
+            continue;
+        }
+
+        deadline.tv_sec = (time_t)(next / 1000000000LL);
+        deadline.tv_nsec = (long)(next % 1000000000LL);
+        pthread_cond_timedwait(&gPacer.cond, &gPacer.lock, &deadline);
+    }
+    pthread_mutex_unlock(&gPacer.lock);
+
+    detachJvm(env, needDetach);
+    return NULL;
+}
+
+/* Called with gPacer.lock held. */
+static
+int startPacerLocked(void)
+{
+    pthread_condattr_t attr;
+
+    if (gPacer.started)
+        return 1;
+    if (gPacer.stopped)
+        return 0;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gPacer.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&gPacer.thread, NULL, pacerRoutine, NULL) != 0) {
+        logE("Create send pacer thread error");
+        pthread_cond_destroy(&gPacer.cond);
+        return 0;
+    }
+
+    gPacer.started = 1;
+    return 1;
+}
+
+/* Have the pacer drain queue at when, unless it is due earlier already. */
+static
+void pacerSchedule(SendQueue* queue, int64_t when)
+{
+    pthread_mutex_lock(&gPacer.lock);
+
+    if (startPacerLocked()) {
+        if (!queue->waiting) {
+            queue->waiting = 1;
+            queue->wakeAt = when;
+            queue->pacerNext = gPacer.waiting;
+            gPacer.waiting = queue;
+            pthread_cond_broadcast(&gPacer.cond);
+        } else if (when < queue->wakeAt) {
+            queue->wakeAt = when;
+            pthread_cond_broadcast(&gPacer.cond);
+        }
+    }
+
+    pthread_mutex_unlock(&gPacer.lock);
+}
+
+/*
+ * Take queue off the pacer, waiting out a drain of it in progress, which
+ * may schedule it again. A drain that is the caller itself, stopping the
+ * queue from a writability callback, is not waited for: it sees the queue
+ * frozen or closed once the callback returns.
+ */
+static
+void pacerCancel(SendQueue* queue)
+{
+    SendQueue** link;
+
+    pthread_mutex_lock(&gPacer.lock);
+
+    for (;;) {
+        for (link = &gPacer.waiting; *link; link = &(*link)->pacerNext) {
+            if (*link == queue) {
+                *link = queue->pacerNext;
+                break;
+            }
+        }
+        queue->waiting = 0;
+
+        if (gPacer.running != queue || pthread_equal(pthread_self(), gPacer.thread))
+            break;
+
+        pthread_cond_wait(&gPacer.cond, &gPacer.lock);
+    }
+
+    pthread_mutex_unlock(&gPacer.lock);
+}
+
+SendQueue* sendQueueCreate(JNIEnv* env, CallbackContext* cc, IOEXSession* session,
+                           int streamId, size_t capacity, size_t lowWatermark,
+                           size_t highWatermark)
+{
+    SendQueue* queue;
+
+    assert(cc);
+    assert(capacity > 0);
+    assert(lowWatermark <= highWatermark && highWatermark <= capacity);
+
+    queue = (SendQueue*)calloc(1, sizeof(*queue));
+    if (!queue)
+        return NULL;
+
+    initRecursiveMutex(&queue->lock);
+    initRecursiveMutex(&queue->notifyLock);
+
+    queue->cc = cc;
+    queue->session = session;
+    queue->streamId = streamId;
+    queue->notify = (*env)->IsInstanceOf(env, cc->handler,
+                                         gJni.writabilityStreamHandler.clazz);
+    queue->capacity = capacity;
+    queue->low = lowWatermark;
+    queue->high = highWatermark;
+
+    return queue;
+}
+
+void sendQueueFreeze(SendQueue* queue)
+{
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+    queue->frozen = 1;
+    pthread_mutex_unlock(&queue->lock);
+
+    pacerCancel(queue);
+}
+
+void sendQueueThaw(SendQueue* queue)
+{
+    int i;
+
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+    queue->frozen = 0;
+    for (i = 0; i < queue->count; i++) {
+        if (queue->channels[i].head) {
+            pacerSchedule(queue, nowNanos());
+            break;
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void sendQueueDetach(SendQueue* queue)
+{
+    int i;
+
+    if (!queue)
+        return;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return;
+    }
+    queue->closed = 1;
+    for (i = 0; i < queue->count; i++)
+        dropFrames(&queue->channels[i]);
+    pthread_mutex_unlock(&queue->lock);
+
+    pacerCancel(queue);
+
+    // A report of another thread checked closed before it; wait for it to
+    // return, so none uses the stream or handler after this.
+    if (queue->notify) {
+        pthread_mutex_lock(&queue->notifyLock);
+        pthread_mutex_unlock(&queue->notifyLock);
+    }
+}
+
+void sendQueueDestroy(SendQueue* queue)
+{
+    if (!queue)
+        return;
+
+    // A drain that detached the queue from its own callback may still be
+    // unwinding on the pacer thread.
+    sendQueueDetach(queue);
+    pacerCancel(queue);
+    freeQueue(queue);
+}
+
+ssize_t sendQueueWrite(SendQueue* queue, JNIEnv* env, int channel, const void* data,
+                       size_t len)
+{
+    ChannelQueue* cq;
+    ssize_t bytes = 0;
+    int64_t wake = INT64_MAX;
+    size_t limit;
+    int paced;
+    int report;
+    int err;
+
+    assert(queue);
+    assert(channel >= 0);
+    assert(data && len > 0);
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return -1;
+    }
+
+    cq = addChannel(queue, channel);
+    if (!cq) {
+        pthread_mutex_unlock(&queue->lock);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        return -1;
+    }
+
+    // Whatever is queued goes out before this write; if anything is left,
+    // the transport is full or the channel is out of tokens, and the write
+    // has to wait its turn.
+    paced = pacedLocked(queue, cq);
+    if (drainLocked(queue) && !cq->pended && !cq->head) {
+        limit = paced ? allowanceLocked(queue, cq, len, nowNanos(), &wake) : len;
+        if (limit > 0)
+            bytes = transportWrite(queue, channel, data, limit);
+
+        if (bytes < 0) {
+            err = IOEX_get_error();
+            if (!sendWouldBlock(err)) {
+                streamStatsWritten(queue->cc, limit, bytes);
+                pthread_mutex_unlock(&queue->lock);
+                logE("Call IOEX_stream_write%s API error", channel > 0 ? "_channel" : "");
+                setErrorCode(err);
+                return -1;
+            }
+            bytes = 0;
+        } else if (limit > 0) {
+            streamStatsWritten(queue->cc, limit, bytes);
+            if (bytes > 0 && paced)
+                takeTokensLocked(queue, cq, (size_t)bytes);
+            if ((size_t)bytes == len)
+                frameSent(cq, 0);
+        }
+    }
+
+    if ((size_t)bytes < len) {
+        if (cq->bytes + (len - (size_t)bytes) > queue->capacity) {
+            if (bytes == 0) {
+                pthread_mutex_unlock(&queue->lock);
+                setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LIMIT_EXCEEDED));
+                return -1;
+            }
+        } else if (appendLocked(queue, cq, (const uint8_t*)data + bytes, len - (size_t)bytes)) {
+            bytes = (ssize_t)len;
+            // Pace out the rest: this sends what tokens are left and sets the timer.
+            if (paced)
+                drainLocked(queue);
+        } else if (bytes == 0) {
+            pthread_mutex_unlock(&queue->lock);
+            setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+            return -1;
+        }
+    }
+
+    report = anyReportLocked(queue);
+    pthread_mutex_unlock(&queue->lock);
+
+    if (report)
+        notifyWritability(queue, env);
+
+    return bytes;
+}
+
+void sendQueuePend(SendQueue* queue, int channel)
+{
+    ChannelQueue* cq;
+
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+    cq = queue->closed ? NULL : addChannel(queue, channel);
+    if (cq)
+        cq->pended = 1;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void sendQueueResume(SendQueue* queue, JNIEnv* env, int channel)
+{
+    ChannelQueue* cq;
+    int report;
+
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return;
+    }
+    cq = findChannel(queue, channel);
+    if (cq)
+        cq->pended = 0;
+    drainLocked(queue);
+    report = anyReportLocked(queue);
+    pthread_mutex_unlock(&queue->lock);
+
+    if (report)
+        notifyWritability(queue, env);
+}
+
+void sendQueueClose(SendQueue* queue, int channel)
+{
+    ChannelQueue* cq;
+
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+    cq = findChannel(queue, channel);
+    if (cq) {
+        dropFrames(cq);
+        *cq = queue->channels[--queue->count];
+        queue->cursor = 0;
+        queue->credited = 0;
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+int sendQueueSchedule(SendQueue* queue, int channel, int priority, int weight)
+{
+    ChannelQueue* cq;
+
+    assert(queue);
+    assert(priority >= 0 && priority < SEND_QUEUE_PRIORITIES);
+    assert(weight > 0 && weight <= SEND_QUEUE_MAX_WEIGHT);
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return 0;
+    }
+    cq = addChannel(queue, channel);
+    if (cq) {
+        cq->priority = priority;
+        cq->weight = weight;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    if (!cq)
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+    return cq != NULL;
+}
+
+int sendQueueRateLimit(SendQueue* queue, int channel, int64_t rate, int64_t burst)
+{
+    ChannelQueue* cq;
+    int64_t now = nowNanos();
+    int i;
+
+    assert(queue);
+    assert(rate >= 0 && (rate == 0 || burst > 0));
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return 0;
+    }
+
+    if (channel == SEND_QUEUE_WHOLE_STREAM) {
+        tokenBucketSet(&queue->bucket, rate, burst, now);
+    } else {
+        cq = addChannel(queue, channel);
+        if (!cq) {
+            pthread_mutex_unlock(&queue->lock);
+            setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+            return 0;
+        }
+        tokenBucketSet(&cq->bucket, rate, burst, now);
+    }
+
+    // Let what waits under the old limits go out under the new ones.
+    for (i = 0; i < queue->count; i++) {
+        if (queue->channels[i].head) {
+            pacerSchedule(queue, now);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return 1;
+}
+
+void sendQueueGlobalRateLimit(int64_t rate, int64_t burst)
+{
+    SendQueue* queue;
+    TokenBucket bucket;
+    int64_t now = nowNanos();
+
+    assert(rate >= 0 && (rate == 0 || burst > 0));
+
+    tokenBucketSet(&bucket, rate, burst, now);
+
+    pthread_mutex_lock(&gPacer.lock);
+
+    gPacer.bucket.burst = bucket.burst;
+    gPacer.bucket.tokens = bucket.tokens;
+    gPacer.bucket.last = bucket.last;
+    __atomic_store_n(&gPacer.bucket.rate, bucket.rate, __ATOMIC_RELAXED);
+
+    for (queue = gPacer.waiting; queue; queue = queue->pacerNext)
+        queue->wakeAt = now;
+    if (gPacer.started)
+        pthread_cond_broadcast(&gPacer.cond);
+
+    pthread_mutex_unlock(&gPacer.lock);
+}
+
+void sendQueueShutdown(void)
+{
+    int started;
+
+    pthread_mutex_lock(&gPacer.lock);
+    gPacer.stopped = 1;
+    started = gPacer.started;
+    if (started)
+        pthread_cond_broadcast(&gPacer.cond);
+    pthread_mutex_unlock(&gPacer.lock);
+
+    if (started) {
+        pthread_join(gPacer.thread, NULL);
+        pthread_cond_destroy(&gPacer.cond);
+        gPacer.started = 0;
+    }
+}
+
+void sendQueueStats(SendQueue* queue, int channel, uint64_t stats[SEND_QUEUE_STAT_COUNT])
+{
+    ChannelQueue* cq;
+
+    assert(queue);
+
+    memset(stats, 0, sizeof(uint64_t) * SEND_QUEUE_STAT_COUNT);
+
+    pthread_mutex_lock(&queue->lock);
+    cq = findChannel(queue, channel);
+    if (cq) {
+        stats[SEND_QUEUE_STAT_QUEUED_BYTES] = cq->bytes;
+        stats[SEND_QUEUE_STAT_FRAMES] = cq->frames;
+        stats[SEND_QUEUE_STAT_DELAYED_FRAMES] = cq->delayedFrames;
+        stats[SEND_QUEUE_STAT_TOTAL_DELAY] = cq->totalDelay;
+        stats[SEND_QUEUE_STAT_MAX_DELAY] = cq->maxDelay;
+        stats[SEND_QUEUE_STAT_THROTTLED_TIME] = cq->throttledTime;
+        if (cq->throttledSince)
+            stats[SEND_QUEUE_STAT_THROTTLED_TIME] += (uint64_t)(nowNanos() - cq->throttledSince);
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+size_t sendQueueBytes(SendQueue* queue, int channel)
+{
+    ChannelQueue* cq;
+    size_t bytes;
+
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+    cq = findChannel(queue, channel);
+    bytes = cq ? cq->bytes : 0;
+    pthread_mutex_unlock(&queue->lock);
+
+    return bytes;
+}
+
+int sendQueueWritable(SendQueue* queue, int channel)
+{
+    ChannelQueue* cq;
+    int writable = 1;
+
+    assert(queue);
+
+    pthread_mutex_lock(&queue->lock);
+    cq = findChannel(queue, channel);
+    writable = cq ? !cq->unwritable : 1;
+    pthread_mutex_unlock(&queue->lock);
+
+    return writable;
+}
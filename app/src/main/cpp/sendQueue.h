@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __SEND_QUEUE_H__
+#define __SEND_QUEUE_H__
+
+#include <jni.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <IOEX_carrier.h>
+#include <IOEX_session.h>
+
+struct CallbackContext;
+
+/*
+ * Per-channel send queues of a stream with a byte budget each, channel 0
+ * being the stream itself. A write that the transport would block on, or
+ * that arrives while the peer has the channel pended or earlier data is
+ * still queued, is kept here and drained when the channel resumes. Crossing the high watermark
+ * makes a channel unwritable; draining down to the low watermark makes it
+ * writable again, and both are reported through
+ * WritabilityStreamHandler.onChannelWritabilityChanged() if the stream
+ * handler implements it.
+ *
+ * Queued frames of all channels share the transport by priority class
+ * first, higher classes going out before lower ones, and by deficit round
+ * robin within a class, where a channel gets weight quanta per round.
+ *
+ * Sends may further be paced by token buckets of the channel, the stream
+ * and the process, all of which a send must fit. What they hold back stays
+ * queued and a pacer thread drains it once the tokens refill, so writers
+ * never sleep on a limit.
+ */
+typedef struct SendQueue SendQueue;
+
+#define SEND_QUEUE_PRIORITIES   8
+#define SEND_QUEUE_MAX_WEIGHT   64
+
+/* Bytes a channel of weight 1 may send per round */
+#define SEND_QUEUE_QUANTUM      1024
+
+/* Channel argument of sendQueueRateLimit() for the stream as a whole */
+#define SEND_QUEUE_WHOLE_STREAM (-1)
+
+/* Per channel statistics, in the order Stream.getChannelQueueStats() reads them */
+enum {
+    SEND_QUEUE_STAT_QUEUED_BYTES = 0,
+    SEND_QUEUE_STAT_FRAMES,
+    SEND_QUEUE_STAT_DELAYED_FRAMES,
+    SEND_QUEUE_STAT_TOTAL_DELAY,
+    SEND_QUEUE_STAT_MAX_DELAY,
+    SEND_QUEUE_STAT_THROTTLED_TIME,
+    SEND_QUEUE_STAT_COUNT
+};
+
+/* Whether a failed write only means the transport can not take data now. */
+static inline
+int sendWouldBlock(int err)
+{
+    return err == IOEX_GENERAL_ERROR(IOEXERR_BUSY) ||
+           err == IOEX_SYS_ERROR(EAGAIN) ||
+           err == IOEX_SYS_ERROR(EWOULDBLOCK);
+}
+
+SendQueue* sendQueueCreate(JNIEnv* env, struct CallbackContext* cc, IOEXSession* session,
+                           int streamId, size_t capacity, size_t lowWatermark,
+                           size_t highWatermark);
+
+/*
+ * Hold back everything queued, pacer drains included, while the stream is
+ * being removed. Writes still queue, so a removal that fails loses nothing.
+ */
+void sendQueueFreeze(SendQueue* queue);
+
+/* Send again what a frozen queue held back. */
+void sendQueueThaw(SendQueue* queue);
+
+/*
+ * Drop every queued frame and stop the queue for good, once its stream is
+ * removed or its session closed: later writes fail with WRONG_STATE and no
+ * drain or writability report reaches the stream any more. The memory
+ * stays valid for threads that still hold the queue.
+ */
+void sendQueueDetach(SendQueue* queue);
+
+/*
+ * Detach the queue if needed and free it, once nothing can reach it.
+ */
+void sendQueueDestroy(SendQueue* queue);
+
+/*
+ * Send or queue len bytes to channel. Returns len once the data is sent or
+ * queued, fewer bytes if the transport took part of them and the rest does
+ * not fit into the budget, or -1 with the error code set.
+ */
+ssize_t sendQueueWrite(SendQueue* queue, JNIEnv* env, int channel, const void* data,
+                       size_t len);
+
+/* The peer asked to pend the channel: hold its writes until it resumes. */
+void sendQueuePend(SendQueue* queue, int channel);
+
+/* The peer resumed the channel: send what is queued, in schedule order. */
+void sendQueueResume(SendQueue* queue, JNIEnv* env, int channel);
+
+/* The channel is closed: drop what is queued for it, and its settings. */
+void sendQueueClose(SendQueue* queue, int channel);
+
+/*
+ * Set the priority class and round robin weight of channel. Returns 0 with
+ * the error code set on failure.
+ */
+int sendQueueSchedule(SendQueue* queue, int channel, int priority, int weight);
+
+/*
+ * Limit channel, or the stream if SEND_QUEUE_WHOLE_STREAM, to rate bytes
+ * per second with bursts of up to burst bytes. A rate of 0 lifts the limit.
+ * Returns 0 with the error code set on failure.
+ */
+int sendQueueRateLimit(SendQueue* queue, int channel, int64_t rate, int64_t burst);
+
+/* The same for the sends of all streams of the process together. */
+void sendQueueGlobalRateLimit(int64_t rate, int64_t burst);
+
+/* Stop the pacer thread, when the library is unloaded. */
+void sendQueueShutdown(void);
+
+/*
+ * Frames sent, the time the queued ones waited and the time the channel
+ * was held back by rate limits, in nanoseconds.
+ */
+void sendQueueStats(SendQueue* queue, int channel, uint64_t stats[SEND_QUEUE_STAT_COUNT]);
+
+/* Bytes queued for channel and not yet taken by the transport. */
+size_t sendQueueBytes(SendQueue* queue, int channel);
+
+int sendQueueWritable(SendQueue* queue, int channel);
+
+#endif //__SEND_QUEUE_H__
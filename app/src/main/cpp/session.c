@@ -55,13 +55,9 @@
 #include "utilsExt.h"
 #include "sessionUtils.h"
 #include "sessionCookie.h"
-
-typedef struct CallbackContext {
-    JNIEnv* env;
-    jclass  clazz;
-    jobject object;
-    jobject handler;
-} CallbackContext;
+#include "jniCache.h"
+#include "upcallStats.h"
+#include "streamContext.h"
 
 static
 void sessionClose(JNIEnv* env, jobject thiz)
@@ -72,30 +68,22 @@ void sessionClose(JNIEnv* env, jobject thiz)
 static
 bool callbackCtxtSet(CallbackContext* cc, JNIEnv* env, jobject jobjekt, jobject jhandler) {
 
-    jclass  lclazz   = NULL;
-    jclass  gclazz   = NULL;
     jobject gobject  = NULL;
     jobject ghandler = NULL;
 
-    lclazz = (*env)->GetObjectClass(env, jhandler);
-    if (!lclazz) {
-        return false;
-    }
-    gclazz   = (*env)->NewGlobalRef(env, lclazz);
     gobject  = (*env)->NewGlobalRef(env, jobjekt);
     ghandler = (*env)->NewGlobalRef(env, jhandler);
-    if (!gclazz || !gobject || !ghandler) {
+    if (!gobject || !ghandler) {
         goto errorExit;
     }
 
     cc->env     = NULL;
-    cc->clazz   = gclazz;
     cc->object  = gobject;
     cc->handler = ghandler;
+    pthread_mutex_init(&cc->lock, NULL);
     return true;
 
 errorExit:
-    if (gclazz)  (*env)->DeleteGlobalRef(env, gclazz);
     if (gobject) (*env)->DeleteGlobalRef(env, gobject);
     if (ghandler)(*env)->DeleteGlobalRef(env, ghandler);
 
@@ -107,12 +95,58 @@ void callbackCtxtCleanup(CallbackContext* cc, JNIEnv* env)
 {
     assert(cc);
 
-    if (cc->clazz)
-        (*env)->DeleteGlobalRef(env, cc->clazz);
+    // The pacer drains the send queue through the stream and its handler.
+    sendQueueDestroy(takeSendQueue(cc));
+
+    // the batch delivers its pending packets through object and handler.
+    if (cc->batch)
+        streamBatchDestroy(cc->batch, env);
+
     if (cc->object)
         (*env)->DeleteGlobalRef(env, cc->object);
     if (cc->handler)
         (*env)->DeleteGlobalRef(env, cc->handler);
+    if (cc->pool)
+        bufferPoolDestroy(cc->pool, env);
+
+    pthread_mutex_destroy(&cc->lock);
+}
+
+void streamContextClose(CallbackContext* cc, JNIEnv* env)
+{
+    StreamBatch* batch;
+
+    assert(cc);
+
+    pthread_mutex_lock(&cc->lock);
+    if (cc->closed) {
+        pthread_mutex_unlock(&cc->lock);
+        return;
+    }
+    cc->closed = 1;
+    batch = __atomic_exchange_n(&cc->batch, NULL, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&cc->lock);
+
+    // Both still deliver through object and handler until they stop. The
+    // queue itself is freed with the context, java may still write to it.
+    sendQueueDetach(getSendQueue(cc));
+    if (batch)
+        streamBatchDestroy(batch, env);
+
+    // The receive pool stays: java may still hand its buffers back.
+    (*env)->DeleteGlobalRef(env, cc->object);
+    (*env)->DeleteGlobalRef(env, cc->handler);
+    cc->object = NULL;
+    cc->handler = NULL;
+}
+
+void streamContextFree(CallbackContext* cc, JNIEnv* env)
+{
+    assert(cc);
+
+    streamContextClose(cc, env);
+    callbackCtxtCleanup(cc, env);
+    free(cc);
 }
 
 static
@@ -148,8 +182,8 @@ void onSessionRequestCompleteCb(IOEXSession* session, int status, const char* re
         return;
     }
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onCompletion",
-                        "("_S("Session;I")_J("String;")_J("String;)V"),
+    if (!callVoidUpcall(env, UPCALL_SESSION_REQUEST_COMPLETE, cc->handler,
+                        gJni.requestCompleteHandler.onCompletion,
                         cc->object, status, jreason, jsdp)) {
         logE("Call java callback 'void onCompletion(Session, String, String' error");
     }
@@ -249,11 +283,96 @@ jboolean sessionStart(JNIEnv* env, jobject thiz, jstring jsdp)
     return JNI_TRUE;
 }
 
+/*
+ * Wrap inbound data into a ByteBuffer from the stream's receive pool. When the
+ * pool is exhausted a heap buffer is handed out instead, *local is set and the
+ * caller owns the returned local reference.
+ */
+static
+jobject newReceiveBuffer(JNIEnv* env, BufferPool* pool, const void* data, size_t len,
+                         int* local)
+{
+    jbyteArray jdata;
+    jobject jbuffer = NULL;
+
+    jbuffer = bufferPoolAcquire(pool, data, len);
+    if (jbuffer) {
+        *local = 0;
+        return jbuffer;
+    }
+
+    jdata = (*env)->NewByteArray(env, (jsize)len);
+    if (!jdata)
+        return NULL;
+    (*env)->SetByteArrayRegion(env, jdata, 0, (jsize)len, data);
+
+    if (!callStaticObjectMethod(env, gJni.byteBuffer.clazz, gJni.byteBuffer.wrap,
+                                &jbuffer, jdata))
+        jbuffer = NULL;
+    (*env)->DeleteLocalRef(env, jdata);
+
+    *local = 1;
+    return jbuffer;
+}
+
+static
+void onPooledStreamData(JNIEnv* env, CallbackContext* cc, BufferPool* pool,
+                        const void* data, size_t len)
+{
+    jobject jbuffer;
+    int local = 0;
+
+    jbuffer = newReceiveBuffer(env, pool, data, len, &local);
+    if (!jbuffer) {
+        logE("New receive buffer for stream data error");
+        return;
+    }
+
+    if (!callVoidUpcall(env, UPCALL_STREAM_DATA, cc->handler,
+                        gJni.pooledStreamHandler.onStreamData,
+                        cc->object, jbuffer, (jint)len)) {
+        logE("Invoke java callback 'void onStreamData(Stream, ByteBuffer, int)' error");
+        streamStatsAdd(cc, STREAM_STAT_CALLBACK_ERRORS, 1);
+    }
+
+    if (local)
+        (*env)->DeleteLocalRef(env, jbuffer);
+}
+
+static
+bool onPooledChannelData(JNIEnv* env, CallbackContext* cc, BufferPool* pool, int channel,
+                         const void* data, size_t len)
+{
+    jobject jbuffer;
+    jboolean jresult = JNI_FALSE;
+    int local = 0;
+
+    jbuffer = newReceiveBuffer(env, pool, data, len, &local);
+    if (!jbuffer) {
+        logE("New receive buffer for channel data error");
+        return false;
+    }
+
+    if (!callBooleanUpcall(env, UPCALL_CHANNEL_DATA, cc->handler,
+                           gJni.pooledStreamHandler.onChannelData,
+                           &jresult, cc->object, channel, jbuffer, (jint)len)) {
+        logE("Call java callback 'boolean onChannelData(Stream, int, ByteBuffer, int)' error");
+        streamStatsAdd(cc, STREAM_STAT_CALLBACK_ERRORS, 1);
+    }
+
+    if (local)
+        (*env)->DeleteLocalRef(env, jbuffer);
+
+    return (bool)jresult;
+}
+
 static
 void onStreamDataCallback(IOEXSession* ws, int stream,
                          const void* data, size_t len, void* context)
 {
     CallbackContext* cc = (CallbackContext*)context;
+    StreamBatch* batch;
+    BufferPool* pool;
     int needDetach = 0;
     JNIEnv *env;
     jbyteArray jdata;
@@ -262,12 +381,27 @@ void onStreamDataCallback(IOEXSession* ws, int stream,
     assert(stream > 0);
     assert(data);
 
+    streamStatsReceived(cc, len);
+
     env = attachJvm(&needDetach);
     if (!env) {
         logE("Attach current thread to JVM error");
         return ;
     }
 
+    batch = getStreamBatch(cc);
+    if (batch && streamBatchAppend(batch, env, data, len)) {
+        detachJvm(env, needDetach);
+        return;
+    }
+
+    pool = getReceivePool(cc);
+    if (pool) {
+        onPooledStreamData(env, cc, pool, data, len);
+        detachJvm(env, needDetach);
+        return;
+    }
+
     jdata = (*env)->NewByteArray(env, (jsize)len);
     if (!jdata) {
         detachJvm(env, needDetach);
@@ -275,10 +409,11 @@ void onStreamDataCallback(IOEXSession* ws, int stream,
     }
     (*env)->SetByteArrayRegion(env, jdata, 0, (jsize)len, data);
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onStreamData",
-                        "("_S("Stream;[B)V"),
+    if (!callVoidUpcall(env, UPCALL_STREAM_DATA, cc->handler,
+                        gJni.streamHandler.onStreamData,
                         cc->object, jdata)) {
         logE("Invoke java callback 'void onData(Stream, byte[])' error");
+        streamStatsAdd(cc, STREAM_STAT_CALLBACK_ERRORS, 1);
     }
 
     (*env)->DeleteLocalRef(env, jdata);
@@ -308,14 +443,13 @@ void onStateChangedCallback(IOEXSession* ws, int stream, IOEXStreamState state,
         return;
     }
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onStateChanged",
-                        "("_S("Stream;")_S("StreamState;)V"),
+    if (!callVoidUpcall(env, UPCALL_STREAM_STATE, cc->handler,
+                        gJni.streamHandler.onStateChanged,
                         cc->object, jstate)) {
 
         logE("Invoke java callback 'void onStateChanged(Stream, StreamState)' error");
     }
 
-    (*env)->DeleteLocalRef(env, jstate);
     detachJvm(env, needDetach);
 }
 
@@ -327,7 +461,7 @@ bool onChannelOpenCallback(IOEXSession *ws, int stream, int channel,
     int needDetach = 0;
     JNIEnv* env;
     jstring jcookie;
-    jboolean jresult;
+    jboolean jresult = JNI_FALSE;
 
     assert(ws);
     assert(stream > 0);
@@ -346,8 +480,8 @@ bool onChannelOpenCallback(IOEXSession *ws, int stream, int channel,
         return false;
     }
 
-    if (!callBooleanMethod(env, cc->clazz, cc->handler, "onChannelOpen",
-                           "("_S("Stream;I")_J("String;)Z"),
+    if (!callBooleanUpcall(env, UPCALL_CHANNEL_OPEN, cc->handler,
+                           gJni.streamHandler.onChannelOpen,
                            &jresult,
                            cc->object, channel, jcookie)) {
 
@@ -378,8 +512,8 @@ void onChannelOpenedCallback(IOEXSession* ws, int stream, int channel,
         return ;
     }
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onChannelOpened",
-                        "("_S("Stream;I)V"),
+    if (!callVoidUpcall(env, UPCALL_CHANNEL_OPENED, cc->handler,
+                        gJni.streamHandler.onChannelOpened,
                         cc->object, channel)) {
         logE("Invoke java callback 'void onChannelOpened(Stream, int)' error");
     }
@@ -392,6 +526,7 @@ void onChannelCloseCallback(IOEXSession* ws, int stream, int channel,
                             CloseReason reason, void* context)
 {
     CallbackContext* cc = (CallbackContext*)context;
+    SendQueue* queue;
     int needDetach = 0;
     JNIEnv* env;
     jobject jreason;
@@ -400,6 +535,10 @@ void onChannelCloseCallback(IOEXSession* ws, int stream, int channel,
     assert(stream > 0);
     assert(channel > 0);
 
+    queue = getSendQueue(cc);
+    if (queue)
+        sendQueueClose(queue, channel);
+
     env = attachJvm(&needDetach);
     if (!env) {
         logE("Attach current thread to JVM error");
@@ -411,14 +550,13 @@ void onChannelCloseCallback(IOEXSession* ws, int stream, int channel,
         return;
     }
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onChannelClose",
-                        "("_S("Stream;I")_S("CloseReason;)V"),
+    if (!callVoidUpcall(env, UPCALL_CHANNEL_CLOSE, cc->handler,
+                        gJni.streamHandler.onChannelClose,
                         cc->object, channel, jreason)) {
 
         logE("Call java callback 'void onChannelClose(Stream, int, CloseReason)' error");
     }
 
-    (*env)->DeleteLocalRef(env, jreason);
     detachJvm(env, needDetach);
 }
 
@@ -427,21 +565,31 @@ bool onChannelDataCallback(IOEXSession* ws, int stream, int channel,
                            const void* data, size_t len, void *context)
 {
     CallbackContext* cc = (CallbackContext*)context;
+    BufferPool* pool;
     int needDetach = 0;
     JNIEnv* env;
     jbyteArray jdata;
-    jboolean jresult;
+    jboolean jresult = JNI_FALSE;
 
     assert(ws);
     assert(stream > 0);
     assert(channel > 0);
 
+    streamStatsReceived(cc, len);
+
     env = attachJvm(&needDetach);
     if (!env) {
         logE("Attach current thread to JVM error");
         return false;
     }
 
+    pool = getReceivePool(cc);
+    if (pool) {
+        bool result = onPooledChannelData(env, cc, pool, channel, data, len);
+        detachJvm(env, needDetach);
+        return result;
+    }
+
     jdata = (*env)->NewByteArray(env, (jsize)len);
     if (!jdata) {
         detachJvm(env, needDetach);
@@ -449,11 +597,12 @@ bool onChannelDataCallback(IOEXSession* ws, int stream, int channel,
     }
     (*env)->SetByteArrayRegion(env, jdata, 0, (jsize)len, data);
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onChannelData",
-                        "("_S("Stream;I[B)Z"),
+    if (!callBooleanUpcall(env, UPCALL_CHANNEL_DATA, cc->handler,
+                           gJni.streamHandler.onChannelData,
                         &jresult, cc->object, channel, jdata)) {
 
         logE("Call java callback 'boolean onChannelData(Stream, int, byte[])' error");
+        streamStatsAdd(cc, STREAM_STAT_CALLBACK_ERRORS, 1);
     }
 
     (*env)->DeleteLocalRef(env, jdata);
@@ -467,6 +616,7 @@ void onChannelPendingCallback(IOEXSession* ws, int stream, int channel,
                               void* context)
 {
     CallbackContext* cc = (CallbackContext*)context;
+    SendQueue* queue;
     int needDetach = 0;
     JNIEnv* env;
 
@@ -474,16 +624,22 @@ void onChannelPendingCallback(IOEXSession* ws, int stream, int channel,
     assert(stream > 0);
     assert(channel > 0);
 
+    streamStatsAdd(cc, STREAM_STAT_PENDS, 1);
+
+    queue = getSendQueue(cc);
+    if (queue)
+        sendQueuePend(queue, channel);
+
     env = attachJvm(&needDetach);
     if (!env) {
         logE("Attach current thread to JVM error");
         return ;
     }
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onChannelPending",
-                        "("_S("Session;I)V"),
+    if (!callVoidUpcall(env, UPCALL_CHANNEL_PENDING, cc->handler,
+                        gJni.streamHandler.onChannelPending,
                         cc->object, channel)) {
-        logE("Call java callback 'void onChannelPending(Session, int) error");
+        logE("Call java callback 'void onChannelPending(Stream, int)' error");
     }
 
     detachJvm(env, needDetach);
@@ -494,6 +650,7 @@ void onChannelResumeCallback(IOEXSession* ws, int stream, int channel,
                              void* context)
 {
     CallbackContext* cc = (CallbackContext*)context;
+    SendQueue* queue;
     int needDetach = 0;
     JNIEnv* env;
 
@@ -501,16 +658,23 @@ void onChannelResumeCallback(IOEXSession* ws, int stream, int channel,
     assert(stream > 0);
     assert(channel > 0);
 
+    streamStatsAdd(cc, STREAM_STAT_RESUMES, 1);
+
     env = attachJvm(&needDetach);
     if (!env) {
         logE("Attach current thread to JVM error");
         return ;
     }
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onChannelResume",
-                        "("_S("Session;I)V"),
+    // Queued data goes out before the handler hears about the resume.
+    queue = getSendQueue(cc);
+    if (queue)
+        sendQueueResume(queue, env, channel);
+
+    if (!callVoidUpcall(env, UPCALL_CHANNEL_RESUME, cc->handler,
+                        gJni.streamHandler.onChannelResume,
                         cc->object, channel)) {
-        logE("Call java callback 'void onChannelResume(Session, int) error");
+        logE("Call java callback 'void onChannelResume(Stream, int)' error");
     }
 
     detachJvm(env, needDetach);
@@ -566,12 +730,13 @@ jobject addStream(JNIEnv* env, jobject thiz, jobject jtype, jint joptions,
     };
 
     session = getSession(env, thiz);
-    setLongField(env, jstream, "nativeCookie",(uint64_t)session);
-    setLongField(env, jstream, "contextCookie", (uint64_t)cc);
+    setLongField(env, jstream, gJni.stream.nativeCookie, (uint64_t)session);
+    setLongField(env, jstream, gJni.stream.contextCookie, (uint64_t)cc);
 
     streamId = IOEX_session_add_stream(session, type, joptions, &cbs, cc);
     if (streamId < 0) {
         logE("Call IOEX_session_add_stream API error");
+        setLongField(env, jstream, gJni.stream.contextCookie, 0);
         callbackCtxtCleanup(cc, env);
         free(cc);
         (*env)->DeleteLocalRef(env, jstream);
@@ -580,7 +745,7 @@ jobject addStream(JNIEnv* env, jobject thiz, jobject jtype, jint joptions,
     }
 
     // TODO: CHECKME!
-    setIntField(env, jstream, "streamId", streamId);
+    setIntField(env, jstream, gJni.stream.streamId, streamId);
 
     return jstream;
 }
@@ -589,20 +754,29 @@ static
 jboolean removeStream(JNIEnv* env, jobject thiz, jint streamId, jobject jstream)
 {
     CallbackContext* cc;
+    SendQueue* queue;
     int rc;
 
+    // Keep the pacer from writing to the stream while it is removed, but
+    // hold on to what is queued in case the removal fails.
+    cc = (CallbackContext*)getStreamCookie(env, jstream);
+    queue = cc ? getSendQueue(cc) : NULL;
+    if (queue)
+        sendQueueFreeze(queue);
+
     rc = IOEX_session_remove_stream(getSession(env, thiz), streamId);
     if (rc < 0) {
         logE("Call IOEX_session_remove_stream API error");
         setErrorCode(IOEX_get_error());
+        if (queue)
+            sendQueueThaw(queue);
         return JNI_FALSE;
     }
 
-    cc = (CallbackContext*)getStreamCookie(env, jstream);
-    if (cc) {
-        callbackCtxtCleanup(cc, env);
-        free(cc);
-    }
+    // Java threads may still be writing through the context; it is freed
+    // once the Stream is collected.
+    if (cc)
+        streamContextClose(cc, env);
 
     return JNI_TRUE;
 }
@@ -51,25 +51,33 @@
 #include <IOEX_session.h>
 #include "utils.h"
 #include "utilsExt.h"
+#include "jniCache.h"
 
 static inline
 IOEXSession* getSession(JNIEnv* env, jobject thiz)
 {
     uint64_t ctxt = 0;
-    return getLongField(env, thiz, "nativeCookie", &ctxt) ? (IOEXSession*)ctxt : NULL;
+    return getLongField(env, thiz, gJni.session.nativeCookie, &ctxt) ? (IOEXSession*)ctxt : NULL;
+}
+
+static inline
+IOEXSession* getStreamSession(JNIEnv* env, jobject thiz)
+{
+    uint64_t ctxt = 0;
+    return getLongField(env, thiz, gJni.stream.nativeCookie, &ctxt) ? (IOEXSession*)ctxt : NULL;
 }
 
 static inline
 void setSessionCookie(JNIEnv* env, jobject thiz, IOEXSession* session)
 {
-    setLongField(env, thiz, "nativeCookie", (uint64_t)session);
+    setLongField(env, thiz, gJni.session.nativeCookie, (uint64_t)session);
 }
 
 static inline
 void* getStreamCookie(JNIEnv* env, jobject thiz)
 {
     uint64_t ctxt = 0;
-    return getLongField(env, thiz, "contextCookie", &ctxt) ? (void*)ctxt : NULL;
+    return getLongField(env, thiz, gJni.stream.contextCookie, &ctxt) ? (void*)ctxt : NULL;
 }
 
 #endif //_SESSION_COOKIE_H__
\ No newline at end of file
@@ -53,21 +53,14 @@
 #include "utils.h"
 #include "carrierCookie.h"
 #include "sessionUtils.h"
-
-typedef struct CallbackContext {
-    JNIEnv* env;
-    jclass  clazz;
-    jobject carrier;
-    jobject handler;
-} CallbackContext;
-
-static CallbackContext callbackContext;
+#include "jniCache.h"
+#include "upcallStats.h"
 
 static
 void onSessionRequestCallback(IOEXCarrier* carrier, const char* from, const char* sdp,
                               size_t len, void* context)
 {
-    CallbackContext* cc = (CallbackContext*)context;
+    HandlerContext* hc = (HandlerContext*)context;
     int needDetach = 0;
     JNIEnv* env;
     jstring jfrom;
@@ -80,6 +73,11 @@ void onSessionRequestCallback(IOEXCarrier* carrier, const char* from, const char
     (void)carrier;
     (void)len;
 
+    if (!hc->sessionHandler) {
+        logW("Session request from %s dropped without session manager handler", from);
+        return;
+    }
+
     env = attachJvm(&needDetach);
     if (!env) {
         logE("Attach JVM error");
@@ -99,9 +97,9 @@ void onSessionRequestCallback(IOEXCarrier* carrier, const char* from, const char
         return;
     }
 
-    if (!callVoidMethod(env, cc->clazz, cc->handler, "onSessionRequest",
-                        "("_W("Carrier;")_J("String;")_J("String;)V"),
-                        cc->carrier, jfrom, jsdp)) {
+    if (!callVoidUpcall(env, UPCALL_SESSION_REQUEST, hc->sessionHandler,
+                        gJni.managerHandler.onSessionRequest,
+                        hc->carrier, jfrom, jsdp)) {
         logE("Can not call method:\n\tvoid onSessionRequest(Carrier, String, String)");
     }
 
@@ -111,82 +109,38 @@ void onSessionRequestCallback(IOEXCarrier* carrier, const char* from, const char
     detachJvm(env, needDetach);
 }
 
-static
-bool callbackCtxtSet(CallbackContext* hc, JNIEnv* env, jobject jcarrier, jobject jhandler)
-{
-
-    jclass lclazz;
-    jclass  gclazz;
-    jobject gjcarrier;
-    jobject gjhandler;
-
-    lclazz = (*env)->GetObjectClass(env, jhandler);
-    if (!lclazz) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
-        return false;
-    }
-
-    gclazz    = (*env)->NewGlobalRef(env, lclazz);
-    gjcarrier = (*env)->NewGlobalRef(env, jcarrier);
-    gjhandler = (*env)->NewGlobalRef(env, jhandler);
-
-    if (!gclazz || !gjcarrier || !gjhandler) {
-        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
-        goto errorExit;
-    }
-
-    hc->env     = NULL;
-    hc->clazz   = gclazz;
-    hc->carrier = gjcarrier;
-    hc->handler = gjhandler;
-    return true;
-
-errorExit:
-    if (gjhandler) (*env)->DeleteGlobalRef(env, gjhandler);
-    if (gjcarrier) (*env)->DeleteGlobalRef(env, gjcarrier);
-    if (gclazz)    (*env)->DeleteGlobalRef(env, gclazz);
-
-    return false;
-}
-
-static
-void callbackCtxtCleanup(CallbackContext* cc, JNIEnv* env)
-{
-    assert(cc);
-
-    if (cc->clazz)
-        (*env)->DeleteGlobalRef(env, cc->clazz);
-    if (cc->carrier)
-        (*env)->DeleteGlobalRef(env, cc->carrier);
-    if (cc->handler)
-        (*env)->DeleteGlobalRef(env, cc->handler);
-}
-
 static
 jboolean sessionMgrInit(JNIEnv* env, jclass clazz, jobject jcarrier, jobject jhandler)
 {
-    CallbackContext *hc = NULL;
+    HandlerContext *hc;
     int rc;
 
     assert(jcarrier);
 
     (void)clazz;
 
-    memset(&callbackContext, 0, sizeof(callbackContext));
-
+    hc = getContext(env, jcarrier);
+    if (!hc) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return JNI_FALSE;
+    }
 
     if (jhandler) {
-        hc = (CallbackContext*)&callbackContext;
-        if (!callbackCtxtSet(hc, env, jcarrier, jhandler)) {
-            setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
+        hc->sessionHandler = (*env)->NewGlobalRef(env, jhandler);
+        if (!hc->sessionHandler) {
+            setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
             return JNI_FALSE;
         }
     }
 
-    rc = IOEX_session_init(getCarrier(env, jcarrier), onSessionRequestCallback, hc);
+    rc = IOEX_session_init(hc->nativeCarrier, onSessionRequestCallback, hc);
     if (rc < 0) {
         logE("Call IOEX_session_init API error");
         setErrorCode(IOEX_get_error());
+        if (hc->sessionHandler) {
+            (*env)->DeleteGlobalRef(env, hc->sessionHandler);
+            hc->sessionHandler = NULL;
+        }
         return JNI_FALSE;
     }
 
@@ -196,18 +150,29 @@ jboolean sessionMgrInit(JNIEnv* env, jclass clazz, jobject jcarrier, jobject jha
 static
 void sessionMgrCleanup(JNIEnv* env, jclass clazz, jobject jcarrier)
 {
+    HandlerContext *hc;
+
     assert(jcarrier);
 
     (void)clazz;
 
-    callbackCtxtCleanup(&callbackContext, env);
-    IOEX_session_cleanup(getCarrier(env, jcarrier));
+    hc = getContext(env, jcarrier);
+    if (!hc)
+        return;
+
+    IOEX_session_cleanup(hc->nativeCarrier);
+
+    if (hc->sessionHandler) {
+        (*env)->DeleteGlobalRef(env, hc->sessionHandler);
+        hc->sessionHandler = NULL;
+    }
 }
 
 static
 jobject createSession(JNIEnv* env, jobject thiz, jobject jcarrier, jstring jto)
 {
     const char *to;
+    IOEXCarrier *carrier;
     IOEXSession *session;
     jobject jsession;
 
@@ -222,7 +187,14 @@ jobject createSession(JNIEnv* env, jobject thiz, jobject jcarrier, jstring jto)
         return NULL;
     }
 
-    session = IOEX_session_new(getCarrier(env, jcarrier), to);
+    carrier = getCarrier(env, jcarrier);
+    if (!carrier) {
+        (*env)->ReleaseStringUTFChars(env, jto, to);
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return NULL;
+    }
+
+    session = IOEX_session_new(carrier, to);
     (*env)->ReleaseStringUTFChars(env, jto, to);
     if (!session) {
         logE("Call IOEX_session_new API error");
@@ -48,22 +48,16 @@
 
 #include "sessionUtils.h"
 #include "sessionCookie.h"
+#include "jniCache.h"
 #include "log.h"
 
 int newJavaStreamState(JNIEnv* env, IOEXStreamState state, jobject* jstate)
 {
-    const char* clazzName = "org/ioex/carrier/session/StreamState";
-    jclass clazz = findClass(env, clazzName);
-    if (!clazz) {
-        logE("Java enum 'StreamState' not found");
-        return 0;
-    }
+    jobject jobj = ENUM_CONSTANT(streamState, state);
 
-    const char* signature = "(I)"_S("StreamState;");
-    jobject jobj = NULL;
-    int result = callStaticObjectMethod(env, clazz, "valueOf", signature, &jobj, state);
-    if (!result) {
-        logE("Call static method 'valueof' of StreamState error");
+    (void)env;
+    if (!jobj) {
+        logE("Invalid stream state %d", (int)state);
         return 0;
     }
 
@@ -73,15 +67,8 @@ int newJavaStreamState(JNIEnv* env, IOEXStreamState state, jobject* jstate)
 
 int getNativeStreamType(JNIEnv* env, jobject jjtype, IOEXStreamType* type)
 {
-    const char* clazzName = "org/ioex/carrier/session/StreamType";
-    jclass clazz = (*env)->FindClass(env, clazzName);
-    if (!clazz) {
-        logE("Java enum 'StreamType' not found");
-        return 0;
-    }
-
     jint value = 0;
-    int result = callIntMethod(env, clazz, jjtype, "value", "()I", &value);
+    int result = callIntMethod(env, jjtype, gJni.streamType.value, &value);
     if (!result) {
         logE("Call method 'value()' of StreamType error");
         return 0;
@@ -93,20 +80,7 @@ int getNativeStreamType(JNIEnv* env, jobject jjtype, IOEXStreamType* type)
 
 int newJavaSession(JNIEnv* env, IOEXSession* session, jobject jto, jobject* jsession)
 {
-    const char* clazzName = "org/ioex/carrier/session/Session";
-    jclass clazz = (*env)->FindClass(env, clazzName);
-    if (!clazz) {
-        logE("Java enum 'Session' not found");
-        return 0;
-    }
-
-    jmethodID contor = (*env)->GetMethodID(env, clazz, "<init>", "("_J("String;)V"));
-    if (!contor) {
-        logE("constructor method: 'Session() mismatched");
-        return 0;
-    }
-
-    jobject jobj = (*env)->NewObject(env, clazz, contor, jto);
+    jobject jobj = (*env)->NewObject(env, gJni.session.clazz, gJni.session.init, jto);
     if (!jobj) {
         logE("New class Session object error");
         return 0;
@@ -119,20 +93,7 @@ int newJavaSession(JNIEnv* env, IOEXSession* session, jobject jto, jobject* jses
 
 int newJavaStream(JNIEnv* env, jobject jtype, jobject* jstream)
 {
-    const char* clazzName = "org/ioex/carrier/session/Stream";
-    jclass clazz = (*env)->FindClass(env, clazzName);
-    if (!clazz) {
-        logE("Java enum 'Stream' not found");
-        return 0;
-    }
-
-    jmethodID contor = (*env)->GetMethodID(env, clazz, "<init>", "("_S("StreamType;)V"));
-    if (!contor) {
-        logE("constructor method: 'Stream() mismatched");
-        return 0;
-    }
-
-    jobject jobj = (*env)->NewObject(env, clazz, contor, jtype);
+    jobject jobj = (*env)->NewObject(env, gJni.stream.clazz, gJni.stream.init, jtype);
     if (!jobj) {
         logE("New class Stream object error");
         return 0;
@@ -144,18 +105,11 @@ int newJavaStream(JNIEnv* env, jobject jtype, jobject* jstream)
 
 int newJavaCloseReason(JNIEnv* env, CloseReason reason, jobject* jreason)
 {
-    const char* clazzName = "org/ioex/carrier/session/CloseReason";
-    jclass clazz = findClass(env, clazzName);
-    if (!clazz) {
-        logE("Java enum 'CloseReason' not found");
-        return 0;
-    }
+    jobject jobj = ENUM_CONSTANT(closeReason, reason);
 
-    const char* signature = "(I)L"_S("CloseReason;");
-    jobject jobj = NULL;
-    int result = callStaticObjectMethod(env, clazz, "valueOf", signature, &jobj, (int)reason);
-    if (!result) {
-        logE("Call static method 'valueof' of CloseReason error");
+    (void)env;
+    if (!jobj) {
+        logE("Invalid close reason %d", (int)reason);
         return 0;
     }
 
@@ -165,15 +119,8 @@ int newJavaCloseReason(JNIEnv* env, CloseReason reason, jobject* jreason)
 
 int getNativeProtocol(JNIEnv* env, jobject jprotocol, PortForwardingProtocol* protocol)
 {
-    const char* clazzName = "org/ioex/carrier/session/PortForwardingProtocol";
-    jclass clazz = (*env)->FindClass(env, clazzName);
-    if (!clazz) {
-        logE("Java enum 'PortForwardingProtocol' not found");
-        return 0;
-    }
-
     jint value = 0;
-    int result = callIntMethod(env, clazz, jprotocol, "value", "()I", &value);
+    int result = callIntMethod(env, jprotocol, gJni.protocol.value, &value);
     if (!result) {
         logE("Call method 'value()' of PortForwardingProtocol error");
         return 0;
@@ -184,151 +131,68 @@ int getNativeProtocol(JNIEnv* env, jobject jprotocol, PortForwardingProtocol* pr
 }
 
 static
-int newInetSocketAddress(JNIEnv *env, const char *host, int port, jobject* jsocketAddr)
+int newJavaAddresInfo(JNIEnv *env, IOEXAddressInfo *info, jobject *jaddrInfo)
 {
-    const char* clazzName = "java/net/InetSocketAddress";
-    jclass clazz = (*env)->FindClass(env, clazzName);
-    if (!clazz) {
-        logE("Java class 'InetSocketAddress' not found");
-        return 0;
-    }
-
-    jmethodID contor = (*env)->GetMethodID(env, clazz, "<init>", "("_J("String;I)V"));
-    if (!contor) {
-        logE("constructor method: 'InetSocketAddress() error");
-        return 0;
-    }
+    jvalue args[5];
 
-    jstring jhost = (*env)->NewStringUTF(env, host);
-    if (!jhost) {
+    args[0].i = (jint)info->type;
+    args[1].l = (*env)->NewStringUTF(env, info->addr);
+    if (!args[1].l) {
         logE("New java string for hostname error");
         return 0;
     }
-
-    jobject jobj = (*env)->NewObject(env, clazz, contor, jhost, port);
-    if (!jobj) {
-        logE("New class InetSocketAddress object error");
-        (*env)->DeleteLocalRef(env, jhost);
-        return 0;
-    }
-
-    *jsocketAddr = jobj;
-    return 1;
-}
-
-static
-int newJavaAddresInfo(JNIEnv *env, IOEXAddressInfo *info, jobject *jaddrInfo)
-{
-    const char* clazzName = "org/ioex/carrier/session/AddressInfo";
-    jclass clazz = (*env)->FindClass(env, clazzName);
-    if (!clazz) {
-        logE("Java class 'AddressInfo' not found");
-        return 0;
-    }
-
-    jmethodID contor = (*env)->GetMethodID(env, clazz, "<init>", "()V");
-    if (!contor) {
-        logE("constructor method: 'AddressInfo() error");
-        return 0;
+    args[2].i = (jint)info->port;
+    args[3].l = NULL;
+    if (*info->related_addr) {
+        args[3].l = (*env)->NewStringUTF(env, info->related_addr);
+        if (!args[3].l) {
+            logE("New java string for related hostname error");
+            (*env)->DeleteLocalRef(env, args[1].l);
+            return 0;
+        }
     }
+    args[4].i = (jint)info->related_port;
 
-    jobject jobj = (*env)->NewObject(env, clazz, contor);
+    jobject jobj = (*env)->NewObjectA(env, gJni.addressInfo.clazz, gJni.addressInfo.init, args);
+    (*env)->DeleteLocalRef(env, args[1].l);
+    if (args[3].l)
+        (*env)->DeleteLocalRef(env, args[3].l);
     if (!jobj) {
+        (*env)->ExceptionClear(env);
         logE("New class AddressInfo object error");
         return 0;
     }
 
-    int result = callVoidMethod(env, clazz, jobj, "setCandidateType", "(I)V", info->type);
-    if (!result) {
-        logE("Call method setCandidateType error");
-        (*env)->DeleteGlobalRef(env, jobj);
-        return 0;
-    }
-
-    jobject jaddr = NULL;
-    if (!newInetSocketAddress(env, info->addr, info->port, &jaddr)) {
-        logE("New java InetSocketAddress object error");
-        (*env)->DeleteLocalRef(env, jobj);
-        return 0;
-    }
-
-    result = callVoidMethod(env, clazz, jobj, "setAddress",
-                            "(Ljava/net/InetSocketAddress;)V",
-                            jaddr);
-    if (!result) {
-        logE("Call method setAddress of AddressInfo object error");
-        (*env)->DeleteLocalRef(env, jaddr);
-        (*env)->DeleteLocalRef(env, jobj);
-        return 0;
-    }
-
-    if (*info->related_addr) {
-        jobject jrelatedAddr = NULL;
-
-        if (!newInetSocketAddress(env, info->related_addr, info->related_port, &jrelatedAddr)) {
-            logE("New java InetSocketAddress object error");
-            (*env)->DeleteLocalRef(env, jobj);
-            return 0;
-        }
-
-        result = callVoidMethod(env, clazz, jobj, "setRelatedAddress",
-                                "(Ljava/net/InetSocketAddress;)V",
-                                jrelatedAddr);
-        if (!result) {
-            logE("Call method setAddress of AddressInfo object error");
-            (*env)->DeleteLocalRef(env, jrelatedAddr);
-            (*env)->DeleteLocalRef(env, jobj);
-            return 0;
-        }
-    }
-
     *jaddrInfo = jobj;
     return 1;
 }
 
-int setJavaTransportInfo(JNIEnv *env, jobject jtransport, IOEXTransportInfo *info)
+int newJavaTransportInfo(JNIEnv *env, IOEXTransportInfo *info, jobject *jtransport)
 {
-    jclass clazz = (*env)->GetObjectClass(env, jtransport);
-    if (!clazz) {
-        logE("java class 'TransportInfo' not found");
-        return 0;
-    }
-
-    int result = callVoidMethod(env, clazz, jtransport, "setTopology", "(I)V", info->topology);
-    if (!result) {
-        logE("Call method setTopology error");
-        return 0;
-    }
+    jobject jlocal;
+    jobject jremote;
 
-    jobject jaddrInfo;
-    if (!newJavaAddresInfo(env, &info->local, &jaddrInfo)) {
+    if (!newJavaAddresInfo(env, &info->local, &jlocal)) {
         logE("New java AddressInfo error");
         return 0;
     }
 
-    result = callVoidMethod(env, clazz, jtransport, "setLocalAddressInfo",
-                            "("_S("AddressInfo;)V"),
-                            jaddrInfo);
-    if (!result) {
-        logE("Call method setLocalAddressInfo error");
-        (*env)->DeleteLocalRef(env, jaddrInfo);
-        return 0;
-    }
-
-    jobject jremotedAddrInfo;
-    if (!newJavaAddresInfo(env, &info->remote, &jremotedAddrInfo)) {
+    if (!newJavaAddresInfo(env, &info->remote, &jremote)) {
         logE("New java AddressInfo error");
+        (*env)->DeleteLocalRef(env, jlocal);
         return 0;
     }
 
-    result = callVoidMethod(env, clazz, jtransport, "setRemoteAddressInfo",
-                            "("_S("AddressInfo;)V"),
-                            jremotedAddrInfo);
-    if (!result) {
-        logE("Call method setRemoteAddressInfo error");
-        (*env)->DeleteLocalRef(env, jremotedAddrInfo);
+    jobject jobj = (*env)->NewObject(env, gJni.transportInfo.clazz, gJni.transportInfo.init,
+                                     (jint)info->topology, jlocal, jremote);
+    (*env)->DeleteLocalRef(env, jlocal);
+    (*env)->DeleteLocalRef(env, jremote);
+    if (!jobj) {
+        (*env)->ExceptionClear(env);
+        logE("New class TransportInfo object error");
         return 0;
     }
 
+    *jtransport = jobj;
     return 1;
-}
\ No newline at end of file
+}
@@ -49,6 +49,7 @@
 #include <IOEX_carrier.h>
 #include <IOEX_session.h>
 
+/* Returns the cached enum constant, owned by the JNI cache: do not delete it. */
 int newJavaStreamState(JNIEnv* env, IOEXStreamState state, jobject* jstate);
 
 int getNativeStreamType(JNIEnv* env, jobject jjtype,  IOEXStreamType* type);
@@ -57,10 +58,11 @@ int newJavaSession(JNIEnv* env, IOEXSession* session, jobject jto, jobject* jses
 
 int newJavaStream(JNIEnv* env, jobject jtype, jobject* jstream);
 
+/* Returns the cached enum constant, owned by the JNI cache: do not delete it. */
 int newJavaCloseReason(JNIEnv* env, CloseReason reason, jobject* jreason);
 
 int getNativeProtocol(JNIEnv* env, jobject jproto, PortForwardingProtocol* protocol);
 
-int setJavaTransportInfo(JNIEnv *env, jobject jtransport, IOEXTransportInfo *info);
+int newJavaTransportInfo(JNIEnv *env, IOEXTransportInfo *info, jobject *jtransport);
 
 #endif //__SESSION_UTILS_H__
\ No newline at end of file
@@ -44,6 +44,7 @@
 
 #include <jni.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <IOEX_carrier.h>
 #include <IOEX_session.h>
@@ -52,56 +53,279 @@
 #include "utils.h"
 #include "sessionCookie.h"
 #include "sessionUtils.h"
+#include "jniCache.h"
+#include "streamContext.h"
 
 static
-jboolean getTransportInfo(JNIEnv *env, jobject thiz, jint jstreamId, jobject jtransportInfo)
+jobject getTransportInfo(JNIEnv *env, jobject thiz, jint jstreamId)
 {
     IOEXTransportInfo info;
+    jobject jtransportInfo;
     int rc;
 
     assert(jstreamId > 0);
-    assert(jtransportInfo);
 
-    rc = IOEX_stream_get_transport_info(getSession(env, thiz), jstreamId, &info);
+    rc = IOEX_stream_get_transport_info(getStreamSession(env, thiz), jstreamId, &info);
     if (rc < 0) {
         logE("Call IOEX_stream_get_transport_info error");
         setErrorCode(IOEX_get_error());
-        return JNI_FALSE;
+        return NULL;
     }
 
-    if (!setJavaTransportInfo(env, jtransportInfo, &info)) {
-        setErrorCode(IOEXERR_LANGUAGE_BINDING);
-        return JNI_FALSE;
+    if (!newJavaTransportInfo(env, &info, &jtransportInfo)) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_LANGUAGE_BINDING));
+        return NULL;
     }
-    return JNI_TRUE;
+    return jtransportInfo;
+}
+
+/*
+ * Writes of at most this many bytes from a heap array are copied onto the
+ * stack, so the array is neither pinned nor duplicated by the runtime.
+ */
+#define STREAM_WRITE_STACK_BYTES 1024
+
+static inline
+ssize_t streamSend(IOEXSession* session, int streamId, int channel,
+                   const void* data, size_t len)
+{
+    if (channel > 0)
+        return IOEX_stream_write_channel(session, streamId, channel, data, len);
+    else
+        return IOEX_stream_write(session, streamId, data, len);
+}
+
+/* Writes go through the send queue of the stream if there is one. */
+static
+ssize_t streamWrite(JNIEnv* env, IOEXSession* session, CallbackContext* cc, int streamId,
+                    int channel, const void* data, size_t len)
+{
+    SendQueue* queue;
+    ssize_t bytes;
+
+    queue = cc ? getSendQueue(cc) : NULL;
+    if (queue)
+        return sendQueueWrite(queue, env, channel, data, len);
+
+    bytes = streamSend(session, streamId, channel, data, len);
+    if (bytes < 0) {
+        logE("Call IOEX_stream_write%s API error", channel > 0 ? "_channel" : "");
+        setErrorCode(IOEX_get_error());
+    }
+    streamStatsWritten(cc, len, bytes);
+    return bytes;
 }
 
+/*
+ * The write natives take the session and stream context handles as
+ * primitives, so the hot path never reads the Stream object. They are
+ * still instance methods: the Stream stays reachable for the call, and
+ * with it the context, which is only freed once the Stream is collected.
+ * A channel of 0 writes to the stream itself.
+ */
 static
-jint writeData(JNIEnv* env, jobject thiz, jint jstreamId, jbyteArray jdata, jint offset, jint len)
+jint writeData(JNIEnv* env, jobject thiz, jlong jsession, jlong jcontext, jint jstreamId,
+               jint channel, jbyteArray jdata, jint offset, jint len)
 {
+    IOEXSession *session = (IOEXSession*)(uintptr_t)jsession;
+    CallbackContext *cc = (CallbackContext*)(uintptr_t)jcontext;
+    jbyte stack[STREAM_WRITE_STACK_BYTES];
     jbyte *data;
-    jsize _len;
     ssize_t bytes;
 
+    (void)thiz;
+
     assert(jdata);
+    assert(offset >= 0 && len > 0);
+    assert((offset + len) <= (*env)->GetArrayLength(env, jdata));
+
+    if (len <= STREAM_WRITE_STACK_BYTES) {
+        (*env)->GetByteArrayRegion(env, jdata, offset, len, stack);
+        bytes = streamWrite(env, session, cc, jstreamId, channel, stack, (size_t)len);
+    } else {
+        data = (*env)->GetByteArrayElements(env, jdata, NULL);
+        if (!data) {
+            setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+            return -1;
+        }
+
+        bytes = streamWrite(env, session, cc, jstreamId, channel, data + offset, (size_t)len);
+        (*env)->ReleaseByteArrayElements(env, jdata, data, JNI_ABORT);
+    }
+
+    return bytes < 0 ? -1 : (jint)bytes;
+}
+
+static
+const void* getDirectBufferData(JNIEnv* env, jobject jbuffer, jint position, jint limit)
+{
+    uint8_t *address;
+    jlong capacity;
+
+    assert(jbuffer);
+    assert(position >= 0 && position < limit);
+
+    address = (uint8_t*)(*env)->GetDirectBufferAddress(env, jbuffer);
+    capacity = (*env)->GetDirectBufferCapacity(env, jbuffer);
+    if (!address || capacity < (jlong)limit) {
+        logE("Buffer is not a direct ByteBuffer or beyond its capacity");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+        return NULL;
+    }
 
-    _len = (*env)->GetArrayLength(env, jdata);
+    return address + position;
+}
+
+static
+jint writeDirectData(JNIEnv* env, jobject thiz, jlong jsession, jlong jcontext, jint jstreamId,
+                     jint channel, jobject jbuffer, jint position, jint limit)
+{
+    IOEXSession *session = (IOEXSession*)(uintptr_t)jsession;
+    CallbackContext *cc = (CallbackContext*)(uintptr_t)jcontext;
+    const void *data;
+    ssize_t bytes;
+
+    (void)thiz;
+
+    data = getDirectBufferData(env, jbuffer, position, limit);
+    if (!data)
+        return -1;
+
+    bytes = streamWrite(env, session, cc, jstreamId, channel, data, (size_t)(limit - position));
+    return bytes < 0 ? -1 : (jint)bytes;
+}
+
+/* Frames of a batch are read from and written back to Java in chunks of this size. */
+#define STREAM_BATCH_CHUNK 128
+
+/*
+ * Sends frame i of a batch, the lengths[i] bytes at base + offsets[i], to
+ * channels[i] and stores the bytes sent in written[i]. The batch stops at the
+ * first frame that would block, including a full send queue, or is sent
+ * partially. Returns the number of
+ * written entries, which counts a partial frame but not a blocked one, or -1
+ * if the first frame failed for any other reason than would-block.
+ */
+static
+jint writeFrames(JNIEnv* env, IOEXSession* session, CallbackContext* cc, int streamId,
+                 const uint8_t* base, jlong size, jintArray jchannels, jintArray joffsets,
+                 jintArray jlengths, jintArray jwritten)
+{
+    jint channels[STREAM_BATCH_CHUNK];
+    jint offsets[STREAM_BATCH_CHUNK];
+    jint lengths[STREAM_BATCH_CHUNK];
+    jint written[STREAM_BATCH_CHUNK];
+    SendQueue* queue = cc ? getSendQueue(cc) : NULL;
+    jsize count;
+    jsize start;
+    jsize n;
+    jsize i;
+    ssize_t bytes;
+    int stop = 0;
+    int err;
+
+    count = (*env)->GetArrayLength(env, jchannels);
+
+    for (start = 0; start < count; start += n) {
+        n = count - start < STREAM_BATCH_CHUNK ? count - start : STREAM_BATCH_CHUNK;
+
+        (*env)->GetIntArrayRegion(env, jchannels, start, n, channels);
+        (*env)->GetIntArrayRegion(env, joffsets, start, n, offsets);
+        (*env)->GetIntArrayRegion(env, jlengths, start, n, lengths);
+
+        for (i = 0; i < n && !stop; i++) {
+            if (offsets[i] < 0 || lengths[i] <= 0 || (jlong)offsets[i] + lengths[i] > size) {
+                logE("Batch frame %d is beyond the buffer", start + i);
+                setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+                stop = -1;
+                break;
+            }
+
+            if (queue) {
+                bytes = sendQueueWrite(queue, env, channels[i], base + offsets[i],
+                                       (size_t)lengths[i]);
+                err = bytes < 0 ? _getErrorCode() : 0;
+            } else {
+                bytes = streamSend(session, streamId, channels[i], base + offsets[i],
+                                   (size_t)lengths[i]);
+                err = bytes < 0 ? IOEX_get_error() : 0;
+                if (bytes >= 0 || !sendWouldBlock(err))
+                    streamStatsWritten(cc, (size_t)lengths[i], bytes);
+            }
+
+            if (bytes < 0) {
+                // A full send queue is the would-block of a queued channel.
+                if (sendWouldBlock(err) || err == IOEX_GENERAL_ERROR(IOEXERR_LIMIT_EXCEEDED)) {
+                    stop = 1;
+                } else {
+                    logE("Call IOEX_stream_write_channel API error");
+                    stop = -1;
+                }
+                setErrorCode(err);
+                break;
+            }
+
+            written[i] = (jint)bytes;
+            if (bytes < lengths[i])
+                stop = 1;
+        }
+
+        (*env)->SetIntArrayRegion(env, jwritten, start, i, written);
+        if (stop)
+            return stop < 0 && start + i == 0 ? -1 : start + i;
+    }
+
+    return count;
+}
+
+static
+jint writeBatch(JNIEnv* env, jobject thiz, jlong jsession, jlong jcontext, jint jstreamId,
+                jintArray jchannels, jbyteArray jdata, jintArray joffsets, jintArray jlengths,
+                jintArray jwritten)
+{
+    jbyte *data;
+    jint rc;
+
+    (void)thiz;
+
+    assert(jchannels && jdata && joffsets && jlengths && jwritten);
 
-    assert(offset >= 0 && offset < _len);
-    assert((offset + len) <= _len);
-    
     data = (*env)->GetByteArrayElements(env, jdata, NULL);
+    if (!data) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        return -1;
+    }
 
-    bytes = IOEX_stream_write(getSession(env, thiz), jstreamId, (const void*)(data + offset), (size_t)len);
-    (*env)->ReleaseByteArrayElements(env, jdata, data, 0);
+    rc = writeFrames(env, (IOEXSession*)(uintptr_t)jsession,
+                     (CallbackContext*)(uintptr_t)jcontext, jstreamId, (const uint8_t*)data,
+                     (*env)->GetArrayLength(env, jdata), jchannels, joffsets, jlengths,
+                     jwritten);
+    (*env)->ReleaseByteArrayElements(env, jdata, data, JNI_ABORT);
+    return rc;
+}
 
-    if (bytes < 0) {
-        logE("Call IOEX_stream_write API error");
-        setErrorCode(IOEX_get_error());
+static
+jint writeDirectBatch(JNIEnv* env, jobject thiz, jlong jsession, jlong jcontext, jint jstreamId,
+                      jintArray jchannels, jobject jbuffer, jintArray joffsets,
+                      jintArray jlengths, jintArray jwritten)
+{
+    const uint8_t *address;
+
+    (void)thiz;
+
+    assert(jchannels && jbuffer && joffsets && jlengths && jwritten);
+
+    address = (const uint8_t*)(*env)->GetDirectBufferAddress(env, jbuffer);
+    if (!address) {
+        logE("Buffer is not a direct ByteBuffer");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
         return -1;
     }
 
-    return (jint)bytes;
+    return writeFrames(env, (IOEXSession*)(uintptr_t)jsession,
+                       (CallbackContext*)(uintptr_t)jcontext, jstreamId, address,
+                       (*env)->GetDirectBufferCapacity(env, jbuffer),
+                       jchannels, joffsets, jlengths, jwritten);
 }
 
 jint openChannel(JNIEnv* env, jobject thiz, jint streamId, jstring jcookie)
@@ -117,7 +341,7 @@ jint openChannel(JNIEnv* env, jobject thiz, jint streamId, jstring jcookie)
         return -1;
     }
 
-    channel = IOEX_stream_open_channel(getSession(env, thiz), streamId, cookie);
+    channel = IOEX_stream_open_channel(getStreamSession(env, thiz), streamId, cookie);
     (*env)->ReleaseStringUTFChars(env, jcookie, cookie);
 
     if (channel < 0) {
@@ -132,80 +356,66 @@ jint openChannel(JNIEnv* env, jobject thiz, jint streamId, jstring jcookie)
 static
 jboolean closeChannel(JNIEnv* env, jobject thiz, jint streamId, jint channel)
 {
+    CallbackContext* cc;
+    SendQueue* queue;
     int rc;
 
     assert(channel > 0);
 
-    rc = IOEX_stream_close_channel(getSession(env, thiz), streamId, channel);
+    rc = IOEX_stream_close_channel(getStreamSession(env, thiz), streamId, channel);
     if (rc < 0) {
         logE("Call IOEX_stream_close_channel API error");
         setErrorCode(IOEX_get_error());
         return JNI_FALSE;
     }
 
-    return JNI_TRUE;
-}
-
-static
-jint writeDataToChannel(JNIEnv* env, jobject thiz, jint streamId, jint channel, jbyteArray jdata,
-                        jint offset, jint len)
-{
-    jbyte *data;
-    jsize _len;
-    ssize_t bytes;
-
-    assert(channel > 0);
-    assert(jdata);
-
-    _len  = (*env)->GetArrayLength(env, jdata);
-
-    assert(offset >= 0 && offset < _len);
-    assert((offset + len) <= _len);
-
-    data = (*env)->GetByteArrayElements(env, jdata, NULL);
-
-    bytes = IOEX_stream_write_channel(getSession(env, thiz), streamId, channel,
-                                     (const void*)(data + offset), (size_t)len);
-    (*env)->ReleaseByteArrayElements(env, jdata, data, 0);
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    queue = cc ? getSendQueue(cc) : NULL;
+    if (queue)
+        sendQueueClose(queue, channel);
 
-    if (bytes < 0) {
-        logE("Call IOEX_stream_write_channel API error");
-        setErrorCode(IOEX_get_error());
-        return -1;
-    }
-
-    return (jint)bytes;
+    return JNI_TRUE;
 }
 
 static
 jboolean pendChannel(JNIEnv* env, jobject thiz, jint streamId, jint channel)
 {
+    CallbackContext* cc;
     int rc;
 
     assert(channel > 0);
 
-    rc = IOEX_stream_pend_channel(getSession(env, thiz), streamId, channel);
+    rc = IOEX_stream_pend_channel(getStreamSession(env, thiz), streamId, channel);
     if (rc < 0) {
         logE("Call IOEX_stream_pend_channel API error");
         setErrorCode(IOEX_get_error());
         return JNI_FALSE;
     }
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    if (cc)
+        streamStatsAdd(cc, STREAM_STAT_PENDS, 1);
     return JNI_TRUE;
 }
 
 static
 jboolean resumeChannel(JNIEnv* env, jobject thiz, jint streamId, jint channel)
 {
+    CallbackContext* cc;
     int rc;
 
     assert(channel > 0);
 
-    rc = IOEX_stream_resume_channel(getSession(env, thiz), streamId, channel);
+    rc = IOEX_stream_resume_channel(getStreamSession(env, thiz), streamId, channel);
     if (rc < 0) {
         logE("Call IOEX_stream_resume_channel API error");
         setErrorCode(IOEX_get_error());
         return JNI_FALSE;
     }
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    if (cc)
+        streamStatsAdd(cc, STREAM_STAT_RESUMES, 1);
     return JNI_TRUE;
 }
 
@@ -240,7 +450,7 @@ jint openPortForwarding(JNIEnv* env, jobject thiz, jint streamId, jstring jservi
         goto errorExit;
     }
 
-    pfId = IOEX_stream_open_port_forwarding(getSession(env, thiz), streamId,
+    pfId = IOEX_stream_open_port_forwarding(getStreamSession(env, thiz), streamId,
                                            service, protocol, host, port);
 
     (*env)->ReleaseStringUTFChars(env, jservice, service);
@@ -271,7 +481,7 @@ jboolean closePortForwarding(JNIEnv* env, jobject thiz, jint streamId, jint port
     assert(streamId > 0);
     assert(portForwarding > 0);
 
-    rc = IOEX_stream_close_port_forwarding(getSession(env, thiz), streamId,
+    rc = IOEX_stream_close_port_forwarding(getStreamSession(env, thiz), streamId,
                                                       portForwarding);
     if (rc < 0) {
         logE("Call IOEX_stream_close_port_forwarding API error");
@@ -281,6 +491,364 @@ jboolean closePortForwarding(JNIEnv* env, jobject thiz, jint streamId, jint port
     return JNI_TRUE;
 }
 
+/*
+ * The context of a stream for a native that configures it, locked so the
+ * handler can be used. Fails with WRONG_STATE once the stream is removed.
+ */
+static
+CallbackContext* lockStreamContext(JNIEnv* env, jobject thiz)
+{
+    CallbackContext* cc;
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    if (cc) {
+        pthread_mutex_lock(&cc->lock);
+        if (!cc->closed)
+            return cc;
+        pthread_mutex_unlock(&cc->lock);
+    }
+
+    setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+    return NULL;
+}
+
+static
+jboolean setReceiveBufferPool(JNIEnv* env, jobject thiz, jint bufferSize, jint count)
+{
+    CallbackContext* cc;
+    BufferPool* pool;
+    jboolean result = JNI_FALSE;
+
+    assert(bufferSize > 0);
+    assert(count > 0);
+
+    cc = lockStreamContext(env, thiz);
+    if (!cc)
+        return JNI_FALSE;
+
+    if (!(*env)->IsInstanceOf(env, cc->handler, gJni.pooledStreamHandler.clazz)) {
+        logE("Stream handler does not implement PooledStreamHandler");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+        goto unlock;
+    }
+
+    if (getReceivePool(cc)) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_ALREADY_EXIST));
+        goto unlock;
+    }
+
+    pool = bufferPoolCreate(env, bufferSize, count);
+    if (!pool) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        goto unlock;
+    }
+
+    __atomic_store_n(&cc->pool, pool, __ATOMIC_RELEASE);
+    result = JNI_TRUE;
+
+unlock:
+    pthread_mutex_unlock(&cc->lock);
+    return result;
+}
+
+static
+jboolean setDataBatching(JNIEnv* env, jobject thiz, jint maxBytes, jint maxCount,
+                         jint maxDelayMs)
+{
+    CallbackContext* cc;
+    StreamBatch* batch;
+    jboolean result = JNI_FALSE;
+
+    assert(maxBytes > 0);
+    assert(maxCount > 0);
+    assert(maxDelayMs >= 0);
+
+    cc = lockStreamContext(env, thiz);
+    if (!cc)
+        return JNI_FALSE;
+
+    if (!(*env)->IsInstanceOf(env, cc->handler, gJni.batchStreamHandler.clazz)) {
+        logE("Stream handler does not implement BatchStreamHandler");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+        goto unlock;
+    }
+
+    if (getStreamBatch(cc)) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_ALREADY_EXIST));
+        goto unlock;
+    }
+
+    batch = streamBatchCreate(env, cc->object, cc->handler, maxBytes, maxCount, maxDelayMs);
+    if (!batch) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        goto unlock;
+    }
+
+    __atomic_store_n(&cc->batch, batch, __ATOMIC_RELEASE);
+    result = JNI_TRUE;
+
+unlock:
+    pthread_mutex_unlock(&cc->lock);
+    return result;
+}
+
+static
+jboolean setSendQueue(JNIEnv* env, jobject thiz, jint capacity, jint lowWatermark,
+                      jint highWatermark)
+{
+    CallbackContext* cc;
+    SendQueue* queue;
+    jint streamId;
+    jboolean result = JNI_FALSE;
+
+    assert(capacity > 0);
+    assert(lowWatermark >= 0 && lowWatermark <= highWatermark && highWatermark <= capacity);
+
+    cc = lockStreamContext(env, thiz);
+    if (!cc)
+        return JNI_FALSE;
+
+    if (getSendQueue(cc)) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_ALREADY_EXIST));
+        goto unlock;
+    }
+
+    streamId = (*env)->GetIntField(env, thiz, gJni.stream.streamId);
+    queue = sendQueueCreate(env, cc, getStreamSession(env, thiz), streamId, (size_t)capacity,
+                            (size_t)lowWatermark, (size_t)highWatermark);
+    if (!queue) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        goto unlock;
+    }
+
+    __atomic_store_n(&cc->sendQueue, queue, __ATOMIC_RELEASE);
+    result = JNI_TRUE;
+
+unlock:
+    pthread_mutex_unlock(&cc->lock);
+    return result;
+}
+
+/* Stop the send queue, as the session of the stream goes away. */
+static
+void releaseSendQueue(JNIEnv* env, jobject thiz)
+{
+    CallbackContext* cc;
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    if (cc)
+        sendQueueDetach(getSendQueue(cc));
+}
+
+/* Stop the stream once its session is closed, as removeStream() does. */
+static
+void closeContext(JNIEnv* env, jobject thiz)
+{
+    CallbackContext* cc;
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    if (cc)
+        streamContextClose(cc, env);
+}
+
+/* Free the context, from the finalizer of the Stream. */
+static
+void releaseContext(JNIEnv* env, jobject thiz)
+{
+    CallbackContext* cc;
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    if (cc) {
+        setLongField(env, thiz, gJni.stream.contextCookie, 0);
+        streamContextFree(cc, env);
+    }
+}
+
+static
+jlong getQueuedBytes(JNIEnv* env, jobject thiz, jint channel)
+{
+    CallbackContext* cc;
+    SendQueue* queue;
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    queue = cc ? getSendQueue(cc) : NULL;
+
+    return queue ? (jlong)sendQueueBytes(queue, channel) : 0;
+}
+
+static
+jboolean setChannelSchedule(JNIEnv* env, jobject thiz, jint channel, jint priority,
+                            jint weight)
+{
+    CallbackContext* cc;
+    SendQueue* queue;
+
+    assert(channel > 0);
+    assert(priority >= 0 && priority < SEND_QUEUE_PRIORITIES);
+    assert(weight > 0 && weight <= SEND_QUEUE_MAX_WEIGHT);
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    queue = cc ? getSendQueue(cc) : NULL;
+    if (!queue) {
+        logE("Stream has no send queue to schedule");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return JNI_FALSE;
+    }
+
+    if (!sendQueueSchedule(queue, channel, priority, weight))
+        return JNI_FALSE;
+
+    return JNI_TRUE;
+}
+
+static
+jboolean setRateLimit(JNIEnv* env, jobject thiz, jint channel, jlong bytesPerSecond,
+                      jint burst)
+{
+    CallbackContext* cc;
+    SendQueue* queue;
+
+    assert(channel > 0 || channel == SEND_QUEUE_WHOLE_STREAM);
+    assert(bytesPerSecond >= 0 && (bytesPerSecond == 0 || burst > 0));
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    queue = cc ? getSendQueue(cc) : NULL;
+    if (!queue) {
+        logE("Stream has no send queue to pace");
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return JNI_FALSE;
+    }
+
+    if (!sendQueueRateLimit(queue, channel, bytesPerSecond, burst))
+        return JNI_FALSE;
+
+    return JNI_TRUE;
+}
+
+static
+void setGlobalRateLimit(JNIEnv* env, jclass clazz, jlong bytesPerSecond, jint burst)
+{
+    (void)env;
+    (void)clazz;
+
+    assert(bytesPerSecond >= 0 && (bytesPerSecond == 0 || burst > 0));
+
+    sendQueueGlobalRateLimit(bytesPerSecond, burst);
+}
+
+static
+jboolean getChannelQueueStats(JNIEnv* env, jobject thiz, jint channel, jlongArray jstats)
+{
+    CallbackContext* cc;
+    SendQueue* queue;
+    uint64_t values[SEND_QUEUE_STAT_COUNT];
+    jlong stats[SEND_QUEUE_STAT_COUNT];
+    int i;
+
+    assert(jstats);
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    queue = cc ? getSendQueue(cc) : NULL;
+    if (!queue) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return JNI_FALSE;
+    }
+
+    if ((*env)->GetArrayLength(env, jstats) < SEND_QUEUE_STAT_COUNT) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_BUFFER_TOO_SMALL));
+        return JNI_FALSE;
+    }
+
+    sendQueueStats(queue, channel, values);
+    for (i = 0; i < SEND_QUEUE_STAT_COUNT; i++)
+        stats[i] = (jlong)values[i];
+
+    (*env)->SetLongArrayRegion(env, jstats, 0, SEND_QUEUE_STAT_COUNT, stats);
+    return JNI_TRUE;
+}
+
+static
+jboolean isChannelWritable(JNIEnv* env, jobject thiz, jint channel)
+{
+    CallbackContext* cc;
+    SendQueue* queue;
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    queue = cc ? getSendQueue(cc) : NULL;
+
+    return !queue || sendQueueWritable(queue, channel) ? JNI_TRUE : JNI_FALSE;
+}
+
+static
+jboolean recycleBuffer(JNIEnv* env, jobject thiz, jobject jbuffer)
+{
+    CallbackContext* cc;
+    BufferPool* pool;
+
+    assert(jbuffer);
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    pool = cc ? getReceivePool(cc) : NULL;
+    if (!pool)
+        return JNI_FALSE;
+
+    return bufferPoolRecycle(pool, env, jbuffer) ? JNI_TRUE : JNI_FALSE;
+}
+
+static
+jlongArray getBufferPoolStats(JNIEnv* env, jobject thiz)
+{
+    CallbackContext* cc;
+    BufferPool* pool;
+    jlongArray jstats;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    jlong stats[2];
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    pool = cc ? getReceivePool(cc) : NULL;
+    if (pool)
+        bufferPoolStats(pool, &hits, &misses);
+
+    stats[0] = (jlong)hits;
+    stats[1] = (jlong)misses;
+
+    jstats = (*env)->NewLongArray(env, 2);
+    if (!jstats) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_OUT_OF_MEMORY));
+        return NULL;
+    }
+    (*env)->SetLongArrayRegion(env, jstats, 0, 2, stats);
+    return jstats;
+}
+
+static
+jboolean getStreamStats(JNIEnv* env, jobject thiz, jlongArray jstats)
+{
+    CallbackContext* cc;
+    jlong stats[STREAM_STAT_COUNT];
+    int i;
+
+    assert(jstats);
+
+    if ((*env)->GetArrayLength(env, jstats) < STREAM_STAT_COUNT) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_INVALID_ARGS));
+        return JNI_FALSE;
+    }
+
+    cc = (CallbackContext*)getStreamCookie(env, thiz);
+    if (!cc) {
+        setErrorCode(IOEX_GENERAL_ERROR(IOEXERR_WRONG_STATE));
+        return JNI_FALSE;
+    }
+
+    for (i = 0; i < STREAM_STAT_COUNT; i++)
+        stats[i] = (jlong)__atomic_load_n(&cc->stats[i], __ATOMIC_RELAXED);
+
+    (*env)->SetLongArrayRegion(env, jstats, 0, STREAM_STAT_COUNT, stats);
+    return JNI_TRUE;
+}
+
 static
 jint getErrorCode(JNIEnv* env, jclass clazz)
 {
@@ -292,16 +860,34 @@ jint getErrorCode(JNIEnv* env, jclass clazz)
 
 static const char* gClassName = "org/ioex/carrier/session/Stream";
 static JNINativeMethod gMethods[] = {
-        {"get_transport_info",    "(I"_S("TransportInfo;)Z"),      (void*)getTransportInfo },
-        {"write_stream_data",     "(I[BII)I",                      (void*)writeData        },
+        {"get_transport_info",    "(I)"_S("TransportInfo;"),       (void*)getTransportInfo },
+        {"write_data",            "(JJII[BII)I",                   (void*)writeData        },
+        {"write_direct",          "(JJIILjava/nio/ByteBuffer;II)I", (void*)writeDirectData },
+        {"write_batch",           "(JJI[I[B[I[I[I)I",              (void*)writeBatch       },
+        {"write_batch_direct",    "(JJI[ILjava/nio/ByteBuffer;[I[I[I)I",
+                                                                    (void*)writeDirectBatch },
         {"open_channel",          "(I"_J("String;)I"),             (void*)openChannel      },
         {"close_channel",         "(II)Z",                         (void*)closeChannel     },
-        {"write_channel_data",    "(II[BII)I",                     (void*)writeDataToChannel },
         {"pend_channel",          "(II)Z",                         (void*)pendChannel      },
         {"resume_channel",        "(II)Z",                         (void*)resumeChannel    },
         {"open_port_forwarding",  "(I"_J("String;")_S("PortForwardingProtocol;")_J("String;")_J("String;)I"),
                                                                     (void*)openPortForwarding },
         {"close_port_forwarding", "(II)Z",                         (void*)closePortForwarding },
+        {"set_receive_pool",      "(II)Z",                         (void*)setReceiveBufferPool },
+        {"set_data_batching",     "(III)Z",                        (void*)setDataBatching  },
+        {"set_send_queue",        "(III)Z",                        (void*)setSendQueue     },
+        {"release_send_queue",    "()V",                           (void*)releaseSendQueue },
+        {"close_context",         "()V",                           (void*)closeContext     },
+        {"release_context",       "()V",                           (void*)releaseContext   },
+        {"get_queued_bytes",      "(I)J",                          (void*)getQueuedBytes   },
+        {"is_channel_writable",   "(I)Z",                          (void*)isChannelWritable },
+        {"set_channel_schedule",  "(III)Z",                        (void*)setChannelSchedule },
+        {"get_channel_queue_stats", "(I[J)Z",                      (void*)getChannelQueueStats },
+        {"set_rate_limit",        "(IJI)Z",                        (void*)setRateLimit     },
+        {"set_global_rate_limit", "(JI)V",                         (void*)setGlobalRateLimit },
+        {"recycle_buffer",        "(Ljava/nio/ByteBuffer;)Z",      (void*)recycleBuffer    },
+        {"get_receive_pool_stats","()[J",                          (void*)getBufferPoolStats },
+        {"get_stats",             "([J)Z",                          (void*)getStreamStats   },
         {"get_error_code",        "()I",                            (void*)getErrorCode     },
 };
 
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "utils.h"
+#include "jniCache.h"
+#include "upcallStats.h"
+#include "streamBatch.h"
+
+struct StreamBatch {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    pthread_t flusher;
+    int flusherStarted;
+    int stopped;
+
+    jobject stream;
+    jobject handler;
+
+    int maxBytes;
+    int maxCount;
+    int maxDelayMs;
+
+    uint8_t* data;
+    jobject  jdata;
+    jint*    offsets;
+    jintArray joffsets;
+
+    int used;
+    int count;
+    struct timespec deadline;
+};
+
+static
+void deadlineAfter(struct timespec* ts, int delayMs)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+
+    ts->tv_sec  += delayMs / 1000;
+    ts->tv_nsec += (long)(delayMs % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static
+int deadlinePassed(const struct timespec* ts)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec > ts->tv_sec) ||
+           (now.tv_sec == ts->tv_sec && now.tv_nsec >= ts->tv_nsec);
+}
+
+/* Called with batch->lock held. */
+static
+void flushLocked(StreamBatch* batch, JNIEnv* env)
+{
+    if (batch->count == 0)
+        return;
+
+    batch->offsets[batch->count] = batch->used;
+    (*env)->SetIntArrayRegion(env, batch->joffsets, 0, batch->count + 1, batch->offsets);
+
+    if (!callVoidUpcall(env, UPCALL_STREAM_DATA_BATCH, batch->handler,
+                        gJni.batchStreamHandler.onStreamDataBatch,
+                        batch->stream, batch->jdata, batch->joffsets, (jint)batch->count)) {
+        logE("Invoke java callback 'void onStreamDataBatch(Stream, ByteBuffer, int[], int)' error");
+    }
+
+    batch->used = 0;
+    batch->count = 0;
+}
+
+static
+void* flusherRoutine(void* arg)
+{
+    StreamBatch* batch = (StreamBatch*)arg;
+    int needDetach = 0;
+    JNIEnv* env;
+
+    env = attachJvm(&needDetach);
+    if (!env) {
+        logE("Attach batch flusher thread to JVM error");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    while (!batch->stopped) {
+        if (batch->count == 0) {
+            pthread_cond_wait(&batch->cond, &batch->lock);
+            continue;
+        }
+
+        if (!deadlinePassed(&batch->deadline)) {
+            pthread_cond_timedwait(&batch->cond, &batch->lock, &batch->deadline);
+            continue;
+        }
+
+        flushLocked(batch, env);
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    detachJvm(env, needDetach);
+    return NULL;
+}
+
+StreamBatch* streamBatchCreate(JNIEnv* env, jobject jstream, jobject jhandler,
+                               int maxBytes, int maxCount, int maxDelayMs)
+{
+    StreamBatch* batch;
+    pthread_condattr_t attr;
+    jobject ldata;
+    jintArray loffsets;
+
+    assert(maxBytes > 0);
+    assert(maxCount > 0);
+    assert(maxDelayMs >= 0);
+
+    batch = (StreamBatch*)calloc(1, sizeof(*batch));
+    if (!batch)
+        return NULL;
+
+    batch->stream = jstream;
+    batch->handler = jhandler;
+    batch->maxBytes = maxBytes;
+    batch->maxCount = maxCount;
+    batch->maxDelayMs = maxDelayMs;
+
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&batch->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    batch->data = (uint8_t*)malloc((size_t)maxBytes);
+    batch->offsets = (jint*)calloc((size_t)maxCount + 1, sizeof(jint));
+    if (!batch->data || !batch->offsets)
+        goto errorExit;
+
+    ldata = (*env)->NewDirectByteBuffer(env, batch->data, (jlong)maxBytes);
+    loffsets = ldata ? (*env)->NewIntArray(env, maxCount + 1) : NULL;
+    if (!ldata || !loffsets) {
+        if (ldata) (*env)->DeleteLocalRef(env, ldata);
+        goto errorExit;
+    }
+
+    batch->jdata = (*env)->NewGlobalRef(env, ldata);
+    batch->joffsets = (*env)->NewGlobalRef(env, loffsets);
+    (*env)->DeleteLocalRef(env, ldata);
+    (*env)->DeleteLocalRef(env, loffsets);
+    if (!batch->jdata || !batch->joffsets)
+        goto errorExit;
+
+    if (maxDelayMs > 0) {
+        if (pthread_create(&batch->flusher, NULL, flusherRoutine, batch) != 0) {
+            logE("Create stream batch flusher thread error");
+            goto errorExit;
+        }
+        batch->flusherStarted = 1;
+    }
+
+    return batch;
+
+errorExit:
+    streamBatchDestroy(batch, env);
+    return NULL;
+}
+
+void streamBatchDestroy(StreamBatch* batch, JNIEnv* env)
+{
+    if (!batch)
+        return;
+
+    pthread_mutex_lock(&batch->lock);
+    batch->stopped = 1;
+    pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+
+    if (batch->flusherStarted)
+        pthread_join(batch->flusher, NULL);
+
+    if (batch->jdata && batch->joffsets) {
+        pthread_mutex_lock(&batch->lock);
+        flushLocked(batch, env);
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    if (batch->jdata)
+        (*env)->DeleteGlobalRef(env, batch->jdata);
+    if (batch->joffsets)
+        (*env)->DeleteGlobalRef(env, batch->joffsets);
+    if (batch->data)
+        free(batch->data);
+    if (batch->offsets)
+        free(batch->offsets);
+
+    pthread_cond_destroy(&batch->cond);
+    pthread_mutex_destroy(&batch->lock);
+    free(batch);
+}
+
+int streamBatchAppend(StreamBatch* batch, JNIEnv* env, const void* data, size_t len)
+{
+    assert(batch);
+
+    pthread_mutex_lock(&batch->lock);
+
+    if (len > (size_t)batch->maxBytes) {
+        // Keep ordering: whatever is pending goes out before this packet.
+        flushLocked(batch, env);
+        pthread_mutex_unlock(&batch->lock);
+        return 0;
+    }
+
+    if (batch->used + len > (size_t)batch->maxBytes)
+        flushLocked(batch, env);
+
+    memcpy(batch->data + batch->used, data, len);
+    batch->offsets[batch->count++] = batch->used;
+    batch->used += (int)len;
+
+    if (batch->count >= batch->maxCount || batch->used >= batch->maxBytes) {
+        flushLocked(batch, env);
+    } else if (batch->count == 1 && batch->maxDelayMs > 0) {
+        deadlineAfter(&batch->deadline, batch->maxDelayMs);
+        pthread_cond_signal(&batch->cond);
+    }
+
+    pthread_mutex_unlock(&batch->lock);
+    return 1;
+}
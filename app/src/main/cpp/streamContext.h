@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __STREAM_CONTEXT_H__
+#define __STREAM_CONTEXT_H__
+
+#include <jni.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "bufferPool.h"
+#include "streamBatch.h"
+#include "sendQueue.h"
+
+/*
+ * Traffic counters of a stream, in the order org.ioex.carrier.session
+ * .StreamStats reads them. Pend and resume count both local requests and
+ * notifications from the peer.
+ */
+enum {
+    STREAM_STAT_BYTES_IN = 0,
+    STREAM_STAT_PACKETS_IN,
+    STREAM_STAT_BYTES_OUT,
+    STREAM_STAT_PACKETS_OUT,
+    STREAM_STAT_PARTIAL_WRITES,
+    STREAM_STAT_WRITE_ERRORS,
+    STREAM_STAT_CALLBACK_ERRORS,
+    STREAM_STAT_PENDS,
+    STREAM_STAT_RESUMES,
+    STREAM_STAT_QUEUED_WRITES,
+    STREAM_STAT_COUNT
+};
+
+typedef struct CallbackContext {
+    JNIEnv* env;
+    jobject object;
+    jobject handler;
+
+    /* Optional receive buffer pool, set by Stream.setReceiveBufferPool() */
+    BufferPool* pool;
+
+    /* Optional data batching, set by Stream.setDataBatching() */
+    StreamBatch* batch;
+
+    /* Optional channel send queues, set by Stream.setSendQueue() */
+    SendQueue* sendQueue;
+
+    /* Updated from transport and java threads without locking */
+    uint64_t stats[STREAM_STAT_COUNT];
+
+    /*
+     * Set once the stream is removed or its session closed. The lock
+     * orders it against the natives that configure the stream and use
+     * the handler, which fail from then on.
+     */
+    pthread_mutex_t lock;
+    int closed;
+} CallbackContext;
+
+/*
+ * Stop the context of a removed stream: nothing reaches java through it
+ * any more and its global references are dropped, so the Stream can be
+ * collected. The memory stays until streamContextFree(), since java
+ * threads still holding the Stream may write through it.
+ */
+void streamContextClose(CallbackContext* cc, JNIEnv* env);
+
+/* Free the context, once its Stream has been collected. */
+void streamContextFree(CallbackContext* cc, JNIEnv* env);
+
+static inline
+BufferPool* getReceivePool(CallbackContext* cc)
+{
+    return __atomic_load_n(&cc->pool, __ATOMIC_ACQUIRE);
+}
+
+static inline
+StreamBatch* getStreamBatch(CallbackContext* cc)
+{
+    return __atomic_load_n(&cc->batch, __ATOMIC_ACQUIRE);
+}
+
+static inline
+SendQueue* getSendQueue(CallbackContext* cc)
+{
+    return __atomic_load_n(&cc->sendQueue, __ATOMIC_ACQUIRE);
+}
+
+/* Detach the send queue from the stream, for its owner to destroy. */
+static inline
+SendQueue* takeSendQueue(CallbackContext* cc)
+{
+    return __atomic_exchange_n(&cc->sendQueue, NULL, __ATOMIC_ACQ_REL);
+}
+
+static inline
+void streamStatsAdd(CallbackContext* cc, int stat, uint64_t value)
+{
+    __atomic_fetch_add(&cc->stats[stat], value, __ATOMIC_RELAXED);
+}
+
+static inline
+void streamStatsReceived(CallbackContext* cc, size_t len)
+{
+    streamStatsAdd(cc, STREAM_STAT_BYTES_IN, len);
+    streamStatsAdd(cc, STREAM_STAT_PACKETS_IN, 1);
+}
+
+/* Account one write of len bytes that returned bytes, or -1 on error. */
+static inline
+void streamStatsWritten(CallbackContext* cc, size_t len, ssize_t bytes)
+{
+    if (!cc)
+        return;
+
+    if (bytes < 0) {
+        streamStatsAdd(cc, STREAM_STAT_WRITE_ERRORS, 1);
+        return;
+    }
+
+    streamStatsAdd(cc, STREAM_STAT_BYTES_OUT, (uint64_t)bytes);
+    streamStatsAdd(cc, STREAM_STAT_PACKETS_OUT, 1);
+    if ((size_t)bytes < len)
+        streamStatsAdd(cc, STREAM_STAT_PARTIAL_WRITES, 1);
+}
+
+#endif //__STREAM_CONTEXT_H__
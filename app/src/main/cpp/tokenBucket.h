@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __TOKEN_BUCKET_H__
+#define __TOKEN_BUCKET_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A token bucket refilled at rate bytes per second up to burst bytes, used
+ * to pace sends. A rate of 0 means no limit. It is not locked: its owner
+ * serializes access.
+ */
+typedef struct TokenBucket {
+    int64_t rate;
+    int64_t burst;
+    double tokens;
+    int64_t last;
+} TokenBucket;
+
+static inline
+void tokenBucketSet(TokenBucket* tb, int64_t rate, int64_t burst, int64_t now)
+{
+    tb->rate = rate;
+    tb->burst = rate > 0 ? burst : 0;
+    tb->tokens = (double)tb->burst;
+    tb->last = now;
+}
+
+static inline
+int tokenBucketLimited(const TokenBucket* tb)
+{
+    return tb->rate > 0;
+}
+
+/* Refill the bucket up to now, and return the whole tokens in it. */
+static inline
+int64_t tokenBucketRefill(TokenBucket* tb, int64_t now)
+{
+    if (now > tb->last) {
+        tb->tokens += (double)(now - tb->last) * (double)tb->rate / 1e9;
+        if (tb->tokens > (double)tb->burst)
+            tb->tokens = (double)tb->burst;
+        tb->last = now;
+    }
+    return (int64_t)tb->tokens;
+}
+
+static inline
+void tokenBucketTake(TokenBucket* tb, size_t bytes)
+{
+    tb->tokens -= (double)bytes;
+}
+
+/* Nanoseconds until the bucket holds want tokens, as of its last refill. */
+static inline
+int64_t tokenBucketDelay(const TokenBucket* tb, int64_t want)
+{
+    double missing = (double)want - tb->tokens;
+
+    return missing > 0 ? (int64_t)(missing * 1e9 / (double)tb->rate) + 1 : 0;
+}
+
+#endif //__TOKEN_BUCKET_H__
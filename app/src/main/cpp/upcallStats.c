@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "upcallStats.h"
+
+typedef struct UpcallHistogram {
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint64_t buckets[UPCALL_BUCKETS];
+} UpcallHistogram;
+
+/*
+ * The upcall a thread is in now. begin is 0 between upcalls; an upcall
+ * made from inside another only bumps depth, the outermost one is the
+ * one watched. Only the owning thread writes a slot, the watchdog reads
+ * it under gWatchdog.lock, which keeps it alive.
+ */
+typedef struct UpcallSlot {
+    struct UpcallSlot* next;
+    int depth;
+    int type;
+    int64_t begin;
+    int64_t reported;
+} UpcallSlot;
+
+static UpcallHistogram gHistograms[UPCALL_COUNT];
+static int64_t gSlowThresholdNs = (int64_t)UPCALL_DEFAULT_SLOW_MS * 1000000;
+
+/*
+ * Watchdog over the slots of all threads that made an upcall: an upcall
+ * still running past the slow threshold is reported once, so a handler
+ * that hangs is visible even though upcallEnd() never runs for it.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int started;
+    int stopped;
+
+    UpcallSlot* slots;
+} gWatchdog = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static pthread_key_t  gSlotKey;
+static pthread_once_t gSlotKeyOnce = PTHREAD_ONCE_INIT;
+static __thread UpcallSlot* tSlot = NULL;
+
+static const char* gNames[UPCALL_COUNT] = {
+    "onIdle",
+    "onConnection",
+    "onReady",
+    "onSelfInfoChanged",
+    "onFriends",
+    "onFriendConnection",
+    "onFriendInfoChanged",
+    "onFriendPresence",
+    "onFriendRequest",
+    "onFriendAdded",
+    "onFriendRemoved",
+    "onFriendMessage",
+    "onFriendInviteRequest",
+    "onFriendInviteResponse",
+    "onFriendFileRequest",
+    "onFriendFileAccepted",
+    "onFriendFilePaused",
+    "onFriendFileResumed",
+    "onFriendFileCanceled",
+    "onFriendFileCompleted",
+    "onFriendFileProgress",
+    "onFriendFileQueried",
+    "onSessionRequest",
+    "onSessionRequestComplete",
+    "onStateChanged",
+    "onStreamData",
+    "onStreamDataBatch",
+    "onChannelOpen",
+    "onChannelOpened",
+    "onChannelClose",
+    "onChannelData",
+    "onChannelPending",
+    "onChannelResume",
+    "onChannelWritabilityChanged"
+};
+
+static inline
+int bucketOf(uint64_t ns)
+{
+    int bucket;
+
+    if (!ns)
+        return 0;
+
+    bucket = 64 - __builtin_clzll(ns);
+    return bucket < UPCALL_BUCKETS ? bucket : UPCALL_BUCKETS - 1;
+}
+
+static
+int64_t nowNanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static
+void* watchdogRoutine(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&gWatchdog.lock);
+    while (!gWatchdog.stopped) {
+        int64_t threshold = __atomic_load_n(&gSlowThresholdNs, __ATOMIC_RELAXED);
+        int64_t now, wakeAt;
+        struct timespec deadline;
+        UpcallSlot* slot;
+
+        if (threshold <= 0) {
+            pthread_cond_wait(&gWatchdog.cond, &gWatchdog.lock);
+            continue;
+        }
+
+        now = nowNanos();
+        for (slot = gWatchdog.slots; slot; slot = slot->next) {
+            int64_t begin = __atomic_load_n(&slot->begin, __ATOMIC_ACQUIRE);
+            int type = __atomic_load_n(&slot->type, __ATOMIC_RELAXED);
+
+            if (!begin || begin == slot->reported || now - begin < threshold)
+                continue;
+
+            // The type read must belong to this same upcall.
+            if (__atomic_load_n(&slot->begin, __ATOMIC_ACQUIRE) != begin)
+                continue;
+
+            slot->reported = begin;
+            logW("Callback %s still running after %lld ms", gNames[type],
+                 (long long)((now - begin) / 1000000));
+        }
+
+        // Looking four times per threshold reports a hung upcall at most
+        // a quarter of the threshold late.
+        wakeAt = now + (threshold / 4 > 1000000 ? threshold / 4 : 1000000);
+        deadline.tv_sec = (time_t)(wakeAt / 1000000000LL);
+        deadline.tv_nsec = (long)(wakeAt % 1000000000LL);
+        pthread_cond_timedwait(&gWatchdog.cond, &gWatchdog.lock, &deadline);
+    }
+    pthread_mutex_unlock(&gWatchdog.lock);
+
+    return NULL;
+}
+
+/* Called with gWatchdog.lock held. */
+static
+void startWatchdogLocked(void)
+{
+    pthread_condattr_t attr;
+
+    if (gWatchdog.started || gWatchdog.stopped)
+        return;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gWatchdog.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&gWatchdog.thread, NULL, watchdogRoutine, NULL) != 0) {
+        logE("Create upcall watchdog thread error");
+        pthread_cond_destroy(&gWatchdog.cond);
+        gWatchdog.stopped = 1;
+        return;
+    }
+
+    gWatchdog.started = 1;
+}
+
+static
+void releaseSlot(void* value)
+{
+    UpcallSlot* slot = (UpcallSlot*)value;
+    UpcallSlot** link;
+
+    pthread_mutex_lock(&gWatchdog.lock);
+    for (link = &gWatchdog.slots; *link; link = &(*link)->next) {
+        if (*link == slot) {
+            *link = slot->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gWatchdog.lock);
+
+    if (tSlot == slot)
+        tSlot = NULL;
+    free(slot);
+}
+
+static
+void createSlotKey(void)
+{
+    if (pthread_key_create(&gSlotKey, releaseSlot) != 0)
+        logE("Create pthread key for upcall slots error");
+}
+
+/* The calling thread's slot, registered with the watchdog on first use. */
+static
+UpcallSlot* threadSlot(void)
+{
+    UpcallSlot* slot = tSlot;
+
+    if (slot)
+        return slot;
+
+    pthread_once(&gSlotKeyOnce, createSlotKey);
+
+    slot = (UpcallSlot*)calloc(1, sizeof(*slot));
+    if (!slot)
+        return NULL;
+
+    if (pthread_setspecific(gSlotKey, slot) != 0) {
+        free(slot);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&gWatchdog.lock);
+    slot->next = gWatchdog.slots;
+    gWatchdog.slots = slot;
+    startWatchdogLocked();
+    pthread_mutex_unlock(&gWatchdog.lock);
+
+    tSlot = slot;
+    return slot;
+}
+
+int64_t upcallBegin(int type)
+{
+    UpcallSlot* slot;
+    int64_t begin;
+
+    assert(type >= 0 && type < UPCALL_COUNT);
+
+    begin = nowNanos();
+
+    slot = threadSlot();
+    if (slot && slot->depth++ == 0) {
+        __atomic_store_n(&slot->type, type, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->begin, begin, __ATOMIC_RELEASE);
+    }
+
+    return begin;
+}
+
+void upcallEnd(int type, int64_t begin)
+{
+    UpcallHistogram* h;
+    int64_t elapsed;
+    int64_t threshold;
+    uint64_t max;
+
+    assert(type >= 0 && type < UPCALL_COUNT);
+
+    if (tSlot && tSlot->depth > 0 && --tSlot->depth == 0)
+        __atomic_store_n(&tSlot->begin, 0, __ATOMIC_RELEASE);
+
+    elapsed = nowNanos() - begin;
+    if (elapsed < 0)
+        elapsed = 0;
+
+    h = &gHistograms[type];
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->totalNs, (uint64_t)elapsed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->buckets[bucketOf((uint64_t)elapsed)], 1, __ATOMIC_RELAXED);
+
+    max = __atomic_load_n(&h->maxNs, __ATOMIC_RELAXED);
+    while ((uint64_t)elapsed > max &&
+           !__atomic_compare_exchange_n(&h->maxNs, &max, (uint64_t)elapsed, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    threshold = __atomic_load_n(&gSlowThresholdNs, __ATOMIC_RELAXED);
+    if (threshold > 0 && elapsed >= threshold)
+        logW("Slow callback %s took %lld ms", gNames[type],
+             (long long)(elapsed / 1000000));
+}
+
+const char* upcallName(int type)
+{
+    assert(type >= 0 && type < UPCALL_COUNT);
+    return gNames[type];
+}
+
+void upcallStatsSetSlowThreshold(int ms)
+{
+    __atomic_store_n(&gSlowThresholdNs, ms > 0 ? (int64_t)ms * 1000000 : 0,
+                     __ATOMIC_RELAXED);
+
+    // Let the watchdog pick up the new period, or go idle at 0.
+    pthread_mutex_lock(&gWatchdog.lock);
+    if (gWatchdog.started)
+        pthread_cond_broadcast(&gWatchdog.cond);
+    pthread_mutex_unlock(&gWatchdog.lock);
+}
+
+void upcallStatsGet(int64_t* values)
+{
+    int i, j;
+
+    assert(values);
+
+    for (i = 0; i < UPCALL_COUNT; i++) {
+        UpcallHistogram* h = &gHistograms[i];
+        int64_t* v = values + i * UPCALL_STATS_STRIDE;
+
+        v[0] = (int64_t)__atomic_load_n(&h->count, __ATOMIC_RELAXED);
+        v[1] = (int64_t)__atomic_load_n(&h->totalNs, __ATOMIC_RELAXED);
+        v[2] = (int64_t)__atomic_load_n(&h->maxNs, __ATOMIC_RELAXED);
+        for (j = 0; j < UPCALL_BUCKETS; j++)
+            v[3 + j] = (int64_t)__atomic_load_n(&h->buckets[j], __ATOMIC_RELAXED);
+    }
+}
+
+void upcallStatsShutdown(void)
+{
+    int started;
+
+    pthread_mutex_lock(&gWatchdog.lock);
+    gWatchdog.stopped = 1;
+    started = gWatchdog.started;
+    if (started)
+        pthread_cond_broadcast(&gWatchdog.cond);
+    pthread_mutex_unlock(&gWatchdog.lock);
+
+    if (started) {
+        pthread_join(gWatchdog.thread, NULL);
+        pthread_cond_destroy(&gWatchdog.cond);
+        gWatchdog.started = 0;
+    }
+}
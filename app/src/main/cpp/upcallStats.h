@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef __UPCALL_STATS_H__
+#define __UPCALL_STATS_H__
+
+#include <stdint.h>
+
+/*
+ * Latency of every native to java callback, kept per callback type in
+ * power of two histograms: bucket i counts upcalls that took less than
+ * 2^i nanoseconds (and at least 2^(i-1)), the last bucket takes the rest.
+ *
+ * Stream callbacks have no link to their carrier, so the statistics are
+ * process wide. An upcall running longer than the slow threshold is
+ * reported with a warning by a watchdog thread while it is still running,
+ * so a handler that never returns shows up too, and again once it returns.
+ */
+enum {
+    UPCALL_IDLE = 0,
+    UPCALL_CONNECTION,
+    UPCALL_READY,
+    UPCALL_SELF_INFO_CHANGED,
+    UPCALL_FRIENDS,
+    UPCALL_FRIEND_CONNECTION,
+    UPCALL_FRIEND_INFO_CHANGED,
+    UPCALL_FRIEND_PRESENCE,
+    UPCALL_FRIEND_REQUEST,
+    UPCALL_FRIEND_ADDED,
+    UPCALL_FRIEND_REMOVED,
+    UPCALL_FRIEND_MESSAGE,
+    UPCALL_FRIEND_INVITE_REQUEST,
+    UPCALL_FRIEND_INVITE_RESPONSE,
+    UPCALL_FILE_REQUEST,
+    UPCALL_FILE_ACCEPTED,
+    UPCALL_FILE_PAUSED,
+    UPCALL_FILE_RESUMED,
+    UPCALL_FILE_CANCELED,
+    UPCALL_FILE_COMPLETED,
+    UPCALL_FILE_PROGRESS,
+    UPCALL_FILE_QUERIED,
+    UPCALL_SESSION_REQUEST,
+    UPCALL_SESSION_REQUEST_COMPLETE,
+    UPCALL_STREAM_STATE,
+    UPCALL_STREAM_DATA,
+    UPCALL_STREAM_DATA_BATCH,
+    UPCALL_CHANNEL_OPEN,
+    UPCALL_CHANNEL_OPENED,
+    UPCALL_CHANNEL_CLOSE,
+    UPCALL_CHANNEL_DATA,
+    UPCALL_CHANNEL_PENDING,
+    UPCALL_CHANNEL_RESUME,
+    UPCALL_CHANNEL_WRITABILITY,
+    UPCALL_COUNT
+};
+
+#define UPCALL_BUCKETS          32
+
+/* Exported values per callback type: count, total ns, max ns, buckets */
+#define UPCALL_STATS_STRIDE     (3 + UPCALL_BUCKETS)
+
+#define UPCALL_DEFAULT_SLOW_MS  100
+
+/*
+ * Mark an upcall of type as in flight on the calling thread, where the
+ * watchdog can see it. Returns its start time, to pass to upcallEnd().
+ */
+int64_t upcallBegin(int type);
+
+/* Record one upcall of type that started at begin, as returned by upcallBegin(). */
+void upcallEnd(int type, int64_t begin);
+
+const char* upcallName(int type);
+
+/* Warn about upcalls running longer than ms milliseconds, 0 disables. */
+void upcallStatsSetSlowThreshold(int ms);
+
+/* Fill values with UPCALL_COUNT * UPCALL_STATS_STRIDE entries. */
+void upcallStatsGet(int64_t* values);
+
+/* Stop the watchdog thread, if it was started. */
+void upcallStatsShutdown(void);
+
+#endif //__UPCALL_STATS_H__
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+* Copyright (c) 2019 ioeXNetwork
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+
+// UTF8_SCALAR_ONLY builds the portable path alone, so tests can check it
+// on hosts that also have a vector unit.
+#if defined(UTF8_SCALAR_ONLY)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define UTF8_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UTF8_SSE2
+#endif
+
+#include "utf8.h"
+
+#define REPLACEMENT_CHAR    0xFFFD
+
+/* Strings up to this many UTF-16 units are transcoded on the stack. */
+#define STACK_UNITS         1024
+
+#if defined(UTF8_NEON) && !defined(__aarch64__)
+static inline
+int hasHighBit(uint8x16_t v)
+{
+    uint8x8_t r = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+
+    r = vpmax_u8(r, r);
+    r = vpmax_u8(r, r);
+    r = vpmax_u8(r, r);
+    return vget_lane_u8(r, 0) >= 0x80;
+}
+#endif
+
+/*
+ * Widens the leading ASCII bytes, up to the first non-ASCII or NUL byte,
+ * 16 at a time. Returns the number of bytes consumed, which is also the
+ * number of units written. A block is always stored whole: units never
+ * outrun bytes, so the tail of the store still lands inside out.
+ */
+static inline
+size_t widenAscii(const uint8_t* in, size_t length, jchar* out)
+{
+    size_t i = 0;
+
+#if defined(UTF8_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        int mask;
+
+        _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(out + i + 8), _mm_unpackhi_epi8(v, zero));
+
+        // NUL bytes compare to 0xFF, so either case sets a high bit.
+        mask = _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+        if (mask)
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+#elif defined(UTF8_NEON)
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t v = vld1q_u8(in + i);
+        uint8x16_t stop = vorrq_u8(v, vceqq_u8(v, vdupq_n_u8(0)));
+
+        vst1q_u16((uint16_t*)(out + i), vmovl_u8(vget_low_u8(v)));
+        vst1q_u16((uint16_t*)(out + i + 8), vmovl_u8(vget_high_u8(v)));
+
+#ifdef __aarch64__
+        {
+            // One nibble per byte, set where the byte stops the run.
+            uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_s8(
+                    vshrq_n_s8(vreinterpretq_s8_u8(stop), 7)), 4);
+            uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+
+            if (mask)
+                return i + (size_t)(__builtin_ctzll(mask) >> 2);
+        }
+#else
+        if (hasHighBit(stop))
+            break;
+#endif
+    }
+#else
+    (void)in;
+    (void)length;
+    (void)out;
+#endif
+
+    return i;
+}
+
+size_t utf8ToUtf16(const uint8_t* utf8, size_t length, jchar* out)
+{
+    const uint8_t* p = utf8;
+    const uint8_t* end = utf8 + length;
+    jchar* o = out;
+
+    while (p < end) {
+        uint32_t c;
+        uint8_t lo = 0x80, hi = 0xBF;
+        int need, i;
+
+        // Single ASCII bytes between other scripts are not worth a vector.
+        if (*p < 0x80 && p + 1 < end && p[1] < 0x80) {
+            size_t n = widenAscii(p, (size_t)(end - p), o);
+
+            p += n;
+            o += n;
+            if (p >= end)
+                break;
+        }
+
+        c = *p;
+        if (c == 0)
+            break;
+
+        if (c < 0x80) {
+            *o++ = (jchar)c;
+            p++;
+            continue;
+        }
+
+        // Bounds of the second byte exclude overlongs, surrogates and
+        // code points above U+10FFFF.
+        if (c >= 0xC2 && c <= 0xDF) {
+            need = 1;
+            c &= 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            need = 2;
+            if (c == 0xE0) lo = 0xA0;
+            if (c == 0xED) hi = 0x9F;
+            c &= 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            need = 3;
+            if (c == 0xF0) lo = 0x90;
+            if (c == 0xF4) hi = 0x8F;
+            c &= 0x07;
+        } else {
+            *o++ = REPLACEMENT_CHAR;
+            p++;
+            continue;
+        }
+
+        // On error skip the lead byte and the continuation bytes that
+        // were valid so far, as one replacement character.
+        for (i = 1; i <= need; i++) {
+            if (p + i >= end || p[i] < lo || p[i] > hi)
+                break;
+            c = (c << 6) | (p[i] & 0x3F);
+            lo = 0x80;
+            hi = 0xBF;
+        }
+        if (i <= need) {
+            *o++ = REPLACEMENT_CHAR;
+            p += i;
+            continue;
+        }
+        p += i;
+
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            *o++ = (jchar)(0xD800 + (c >> 10));
+            *o++ = (jchar)(0xDC00 + (c & 0x3FF));
+        } else {
+            *o++ = (jchar)c;
+        }
+    }
+
+    return (size_t)(o - out);
+}
+
+jstring newStringFromUtf8(JNIEnv* env, const void* utf8, size_t length)
+{
+    jchar stackUnits[STACK_UNITS];
+    jchar* units = stackUnits;
+    jstring jstr;
+    size_t count;
+
+    if (length > STACK_UNITS) {
+        units = (jchar*)malloc(length * sizeof(jchar));
+        if (!units)
+            return NULL;
+    }
+
+    count = utf8ToUtf16((const uint8_t*)utf8, length, units);
+    jstr = (*env)->NewString(env, units, (jsize)count);
+
+    if (units != stackUnits)
+        free(units);
+    return jstr;
+}
@@ -45,8 +45,11 @@
 #include <jni.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "utils.h"
 #include "log.h"
+#include "upcallStats.h"
 
 static __thread int jniErrorCode;
 
@@ -62,9 +65,42 @@ int _getErrorCode(void)
 
 static JavaVM* javaVm = NULL;
 
+/*
+ * Native threads are attached to the JVM once, on their first callback, and
+ * stay attached until they exit: the pthread key destructor detaches them.
+ * Later callbacks on the same thread only read the cached JNIEnv from TLS.
+ */
+static pthread_key_t  gEnvKey;
+static pthread_once_t gEnvKeyOnce = PTHREAD_ONCE_INIT;
+static __thread JNIEnv* tEnv = NULL;
+static uint64_t gAttachCount = 0;
+
+static
+void detachThread(void* value)
+{
+    (void)value;
+
+    tEnv = NULL;
+    if (javaVm)
+        (*javaVm)->DetachCurrentThread(javaVm);
+}
+
+static
+void createEnvKey(void)
+{
+    if (pthread_key_create(&gEnvKey, detachThread) != 0)
+        logE("Create pthread key for JNIEnv error");
+}
+
 void setJvm(JavaVM* vm)
 {
     javaVm = vm;
+    pthread_once(&gEnvKeyOnce, createEnvKey);
+}
+
+uint64_t getJvmAttachCount(void)
+{
+    return __atomic_load_n(&gAttachCount, __ATOMIC_RELAXED);
 }
 
 JNIEnv* attachJvm(int* newlyAttached)
@@ -75,10 +111,12 @@ JNIEnv* attachJvm(int* newlyAttached)
     assert(javaVm != NULL);
     *newlyAttached = 0;
 
+    if (tEnv)
+        return tEnv;
+
     result = (*javaVm)->GetEnv(javaVm, (void**)&env, JNI_VERSION_1_6);
     switch(result) {
         case JNI_OK:
-            logD("Already attached JVM");
             break;
 
         case JNI_EVERSION:
@@ -89,11 +127,21 @@ JNIEnv* attachJvm(int* newlyAttached)
             result = (*javaVm)->AttachCurrentThread(javaVm, &env, NULL);
             if (result != JNI_OK) {
                 logE("Attach current thread to JVM error (%d)", result);
+                env = NULL;
+                break;
+            }
+
+            __atomic_add_fetch(&gAttachCount, 1, __ATOMIC_RELAXED);
+            logV("Attached current thread to JVM in success");
+
+            if (pthread_setspecific(gEnvKey, env) == 0) {
+                tEnv = env;
             } else {
-                logV("Attached current thread to JVM in success");
+                logW("Cache JNIEnv for current thread error, detach per callback");
                 *newlyAttached = 1;
             }
             break;
+
         case JNI_ERR:
         default:
             logE("Get JNIEnv for current thread error");
@@ -126,104 +174,128 @@ int registerNativeMethods(JNIEnv* env, const char* clazzName, JNINativeMethod* m
 }
 
 static
-jmethodID getMethod(JNIEnv* env, jclass jcls, jobject jobj, const char* methodName, const char* sig)
-{
-    jclass clazz = jcls;
-    if (!clazz) {
-        clazz = (*env)->GetObjectClass(env, jobj);
-        if (!clazz) {
-            return NULL;
-        }
+int checkException(JNIEnv* env, jmethodID method)
+{
+    if ((*env)->ExceptionCheck(env)) {
+        logE("Java exception thrown from method %p", method);
+        (*env)->ExceptionDescribe(env);
+        (*env)->ExceptionClear(env);
+        return 0;
     }
+    return 1;
+}
 
-    jmethodID method = (*env)->GetMethodID(env, clazz, methodName, sig);
-    if (!method) {
-        logE("Get method %s with signature:%s error", methodName, sig);
-        return NULL;
-    }
-    return method;
+int callVoidMethod(JNIEnv* env, jobject jobj, jmethodID method, ...)
+{
+    va_list args;
+
+    assert(method);
+
+    va_start(args, method);
+    (*env)->CallVoidMethodV(env, jobj, method, args);
+    va_end(args);
+    return checkException(env, method);
 }
 
-int callVoidMethod(JNIEnv* env, jclass jcls, jobject jobj, const char* methodName,
-        const char* sig, ...)
+int callVoidUpcall(JNIEnv* env, int upcall, jobject jobj, jmethodID method, ...)
 {
-    jmethodID method = getMethod(env, jcls, jobj, methodName, sig);
-    if (method) {
-        va_list args;
-        va_start(args, sig);
-        (*env)->CallVoidMethodV(env, jobj, method, args);
-        va_end(args);
-        return 1;
-    }
-    return 0;
+    va_list args;
+    int64_t begin;
+
+    assert(method);
+
+    va_start(args, method);
+    begin = upcallBegin(upcall);
+    (*env)->CallVoidMethodV(env, jobj, method, args);
+    upcallEnd(upcall, begin);
+    va_end(args);
+    return checkException(env, method);
 }
 
-int callIntMethod(JNIEnv *env, jclass jcls, jobject jobj, const char* methodName,
-        const char* sig,  jint* result, ...)
+int callBooleanUpcall(JNIEnv* env, int upcall, jobject jobj, jmethodID method,
+                      jboolean* result, ...)
 {
-    jmethodID method = getMethod(env, jcls, jobj, methodName, sig);
-    if (method) {
-        va_list args;
-        va_start(args, result);
-        *result = (*env)->CallIntMethodV(env, jobj, method, args);
-        va_end(args);
-        return 1;
-    }
-    return 0;
+    va_list args;
+    int64_t begin;
+
+    assert(method);
+
+    va_start(args, result);
+    begin = upcallBegin(upcall);
+    *result = (*env)->CallBooleanMethodV(env, jobj, method, args);
+    upcallEnd(upcall, begin);
+    va_end(args);
+    return checkException(env, method);
 }
 
-int callBooleanMethod(JNIEnv *env, jclass jcls, jobject jobj, const char* methodName,
-        const char* sig, jboolean* result, ...)
+int callIntMethod(JNIEnv *env, jobject jobj, jmethodID method, jint* result, ...)
 {
-    jmethodID method = getMethod(env, jcls, jobj, methodName, sig);
-    if (method) {
-        va_list args;
-        va_start(args, result);
-        *result = (*env)->CallBooleanMethodV(env, jobj, method, args);
-        va_end(args);
-        return 1;
-    }
-    return 0;
+    va_list args;
+
+    assert(method);
+
+    va_start(args, result);
+    *result = (*env)->CallIntMethodV(env, jobj, method, args);
+    va_end(args);
+    return checkException(env, method);
 }
 
-int callStringMethod(JNIEnv *env, jclass jcls, jobject jobj, const char* methodName,
-        const char* sig, jstring* result, ...)
+int callLongMethod(JNIEnv *env, jobject jobj, jmethodID method, jlong* result, ...)
 {
-    jmethodID method = getMethod(env, jcls, jobj, methodName, sig);
-    if (method) {
-        va_list args;
-        va_start(args, result);
-        *result = (*env)->CallObjectMethodV(env, jobj, method, args);
-        va_end(args);
-        return 1;
-    }
-    return 0;
+    va_list args;
+
+    assert(method);
+
+    va_start(args, result);
+    *result = (*env)->CallLongMethodV(env, jobj, method, args);
+    va_end(args);
+    return checkException(env, method);
 }
 
-int callObjectMethod(JNIEnv *env, jclass jcls, jobject jobj, const char* methodName,
-        const char* sig, jobject* result, ...)
+int callBooleanMethod(JNIEnv *env, jobject jobj, jmethodID method, jboolean* result, ...)
 {
-    jmethodID method = getMethod(env, jcls, jobj, methodName, sig);
-    if (method) {
-        va_list args;
-        va_start(args, result);
-        *result = (*env)->CallObjectMethodV(env, jobj, method, args);
-        va_end(args);
-        return 1;
-    }
-    return 0;
+    va_list args;
+
+    assert(method);
+
+    va_start(args, result);
+    *result = (*env)->CallBooleanMethodV(env, jobj, method, args);
+    va_end(args);
+    return checkException(env, method);
 }
 
-int callStaticObjectMethod(JNIEnv* env, jclass jcls, const char* methodName,
-        const char* sig, jobject* result, ...)
+int callStringMethod(JNIEnv *env, jobject jobj, jmethodID method, jstring* result, ...)
 {
-    jmethodID method = (*env)->GetStaticMethodID(env, jcls, methodName, sig);
-    if (method) {
-        va_list args;
-        va_start(args, result);
-        *result = (*env)->CallStaticObjectMethodV(env, jcls, method, args);
-        va_end(args);
-        return 1;
-    }
-    return 0;
+    va_list args;
+
+    assert(method);
+
+    va_start(args, result);
+    *result = (*env)->CallObjectMethodV(env, jobj, method, args);
+    va_end(args);
+    return checkException(env, method);
+}
+
+int callObjectMethod(JNIEnv *env, jobject jobj, jmethodID method, jobject* result, ...)
+{
+    va_list args;
+
+    assert(method);
+
+    va_start(args, result);
+    *result = (*env)->CallObjectMethodV(env, jobj, method, args);
+    va_end(args);
+    return checkException(env, method);
+}
+
+int callStaticObjectMethod(JNIEnv* env, jclass jcls, jmethodID method, jobject* result, ...)
+{
+    va_list args;
+
+    assert(method);
+
+    va_start(args, result);
+    *result = (*env)->CallStaticObjectMethodV(env, jcls, method, args);
+    va_end(args);
+    return checkException(env, method);
 }
@@ -46,6 +46,7 @@
 #define __JNI_UTILS_H__
 
 #include <jni.h>
+#include <stdint.h>
 
 #define ARG(ctxt, index, type, value)  type value = (type) ((void**)ctxt)[index]
 
@@ -61,7 +62,7 @@ void setJvm(JavaVM* vm);
 JNIEnv* attachJvm(int* newlyAttached);
 void detachJvm(JNIEnv* env, int needDetach);
 
-jclass findClass(JNIEnv* env, const char* className);
+uint64_t getJvmAttachCount(void);
 
 int registerNativeMethods(JNIEnv* env,
         const char* clazzName,
@@ -69,54 +70,74 @@ int registerNativeMethods(JNIEnv* env,
         int nMethods
     );
 
+/*
+ * The following helpers invoke methods by their cached IDs (see jniCache.h).
+ * They return 0 if the java method threw an exception, which is then logged
+ * and cleared.
+ */
 int callVoidMethod(JNIEnv* env,
-        jclass jclazz,
         jobject jobj,
-        const char* methodName,
-        const char* sig,
+        jmethodID method,
+        ...
+    );
+
+/*
+ * Same as callVoidMethod() and callBooleanMethod(), but the time spent in
+ * java is recorded as an upcall of the given type (see upcallStats.h).
+ */
+int callVoidUpcall(JNIEnv* env,
+        int upcall,
+        jobject jobj,
+        jmethodID method,
+        ...
+    );
+
+int callBooleanUpcall(JNIEnv* env,
+        int upcall,
+        jobject jobj,
+        jmethodID method,
+        jboolean* result,
         ...
     );
 
 int callIntMethod(JNIEnv* env,
-        jclass clazz,
         jobject jobj,
-        const char* methodName,
-        const char* sig,
+        jmethodID method,
         jint* result,
         ...
     );
 
+int callLongMethod(JNIEnv* env,
+        jobject jobj,
+        jmethodID method,
+        jlong* result,
+        ...
+    );
+
 int callBooleanMethod(JNIEnv* env,
-        jclass clazz,
         jobject jobj,
-        const char* methodName,
-        const char* sig,
+        jmethodID method,
         jboolean* result,
         ...
     );
 
 int callStringMethod(JNIEnv* env,
-        jclass clazz,
         jobject jobj,
-        const char* methodName,
-        const char* sig,
-        jobject* result,
+        jmethodID method,
+        jstring* result,
         ...
     );
 
 int callObjectMethod(JNIEnv* env,
-        jclass clazz,
         jobject jobj,
-        const char* methodName,
-        const char* sig,
+        jmethodID method,
         jobject* result,
         ...
     );
 
 int callStaticObjectMethod(JNIEnv* env,
         jclass clazz,
-        const char* methodName,
-        const char* sig,
+        jmethodID method,
         jobject* result,
         ...
     );
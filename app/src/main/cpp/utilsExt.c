@@ -48,85 +48,56 @@
 
 #include "utils.h"
 
-int setIntField(JNIEnv* env, jobject jobj, const char* name, int value)
+int setIntField(JNIEnv* env, jobject jobj, jfieldID field, int value)
 {
-    jclass* jcls;
-    jfieldID fieldid;
-
-    jcls = (*env)->GetObjectClass(env, jobj);
-    if (!jcls)
-        return 0;
-
-    fieldid = (*env)->GetFieldID(env, jcls, name, "I");
-    if (!fieldid)
-        return 0;
-
-    (*env)->SetIntField(env, jobj, fieldid, (jint)value);
+    (*env)->SetIntField(env, jobj, field, (jint)value);
     return 1;
 }
 
-int setLongField(JNIEnv* env, jobject jobj, const char* name, uint64_t value)
+int setLongField(JNIEnv* env, jobject jobj, jfieldID field, uint64_t value)
 {
-    jclass* jcls;
-    jfieldID fieldid;
-
-    jcls = (*env)->GetObjectClass(env, jobj);
-    if (!jcls)
-        return 0;
-
-    fieldid = (*env)->GetFieldID(env, jcls, name, "J");
-    if (!fieldid)
-        return 0;
-
-    (*env)->SetLongField(env, jobj, fieldid, (jlong)value);
+    (*env)->SetLongField(env, jobj, field, (jlong)value);
     return 1;
 }
 
-int getLongField(JNIEnv* env, jobject jobj, const char* name, uint64_t* value)
+int getLongField(JNIEnv* env, jobject jobj, jfieldID field, uint64_t* value)
 {
-    jclass* jcls;
-    jfieldID fieldid;
+    *value = (uint64_t)(*env)->GetLongField(env, jobj, field);
+    return 1;
+}
 
-    jcls = (*env)->GetObjectClass(env, jobj);
-    if (!jcls)
-        return 0;
+int getStringRegion(JNIEnv* env, jstring jstr, char* buf, int length)
+{
+    jsize utfLength;
 
-    fieldid = (*env)->GetFieldID(env, jcls, name, "J");
-    if (!fieldid)
+    utfLength = (*env)->GetStringUTFLength(env, jstr);
+    if (utfLength >= length)
         return 0;
 
-    *value = (uint64_t)(*env)->GetLongField(env, jobj, fieldid);
+    (*env)->GetStringUTFRegion(env, jstr, 0, (*env)->GetStringLength(env, jstr), buf);
+    buf[utfLength] = '\0';
     return 1;
 }
 
-int getString(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName,
-              char* buf, int length)
+int getString(JNIEnv* env, jobject jobj, jmethodID method, char* buf, int length)
 {
     jstring jresult = NULL;
-    const char *result;
+    int rc;
 
     memset(buf, 0, (size_t)length);
 
-    if (!callStringMethod(env, clazz, jobj, methodName, "()"_J("String;"), &jresult))
+    if (!callStringMethod(env, jobj, method, &jresult))
         return 0;
 
     if (!jresult)
         return 1;
 
-    result = (*env)->GetStringUTFChars(env, jresult, NULL);
-    if (!result || strlen(result) >= length) {
-        if (result) (*env)->ReleaseStringUTFChars(env, jresult, result);
-        (*env)->DeleteLocalRef(env, jresult);
-        return 0;
-    }
-
-    strcpy(buf, result);
-    (*env)->ReleaseStringUTFChars(env, jresult, result);
+    rc = getStringRegion(env, jresult, buf, length);
     (*env)->DeleteLocalRef(env, jresult);
-    return 1;
+    return rc;
 }
 
-int setString(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, const char* value)
+int setString(JNIEnv* env, jobject jobj, jmethodID method, const char* value)
 {
     jstring jvalue;
     int rc;
@@ -135,18 +106,18 @@ int setString(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, c
     if (!jvalue)
         return 0;
 
-    rc = callVoidMethod(env, clazz, jobj, methodName, "("_J("String;)V"), jvalue);
+    rc = callVoidMethod(env, jobj, method, jvalue);
     (*env)->DeleteLocalRef(env, jvalue);
     return rc != 0;
 }
 
-int getStringExt(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, char** value)
+int getStringExt(JNIEnv* env, jobject jobj, jmethodID method, char** value)
 {
     jstring jresult = NULL;
     const char *result;
     *value = NULL;
 
-    if (!callStringMethod(env, clazz, jobj, methodName, "()"_J("String;"), &jresult))
+    if (!callStringMethod(env, jobj, method, &jresult))
         return 0;
 
     if (!jresult)
@@ -51,32 +51,56 @@
 #include "utils.h"
 
 static inline
-int getInt(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, int* value)
+int getInt(JNIEnv* env, jobject jobj, jmethodID method, int* value)
 {
-    return callIntMethod(env, clazz, jobj, methodName, "()I", value);
+    return callIntMethod(env, jobj, method, value);
 }
 
 static inline
-int getBoolean(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, int* value)
+int getLong(JNIEnv* env, jobject jobj, jmethodID method, int64_t* value)
 {
-    return callBooleanMethod(env, clazz, jobj, methodName, "()Z", (jboolean*)value);
+    jlong result = 0;
+
+    if (!callLongMethod(env, jobj, method, &result))
+        return 0;
+
+    *value = (int64_t)result;
+    return 1;
 }
 
 static inline
-int setBoolean(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, int value)
+int getBoolean(JNIEnv* env, jobject jobj, jmethodID method, int* value)
 {
-    return callVoidMethod(env, clazz, jobj, methodName, "(Z)V", (jboolean)value);
+    jboolean result = JNI_FALSE;
+
+    if (!callBooleanMethod(env, jobj, method, &result))
+        return 0;
+
+    *value = (result == JNI_TRUE);
+    return 1;
 }
 
-int setIntField(JNIEnv* env, jobject jobj, const char* name, int value);
+static inline
+int setBoolean(JNIEnv* env, jobject jobj, jmethodID method, int value)
+{
+    return callVoidMethod(env, jobj, method, (jboolean)value);
+}
+
+int setIntField(JNIEnv* env, jobject jobj, jfieldID field, int value);
+
+int setLongField(JNIEnv* env, jobject jobj, jfieldID field, uint64_t value);
+int getLongField(JNIEnv* env, jobject jobj, jfieldID field, uint64_t* value);
 
-int setLongField(JNIEnv* env, jobject jobj, const char* name, uint64_t value);
-int getLongField(JNIEnv* env, jobject jobj, const char* name, uint64_t* value);
+/*
+ * Copies the modified UTF-8 form of jstr, NUL terminated, into buf with
+ * GetStringUTFRegion, so no heap copy of the string is made. Returns 0 if
+ * it does not fit in length bytes.
+ */
+int getStringRegion(JNIEnv* env, jstring jstr, char* buf, int length);
 
-int getString(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName,
-              char* buf, int length);
-int setString(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, const char* value);
+int getString(JNIEnv* env, jobject jobj, jmethodID method, char* buf, int length);
+int setString(JNIEnv* env, jobject jobj, jmethodID method, const char* value);
 
-int getStringExt(JNIEnv* env, jclass clazz, jobject jobj, const char* methodName, char** value);
+int getStringExt(JNIEnv* env, jobject jobj, jmethodID method, char** value);
 
 #endif
\ No newline at end of file
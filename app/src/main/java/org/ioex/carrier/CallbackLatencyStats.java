@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier;
+
+/**
+ * Latency histograms of the callbacks delivered from the native layer to
+ * java, one per callback type, covering all carriers and streams of the
+ * process.
+ *
+ * Bucket i counts the callbacks that took less than 2^i nanoseconds and
+ * at least half of that, the last bucket also holds every slower callback.
+ */
+public final class CallbackLatencyStats {
+	/** Number of histogram buckets per callback type. */
+	public static final int BUCKETS = 32;
+
+	private static final int STRIDE = 3 + BUCKETS;
+	private static final int COUNT = 0;
+	private static final int TOTAL_NANOS = 1;
+	private static final int MAX_NANOS = 2;
+	private static final int FIRST_BUCKET = 3;
+
+	private final String[] names;
+	private final long[] values;
+
+	/* Constructed by the native layer only */
+	CallbackLatencyStats(String[] names, long[] values) {
+		this.names = names;
+		this.values = values;
+	}
+
+	/**
+	 * Get the number of callback types.
+	 *
+	 * @return
+	 * 		The number of callback types
+	 */
+	public int size() {
+		return names.length;
+	}
+
+	/**
+	 * Get the name of a callback type, such as "onFriendMessage".
+	 *
+	 * @param
+	 * 		index		The callback type index
+	 *
+	 * @return
+	 * 		The callback name
+	 */
+	public String getName(int index) {
+		return names[index];
+	}
+
+	/**
+	 * Find a callback type by its name.
+	 *
+	 * @param
+	 * 		name		The callback name
+	 *
+	 * @return
+	 * 		The callback type index, or -1 if there is no such callback
+	 */
+	public int indexOf(String name) {
+		for (int i = 0; i < names.length; i++) {
+			if (names[i].equals(name))
+				return i;
+		}
+		return -1;
+	}
+
+	/**
+	 * Get the number of calls of a callback type.
+	 *
+	 * @param
+	 * 		index		The callback type index
+	 *
+	 * @return
+	 * 		The number of calls
+	 */
+	public long getCount(int index) {
+		return values[index * STRIDE + COUNT];
+	}
+
+	/**
+	 * Get the total time spent in a callback type.
+	 *
+	 * @param
+	 * 		index		The callback type index
+	 *
+	 * @return
+	 * 		The total time in nanoseconds
+	 */
+	public long getTotalNanos(int index) {
+		return values[index * STRIDE + TOTAL_NANOS];
+	}
+
+	/**
+	 * Get the longest single call of a callback type.
+	 *
+	 * @param
+	 * 		index		The callback type index
+	 *
+	 * @return
+	 * 		The longest call in nanoseconds
+	 */
+	public long getMaxNanos(int index) {
+		return values[index * STRIDE + MAX_NANOS];
+	}
+
+	/**
+	 * Get the number of calls in one histogram bucket.
+	 *
+	 * @param
+	 * 		index		The callback type index
+	 * @param
+	 * 		bucket		The bucket, from 0 to BUCKETS - 1
+	 *
+	 * @return
+	 * 		The number of calls that fell in the bucket
+	 */
+	public long getBucketCount(int index, int bucket) {
+		if (bucket < 0 || bucket >= BUCKETS)
+			throw new IllegalArgumentException();
+
+		return values[index * STRIDE + FIRST_BUCKET + bucket];
+	}
+
+	/**
+	 * Estimate a latency percentile of a callback type from its histogram.
+	 *
+	 * @param
+	 * 		index		The callback type index
+	 * @param
+	 * 		percentile	The percentile, between 0 and 100
+	 *
+	 * @return
+	 * 		The upper bound in nanoseconds of the bucket holding the
+	 * 		percentile, or 0 if the callback was never called
+	 */
+	public long getPercentileNanos(int index, double percentile) {
+		if (percentile < 0 || percentile > 100)
+			throw new IllegalArgumentException();
+
+		long count = getCount(index);
+		if (count == 0)
+			return 0;
+
+		long rank = (long)Math.ceil(count * percentile / 100);
+		long seen = 0;
+		for (int i = 0; i < BUCKETS - 1; i++) {
+			seen += getBucketCount(index, i);
+			if (seen >= rank && seen > 0)
+				return Math.min(1L << i, getMaxNanos(index));
+		}
+		return getMaxNanos(index);
+	}
+
+	@Override
+	public String toString() {
+		StringBuilder sb = new StringBuilder("CallbackLatencyStats[");
+		boolean first = true;
+
+		for (int i = 0; i < names.length; i++) {
+			long count = getCount(i);
+			if (count == 0)
+				continue;
+
+			if (!first)
+				sb.append(", ");
+			first = false;
+
+			sb.append(String.format("%s:{count:%d, avg:%dns, p99:%dns, max:%dns}", names[i],
+					count, getTotalNanos(i) / count, getPercentileNanos(i, 99),
+					getMaxNanos(i)));
+		}
+		return sb.append(']').toString();
+	}
+}
@@ -44,11 +44,12 @@
 package org.ioex.carrier;
 
 import java.nio.ByteBuffer;
-import java.util.List;
 import java.util.ArrayList;
+import java.util.List;
 import java.util.Arrays;
 
 import org.ioex.carrier.exceptions.IOEXException;
+import org.ioex.carrier.session.Manager;
 
 /**
  * The class representing Carrier node instance.
@@ -64,6 +65,11 @@ public class Carrier {
 	 */
 	public static final int MAX_KEY_LEN = 45;
 
+	/**
+	 * Max length in bytes of a friend message.
+	 */
+	public static final int MAX_APP_MESSAGE_LEN = 1024;
+
 	private static final String TAG = "CarrierCore";
 	private static Carrier carrier;
 	private Thread carrierThread;
@@ -76,8 +82,6 @@ public class Carrier {
 	}
 
 	private static class Callbacks {
-		private List<FriendInfo> friends;
-
 		void onIdle(Carrier carrier) {
 			carrier.handler.onIdle(carrier);
 		}
@@ -94,17 +98,8 @@ public class Carrier {
 			carrier.handler.onSelfInfoChanged(carrier, userInfo);
 		}
 
-		boolean onFriendsIterated(Carrier carrier, FriendInfo info) {
-			if (friends == null)
-				friends = new ArrayList<FriendInfo>();
-
-			if (info != null) {
-				friends.add(info);
-			} else {
-				carrier.handler.onFriends(carrier, friends);
-				friends = null;
-			}
-			return true;
+		void onFriends(Carrier carrier, FriendsSnapshot friends) {
+			carrier.handler.onFriends(carrier, new ArrayList<FriendInfo>(friends));
 		}
 
 		void onFriendConnection(Carrier carrier, String friendid, ConnectionStatus status) {
@@ -135,6 +130,11 @@ public class Carrier {
 			carrier.handler.onFriendMessage(carrier, from, message);
 		}
 
+		void onFriendBinaryMessage(Carrier carrier, String from, byte[] message) {
+			((BinaryMessageHandler)carrier.handler).onFriendBinaryMessage(carrier, from,
+					ByteBuffer.wrap(message));
+		}
+
 		void onFriendInviteRequest(Carrier carrier, String from, String data) {
 			carrier.handler.onFriendInviteRequest(carrier, from, data);
 		}
@@ -183,6 +183,40 @@ public class Carrier {
 		private String persistentLocation;
 		private boolean udpEnabled;
 		private List<BootstrapNode> bootstrapNodes;
+		private int dispatchQueueCapacity;
+		private int dispatchThreads = 1;
+		private OverflowPolicy overflowPolicy = OverflowPolicy.Block;
+		private boolean binaryMessages;
+		private int progressMinInterval;
+		private int progressMinPercent;
+		private long progressMinBytes;
+
+		/**
+		 * What to do with a callback event when the asynchronous dispatch
+		 * queue is full.
+		 */
+		public enum OverflowPolicy {
+			/**
+			 * Drop the new event.
+			 */
+			Drop,
+
+			/**
+			 * Block the carrier thread until the queue has room again.
+			 */
+			Block,
+
+			/**
+			 * Keep only the latest friend presence and friend connection
+			 * event per friend until the queue drains, block for any
+			 * other event.
+			 */
+			CoalescePresence;
+
+			int value() {
+				return ordinal();
+			}
+		}
 
 		public static class BootstrapNode {
 			private String ipv4;
@@ -280,6 +314,138 @@ public class Carrier {
 		public List<BootstrapNode> getBootstrapNodes() {
 			return bootstrapNodes;
 		}
+
+		/**
+		 * Deliver carrier callbacks on dedicated dispatcher threads instead
+		 * of the carrier thread, so that a slow handler does not stall the
+		 * carrier network loop.
+		 *
+		 * Callbacks are copied into a bounded queue and handed to the
+		 * handler in order when only one dispatcher thread is used. With
+		 * more threads, callbacks may be delivered concurrently and out of
+		 * order.
+		 *
+		 * @param queueCapacity	The maximum number of pending callbacks,
+		 * 						0 to deliver callbacks synchronously (default).
+		 * @param threads		The number of dispatcher threads (1 ~ 8).
+		 * @param policy		What to do when the queue is full.
+		 *
+		 * @return The current options object reference.
+		 */
+		public Options setAsyncDispatch(int queueCapacity, int threads, OverflowPolicy policy) {
+			if (queueCapacity < 0 || threads < 1 || policy == null)
+				throw new IllegalArgumentException();
+
+			this.dispatchQueueCapacity = queueCapacity;
+			this.dispatchThreads = threads;
+			this.overflowPolicy = policy;
+			return this;
+		}
+
+		/**
+		 * Get the capacity of the asynchronous dispatch queue.
+		 *
+		 * @return The queue capacity, 0 if callbacks are delivered synchronously.
+		 */
+		public int getDispatchQueueCapacity() {
+			return dispatchQueueCapacity;
+		}
+
+		/**
+		 * Get the number of dispatcher threads.
+		 *
+		 * @return The number of dispatcher threads.
+		 */
+		public int getDispatchThreads() {
+			return dispatchThreads;
+		}
+
+		/**
+		 * Get the overflow policy of the asynchronous dispatch queue.
+		 *
+		 * @return The overflow policy.
+		 */
+		public OverflowPolicy getOverflowPolicy() {
+			return overflowPolicy;
+		}
+
+		/**
+		 * Deliver friend messages to BinaryMessageHandler.onFriendBinaryMessage
+		 * as the exact bytes received, instead of decoding them into a String
+		 * for CarrierHandler.onFriendMessage. Creating a carrier node with
+		 * this enabled fails unless its handler implements
+		 * BinaryMessageHandler.
+		 *
+		 * Messages sent by sendFriendMessage(String, String) arrive with
+		 * their terminating NUL byte.
+		 *
+		 * @param binaryMessages flag to enable or disable binary delivery.
+		 *
+		 * @return The current options object reference.
+		 */
+		public Options setBinaryMessages(boolean binaryMessages) {
+			this.binaryMessages = binaryMessages;
+			return this;
+		}
+
+		/**
+		 * Get whether friend messages are delivered as raw bytes.
+		 *
+		 * @return	The value of enable/disable binary delivery.
+		 */
+		public boolean getBinaryMessages() {
+			return binaryMessages;
+		}
+
+		/**
+		 * Limit how often CarrierHandler.onFriendFileProgress is called for
+		 * each file transfer. A progress update is delivered only once all
+		 * of the given minimums are reached since the last delivered update
+		 * of that file; the first and the final update of a transfer are
+		 * always delivered. All values 0 (default) deliver every update.
+		 *
+		 * @param minIntervalMs	Minimum time between updates in milliseconds, or 0.
+		 * @param minPercent	Minimum progress step in percent of the file size, or 0.
+		 * @param minBytes		Minimum number of bytes transferred between updates, or 0.
+		 *
+		 * @return The current options object reference.
+		 */
+		public Options setFileProgressThrottle(int minIntervalMs, int minPercent, long minBytes) {
+			if (minIntervalMs < 0 || minPercent < 0 || minPercent > 100 || minBytes < 0)
+				throw new IllegalArgumentException();
+
+			this.progressMinInterval = minIntervalMs;
+			this.progressMinPercent = minPercent;
+			this.progressMinBytes = minBytes;
+			return this;
+		}
+
+		/**
+		 * Get the minimum time between file progress updates.
+		 *
+		 * @return The interval in milliseconds, 0 if not limited.
+		 */
+		public int getProgressMinInterval() {
+			return progressMinInterval;
+		}
+
+		/**
+		 * Get the minimum progress step between file progress updates.
+		 *
+		 * @return The step in percent, 0 if not limited.
+		 */
+		public int getProgressMinPercent() {
+			return progressMinPercent;
+		}
+
+		/**
+		 * Get the minimum byte delta between file progress updates.
+		 *
+		 * @return The number of bytes, 0 if not limited.
+		 */
+		public long getProgressMinBytes() {
+			return progressMinBytes;
+		}
 	}
 
 	// native jni methods.
@@ -301,7 +467,7 @@ public class Carrier {
 
 	private native boolean is_ready();
 
-	private native boolean get_friends(FriendsIterator iterator, Object context);
+	private native FriendsSnapshot get_friends_snapshot();
 	private native FriendInfo get_friend(String userId);
 	private native boolean label_friend(String userId, String label);
 	private native boolean is_friend(String userId);
@@ -311,11 +477,21 @@ public class Carrier {
 	private native boolean remove_friend(String userId);
 
 	private native boolean send_message(String to, String message);
+	private native boolean send_binary_message(String to, byte[] data, int offset, int length);
+	private native boolean send_direct_message(String to, ByteBuffer data, int position, int limit);
 	private native boolean friend_invite(String to, String data,
 										 FriendInviteResponseHandler handler);
 	private native boolean reply_friend_invite(String from, int status, String reason,
 											   String data);
+	private native long[] get_dispatch_stats();
+	private native long[] get_progress_stats();
+	private native FileTransfers get_file_transfers();
 	private static native int get_error_code();
+	private static native long get_attach_count();
+	private static native CallbackLatencyStats get_callback_latency_stats();
+	private static native void set_slow_callback_threshold(int ms);
+	private static native void set_log_level(int level);
+	private static native boolean set_async_logging(boolean enable);
 	private native String send_file(String to, String filename);
 	private native boolean accept_file(String fileid, String filename, String filepath);
 	private native boolean pause_file(String fileid);
@@ -338,6 +514,97 @@ public class Carrier {
 		return "5.0/Android";
 	}
 
+	/**
+	 * Get the number of times native threads have been attached to the JVM
+	 * to deliver callbacks.
+	 *
+	 * Native threads are attached once and stay attached until they exit,
+	 * so this number should stay close to the number of native threads
+	 * that ever delivered a callback.
+	 *
+	 * @return
+	 * 		The count of JVM attach operations since the library was loaded.
+	 */
+	public static long getJvmAttachCount() {
+		return get_attach_count();
+	}
+
+	/**
+	 * Get the latency histograms of the callbacks delivered to java.
+	 *
+	 * Every call from the native layer into a CarrierHandler, a session
+	 * or a stream handler is timed, so a slow handler shows up here under
+	 * its callback name. The histograms cover all carriers of the process.
+	 *
+	 * @return
+	 * 		The snapshot of the callback latencies.
+	 *
+	 * @throws
+	 * 		IOEXException
+	 */
+	public static CallbackLatencyStats getCallbackLatencyStats() throws IOEXException {
+		CallbackLatencyStats stats = get_callback_latency_stats();
+		if (stats == null)
+			throw new IOEXException(get_error_code());
+
+		return stats;
+	}
+
+	/**
+	 * Set how long a callback may run before a warning naming it is logged.
+	 *
+	 * Callbacks on the carrier thread hold up the whole node, so handlers
+	 * slower than this are worth moving off that thread. A callback is
+	 * reported while it is still running, so one that never returns is
+	 * logged too. The default is 100 milliseconds.
+	 *
+	 * @param
+	 * 		ms		The threshold in milliseconds, or 0 to disable the warning
+	 */
+	public static void setSlowCallbackThreshold(int ms) {
+		if (ms < 0)
+			throw new IllegalArgumentException();
+
+		set_slow_callback_threshold(ms);
+	}
+
+	/**
+	 * Set the native log level.
+	 *
+	 * The level applies to the carrier library and to the JNI binding alike.
+	 * Lines below the level are dropped before they are formatted. Debug and
+	 * verbose lines of the binding are only compiled into debug builds.
+	 *
+	 * @param
+	 * 		level		The least severe level to write
+	 */
+	public static void setLogLevel(LogLevel level) {
+		if (level == null)
+			throw new IllegalArgumentException();
+
+		set_log_level(level.value());
+	}
+
+	/**
+	 * Write native log lines from a background thread.
+	 *
+	 * When enabled, the JNI binding queues formatted lines in a ring buffer
+	 * instead of writing to the log on the calling thread, which keeps the
+	 * log I/O off the carrier and transport threads. Lines are dropped, and
+	 * the number of dropped lines is logged, when the ring is full.
+	 *
+	 * @param
+	 * 		enable		True to write asynchronously, false to flush the
+	 * 					queued lines and write synchronously again
+	 *
+	 * @throws
+	 * 		IOEXException
+	 */
+	public static void setAsyncLogging(boolean enable) throws IOEXException {
+		if (!set_async_logging(enable))
+			throw new IOEXException(get_error_code());
+	}
+
 	/**
 	 * Check if the ID is Carrier node id.
 	 *
@@ -411,15 +678,40 @@ public class Carrier {
 				throw new IllegalArgumentException();
 
 		if (carrier == null) {
-			Callbacks callbacks = new Callbacks();
-			Carrier tmp = new Carrier(handler);
+			carrier = createInstance(options, handler);
+		}
+	}
+
+	/**
+	 * Create a new carrier node instance besides the singleton one.
+	 *
+	 * Several carrier node instances can run side by side in one process,
+	 * each with its own identity. Every instance must be given its own
+	 * persistent location in options.
+	 *
+	 * @param
+	 * 		options		The options to set for creating carrier node.
+	 * @param
+	 * 		handler		The interface handler for carrier node.
+	 *
+	 * @return
+	 * 		A new carrier node instance, which is not returned by getInstance().
+	 *
+	 * @throws
+	 * 		IOEXException
+	 */
+	public static Carrier createInstance(Options options, CarrierHandler handler) throws IOEXException {
+		if (options == null || handler == null)
+			throw new IllegalArgumentException();
 
-			if (!tmp.native_init(options, callbacks))
-				throw new IOEXException(get_error_code());
+		Callbacks callbacks = new Callbacks();
+		Carrier tmp = new Carrier(handler);
+
+		if (!tmp.native_init(options, callbacks))
+			throw new IOEXException(get_error_code());
 
-			Log.i(TAG, "Carrier node instance created");
-			carrier = tmp;
-  		}
+		Log.i(TAG, "Carrier node instance created");
+		return tmp;
 	}
 
 	@Override
@@ -445,13 +737,13 @@ public class Carrier {
 	 * @param
 	 * 		iterateInterval		Internal loop interval, in milliseconds.
 	 */
-	public void start(final int iterateInterval) {
-		if (carrierThread == null) {
+	public synchronized void start(final int iterateInterval) {
+		if (carrierThread == null && !didKill) {
 			carrierThread = new Thread() {
 				@Override
 				public void run() {
 					Log.i(TAG, "Native carrier node started: " + Thread.currentThread().getId() + "/ " + Thread.currentThread().getName());
-					if (!carrier.native_run(iterateInterval)) {
+					if (!Carrier.this.native_run(iterateInterval)) {
 						Log.e(TAG, "Native carrier node started error(" + get_error_code() + ")");
 						return;
 					}
@@ -472,9 +764,11 @@ public class Carrier {
 		if (!didKill) {
 
 			Log.i(TAG, "Killing Carrier node instance ...");
+			Manager.cleanupInstance(this);
 			native_kill();
 			didKill = true;
-			carrier = null;
+			if (carrier == this)
+				carrier = null;
 
 			if (carrierThread != null) {
 				try {
@@ -661,9 +955,68 @@ public class Carrier {
 	public boolean isReady() {
 		return is_ready();
 	}
+	/**
+	 * Get the statistics of the asynchronous callback dispatcher.
+	 *
+	 * @return
+	 * 		The dispatcher statistics.
+	 *
+	 * @throws
+	 * 		IOEXException	The carrier was not created with asynchronous
+	 * 						dispatch, or has been killed.
+	 */
+	public DispatchStats getDispatchStats() throws IOEXException {
+		long[] stats = get_dispatch_stats();
+		if (stats == null)
+			throw new IOEXException(get_error_code());
+
+		return new DispatchStats(stats);
+	}
+
+	/**
+	 * Get the number of file progress updates delivered to and withheld
+	 * from the handler, see Options.setFileProgressThrottle().
+	 *
+	 * @return
+	 * 		The file progress statistics.
+	 *
+	 * @throws
+	 * 		IOEXException	The carrier has been killed.
+	 */
+	public FileProgressStats getFileProgressStats() throws IOEXException {
+		long[] stats = get_progress_stats();
+		if (stats == null)
+			throw new IOEXException(get_error_code());
+
+		return new FileProgressStats(stats[0], stats[1]);
+	}
+
+	/**
+	 * Get the status of all file transmissions.
+	 *
+	 * All trackers are collected natively in one call and returned as one
+	 * packed snapshot, which makes polling the transfers cheap.
+	 *
+	 * @return
+	 * 		The snapshot of file transmissions
+	 *
+	 * @throws
+	 * 		IOEXException
+	 */
+	public FileTransfers getFileTransfers() throws IOEXException {
+		FileTransfers transfers = get_file_transfers();
+		if (transfers == null)
+			throw new IOEXException(get_error_code());
+
+		return transfers;
+	}
+
 	/**
 	 * Get friends list.
 	 *
+	 * The returned list is a modifiable copy of getFriendsSnapshot(), which
+	 * avoids building every FriendInfo up front.
+	 *
 	 * @return
 	 * 		The list of friend information to current user
 	 *
@@ -671,27 +1024,27 @@ public class Carrier {
 	 * 		IOEXException
 	 */
 	public List<FriendInfo> getFriends() throws IOEXException {
-		List<FriendInfo> friends = new ArrayList<FriendInfo>();
-
-		boolean result = get_friends(new FriendsIterator() {
-			public boolean onIterated(FriendInfo info, Object context) {
-				@SuppressWarnings({"unchecked"})
-				List<FriendInfo> friends = (List<FriendInfo>)context;
-				if (info != null)
-					friends.add(info);
-				return true;
-			}
-		}, friends);
+		return new ArrayList<FriendInfo>(getFriendsSnapshot());
+	}
 
-		if (!result)
+	/**
+	 * Get a snapshot of the friends list.
+	 *
+	 * All friends are collected natively in one call and packed into the
+	 * snapshot. A FriendInfo object is only built when its entry is accessed.
+	 *
+	 * @return
+	 * 		The snapshot of friends to current user
+	 *
+	 * @throws
+	 * 		IOEXException
+	 */
+	public FriendsSnapshot getFriendsSnapshot() throws IOEXException {
+		FriendsSnapshot friends = get_friends_snapshot();
+		if (friends == null)
 			throw new IOEXException(get_error_code());
 
-		Log.d(TAG, "Current user's friends listed below: +++++>>");
-		for (FriendInfo friend: friends) {
-			Log.d(TAG, friend.toString());
-		}
-		Log.d(TAG, "<<++++++++");
-
+		Log.d(TAG, "Current user has " + friends.size() + " friends");
 		return friends;
 	}
 
@@ -864,6 +1217,75 @@ public class Carrier {
 		Log.d(TAG, "Send message [" + message + "] to friend " + to);
 	}
 
+	/**
+	 * Send a binary message to a friend.
+	 *
+	 * The bytes are sent as they are, without a terminating NUL. They reach
+	 * the friend intact only if it enabled Options.setBinaryMessages.
+	 *
+	 * @param
+	 * 		to 			The target id
+	 * @param
+	 * 		message		The message content, at most MAX_APP_MESSAGE_LEN bytes
+	 *
+	 * @throws
+	 * 		IllegalArgumentException
+	 * 		IOEXException
+	 */
+	public void sendFriendMessage(String to, byte[] message) throws IOEXException {
+		if (to == null || to.length() == 0 ||
+				message == null || message.length == 0 ||
+				message.length > MAX_APP_MESSAGE_LEN)
+			throw new IllegalArgumentException();
+
+		if (!send_binary_message(to, message, 0, message.length))
+			throw new IOEXException(get_error_code());
+
+		Log.d(TAG, "Send binary message (" + message.length + " bytes) to friend " + to);
+	}
+
+	/**
+	 * Send the remaining bytes of a buffer to a friend as a binary message.
+	 *
+	 * On success the buffer position is advanced to its limit. Direct
+	 * buffers are sent without any copy on the java side.
+	 *
+	 * @param
+	 * 		to 			The target id
+	 * @param
+	 * 		message		The message content, at most MAX_APP_MESSAGE_LEN bytes
+	 *
+	 * @throws
+	 * 		IllegalArgumentException
+	 * 		IOEXException
+	 */
+	public void sendFriendMessage(String to, ByteBuffer message) throws IOEXException {
+		if (to == null || to.length() == 0 ||
+				message == null || !message.hasRemaining() ||
+				message.remaining() > MAX_APP_MESSAGE_LEN)
+			throw new IllegalArgumentException();
+
+		int position = message.position();
+		int length = message.remaining();
+		boolean rc;
+
+		if (message.isDirect()) {
+			rc = send_direct_message(to, message, position, message.limit());
+		} else if (message.hasArray()) {
+			rc = send_binary_message(to, message.array(), message.arrayOffset() + position, length);
+		} else {
+			byte[] data = new byte[length];
+			message.duplicate().get(data);
+			rc = send_binary_message(to, data, 0, length);
+		}
+
+		if (!rc)
+			throw new IOEXException(get_error_code());
+
+		message.position(position + length);
+		Log.d(TAG, "Send binary message (" + length + " bytes) to friend " + to);
+	}
+
 	/**
 	 * Send invite request to a friend.
 	 *
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier;
+
+/**
+ * A point in time view of the asynchronous callback dispatcher of a carrier,
+ * see {@link Carrier.Options#setAsyncDispatch}.
+ */
+public final class DispatchStats {
+	// Layout of the array filled by the native layer, see carrierDispatcher.h
+	private static final int DEPTH = 0;
+	private static final int MAX_DEPTH = 1;
+	private static final int ENQUEUED = 2;
+	private static final int DISPATCHED = 3;
+	private static final int DROPPED = 4;
+	private static final int COALESCED = 5;
+	private static final int BLOCKED = 6;
+	private static final int TOTAL_LATENCY = 7;
+	private static final int MAX_LATENCY = 8;
+
+	private final long[] stats;
+
+	DispatchStats(long[] stats) {
+		this.stats = stats;
+	}
+
+	/**
+	 * Get the number of callbacks waiting to be delivered.
+	 *
+	 * @return The current queue depth.
+	 */
+	public long getQueueDepth() {
+		return stats[DEPTH];
+	}
+
+	/**
+	 * Get the highest queue depth seen so far.
+	 *
+	 * @return The maximum queue depth.
+	 */
+	public long getMaxQueueDepth() {
+		return stats[MAX_DEPTH];
+	}
+
+	/**
+	 * Get the number of callbacks queued by the carrier thread.
+	 *
+	 * @return The number of queued callbacks.
+	 */
+	public long getEnqueuedCount() {
+		return stats[ENQUEUED];
+	}
+
+	/**
+	 * Get the number of callbacks delivered to the handler.
+	 *
+	 * @return The number of delivered callbacks.
+	 */
+	public long getDispatchedCount() {
+		return stats[DISPATCHED];
+	}
+
+	/**
+	 * Get the number of callbacks dropped because the queue was full.
+	 *
+	 * @return The number of dropped callbacks.
+	 */
+	public long getDroppedCount() {
+		return stats[DROPPED];
+	}
+
+	/**
+	 * Get the number of presence callbacks replaced by a newer one while
+	 * the queue was full.
+	 *
+	 * @return The number of coalesced callbacks.
+	 */
+	public long getCoalescedCount() {
+		return stats[COALESCED];
+	}
+
+	/**
+	 * Get the number of times the carrier thread had to wait for room in
+	 * the queue.
+	 *
+	 * @return The number of blocked enqueues.
+	 */
+	public long getBlockedCount() {
+		return stats[BLOCKED];
+	}
+
+	/**
+	 * Get the average time callbacks spent in the queue.
+	 *
+	 * @return The average queueing latency in nanoseconds.
+	 */
+	public long getAverageLatencyNanos() {
+		return stats[DISPATCHED] > 0 ? stats[TOTAL_LATENCY] / stats[DISPATCHED] : 0;
+	}
+
+	/**
+	 * Get the longest time a callback spent in the queue.
+	 *
+	 * @return The maximum queueing latency in nanoseconds.
+	 */
+	public long getMaxLatencyNanos() {
+		return stats[MAX_LATENCY];
+	}
+
+	@Override
+	public String toString() {
+		return String.format("DispatchStats[depth:%d, maxDepth:%d, enqueued:%d, dispatched:%d, "
+				+ "dropped:%d, coalesced:%d, blocked:%d, avgLatency:%dns, maxLatency:%dns]",
+				getQueueDepth(), getMaxQueueDepth(), getEnqueuedCount(), getDispatchedCount(),
+				getDroppedCount(), getCoalescedCount(), getBlockedCount(),
+				getAverageLatencyNanos(), getMaxLatencyNanos());
+	}
+}
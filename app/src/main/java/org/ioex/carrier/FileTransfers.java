@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier;
+
+/**
+ * A snapshot of every file transmission tracked by a carrier, collected by
+ * the native layer in one call.
+ *
+ * The status of all transfers is held in one long array and read in place,
+ * so polling the snapshot allocates nothing beyond the file id strings.
+ */
+public final class FileTransfers {
+	/** No file transmission. */
+	public static final int STATUS_NONE = 0;
+	/** The request is sent and waiting for the response. */
+	public static final int STATUS_PENDING = 1;
+	/** The file is transmitting. */
+	public static final int STATUS_RUNNING = 2;
+	/** The transmission is finished. */
+	public static final int STATUS_FINISHED = 3;
+
+	/** Nobody paused the transmission. */
+	public static final int PAUSED_NONE = 0;
+	/** The transmission is paused by us. */
+	public static final int PAUSED_US = 1;
+	/** The transmission is paused by the friend. */
+	public static final int PAUSED_OTHER = 2;
+	/** The transmission is paused by both sides. */
+	public static final int PAUSED_BOTH = 3;
+
+	/** The direction is unknown. */
+	public static final int DIRECTION_UNKNOWN = 0;
+	/** We are the file sender. */
+	public static final int DIRECTION_SEND = 1;
+	/** We are the file receiver. */
+	public static final int DIRECTION_RECEIVE = 2;
+
+	private static final int STRIDE = 3;
+	private static final int FILE_SIZE = 0;
+	private static final int TRANSFERRED_SIZE = 1;
+	private static final int STATE = 2;
+
+	private final String[] fileIds;
+	private final long[] values;
+
+	/* Constructed by the native layer only */
+	FileTransfers(String[] fileIds, long[] values) {
+		this.fileIds = fileIds;
+		this.values = values;
+	}
+
+	/**
+	 * Get the number of file transmissions in the snapshot.
+	 *
+	 * @return
+	 * 		The number of file transmissions
+	 */
+	public int size() {
+		return fileIds.length;
+	}
+
+	/**
+	 * Get the file id of a transmission.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The file id
+	 */
+	public String getFileId(int index) {
+		return fileIds[index];
+	}
+
+	/**
+	 * Get the total size of the file of a transmission.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The file size in bytes
+	 */
+	public long getFileSize(int index) {
+		return values[index * STRIDE + FILE_SIZE];
+	}
+
+	/**
+	 * Get the number of bytes transferred so far.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The transferred size in bytes
+	 */
+	public long getTransferredSize(int index) {
+		return values[index * STRIDE + TRANSFERRED_SIZE];
+	}
+
+	/**
+	 * Get the status of a transmission.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		One of the STATUS_* constants
+	 */
+	public int getStatus(int index) {
+		return (int)(values[index * STRIDE + STATE] & 0xff);
+	}
+
+	/**
+	 * Get which side paused a transmission.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		One of the PAUSED_* constants
+	 */
+	public int getPaused(int index) {
+		return (int)((values[index * STRIDE + STATE] >>> 8) & 0xff);
+	}
+
+	/**
+	 * Get the direction of a transmission.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		One of the DIRECTION_* constants
+	 */
+	public int getDirection(int index) {
+		return (int)((values[index * STRIDE + STATE] >>> 16) & 0xff);
+	}
+
+	/**
+	 * Get the friend number of the peer of a transmission.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The friend number
+	 */
+	public int getFriendNumber(int index) {
+		return (int)(values[index * STRIDE + STATE] >>> 32);
+	}
+}
@@ -64,6 +64,19 @@ public class FriendInfo extends UserInfo {
 		connection = ConnectionStatus.Disconnected;
 	}
 
+	/*
+	 * Construct with all fields at once. Only used by the native layer and
+	 * FriendsSnapshot.
+	 */
+	FriendInfo(String userId, String name, String description, String gender,
+			   String phone, String email, String region, boolean hasAvatar,
+			   String label, int presence, int connection) {
+		super(userId, name, description, gender, phone, email, region, hasAvatar);
+		this.label = label;
+		this.presence = PresenceStatus.valueOf(presence);
+		this.connection = ConnectionStatus.valueOf(connection);
+	}
+
 	/**
 	 * Set friend's label name.
 	 *
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier;
+
+import java.nio.charset.Charset;
+import java.util.AbstractList;
+import java.util.RandomAccess;
+
+/**
+ * An immutable snapshot of the friend list, packed by the native layer into
+ * one byte array. FriendInfo objects are only built for the entries that
+ * are actually accessed.
+ *
+ * Each record starts at offsets[i] and holds status, presence and avatar
+ * flag as one byte each, followed by userid, label, name, description,
+ * gender, phone, email and region, each as a one byte length and that many
+ * UTF-8 bytes.
+ */
+public final class FriendsSnapshot extends AbstractList<FriendInfo> implements RandomAccess {
+	private static final Charset UTF8 = Charset.forName("UTF-8");
+
+	private static final int FIELD_USERID = 0;
+	private static final int FIELD_LABEL = 1;
+	private static final int FIELD_NAME = 2;
+	private static final int FIELD_DESCRIPTION = 3;
+	private static final int FIELD_GENDER = 4;
+	private static final int FIELD_PHONE = 5;
+	private static final int FIELD_EMAIL = 6;
+	private static final int FIELD_REGION = 7;
+	private static final int HEADER_LEN = 3;
+
+	private final byte[] data;
+	private final int[] offsets;
+	private final FriendInfo[] decoded;
+
+	/* Constructed by the native layer only */
+	FriendsSnapshot(byte[] data, int[] offsets) {
+		this.data = data;
+		this.offsets = offsets;
+		this.decoded = new FriendInfo[offsets.length];
+	}
+
+	@Override
+	public int size() {
+		return offsets.length;
+	}
+
+	/**
+	 * Get the friend information at the given position, decoding it on first
+	 * access.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The friend information
+	 */
+	@Override
+	public FriendInfo get(int index) {
+		FriendInfo info = decoded[index];
+		if (info == null) {
+			info = decode(index);
+			decoded[index] = info;
+		}
+		return info;
+	}
+
+	/**
+	 * Get the user id of a friend without decoding the whole record.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The user id of the friend
+	 */
+	public String getUserId(int index) {
+		return getString(offsets[index], FIELD_USERID);
+	}
+
+	/**
+	 * Get the connection status of a friend without decoding the whole record.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The connection status of the friend
+	 */
+	public ConnectionStatus getConnectionStatus(int index) {
+		return ConnectionStatus.valueOf(data[offsets[index]] & 0xff);
+	}
+
+	/**
+	 * Get the presence status of a friend without decoding the whole record.
+	 *
+	 * @param
+	 * 		index		The position in the snapshot
+	 *
+	 * @return
+	 * 		The presence status of the friend
+	 */
+	public PresenceStatus getPresence(int index) {
+		return PresenceStatus.valueOf(data[offsets[index] + 1] & 0xff);
+	}
+
+	private int fieldOffset(int record, int field) {
+		int pos = record + HEADER_LEN;
+		for (int i = 0; i < field; i++)
+			pos += 1 + (data[pos] & 0xff);
+		return pos;
+	}
+
+	private String getString(int record, int field) {
+		int pos = fieldOffset(record, field);
+		return new String(data, pos + 1, data[pos] & 0xff, UTF8);
+	}
+
+	private FriendInfo decode(int index) {
+		int record = offsets[index];
+		int pos = record + HEADER_LEN;
+		String[] fields = new String[FIELD_REGION + 1];
+
+		for (int i = 0; i < fields.length; i++) {
+			int len = data[pos] & 0xff;
+			fields[i] = new String(data, pos + 1, len, UTF8);
+			pos += 1 + len;
+		}
+
+		return new FriendInfo(fields[FIELD_USERID], fields[FIELD_NAME],
+				fields[FIELD_DESCRIPTION], fields[FIELD_GENDER], fields[FIELD_PHONE],
+				fields[FIELD_EMAIL], fields[FIELD_REGION], data[record + 2] != 0,
+				fields[FIELD_LABEL], data[record + 1] & 0xff, data[record] & 0xff);
+	}
+}
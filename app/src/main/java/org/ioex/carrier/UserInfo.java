@@ -98,6 +98,22 @@ public class UserInfo {
 
 	protected UserInfo() {}
 
+	/*
+	 * Construct with all fields at once. Only used by the native layer, which
+	 * passes values already bounded by the carrier limits.
+	 */
+	UserInfo(String userId, String name, String description, String gender,
+			 String phone, String email, String region, boolean hasAvatar) {
+		this.userId = userId;
+		this.name = name;
+		this.description = description;
+		this.gender = gender;
+		this.phone = phone;
+		this.email = email;
+		this.region = region;
+		this.hasAvatar = hasAvatar;
+	}
+
 	/**
 	 * Set user ID.
 	 *
@@ -51,27 +51,26 @@ public class AddressInfo {
 	private InetSocketAddress addr;
 	private InetSocketAddress relatedAddr;
 
-	public CandidateType getCandidateType() {
-		return type;
+	/*
+	 * Only constructed by the native layer, relatedHost is null when the
+	 * candidate has no related address.
+	 */
+	AddressInfo(int type, String host, int port, String relatedHost, int relatedPort) {
+		this.type = CandidateType.valueOf(type);
+		this.addr = new InetSocketAddress(host, port);
+		if (relatedHost != null)
+			this.relatedAddr = new InetSocketAddress(relatedHost, relatedPort);
 	}
 
-	void setCandidateType(int type) {
-		this.type = CandidateType.valueOf(type);
+	public CandidateType getCandidateType() {
+		return type;
 	}
 
 	public InetSocketAddress getAddress() {
 		return addr;
 	}
 
-	void setAddress(InetSocketAddress addr) {
-		this.addr = addr;
-	}
-
 	public InetSocketAddress getRelatedAddress() {
 		return relatedAddr;
 	}
-
-	void setRelatedAddress(InetSocketAddress addr) {
-		this.relatedAddr = addr;
-	}
 }
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier.session;
+
+/**
+ * Send queue counters of one channel, see {@link Stream#setSendQueue}.
+ *
+ * Frames that went out at once count with no delay; the delay of a queued
+ * frame runs from when it was queued until its last byte was sent.
+ */
+public final class ChannelQueueStats {
+    /* Same order as the native counters in sendQueue.h */
+    static final int QUEUED_BYTES = 0;
+    static final int FRAMES = 1;
+    static final int DELAYED_FRAMES = 2;
+    static final int TOTAL_DELAY = 3;
+    static final int MAX_DELAY = 4;
+    static final int THROTTLED_TIME = 5;
+    static final int COUNT = 6;
+
+    private final long[] values;
+
+    ChannelQueueStats(long[] values) {
+        this.values = values;
+    }
+
+    /**
+     * Get the number of bytes queued and not yet sent.
+     *
+     * @return
+     *      The queued byte count.
+     */
+    public long getQueuedBytes() {
+        return values[QUEUED_BYTES];
+    }
+
+    /**
+     * Get the number of frames sent on the channel.
+     *
+     * @return
+     *      The sent frame count.
+     */
+    public long getFrames() {
+        return values[FRAMES];
+    }
+
+    /**
+     * Get the number of sent frames that waited in the queue.
+     *
+     * @return
+     *      The delayed frame count.
+     */
+    public long getDelayedFrames() {
+        return values[DELAYED_FRAMES];
+    }
+
+    /**
+     * Get the average queueing delay over all sent frames.
+     *
+     * @return
+     *      The average delay in nanoseconds.
+     */
+    public long getAverageDelayNanos() {
+        return values[FRAMES] > 0 ? values[TOTAL_DELAY] / values[FRAMES] : 0;
+    }
+
+    /**
+     * Get the longest queueing delay of a sent frame.
+     *
+     * @return
+     *      The maximum delay in nanoseconds.
+     */
+    public long getMaxDelayNanos() {
+        return values[MAX_DELAY];
+    }
+
+    /**
+     * Get how long rate limits have held back data queued for the channel.
+     *
+     * @return
+     *      The throttled time in nanoseconds.
+     */
+    public long getThrottledNanos() {
+        return values[THROTTLED_TIME];
+    }
+
+    @Override
+    public String toString() {
+        return String.format("ChannelQueueStats[queued:%d bytes, frames:%d, delayed:%d, "
+                + "avgDelay:%dns, maxDelay:%dns, throttled:%dns]",
+                getQueuedBytes(), getFrames(), getDelayedFrames(), getAverageDelayNanos(),
+                getMaxDelayNanos(), getThrottledNanos());
+    }
+}
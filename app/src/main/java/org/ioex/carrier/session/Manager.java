@@ -44,6 +44,9 @@
 
 package org.ioex.carrier.session;
 
+import java.util.HashMap;
+import java.util.Map;
+
 import org.ioex.carrier.Carrier;
 import org.ioex.carrier.Log;
 import org.ioex.carrier.exceptions.IOEXException;
@@ -54,7 +57,7 @@ import org.ioex.carrier.exceptions.IOEXException;
 public class Manager {
     private static final String TAG = "SessionMgr";
 
-    private static Manager sessionMgr;
+    private static final Map<Carrier, Manager> sessionMgrs = new HashMap<Carrier, Manager>();
 
     private Carrier carrier;
     private boolean didCleanup;
@@ -102,35 +105,62 @@ public class Manager {
     public static Manager getInstance(Carrier carrier, ManagerHandler handler)
 			throws IOEXException {
 
-        if (sessionMgr != null && sessionMgr.carrier != carrier) {
-            sessionMgr.cleanup();
-        }
+        if (carrier == null)
+            throw new IllegalArgumentException();
 
-        if (sessionMgr == null) {
-            if (carrier == null)
-                throw new IllegalArgumentException();
+        synchronized (sessionMgrs) {
+            Manager sessionMgr = sessionMgrs.get(carrier);
 
-            Log.d(TAG, "Attempt to create carrier session manager instance ...");
+            if (sessionMgr == null) {
+                Log.d(TAG, "Attempt to create carrier session manager instance ...");
 
-            if (!native_init(carrier, handler))
-                throw new IOEXException(get_error_code());
+                if (!native_init(carrier, handler))
+                    throw new IOEXException(get_error_code());
 
-            sessionMgr = new Manager(carrier);
+                sessionMgr = new Manager(carrier);
+                sessionMgrs.put(carrier, sessionMgr);
 
-            Log.d(TAG, "Carrier session manager instance created");
-        }
+                Log.d(TAG, "Carrier session manager instance created");
+            }
 
-        return sessionMgr;
+            return sessionMgr;
+        }
     }
 
     /**
-     * Get a carrier session manager instance.
+     * Get the carrier session manager instance of the singleton carrier node.
      *
      * @return
      * 		A carrier session manager or null
      */
     public static Manager getInstance() {
-        return sessionMgr;
+        Carrier carrier = Carrier.getInstance();
+        if (carrier == null)
+            return null;
+
+        synchronized (sessionMgrs) {
+            return sessionMgrs.get(carrier);
+        }
+    }
+
+    /**
+     * Clean up the carrier session manager of a carrier node, if it has one.
+     *
+     * Carrier.kill() calls this, so that no session manager outlives its
+     * carrier node.
+     *
+     * @param
+     * 		carrier		Carrier node instance
+     */
+    public static void cleanupInstance(Carrier carrier) {
+        Manager sessionMgr;
+
+        synchronized (sessionMgrs) {
+            sessionMgr = sessionMgrs.get(carrier);
+        }
+
+        if (sessionMgr != null)
+            sessionMgr.cleanup();
     }
 
     private Manager(Carrier carrier) {
@@ -149,9 +179,13 @@ public class Manager {
      */
     public synchronized void cleanup() {
         if (!didCleanup) {
+            synchronized (sessionMgrs) {
+                if (sessionMgrs.get(carrier) == this)
+                    sessionMgrs.remove(carrier);
+            }
+
             native_cleanup(carrier);
 			carrier = null;
-            Manager.sessionMgr = null;
             didCleanup = true;
         }
     }
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier.session;
+
+import java.nio.ByteBuffer;
+
+/**
+ * The stream handler interface to receive incoming data in pooled buffers.
+ *
+ * After Stream.setReceiveBufferPool() is called on a stream whose handler
+ * implements this interface, incoming stream and channel data is reported
+ * through the ByteBuffer variants below instead of the byte[] ones.
+ *
+ * The data occupies [0, length) of the buffer; the buffer's position and limit
+ * are not meaningful. A pooled buffer must be handed back with
+ * Stream.recycleBuffer() once the application is done with it, otherwise the
+ * pool drains and later packets fall back to freshly allocated heap buffers.
+ */
+public interface PooledStreamHandler extends StreamHandler {
+    /**
+     * The callback will be called when the stream receives incoming packet.
+     *
+     * @param
+     *      stream      The carrier stream instance
+     * @param
+     *      data        The buffer holding the received packet data
+     * @param
+     *      length      The length of received packet data
+     */
+    void onStreamData(Stream stream, ByteBuffer data, int length);
+
+    /**
+     * The callback functiont to be called when channel received incoming data.
+     *
+     * @param
+     *      stream      The carrier stream instance
+     * @param
+     *      channel     The current channel ID
+     * @param
+     *      data        The buffer holding the received data
+     * @param
+     *      length      The length of received data
+     *
+     * @return
+     *      True on success, or false if an error occurred.
+     *      If this callback return false, the channel will be closed
+     *      with CloseReason_Error.
+     */
+    boolean onChannelData(Stream stream, int channel, ByteBuffer data, int length);
+}
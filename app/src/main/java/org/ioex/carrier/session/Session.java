@@ -44,6 +44,9 @@
 
 package org.ioex.carrier.session;
 
+import java.util.ArrayList;
+import java.util.List;
+
 import org.ioex.carrier.Log;
 import org.ioex.carrier.exceptions.IOEXException;
 
@@ -58,6 +61,9 @@ public class Session {
     private String to;  // with whom being conversation.
     private boolean didClose;
 
+    private final List<Stream> streams = new ArrayList<Stream>();
+    private final StreamStats removedStats = new StreamStats();
+
     /* Jni native methods. */
     private native void session_close();
     private native boolean native_request(SessionRequestCompleteHandler handler);
@@ -90,9 +96,19 @@ public class Session {
 
             Log.d(TAG, "Closing session with " + to + " ...");
 
+            synchronized (streams) {
+                for (Stream stream : streams)
+                    stream.releaseSendQueue();
+            }
+
             session_close();
             didClose = true;
 
+            synchronized (streams) {
+                for (Stream stream : streams)
+                    stream.closeContext();
+            }
+
             Log.d(TAG, "Session with " + to + " closed");
         }
     }
@@ -223,6 +239,10 @@ public class Session {
         if (stream == null)
             throw new IOEXException(get_error_code());
 
+        synchronized (streams) {
+            streams.add(stream);
+        }
+
         Log.d(TAG, String.format("Stream %d with %s type created", stream.getStreamId(), type.name()));
 
         return stream;
@@ -242,13 +262,42 @@ public class Session {
         if (stream == null)
 			throw new IllegalArgumentException();
 
-        if (!remove_stream(stream.getStreamId(), stream))
-            throw new IOEXException(get_error_code());
+        // Snapshot, native removal and list update share the streams lock so
+        // getStats() counts the stream exactly once, live or removed.
+        synchronized (streams) {
+            long[] values = new long[StreamStats.COUNT];
+            boolean counted = stream.readStats(values);
+
+            if (!remove_stream(stream.getStreamId(), stream))
+                throw new IOEXException(get_error_code());
 
+            if (streams.remove(stream) && counted)
+                removedStats.add(values);
+        }
 
         Log.d(TAG, "Stream " + stream.getStreamId() + " was removed from session");
     }
 
+    /**
+     * Get the traffic counters summed over all streams of the session,
+     * including the streams already removed.
+     *
+     * @return
+     *      The snapshot of the session counters.
+     */
+    public StreamStats getStats() {
+        long[] values = new long[StreamStats.COUNT];
+
+        synchronized (streams) {
+            StreamStats total = new StreamStats(removedStats.values().clone());
+            for (Stream stream : streams) {
+                if (stream.readStats(values))
+                    total.add(values);
+            }
+            return total;
+        }
+    }
+
     /**
      * Add a new portforwarding service to session.
      *
@@ -44,6 +44,9 @@
 
 package org.ioex.carrier.session;
 
+import java.nio.ByteBuffer;
+import java.util.Arrays;
+
 import org.ioex.carrier.Log;
 import org.ioex.carrier.exceptions.IOEXException;
 
@@ -65,13 +68,17 @@ public class Stream {
     public static int PROPERTY_MULTIPLEXING = 0x08;
     public static int PROPERTY_PORT_FORWARDING = 0x10;
 
+    public static final int MAX_CHANNEL_PRIORITY = 7;
+    public static final int MAX_CHANNEL_WEIGHT = 64;
+
+    /* Channel argument of set_rate_limit for the stream as a whole */
+    private static final int WHOLE_STREAM = -1;
+
     /* Jni native methods */
-    private native boolean get_transport_info(int streamId, TransportInfo info);
-    private native int write_stream_data(int streamId, byte[] data, int offset, int len);
+    private native TransportInfo get_transport_info(int streamId);
 
     private native int open_channel(int streamId, String cookie);
     private native boolean close_channel(int streamId, int channel);
-    private native int write_channel_data(int streamId, int channel, byte[] data, int offset, int len);
     private native boolean pend_channel(int streamId, int channel);
     private native boolean resume_channel(int streamId, int channel);
 
@@ -80,6 +87,39 @@ public class Stream {
                                             String host, String port);
     private native boolean close_port_forwarding(int streamId, int portForwarding);
 
+    private native boolean set_receive_pool(int bufferSize, int count);
+    private native boolean recycle_buffer(ByteBuffer buffer);
+    private native boolean set_data_batching(int maxBytes, int maxCount, int maxDelayMs);
+    private native long[] get_receive_pool_stats();
+    private native boolean get_stats(long[] stats);
+    private native boolean set_send_queue(int capacity, int lowWatermark, int highWatermark);
+    private native void release_send_queue();
+    private native long get_queued_bytes(int channel);
+    private native boolean is_channel_writable(int channel);
+    private native boolean set_channel_schedule(int channel, int priority, int weight);
+    private native boolean get_channel_queue_stats(int channel, long[] stats);
+    private native boolean set_rate_limit(int channel, long bytesPerSecond, int burst);
+
+    private native void close_context();
+    private native void release_context();
+
+    /*
+     * Writes take the native session and stream context handles directly so
+     * the hot path does not read them back from this object; channel 0 means
+     * the stream itself. They are instance methods all the same, keeping this
+     * object, and so the context it frees when collected, alive for the call.
+     */
+    private native int write_data(long session, long context, int streamId, int channel,
+                                  byte[] data, int offset, int len);
+    private native int write_direct(long session, long context, int streamId, int channel,
+                                    ByteBuffer data, int position, int limit);
+    private native int write_batch(long session, long context, int streamId,
+                                   int[] channels, byte[] data, int[] offsets,
+                                   int[] lengths, int[] written);
+    private native int write_batch_direct(long session, long context, int streamId,
+                                          int[] channels, ByteBuffer data, int[] offsets,
+                                          int[] lengths, int[] written);
+    private static native void set_global_rate_limit(long bytesPerSecond, int burst);
     private static native int get_error_code();
 
     private Stream(StreamType type) {
@@ -87,6 +127,12 @@ public class Stream {
         this.type = type;
     }
 
+    @Override
+    protected void finalize() throws Throwable {
+        release_context();
+        super.finalize();
+    }
+
     public int getStreamId() {
         return streamId;
     }
@@ -108,11 +154,9 @@ public class Stream {
      *      The transport info of this stream.
      */
     public TransportInfo getTransportInfo() throws IOEXException {
-        TransportInfo info = new TransportInfo();
-
-        if (!get_transport_info(streamId, info)) {
+        TransportInfo info = get_transport_info(streamId);
+        if (info == null)
             throw new IOEXException(get_error_code());
-        }
 
         return info;
     }
@@ -139,7 +183,7 @@ public class Stream {
         if (data == null || data.length == 0 || offset < 0 || len <= 0 || (offset + len) > data.length)
             throw new IllegalArgumentException();
 
-        int bytes = write_stream_data(streamId, data, offset, len);
+        int bytes = write_data(nativeCookie, contextCookie, streamId, 0, data, offset, len);
         if (bytes < 0)
             throw new IOEXException(get_error_code());
 
@@ -189,6 +233,52 @@ public class Stream {
         return writeData(_data);
     }
 
+    /**
+     * Send outgoing data to remote peer.
+     *
+     * The bytes between the buffer's position and limit are sent. If the buffer
+     * is direct, its memory is handed to the native layer without being copied.
+     * On success the buffer's position is advanced by the number of bytes sent.
+     *
+     * If the stream is in multiplexing mode, application can not call this function
+     * to send data. If this function is called on multiplexing mode stream, it will
+     * throw exception.
+     *
+     * @param
+     *      data        The outgoing data
+     *
+     * @return
+     *      Bytes of data sent on success
+     *
+     * @throws
+     *      IOEXException
+     */
+    public int writeData(ByteBuffer data) throws IOEXException {
+        if (data == null || !data.hasRemaining())
+            throw new IllegalArgumentException();
+
+        int position = data.position();
+        int bytes;
+
+        if (data.isDirect()) {
+            bytes = write_direct(nativeCookie, contextCookie, streamId, 0, data, position,
+                                 data.limit());
+        } else if (data.hasArray()) {
+            bytes = write_data(nativeCookie, contextCookie, streamId, 0, data.array(),
+                               data.arrayOffset() + position, data.remaining());
+        } else {
+            byte[] _data = new byte[data.remaining()];
+            data.duplicate().get(_data);
+            bytes = write_data(nativeCookie, contextCookie, streamId, 0, _data, 0, _data.length);
+        }
+
+        if (bytes < 0)
+            throw new IOEXException(get_error_code());
+
+        data.position(position + bytes);
+        return bytes;
+    }
+
     /**
      * Open a new channel on multiplexing stream.
      *
@@ -258,7 +348,7 @@ public class Stream {
         if (channel <= 0 || data == null || data.length == 0 || offset < 0 || len <= 0 || (offset + len) > data.length)
             throw new IllegalArgumentException();
 
-        int result = write_channel_data(streamId, channel, data, offset, len);
+        int result = write_data(nativeCookie, contextCookie, streamId, channel, data, offset, len);
         if (result < 0)
             throw new IOEXException(get_error_code());
 
@@ -282,6 +372,50 @@ public class Stream {
         return writeData(channel, data, 0, data.length);
     }
 
+    /**
+     * Send outgoing data to remote peer.
+     *
+     * The bytes between the buffer's position and limit are sent. If the buffer
+     * is direct, its memory is handed to the native layer without being copied.
+     * On success the buffer's position is advanced by the number of bytes sent.
+     *
+     * If the stream is not multiplexing this function will throw exception.
+     *
+     * @param
+     *      channel     [in] The channel ID
+     * @param
+     *      data        [in] The outgoing data
+     *
+     * @return
+     *      Bytes of data sent on success.
+     */
+    public int writeData(int channel, ByteBuffer data) throws IOEXException {
+        if (channel <= 0 || data == null || !data.hasRemaining())
+            throw new IllegalArgumentException();
+
+        int position = data.position();
+        int result;
+
+        if (data.isDirect()) {
+            result = write_direct(nativeCookie, contextCookie, streamId, channel, data, position,
+                                  data.limit());
+        } else if (data.hasArray()) {
+            result = write_data(nativeCookie, contextCookie, streamId, channel, data.array(),
+                                data.arrayOffset() + position, data.remaining());
+        } else {
+            byte[] _data = new byte[data.remaining()];
+            data.duplicate().get(_data);
+            result = write_data(nativeCookie, contextCookie, streamId, channel, _data, 0,
+                                _data.length);
+        }
+
+        if (result < 0)
+            throw new IOEXException(get_error_code());
+
+        data.position(position + result);
+        return result;
+    }
+
      /**
      * Send outgoing data to remote peer.
      *
@@ -302,6 +436,77 @@ public class Stream {
         return writeData(channel, _data);
     }   
 
+    /**
+     * Send a batch of frames to the channels of the stream in one call.
+     *
+     * Frame i is the lengths[i] bytes of the buffer starting at the absolute
+     * index offsets[i], and is sent to channels[i]. The buffer's position and
+     * limit are neither used nor changed. The batch stops at the first frame
+     * the transport would block on or accepts only partially; the frames
+     * after it are not sent.
+     *
+     * If the stream is not multiplexing this function will throw exception.
+     *
+     * @param
+     *      channels    [in] The channel ID of each frame
+     * @param
+     *      data        [in] The buffer holding the frames
+     * @param
+     *      offsets     [in] The start index of each frame in the buffer
+     * @param
+     *      lengths     [in] The length of each frame
+     *
+     * @return
+     *      Bytes sent of each frame that went out. The array is shorter than
+     *      channels if the batch stopped early, and its last entry is less
+     *      than the frame length if that frame was sent partially.
+     *
+     * @throws
+     *      IOEXException
+     */
+    public int[] writeChannelBatch(int[] channels, ByteBuffer data, int[] offsets, int[] lengths)
+            throws IOEXException {
+        if (channels == null || data == null || offsets == null || lengths == null
+                || channels.length == 0 || offsets.length != channels.length
+                || lengths.length != channels.length)
+            throw new IllegalArgumentException();
+
+        for (int i = 0; i < channels.length; i++) {
+            if (channels[i] <= 0 || offsets[i] < 0 || lengths[i] <= 0
+                    || offsets[i] > data.capacity() - lengths[i])
+                throw new IllegalArgumentException();
+        }
+
+        int[] written = new int[channels.length];
+        int count;
+
+        if (data.isDirect()) {
+            count = write_batch_direct(nativeCookie, contextCookie, streamId, channels, data,
+                                       offsets, lengths, written);
+        } else if (data.hasArray()) {
+            int[] _offsets = offsets;
+            if (data.arrayOffset() != 0) {
+                _offsets = new int[offsets.length];
+                for (int i = 0; i < offsets.length; i++)
+                    _offsets[i] = data.arrayOffset() + offsets[i];
+            }
+            count = write_batch(nativeCookie, contextCookie, streamId, channels, data.array(),
+                                _offsets, lengths, written);
+        } else {
+            ByteBuffer _data = data.duplicate();
+            byte[] array = new byte[_data.capacity()];
+            _data.clear();
+            _data.get(array);
+            count = write_batch(nativeCookie, contextCookie, streamId, channels, array,
+                                offsets, lengths, written);
+        }
+
+        if (count < 0)
+            throw new IOEXException(get_error_code());
+
+        return count == written.length ? written : Arrays.copyOf(written, count);
+    }
+
     /**
      * Request remote peer to pend channel data sending.
      *
@@ -399,4 +604,336 @@ public class Stream {
 
         Log.d(TAG, String.format("Port forwarding %d closed nicely", portForwarding));
     }
+
+    /**
+     * Deliver incoming data in a pool of recycled direct buffers.
+     *
+     * The stream handler must implement PooledStreamHandler. The pool should
+     * be set up before the session is started, and can only be set once.
+     *
+     * @param
+     *      bufferSize  The size of each buffer, which bounds the largest packet
+     *                  that can be delivered from the pool
+     *      count       The number of buffers in the pool
+     *
+     * @throws
+     *      IOEXException
+     */
+    public void setReceiveBufferPool(int bufferSize, int count) throws IOEXException {
+        if (bufferSize <= 0 || count <= 0)
+            throw new IllegalArgumentException();
+
+        if (!set_receive_pool(bufferSize, count))
+            throw new IOEXException(get_error_code());
+
+        Log.d(TAG, String.format("Receive buffer pool (%d x %d bytes) set on stream %d",
+                count, bufferSize, streamId));
+    }
+
+    /**
+     * Hand a buffer received in PooledStreamHandler callbacks back to the pool.
+     *
+     * @param
+     *      buffer      The buffer received from the pooled callbacks
+     *
+     * @return
+     *      True if the buffer was returned to the pool, or false if it was not
+     *      a pooled buffer (for example, a heap buffer delivered on pool miss).
+     */
+    public boolean recycleBuffer(ByteBuffer buffer) {
+        if (buffer == null)
+            throw new IllegalArgumentException();
+
+        return buffer.isDirect() && recycle_buffer(buffer);
+    }
+
+    /**
+     * Get the number of packets delivered from the receive buffer pool.
+     *
+     * @return
+     *      The count of pool hits.
+     */
+    public long getReceiveBufferPoolHits() {
+        long[] stats = get_receive_pool_stats();
+        return stats != null ? stats[0] : 0;
+    }
+
+    /**
+     * Get the number of packets that could not be delivered from the receive
+     * buffer pool, either because it was exhausted or the packet did not fit.
+     *
+     * @return
+     *      The count of pool misses.
+     */
+    public long getReceiveBufferPoolMisses() {
+        long[] stats = get_receive_pool_stats();
+        return stats != null ? stats[1] : 0;
+    }
+
+    /**
+     * Get the traffic counters of the stream.
+     *
+     * @return
+     *      The snapshot of the stream counters.
+     *
+     * @throws
+     *      IOEXException
+     */
+    public StreamStats getStats() throws IOEXException {
+        long[] values = new long[StreamStats.COUNT];
+        if (!get_stats(values))
+            throw new IOEXException(get_error_code());
+
+        return new StreamStats(values);
+    }
+
+    boolean readStats(long[] values) {
+        return get_stats(values);
+    }
+
+    /**
+     * Deliver incoming stream data in batches instead of packet by packet.
+     *
+     * The stream handler must implement BatchStreamHandler. A batch is
+     * delivered as soon as it holds maxBytes bytes or maxCount packets, or
+     * maxDelayMs milliseconds after its first packet arrived, whichever comes
+     * first. The batching should be set up before the session is started,
+     * and can only be set once.
+     *
+     * @param
+     *      maxBytes    The byte threshold of one batch
+     *      maxCount    The packet count threshold of one batch
+     *      maxDelayMs  The longest time a packet waits in a batch, or 0 to
+     *                  deliver only on the byte and count thresholds
+     *
+     * @throws
+     *      IOEXException
+     */
+    public void setDataBatching(int maxBytes, int maxCount, int maxDelayMs) throws IOEXException {
+        if (maxBytes <= 0 || maxCount <= 0 || maxDelayMs < 0)
+            throw new IllegalArgumentException();
+
+        if (!set_data_batching(maxBytes, maxCount, maxDelayMs))
+            throw new IOEXException(get_error_code());
+
+        Log.d(TAG, String.format("Data batching (%d bytes, %d packets, %d ms) set on stream %d",
+                maxBytes, maxCount, maxDelayMs, streamId));
+    }
+
+    /**
+     * Queue writes natively while the transport is congested.
+     *
+     * Once set, a write to this stream or one of its channels is held in a
+     * native send queue when the peer has the channel pended, the transport
+     * would block, a rate limit holds it back or earlier data for the
+     * channel is still queued. The queued data goes out in order when the
+     * channel resumes, with the next write to it, or once rate limits allow.
+     * Writes then succeed as long as the queue of the channel has room for
+     * them, up to capacity bytes, and fail with IOEXException otherwise.
+     *
+     * If the stream handler implements WritabilityStreamHandler, it is told
+     * when a channel reaches highWatermark queued bytes and when it drains
+     * down to lowWatermark again.
+     *
+     * The queue can be set only once. Its byte budget and watermarks apply
+     * to each channel, and to the stream itself as channel 0.
+     *
+     * @param
+     *      capacity        The maximum bytes queued per channel
+     * @param
+     *      lowWatermark    The queued bytes at which a channel turns writable
+     * @param
+     *      highWatermark   The queued bytes at which a channel turns unwritable
+     *
+     * @throws
+     *      IOEXException
+     */
+    public void setSendQueue(int capacity, int lowWatermark, int highWatermark)
+            throws IOEXException {
+        if (capacity <= 0 || lowWatermark < 0 || lowWatermark > highWatermark
+                || highWatermark > capacity)
+            throw new IllegalArgumentException();
+
+        if (!set_send_queue(capacity, lowWatermark, highWatermark))
+            throw new IOEXException(get_error_code());
+
+        Log.d(TAG, String.format("Send queue (%d bytes, watermarks %d/%d) set on stream %d",
+                capacity, lowWatermark, highWatermark, streamId));
+    }
+
+    /*
+     * Drop the send queue and what it holds, so that the pacer no longer
+     * writes through a session that is being closed.
+     */
+    void releaseSendQueue() {
+        release_send_queue();
+    }
+
+    /*
+     * Stop delivering to the handler once the session is closed, and drop
+     * the native references that keep this object alive.
+     */
+    void closeContext() {
+        close_context();
+    }
+
+    /**
+     * Get the number of bytes queued for a channel and not yet sent.
+     *
+     * @param
+     *      channel     The channel ID, or 0 for the stream itself
+     *
+     * @return
+     *      The queued byte count, 0 if the stream has no send queue.
+     */
+    public long getQueuedBytes(int channel) {
+        if (channel < 0)
+            throw new IllegalArgumentException();
+
+        return get_queued_bytes(channel);
+    }
+
+    /**
+     * Check whether a channel is below the high watermark of the send queue.
+     *
+     * @param
+     *      channel     The channel ID, or 0 for the stream itself
+     *
+     * @return
+     *      False between reaching the high watermark and draining to the low
+     *      watermark, otherwise true.
+     */
+    public boolean isChannelWritable(int channel) {
+        if (channel < 0)
+            throw new IllegalArgumentException();
+
+        return is_channel_writable(channel);
+    }
+
+    /**
+     * Set how a channel shares the stream with the other channels while
+     * their writes are queued.
+     *
+     * Queued data of a higher priority channel always goes out before that
+     * of a lower priority one. Channels of the same priority take turns,
+     * each sending in proportion to its weight per turn. Channels start at
+     * priority 0 and weight 1, so a latency sensitive control channel is
+     * best given a higher priority than bulk channels.
+     *
+     * The send queue must be set before.
+     *
+     * @param
+     *      channel     The channel ID
+     * @param
+     *      priority    The priority, from 0 to MAX_CHANNEL_PRIORITY
+     * @param
+     *      weight      The weight, from 1 to MAX_CHANNEL_WEIGHT
+     *
+     * @throws
+     *      IOEXException
+     */
+    public void setChannelPriority(int channel, int priority, int weight) throws IOEXException {
+        if (channel <= 0 || priority < 0 || priority > MAX_CHANNEL_PRIORITY
+                || weight <= 0 || weight > MAX_CHANNEL_WEIGHT)
+            throw new IllegalArgumentException();
+
+        if (!set_channel_schedule(channel, priority, weight))
+            throw new IOEXException(get_error_code());
+    }
+
+    /**
+     * Get the send queue counters, queueing delays and throttled time of a
+     * channel.
+     *
+     * @param
+     *      channel     The channel ID, or 0 for the stream itself
+     *
+     * @return
+     *      The channel queue statistics.
+     *
+     * @throws
+     *      IOEXException
+     */
+    public ChannelQueueStats getChannelQueueStats(int channel) throws IOEXException {
+        if (channel < 0)
+            throw new IllegalArgumentException();
+
+        long[] stats = new long[ChannelQueueStats.COUNT];
+        if (!get_channel_queue_stats(channel, stats))
+            throw new IOEXException(get_error_code());
+
+        return new ChannelQueueStats(stats);
+    }
+
+    /**
+     * Pace everything sent on this stream, channels included, to a rate.
+     *
+     * Writes beyond the rate are not refused and do not block: they wait
+     * in the send queue and a native timer sends them once the limit allows,
+     * so the queue capacity bounds how far a writer can run ahead. Up to
+     * burst bytes may go out at once after the stream has been idle.
+     *
+     * The send queue must be set before.
+     *
+     * @param
+     *      bytesPerSecond  The rate in bytes per second, or 0 for no limit
+     * @param
+     *      burst           The largest burst in bytes
+     *
+     * @throws
+     *      IOEXException
+     */
+    public void setRateLimit(long bytesPerSecond, int burst) throws IOEXException {
+        if (bytesPerSecond < 0 || (bytesPerSecond > 0 && burst <= 0))
+            throw new IllegalArgumentException();
+
+        if (!set_rate_limit(WHOLE_STREAM, bytesPerSecond, burst))
+            throw new IOEXException(get_error_code());
+
+        Log.d(TAG, String.format("Rate limit (%d bytes/s, burst %d) set on stream %d",
+                bytesPerSecond, burst, streamId));
+    }
+
+    /**
+     * Pace a channel to a rate, on top of the limits of the stream and of
+     * the process, see {@link #setRateLimit}.
+     *
+     * The send queue must be set before.
+     *
+     * @param
+     *      channel         The channel ID
+     * @param
+     *      bytesPerSecond  The rate in bytes per second, or 0 for no limit
+     * @param
+     *      burst           The largest burst in bytes
+     *
+     * @throws
+     *      IOEXException
+     */
+    public void setChannelRateLimit(int channel, long bytesPerSecond, int burst)
+            throws IOEXException {
+        if (channel <= 0 || bytesPerSecond < 0 || (bytesPerSecond > 0 && burst <= 0))
+            throw new IllegalArgumentException();
+
+        if (!set_rate_limit(channel, bytesPerSecond, burst))
+            throw new IOEXException(get_error_code());
+    }
+
+    /**
+     * Pace what all streams of the process send together to a rate.
+     *
+     * The limit is shared by the streams with a send queue set, see
+     * {@link #setSendQueue}; streams without one are not paced.
+     *
+     * @param
+     *      bytesPerSecond  The rate in bytes per second, or 0 for no limit
+     * @param
+     *      burst           The largest burst in bytes
+     */
+    public static void setGlobalRateLimit(long bytesPerSecond, int burst) {
+        if (bytesPerSecond < 0 || (bytesPerSecond > 0 && burst <= 0))
+            throw new IllegalArgumentException();
+
+        set_global_rate_limit(bytesPerSecond, burst);
+    }
 }
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2018 Elastos Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Copyright (c) 2019 ioeXNetwork
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+package org.ioex.carrier.session;
+
+/**
+ * Traffic counters of a stream, or the sum over all streams of a session.
+ *
+ * Counters are kept natively with atomic updates and read in one call, so
+ * a snapshot is cheap enough to poll. They start at zero when the stream
+ * is added and are never reset.
+ */
+public final class StreamStats {
+    /* Same order as the native counters in streamContext.h */
+    static final int BYTES_IN = 0;
+    static final int PACKETS_IN = 1;
+    static final int BYTES_OUT = 2;
+    static final int PACKETS_OUT = 3;
+    static final int PARTIAL_WRITES = 4;
+    static final int WRITE_ERRORS = 5;
+    static final int CALLBACK_ERRORS = 6;
+    static final int PENDS = 7;
+    static final int RESUMES = 8;
+    static final int QUEUED_WRITES = 9;
+    static final int COUNT = 10;
+
+    private final long[] values;
+
+    StreamStats() {
+        this.values = new long[COUNT];
+    }
+
+    StreamStats(long[] values) {
+        this.values = values;
+    }
+
+    void add(long[] other) {
+        for (int i = 0; i < COUNT; i++)
+            values[i] += other[i];
+    }
+
+    long[] values() {
+        return values;
+    }
+
+    /**
+     * Get the number of bytes received, on the stream and all its channels.
+     *
+     * @return
+     *      The received byte count.
+     */
+    public long getBytesIn() {
+        return values[BYTES_IN];
+    }
+
+    /**
+     * Get the number of packets received, on the stream and all its channels.
+     *
+     * @return
+     *      The received packet count.
+     */
+    public long getPacketsIn() {
+        return values[PACKETS_IN];
+    }
+
+    /**
+     * Get the number of bytes accepted by writeData().
+     *
+     * @return
+     *      The written byte count.
+     */
+    public long getBytesOut() {
+        return values[BYTES_OUT];
+    }
+
+    /**
+     * Get the number of successful writeData() calls.
+     *
+     * @return
+     *      The written packet count.
+     */
+    public long getPacketsOut() {
+        return values[PACKETS_OUT];
+    }
+
+    /**
+     * Get the number of writes that accepted fewer bytes than requested.
+     *
+     * @return
+     *      The partial write count.
+     */
+    public long getPartialWrites() {
+        return values[PARTIAL_WRITES];
+    }
+
+    /**
+     * Get the number of writes that failed.
+     *
+     * @return
+     *      The write error count.
+     */
+    public long getWriteErrors() {
+        return values[WRITE_ERRORS];
+    }
+
+    /**
+     * Get the number of data callbacks that could not be delivered to the
+     * stream handler or threw.
+     *
+     * @return
+     *      The callback error count.
+     */
+    public long getCallbackErrors() {
+        return values[CALLBACK_ERRORS];
+    }
+
+    /**
+     * Get the number of channel pend events, requested locally or by the
+     * peer.
+     *
+     * @return
+     *      The pend event count.
+     */
+    public long getPends() {
+        return values[PENDS];
+    }
+
+    /**
+     * Get the number of channel resume events, requested locally or by the
+     * peer.
+     *
+     * @return
+     *      The resume event count.
+     */
+    public long getResumes() {
+        return values[RESUMES];
+    }
+
+    /**
+     * Get the number of channel writes held in the send queue, in whole or
+     * in part, instead of going out at once.
+     *
+     * @return
+     *      The queued write count.
+     */
+    public long getQueuedWrites() {
+        return values[QUEUED_WRITES];
+    }
+
+    @Override
+    public String toString() {
+        return String.format("StreamStats[in:%d bytes/%d packets, out:%d bytes/%d packets, "
+                + "partialWrites:%d, writeErrors:%d, callbackErrors:%d, pends:%d, resumes:%d, "
+                + "queuedWrites:%d]",
+                getBytesIn(), getPacketsIn(), getBytesOut(), getPacketsOut(), getPartialWrites(),
+                getWriteErrors(), getCallbackErrors(), getPends(), getResumes(),
+                getQueuedWrites());
+    }
+}
@@ -51,27 +51,22 @@ public class TransportInfo {
 	private AddressInfo localAddr;
 	private AddressInfo remoteAddr;
 
-	public NetworkTopology getTopology() {
-		return topology;
+	/* Only constructed by the native layer */
+	TransportInfo(int topology, AddressInfo localAddr, AddressInfo remoteAddr) {
+		this.topology = NetworkTopology.valueOf(topology);
+		this.localAddr = localAddr;
+		this.remoteAddr = remoteAddr;
 	}
 
-	void setTopology(int topology) {
-		this.topology = NetworkTopology.valueOf(topology);
+	public NetworkTopology getTopology() {
+		return topology;
 	}
 
 	public AddressInfo getLocalAddressInfo() {
 		return localAddr;
 	}
 
-	void setLocalAddressInfo(AddressInfo addrInfo) {
-		this.localAddr = addrInfo;
-	}
-
 	public AddressInfo getRemoteAddressInfo() {
 		return remoteAddr;
 	}
-
-	void setRemoteAddressInfo(AddressInfo addrInfo) {
-		this.remoteAddr = addrInfo;
-	}
 }